@@ -0,0 +1,132 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      ad_parser.h
+ *
+ *  DESCRIPTION
+ *      This file contains prototypes for parsing the AD structures of
+ *      advertising and scan response data in a single pass.
+ *
+ *****************************************************************************/
+
+#ifndef __AD_PARSER_H__
+#define __AD_PARSER_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Maximum number of AD types that can be looked up by AdFindTypes() */
+#define AD_MAX_FIND_TYPES               (16)
+
+/* Check whether the AD type at 'index' in the list passed to AdFindTypes() was
+ * found, given the mask returned by AdFindTypes()
+ */
+#define AD_TYPE_FOUND(mask, index)      (((mask) & (1 << (index))) != 0)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Data of one AD structure. The data is referenced in place in the report and
+ * must not be used after the report buffer has been released.
+ */
+typedef struct _AD_FIELD_T
+{
+    /* AD type of the structure */
+    uint16                      ad_type;
+
+    /* First octet following the AD type */
+    const uint8                *p_data;
+
+    /* Number of octets following the AD type */
+    uint16                      length;
+
+} AD_FIELD_T;
+
+/* State of a walk over the AD structures of a report */
+typedef struct _AD_ITER_T
+{
+    /* Advertising or scan response data, one octet per element */
+    const uint8                *p_data;
+
+    /* Number of octets in the data */
+    uint16                      length;
+
+    /* Offset of the next AD structure */
+    uint16                      offset;
+
+} AD_ITER_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AdIterInit
+ *
+ *  DESCRIPTION
+ *      Prepare a walk over the AD structures of a report.
+ *
+ *  PARAMETERS
+ *      p_iter [out]            Walk state to initialise
+ *      p_data [in]             Advertising or scan response data
+ *      length [in]             Number of octets in the data
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void AdIterInit(AD_ITER_T *p_iter, const uint8 *p_data, uint16 length);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AdIterNext
+ *
+ *  DESCRIPTION
+ *      Return the next AD structure of the report. The walk ends at the end of
+ *      the data, at a zero length octet or at a structure that would overrun
+ *      the data.
+ *
+ *  PARAMETERS
+ *      p_iter [in/out]         Walk state
+ *      p_field [out]           Next AD structure
+ *
+ *  RETURNS
+ *      TRUE if an AD structure was returned, FALSE at the end of the data
+ *----------------------------------------------------------------------------*/
+extern bool AdIterNext(AD_ITER_T *p_iter, AD_FIELD_T *p_field);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AdFindTypes
+ *
+ *  DESCRIPTION
+ *      Look up several AD types in one walk over the report. For each AD type
+ *      in the list, the first matching AD structure is returned in the entry
+ *      with the same index in 'fields'. Nothing is copied out of the report.
+ *
+ *  PARAMETERS
+ *      p_data [in]             Advertising or scan response data
+ *      length [in]             Number of octets in the data
+ *      ad_types [in]           AD types to look for
+ *      fields [out]            AD structures found, one per AD type
+ *      num_types [in]          Number of AD types, up to AD_MAX_FIND_TYPES
+ *
+ *  RETURNS
+ *      Mask with bit n set if ad_types[n] was found
+ *----------------------------------------------------------------------------*/
+extern uint16 AdFindTypes(const uint8 *p_data, uint16 length,
+                          const uint16 *ad_types, AD_FIELD_T *fields,
+                          uint16 num_types);
+
+#endif /* __AD_PARSER_H__ */
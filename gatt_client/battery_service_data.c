@@ -112,9 +112,13 @@ SERVICE_FUNC_POINTERS_T BatteryServiceFuncStore = {
     .writeConfirm           = &BatteryServiceWriteConfirm,
     .readRequest            = &BatteryServiceReadRequest,
     .readConfirm            = &BatteryServiceReadConfirm,
+    .readMultipleRequest    = NULL,
+    .readMultipleConfirm    = NULL,
     .configureService       = &BatteryServiceConfigure,
     .isServiceFound         = &BatteryServiceFound,
-    .resetServiceData       = &BatteryServiceResetData
+    .resetServiceData       = &BatteryServiceResetData,
+    .storeCache             = &BatteryServiceStoreCache,
+    .restoreCache           = &BatteryServiceRestoreCache
 };
 
 /*============================================================================*
@@ -726,9 +730,9 @@ bool BatteryServiceReadRequest(uint16 dev, uint16 type)
     /* Send the read request to the Server */
     
     /* Note that the maximum amount of data that may be transmitted in one PDU
-     * is limited to 22 octets (DEFAULT_ATT_MTU - 1) so any values longer than
-     * this will be truncated. See GattReadLongCharValue() in the Firmware API
-     * for a method to read longer values using multiple PDUs.
+     * is limited to 22 octets (DEFAULT_ATT_MTU - 1). A longer value is read
+     * again with the Read Long Characteristic Value procedure before the
+     * value is confirmed.
      */
     status = GattReadCharValue(g_bs_serv_data[dev].connect_handle, 
                       value_handle);
@@ -922,3 +926,105 @@ void BatteryServiceResetData(uint16 dev)
 {
     batteryDataInit(dev);
 }
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      BatteryServiceStoreCache
+ *
+ *  DESCRIPTION
+ *      Write the discovered service data for the specified device to its
+ *      discovery cache record.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to store service data for
+ *      p_cache [out]           Cache record of the service
+ *      size [in]               Number of words available for the record
+ *
+ *  RETURNS
+ *      Number of words written, or 0 if the record does not fit
+ *----------------------------------------------------------------------------*/
+uint16 BatteryServiceStoreCache(uint16 dev, uint16 *p_cache, uint16 size)
+{
+    uint16 char_num;            /* Loop counter */
+    /* Service data for the specified device */
+    const BATTERY_SERVICE_DATA_T *data = &g_bs_serv_data[dev];
+    /* Words in the record */
+    const uint16 words = GATT_CACHE_SERVICE_WORDS(data->total_char);
+
+    if(words > size)
+    {
+        return 0;
+    }
+
+    p_cache[0] = data->service_start_handle;
+    p_cache[1] = data->service_end_handle;
+    p_cache[2] = data->total_char;
+
+    for(char_num = 0; char_num < data->total_char; char_num++)
+    {
+        GattCacheStoreChar(&p_cache[GATT_CACHE_SERVICE_WORDS(char_num)],
+                           &data->chars[char_num],
+                           data->type[char_num]);
+    }
+
+    return words;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      BatteryServiceRestoreCache
+ *
+ *  DESCRIPTION
+ *      Restore the service data for the specified device from its discovery
+ *      cache record, in place of the Discovery Procedure.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to restore service data for
+ *      connect_handle [in]     Handle of connection with the device
+ *      p_cache [in]            Cache record of the service
+ *      size [in]               Number of words in the record
+ *
+ *  RETURNS
+ *      TRUE if the record is valid
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool BatteryServiceRestoreCache(uint16 dev,
+                                uint16 connect_handle,
+                                const uint16 *p_cache,
+                                uint16 size)
+{
+    uint16 char_num;            /* Loop counter */
+    uint16 type;                /* Characteristic type */
+    /* Service data for the specified device */
+    BATTERY_SERVICE_DATA_T *data = &g_bs_serv_data[dev];
+
+    batteryDataInit(dev);
+
+    if(size < GATT_CACHE_SERVICE_WORDS(0) ||
+       p_cache[2] > MAXIMUM_NUMBER_OF_CHARACTERISTIC ||
+       size != GATT_CACHE_SERVICE_WORDS(p_cache[2]))
+    {
+        return FALSE;
+    }
+
+    for(char_num = 0; char_num < p_cache[2]; char_num++)
+    {
+        type = GattCacheRestoreChar(
+                            &p_cache[GATT_CACHE_SERVICE_WORDS(char_num)],
+                            &data->chars[char_num]);
+        if(type >= battery_type_invalid)
+        {
+            batteryDataInit(dev);
+            return FALSE;
+        }
+
+        data->type[char_num] = type;
+    }
+
+    data->service_start_handle = p_cache[0];
+    data->service_end_handle   = p_cache[1];
+    data->total_char           = p_cache[2];
+    data->connect_handle       = connect_handle;
+
+    return TRUE;
+}
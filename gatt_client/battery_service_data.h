@@ -333,5 +333,46 @@ extern bool BatteryServiceFound(uint16 dev);
  *----------------------------------------------------------------------------*/
 extern void BatteryServiceResetData(uint16 dev);
 
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      BatteryServiceStoreCache
+ *
+ *  DESCRIPTION
+ *      Write the discovered service data to a discovery cache record.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to store service data for
+ *      p_cache [out]           Cache record of the service
+ *      size [in]               Number of words available for the record
+ *
+ *  RETURNS
+ *      Number of words written, or 0 if the record does not fit
+ *----------------------------------------------------------------------------*/
+extern uint16 BatteryServiceStoreCache(uint16 dev,
+                                       uint16 *p_cache,
+                                       uint16 size);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      BatteryServiceRestoreCache
+ *
+ *  DESCRIPTION
+ *      Restore the service data from a discovery cache record.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to restore service data for
+ *      connect_handle [in]     Handle of connection with the device
+ *      p_cache [in]            Cache record of the service
+ *      size [in]               Number of words in the record
+ *
+ *  RETURNS
+ *      TRUE if the record is valid
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool BatteryServiceRestoreCache(uint16 dev,
+                                       uint16 connect_handle,
+                                       const uint16 *p_cache,
+                                       uint16 size);
+
 #endif /* __BATTERY_SERVICE_DATA_H__ */
 
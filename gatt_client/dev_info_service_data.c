@@ -34,6 +34,21 @@
 /* Number of characteristics present in this service, range [1, 15] */
 #define MAXIMUM_NUMBER_OF_CHARACTERISTIC              (9)
 
+/* Sizes of the characteristic values which have a fixed size, in octets */
+#define DEV_INFO_SYSTEM_ID_SIZE                       (8)
+#define DEV_INFO_PNP_ID_SIZE                          (7)
+
+/* Largest number of characteristics read in one multiple read request: the
+ * two with values of a fixed size and one with a value of variable size,
+ * which must come last
+ */
+#define DEV_INFO_MAX_READ_MULTIPLE                    (3)
+
+/* Largest response to a multiple read request, in octets (DEFAULT_ATT_MTU
+ * - 1). A variable size value which fills it may have been truncated.
+ */
+#define DEV_INFO_READ_MULTIPLE_OCTETS                 (22)
+
 /*============================================================================*
  *  Private Data Types
  *===========================================================================*/
@@ -82,6 +97,24 @@ typedef struct _DEV_INFO_SERVICE_DATA_T
      * used in read/write/notify procedures.
      */
     dev_info_char_t type[MAXIMUM_NUMBER_OF_CHARACTERISTIC];   
+
+    /* Indices into chars array of the characteristics in the multiple read
+     * request, in the order their values are returned
+     */
+    uint16 multi_char[DEV_INFO_MAX_READ_MULTIPLE];
+
+    /* Number of entries in multi_char */
+    uint16 multi_count:2;
+
+    /* Flag set to 1 once a multiple read request has been sent, so that it
+     * is only sent once per connection
+     */
+    uint16 multi_sent:1;
+
+    /* Bit mask of indices into chars array of the characteristics whose
+     * values have been read by the multiple read request
+     */
+    uint16 multi_read_mask;
 } DEV_INFO_SERVICE_DATA_T;
 
 /*============================================================================*
@@ -113,9 +146,13 @@ SERVICE_FUNC_POINTERS_T DeviceInfoServiceFuncStore = {
     .writeConfirm           = NULL,
     .readRequest            = &DeviceInfoServiceReadRequest,
     .readConfirm            = &DeviceInfoServiceReadConfirm,
+    .readMultipleRequest    = &DeviceInfoServiceReadMultipleRequest,
+    .readMultipleConfirm    = &DeviceInfoServiceReadMultipleConfirm,
     .configureService       = NULL,
     .isServiceFound         = &DeviceInfoServiceFound,
-    .resetServiceData       = &DeviceInfoServiceResetData
+    .resetServiceData       = &DeviceInfoServiceResetData,
+    .storeCache             = &DeviceInfoServiceStoreCache,
+    .restoreCache           = &DeviceInfoServiceRestoreCache
 };
 
 /*============================================================================*
@@ -131,6 +168,9 @@ static bool deviceInfoCheckATTPermission(uint16           dev,
                                          uint16           permission,
                                          uint16          *count);
 
+/* Get the size of a characteristic value which has a fixed size */
+static uint16 deviceInfoFixedSize(dev_info_char_t type);
+
 /*============================================================================*
  *  Private Function Implementations
  *===========================================================================*/
@@ -160,6 +200,9 @@ static void deviceInfoDataInit(uint16 dev)
     data->service_end_handle   = INVALID_ATT_HANDLE;
     data->total_char           = 0; 
     data->curr_char            = 0;
+    data->multi_count          = 0;
+    data->multi_sent           = FALSE;
+    data->multi_read_mask      = 0;
 
     /* Reset characteristics array */
     MemSet(data->chars, 0x0, sizeof(data->chars));
@@ -227,6 +270,34 @@ static bool deviceInfoCheckATTPermission(uint16           dev,
     return TRUE;
 }
 
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      deviceInfoFixedSize
+ *
+ *  DESCRIPTION
+ *      Get the size of a characteristic value which has a fixed size.
+ *
+ *  PARAMETERS
+ *      type [in]               Characteristic to get the value size of
+ *
+ *  RETURNS
+ *      Size of the value in octets, or 0 if the value has a variable size
+ *----------------------------------------------------------------------------*/
+static uint16 deviceInfoFixedSize(dev_info_char_t type)
+{
+    switch(type)
+    {
+        case dev_info_sys_id:
+            return DEV_INFO_SYSTEM_ID_SIZE;
+
+        case dev_info_pnp_id:
+            return DEV_INFO_PNP_ID_SIZE;
+
+        default:
+            return 0;
+    }
+}
+
 /*============================================================================*
  *  Public Function Implementations
  *===========================================================================*/
@@ -613,6 +684,12 @@ bool DeviceInfoServiceReadRequest(uint16 dev, uint16 type)
         return FALSE;
     }
 
+    if(g_dis_data[dev].multi_read_mask & (1 << count))
+    {
+        /* The value has already been read by the multiple read request */
+        return FALSE;
+    }
+
     /* Check that the characteristic is supported by this service */
     value_handle = g_dis_data[dev].chars[count].valHandle;
     if (value_handle == INVALID_ATT_HANDLE)
@@ -626,9 +703,9 @@ bool DeviceInfoServiceReadRequest(uint16 dev, uint16 type)
     /* Send the read request to the Server */
     
     /* Note that the maximum amount of data that may be transmitted in one PDU
-     * is limited to 22 octets (DEFAULT_ATT_MTU - 1) so any values longer than
-     * this will be truncated. See GattReadLongCharValue() in the Firmware API
-     * for a method to read longer values using multiple PDUs.
+     * is limited to 22 octets (DEFAULT_ATT_MTU - 1). A longer value is read
+     * again with the Read Long Characteristic Value procedure before the
+     * value is confirmed.
      */
     status = GattReadCharValue(g_dis_data[dev].connect_handle, value_handle);
 
@@ -734,10 +811,8 @@ void DeviceInfoServiceReadConfirm(uint16 dev,
 
     /* Display the characteristic value received from the GATT Server. */
 
-    /* Note that the maximum amount of data that may be transmitted in one PDU
-     * is limited to 22 octets (DEFAULT_ATT_MTU - 1) so any values longer than
-     * this will be truncated. See GattReadLongCharValue() in the Firmware API
-     * for a method to read longer values using multiple PDUs.
+    /* The value is complete: a value longer than one PDU has already been
+     * reassembled from several reads.
      */
     DebugIfWriteString("\r\n               Value = 0x");
     for (;size > 0;size--)
@@ -746,6 +821,160 @@ void DeviceInfoServiceReadConfirm(uint16 dev,
     }
 }
 
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      DeviceInfoServiceReadMultipleRequest
+ *
+ *  DESCRIPTION
+ *      Initiate a GATT read request for the values of several characteristics
+ *      at once. Only the last value read this way may have a variable size,
+ *      so the request holds the readable characteristics with values of a
+ *      fixed size followed by the first readable one with a variable size.
+ *      It is sent once per connection, and only if it saves a request.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which to read characteristic values
+ *
+ *  RETURNS
+ *      TRUE if the request was sent, FALSE if the values are to be read one
+ *      at a time
+ *----------------------------------------------------------------------------*/
+bool DeviceInfoServiceReadMultipleRequest(uint16 dev)
+{
+    /* Service data for the specified device */
+    DEV_INFO_SERVICE_DATA_T *data = &g_dis_data[dev];
+    /* Value handles of the characteristics to read */
+    uint16 handles[DEV_INFO_MAX_READ_MULTIPLE];
+    /* Index into chars array of the first readable characteristic with a
+     * value of variable size
+     */
+    uint16 var_char = MAXIMUM_NUMBER_OF_CHARACTERISTIC;
+    uint16 char_num;            /* Loop counter */
+    uint16 status;              /* Function status */
+
+    if(data->multi_sent)
+    {
+        return FALSE;
+    }
+
+    data->multi_sent  = TRUE;
+    data->multi_count = 0;
+
+    for(char_num = 0; char_num < data->total_char; char_num++)
+    {
+        if(!(data->chars[char_num].properties & ATT_PERM_READ) ||
+           data->chars[char_num].valHandle == INVALID_ATT_HANDLE)
+        {
+            continue;
+        }
+
+        if(deviceInfoFixedSize(data->type[char_num]) != 0)
+        {
+            if(data->multi_count == DEV_INFO_MAX_READ_MULTIPLE - 1)
+            {
+                /* Leave room for the value of variable size */
+                continue;
+            }
+
+            handles[data->multi_count] = data->chars[char_num].valHandle;
+            data->multi_char[data->multi_count++] = char_num;
+        }
+        else if(var_char == MAXIMUM_NUMBER_OF_CHARACTERISTIC)
+        {
+            var_char = char_num;
+        }
+    }
+
+    if(data->multi_count == 0)
+    {
+        /* Nothing to gain over reading the values one at a time */
+        return FALSE;
+    }
+
+    if(var_char != MAXIMUM_NUMBER_OF_CHARACTERISTIC)
+    {
+        handles[data->multi_count] = data->chars[var_char].valHandle;
+        data->multi_char[data->multi_count++] = var_char;
+    }
+
+    if(data->multi_count < 2)
+    {
+        /* Nothing to gain over reading the value on its own */
+        return FALSE;
+    }
+
+    status = GattReadMultipleCharValues(data->connect_handle,
+                                        data->multi_count,
+                                        handles);
+
+    return (status == sys_status_success) ? TRUE : FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      DeviceInfoServiceReadMultipleConfirm
+ *
+ *  DESCRIPTION
+ *      Called when a multiple read request is successful. Each complete value
+ *      is handled as if it had been read on its own. A value of variable size
+ *      which fills the response may have been truncated, so it is left to be
+ *      read on its own.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which characteristic values were
+ *                              read
+ *      size [in]               Size of data returned, in octets
+ *      value [in]              Characteristic values, concatenated
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void DeviceInfoServiceReadMultipleConfirm(uint16 dev,
+                                          uint16 size,
+                                          uint8 *value)
+{
+    /* Service data for the specified device */
+    DEV_INFO_SERVICE_DATA_T *data = &g_dis_data[dev];
+    /* TRUE if the response is as long as it can be, so may have been cut */
+    const bool full = (size >= DEV_INFO_READ_MULTIPLE_OCTETS);
+    uint16 entry;               /* Loop counter */
+    uint16 char_num;            /* Index into chars array */
+    uint16 octets;              /* Size of current value */
+
+    for(entry = 0; entry < data->multi_count; entry++)
+    {
+        char_num = data->multi_char[entry];
+        octets   = deviceInfoFixedSize(data->type[char_num]);
+
+        if(octets == 0)
+        {
+            /* The last value takes the rest of the response. If the
+             * response is full, it may have been truncated, so leave it to be
+             * read on its own.
+             */
+            if(full)
+            {
+                break;
+            }
+
+            octets = size;
+        }
+        else if(octets > size)
+        {
+            /* The response is short. Read the values left on their own. */
+            break;
+        }
+
+        data->curr_char = char_num;
+        DeviceInfoServiceReadConfirm(dev, octets, value);
+
+        data->multi_read_mask |= (1 << char_num);
+
+        value += octets;
+        size  -= octets;
+    }
+}
+
 /*---------------------------------------------------------------------------
  *  NAME
  *      DeviceInfoServiceFound
@@ -790,3 +1019,105 @@ void DeviceInfoServiceResetData(uint16 dev)
 {
     deviceInfoDataInit(dev);
 }
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      DeviceInfoServiceStoreCache
+ *
+ *  DESCRIPTION
+ *      Write the discovered service data for the specified device to its
+ *      discovery cache record.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to store service data for
+ *      p_cache [out]           Cache record of the service
+ *      size [in]               Number of words available for the record
+ *
+ *  RETURNS
+ *      Number of words written, or 0 if the record does not fit
+ *----------------------------------------------------------------------------*/
+uint16 DeviceInfoServiceStoreCache(uint16 dev, uint16 *p_cache, uint16 size)
+{
+    uint16 char_num;            /* Loop counter */
+    /* Service data for the specified device */
+    const DEV_INFO_SERVICE_DATA_T *data = &g_dis_data[dev];
+    /* Words in the record */
+    const uint16 words = GATT_CACHE_SERVICE_WORDS(data->total_char);
+
+    if(words > size)
+    {
+        return 0;
+    }
+
+    p_cache[0] = data->service_start_handle;
+    p_cache[1] = data->service_end_handle;
+    p_cache[2] = data->total_char;
+
+    for(char_num = 0; char_num < data->total_char; char_num++)
+    {
+        GattCacheStoreChar(&p_cache[GATT_CACHE_SERVICE_WORDS(char_num)],
+                           &data->chars[char_num],
+                           data->type[char_num]);
+    }
+
+    return words;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      DeviceInfoServiceRestoreCache
+ *
+ *  DESCRIPTION
+ *      Restore the service data for the specified device from its discovery
+ *      cache record, in place of the Discovery Procedure.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to restore service data for
+ *      connect_handle [in]     Handle of connection with the device
+ *      p_cache [in]            Cache record of the service
+ *      size [in]               Number of words in the record
+ *
+ *  RETURNS
+ *      TRUE if the record is valid
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool DeviceInfoServiceRestoreCache(uint16 dev,
+                                   uint16 connect_handle,
+                                   const uint16 *p_cache,
+                                   uint16 size)
+{
+    uint16 char_num;            /* Loop counter */
+    uint16 type;                /* Characteristic type */
+    /* Service data for the specified device */
+    DEV_INFO_SERVICE_DATA_T *data = &g_dis_data[dev];
+
+    deviceInfoDataInit(dev);
+
+    if(size < GATT_CACHE_SERVICE_WORDS(0) ||
+       p_cache[2] > MAXIMUM_NUMBER_OF_CHARACTERISTIC ||
+       size != GATT_CACHE_SERVICE_WORDS(p_cache[2]))
+    {
+        return FALSE;
+    }
+
+    for(char_num = 0; char_num < p_cache[2]; char_num++)
+    {
+        type = GattCacheRestoreChar(
+                            &p_cache[GATT_CACHE_SERVICE_WORDS(char_num)],
+                            &data->chars[char_num]);
+        if(type >= dev_info_type_invalid)
+        {
+            deviceInfoDataInit(dev);
+            return FALSE;
+        }
+
+        data->type[char_num] = type;
+    }
+
+    data->service_start_handle = p_cache[0];
+    data->service_end_handle   = p_cache[1];
+    data->total_char           = p_cache[2];
+    data->connect_handle       = connect_handle;
+
+    return TRUE;
+}
@@ -236,6 +236,43 @@ extern void DeviceInfoServiceReadConfirm(uint16 dev,
                                          uint16 size,
                                          uint8 *value);
 
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      DeviceInfoServiceReadMultipleRequest
+ *
+ *  DESCRIPTION
+ *      Initiate a GATT read request for the values of several characteristics
+ *      at once.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which to read characteristic values
+ *
+ *  RETURNS
+ *      TRUE if the request was sent, FALSE if the values are to be read one
+ *      at a time
+ *----------------------------------------------------------------------------*/
+extern bool DeviceInfoServiceReadMultipleRequest(uint16 dev);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      DeviceInfoServiceReadMultipleConfirm
+ *
+ *  DESCRIPTION
+ *      Called when a multiple read request is successful.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which characteristic values were
+ *                              read
+ *      size [in]               Size of data returned, in octets
+ *      value [in]              Characteristic values, concatenated
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void DeviceInfoServiceReadMultipleConfirm(uint16 dev,
+                                                 uint16 size,
+                                                 uint8 *value);
+
 /*---------------------------------------------------------------------------
  *  NAME
  *      DeviceInfoServiceFound
@@ -267,4 +304,45 @@ extern bool DeviceInfoServiceFound(uint16 dev);
  *----------------------------------------------------------------------------*/
 extern void DeviceInfoServiceResetData(uint16 dev);
 
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      DeviceInfoServiceStoreCache
+ *
+ *  DESCRIPTION
+ *      Write the discovered service data to a discovery cache record.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to store service data for
+ *      p_cache [out]           Cache record of the service
+ *      size [in]               Number of words available for the record
+ *
+ *  RETURNS
+ *      Number of words written, or 0 if the record does not fit
+ *----------------------------------------------------------------------------*/
+extern uint16 DeviceInfoServiceStoreCache(uint16 dev,
+                                          uint16 *p_cache,
+                                          uint16 size);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      DeviceInfoServiceRestoreCache
+ *
+ *  DESCRIPTION
+ *      Restore the service data from a discovery cache record.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to restore service data for
+ *      connect_handle [in]     Handle of connection with the device
+ *      p_cache [in]            Cache record of the service
+ *      size [in]               Number of words in the record
+ *
+ *  RETURNS
+ *      TRUE if the record is valid
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool DeviceInfoServiceRestoreCache(uint16 dev,
+                                          uint16 connect_handle,
+                                          const uint16 *p_cache,
+                                          uint16 size);
+
 #endif /* __DEV_INFO_SERVICE_DATA_H__ */
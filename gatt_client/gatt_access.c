@@ -32,27 +32,54 @@
 #include "gatt_client.h"    /* Interface to top level application functions */
 #include "gatt_access.h"    /* Interface to this file */
 #include "debug_interface.h"/* Debug routines */
+#include "ad_parser.h"      /* Single pass AD structure parser */
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Layout of the discovery cache. The header is followed by a record for each
+ * service found on the device, made of the index of the service in
+ * serviceStore, the number of words in the service's record and the record.
+ */
+#define GATT_CACHE_OFFSET_VERSION            (0)
+#define GATT_CACHE_OFFSET_SUPPORTED          (1)
+#define GATT_CACHE_OFFSET_RECORDS            (2)
+#define GATT_CACHE_HEADER_WORDS              (3)
+
+/* Number of words before each service's record */
+#define GATT_CACHE_RECORD_HEADER_WORDS       (2)
+
+/* Largest part of a characteristic value returned by one read request, in
+ * octets (DEFAULT_ATT_MTU - 1). A value which fills it may continue beyond
+ * it, and the whole value is then read with the Read Long Characteristic
+ * Value procedure.
+ */
+#define GATT_READ_FRAGMENT_SIZE              (22)
+
+/* Size of the buffer in which a long characteristic value is reassembled, in
+ * octets. Longer values are delivered truncated to this size.
+ */
+#define GATT_LONG_VALUE_SIZE                 (64)
 
 /*============================================================================*
  *  Private Data types
  *============================================================================*/
 
-/* GATT data structure */
-typedef struct _APP_GATT_DATA_T
+/* GATT procedure data kept for each connected device */
+typedef struct _APP_GATT_DEV_DATA_T
 {
-	/* Stores all the supported services found on the Server */
-    SERVICE_FUNC_POINTERS_T     *serviceStore[MAX_SUPPORTED_SERVICES];
-
-    /* Number of supported services found on the Server (number of entries in
-     * the serviceStore array)
+    /* Index of service currently being discovered, or configured. It indexes
+     * serviceStore until primary service discovery is complete, and the
+     * services found on the device afterwards.
      */
-    uint16                      totalSupportedServices;
+    uint16                      currentServiceIndex;
 
-    /* Index into serviceStore of service currently being discovered, or
-     * configured
+    /* Flag to indicate that primary service discovery is complete, so that
+     * only the services found on the device are discovered and configured
      */
-    uint16                      currentServiceIndex;
-    
+    bool                        primary_disc_complete;
+
     /* Pointer to a service in serviceStore for which a char read request has
      * been sent
      */
@@ -81,11 +108,55 @@ typedef struct _APP_GATT_DATA_T
      * gatt_status_insufficient_authorization
      */
     bool                       pairing_in_progress;
-    
+
+    /* Handle of the characteristic whose long value is being read, or
+     * INVALID_ATT_HANDLE
+     */
+    uint16                     long_handle;
+
+    /* Number of octets of the value reassembled in long_value */
+    uint16                     long_size;
+
+    /* Buffer in which the long characteristic value is reassembled */
+    uint8                      long_value[GATT_LONG_VALUE_SIZE];
+} APP_GATT_DEV_DATA_T;
+
+/* GATT data structure */
+typedef struct _APP_GATT_DATA_T
+{
+	/* Stores all the services supported by the Client */
+    SERVICE_FUNC_POINTERS_T     *serviceStore[MAX_SUPPORTED_SERVICES];
+
+    /* Number of services supported by the Client (number of entries in the
+     * serviceStore array)
+     */
+    uint16                      totalSupportedServices;
+
+    /* UUID type of each service in serviceStore, captured at GattStartScan,
+     * or GATT_UUID_NONE if the service does not provide its UUID
+     */
+    GATT_UUID_T                 uuid_type[MAX_SUPPORTED_SERVICES];
+
+    /* UUID of each service in serviceStore, captured at GattStartScan */
+    uint16                      uuid[MAX_SUPPORTED_SERVICES][8];
+
+    /* Indices into serviceStore of the services with 16-bit UUIDs, sorted by
+     * UUID so that they can be looked up with a binary search
+     */
+    uint16                      uuid16_order[MAX_SUPPORTED_SERVICES];
+
+    /* Number of entries in uuid16_order */
+    uint16                      num_uuid16;
+
     /* Flag to indicate that devices should be filtered by the services that
      * they advertise
      */
     bool                       filter_by_service;
+
+    /* GATT procedure data for each device, so that devices are discovered
+     * and configured independently of each other
+     */
+    APP_GATT_DEV_DATA_T         dev_data[MAX_CONNECTED_DEVICES];
 } APP_GATT_DATA_T;
 
 /*============================================================================*
@@ -99,6 +170,20 @@ static APP_GATT_DATA_T g_app_gatt_data;
  *  Private Function Prototypes
  *============================================================================*/
 
+/* Get the services used by the GATT procedures on a device */
+static SERVICE_FUNC_POINTERS_T **appGattDevServices(uint16 dev,
+                                                    uint16 *totalServices);
+
+/* Get the service currently being discovered or configured on a device */
+static SERVICE_FUNC_POINTERS_T *appGattCurrentService(uint16 dev);
+
+/* Capture the UUIDs of the supported services and index them */
+static void appGattIndexServiceUuids(void);
+
+/* Find the index in serviceStore of the service with the specified UUID */
+static uint16 appGattFindServiceIndex(GATT_UUID_T uuid_type,
+                                      const uint16 uuid[]);
+
 /* Check and handle if there are any other filtering requirements, other than
  * UUID
  */
@@ -108,19 +193,19 @@ static bool appGattCheckFilter(DISCOVERED_DEVICE_T *device,
 /* Check if the service for which discovery was initiated is mandatory and if so
  * disconnect the device if the service cannot be found.
  */
-static bool appGattCheckMandatoryFoundService(void);
+static bool appGattCheckMandatoryFoundService(uint16 dev);
 
 /* Discover all the characteristics for a given service */
-static void appGattDiscServiceAllChar(uint16 connect_handle);
+static void appGattDiscServiceAllChar(uint16 dev, uint16 connect_handle);
 
 /* Discover all the characteristic descriptors for a given characteristic */
-static bool appGattDiscCharDescriptors(uint16 connect_handle);
+static bool appGattDiscCharDescriptors(uint16 dev, uint16 connect_handle);
 
 /* Notify the current discovered service and check if it initiates any
  * read/write procedures. If not, then start discovering the next service's
  * characteristics
  */
-static void appGattNotifyServAndDiscNext(uint16 connect_handle);
+static void appGattNotifyServAndDiscNext(uint16 dev, uint16 connect_handle);
 
 /* Configure all the supported characteristics of all the support services */
 static void appGattConfigureServices(uint16 dev);
@@ -162,10 +247,224 @@ static void appGattSignalGattCharValInd(GATT_CHAR_VAL_IND_T *p_event_data);
 static void appGattSignalGattReadCharValCfm(
                     GATT_READ_CHAR_VAL_CFM_T *p_event_data);
 
+/* Handle GATT_READ_MULTI_CHAR_VAL_CFM messages received from the firmware */
+static void appGattSignalGattReadMultiCharValCfm(
+                    GATT_READ_MULTI_CHAR_VAL_CFM_T *p_event_data);
+
+/* Hand the reassembled long characteristic value to the service */
+static void appGattLongReadComplete(uint16 dev);
+
+/* Handle GATT_LONG_CHAR_VAL_IND messages received from the firmware */
+static void appGattSignalGattLongCharValInd(
+                    GATT_LONG_CHAR_VAL_IND_T *p_event_data);
+
+/* Handle GATT_READ_LONG_CHAR_VAL_CFM messages received from the firmware */
+static void appGattSignalGattReadLongCharValCfm(
+                    GATT_READ_LONG_CHAR_VAL_CFM_T *p_event_data);
+
 /*============================================================================*
  *  Private Function Implementations
  *============================================================================*/
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appGattDevServices
+ *
+ *  DESCRIPTION
+ *      Get the services used by the GATT procedures on a device: all the
+ *      supported services while primary services are being discovered, and
+ *      only the services found on the device afterwards.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device number
+ *      totalServices [out]     Number of services returned
+ *
+ *  RETURNS
+ *      Pointer to array of services' callback function tables
+ *----------------------------------------------------------------------------*/
+static SERVICE_FUNC_POINTERS_T **appGattDevServices(uint16 dev,
+                                                    uint16 *totalServices)
+{
+    if(g_app_gatt_data.dev_data[dev].primary_disc_complete)
+    {
+        return GetConnServices(dev, totalServices);
+    }
+
+    *totalServices = g_app_gatt_data.totalSupportedServices;
+
+    return g_app_gatt_data.serviceStore;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appGattCurrentService
+ *
+ *  DESCRIPTION
+ *      Get the service currently being discovered or configured on a device.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device number
+ *
+ *  RETURNS
+ *      Pointer to the service's callback function table, or NULL if all the
+ *      services have been handled
+ *----------------------------------------------------------------------------*/
+static SERVICE_FUNC_POINTERS_T *appGattCurrentService(uint16 dev)
+{
+    /* Current service index */
+    const uint16 index = g_app_gatt_data.dev_data[dev].currentServiceIndex;
+    uint16 totalServices;           /* Number of services */
+    SERVICE_FUNC_POINTERS_T **services = appGattDevServices(dev,
+                                                            &totalServices);
+
+    return (index < totalServices) ? services[index] : NULL;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appGattIndexServiceUuids
+ *
+ *  DESCRIPTION
+ *      This function asks each service in serviceStore for its UUID once, and
+ *      keeps the UUIDs so that services can be looked up without calling the
+ *      services back. The services with 16-bit UUIDs are also sorted by UUID,
+ *      keeping the order of serviceStore between services with equal UUIDs.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appGattIndexServiceUuids(void)
+{
+    uint16 index;                   /* Loop counter */
+
+    g_app_gatt_data.num_uuid16 = 0;
+
+    for(index = 0; index < g_app_gatt_data.totalSupportedServices; index++)
+    {
+        /* Pointer to current service */
+        SERVICE_FUNC_POINTERS_T *pService = g_app_gatt_data.serviceStore[index];
+        uint16 pos;                 /* Position in the sorted 16-bit UUIDs */
+
+        g_app_gatt_data.uuid_type[index] = GATT_UUID_NONE;
+
+        if(pService != NULL &&
+           pService->serviceUuid != NULL)
+        {
+            pService->serviceUuid(&g_app_gatt_data.uuid_type[index],
+                                  g_app_gatt_data.uuid[index]);
+        }
+
+        if(g_app_gatt_data.uuid_type[index] != GATT_UUID16)
+        {
+            continue;
+        }
+
+        /* Insert the service after those with lower or equal UUIDs */
+        for(pos = g_app_gatt_data.num_uuid16;
+            pos > 0 &&
+                g_app_gatt_data.uuid[
+                    g_app_gatt_data.uuid16_order[pos - 1]][0] >
+                g_app_gatt_data.uuid[index][0];
+            pos--)
+        {
+            g_app_gatt_data.uuid16_order[pos] =
+                                        g_app_gatt_data.uuid16_order[pos - 1];
+        }
+
+        g_app_gatt_data.uuid16_order[pos] = index;
+        g_app_gatt_data.num_uuid16++;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appGattFindServiceIndex
+ *
+ *  DESCRIPTION
+ *      This function finds the service with the specified UUID among the UUIDs
+ *      captured at GattStartScan. 16-bit UUIDs are found with a binary search;
+ *      128-bit UUIDs, which are rare, are compared in turn. If several
+ *      services have the UUID, the first in serviceStore is returned.
+ *
+ *  PARAMETERS
+ *      uuid_type [in]          Type of UUID to find
+ *      uuid [in]               UUID to find
+ *
+ *  RETURNS
+ *      Index of the service in serviceStore if found, otherwise
+ *      MAX_SUPPORTED_SERVICES
+ *----------------------------------------------------------------------------*/
+static uint16 appGattFindServiceIndex(GATT_UUID_T uuid_type,
+                                      const uint16 uuid[])
+{
+    uint16 index;                   /* Loop counter */
+
+    switch(uuid_type)
+    {
+        case GATT_UUID16:
+        {
+            uint16 low = 0;                              /* First candidate */
+            uint16 high = g_app_gatt_data.num_uuid16;    /* Past last one */
+
+            /* Find the first service with a UUID not lower than uuid */
+            while(low < high)
+            {
+                const uint16 mid = (low + high) / 2;
+
+                if(g_app_gatt_data.uuid[
+                       g_app_gatt_data.uuid16_order[mid]][0] < uuid[0])
+                {
+                    low = mid + 1;
+                }
+                else
+                {
+                    high = mid;
+                }
+            }
+
+            if(low < g_app_gatt_data.num_uuid16)
+            {
+                index = g_app_gatt_data.uuid16_order[low];
+
+                if(g_app_gatt_data.uuid[index][0] == uuid[0])
+                {
+                    /* Service found */
+                    return index;
+                }
+            }
+        }
+        break;
+
+        case GATT_UUID128:
+        {
+            for(index = 0;
+                index < g_app_gatt_data.totalSupportedServices;
+                index++)
+            {
+                if(g_app_gatt_data.uuid_type[index] == GATT_UUID128 &&
+                   !MemCmp(g_app_gatt_data.uuid[index], uuid, 8))
+                {
+                    /* Service found */
+                    return index;
+                }
+            }
+        }
+        break;
+
+        default:
+        {
+            /* Do Nothing */
+        }
+        break;
+    }
+
+    /* Service not found */
+    return MAX_SUPPORTED_SERVICES;
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      appGattCheckFilter
@@ -205,21 +504,16 @@ static bool appGattCheckFilter(DISCOVERED_DEVICE_T *device,
  *      disconnect the device if the service is not found.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device undergoing Discovery Procedure
  *
  *  RETURNS
  *      TRUE if the service is not mandatory, or if the service is mandatory
  *      and has been found, otherwise FALSE.
  *----------------------------------------------------------------------------*/
-static bool appGattCheckMandatoryFoundService(void)
+static bool appGattCheckMandatoryFoundService(uint16 dev)
 {
-    /* Current service index */
-    const uint16 index = g_app_gatt_data.currentServiceIndex;
     /* Current service */
-    const SERVICE_FUNC_POINTERS_T *pService =
-                                            g_app_gatt_data.serviceStore[index];
-    /* Device undergoing Discovery Procedure */
-    const uint16 dev = GetConnDevice();
+    const SERVICE_FUNC_POINTERS_T *pService = appGattCurrentService(dev);
 
     if(pService != NULL)
     {
@@ -264,30 +558,24 @@ static bool appGattCheckMandatoryFoundService(void)
  *      Start the discovery of all the characteristics of the current service.
  *
  *  PARAMETERS
- *      connect_handle [in]     Connection handle for the current device
+ *      dev [in]                Device undergoing Discovery Procedure
+ *      connect_handle [in]     Connection handle for the device
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-static void appGattDiscServiceAllChar(uint16 connect_handle)
+static void appGattDiscServiceAllChar(uint16 dev, uint16 connect_handle)
 {
     uint16 l_start_handl;   /* Start handle of the current service */
     uint16 l_end_handl;     /* End handle of the current service */
 
-    /* Current service index */
-    const uint16 index = g_app_gatt_data.currentServiceIndex;
     /* Current service */
-    const SERVICE_FUNC_POINTERS_T *pService =
-                                            g_app_gatt_data.serviceStore[index];
-    /* Device undergoing Discovery Procedure */
-    const uint16 dev = GetConnDevice();
+    const SERVICE_FUNC_POINTERS_T *pService;
 
-    while(g_app_gatt_data.currentServiceIndex <
-          g_app_gatt_data.totalSupportedServices)
+    while((pService = appGattCurrentService(dev)) != NULL)
     {
         /* Check if the service is found */
-        if(pService != NULL && 
-           pService->isServiceFound != NULL &&
+        if(pService->isServiceFound != NULL &&
            pService->isServiceFound(dev) && /* TRUE means service was found */
            pService->getHandles != NULL)
         {
@@ -317,8 +605,8 @@ static void appGattDiscServiceAllChar(uint16 connect_handle)
             }
         }
         
-        /* Point to the next service in serviceStore */
-        g_app_gatt_data.currentServiceIndex ++;
+        /* Point to the next service */
+        g_app_gatt_data.dev_data[dev].currentServiceIndex ++;
     }
 }
 
@@ -331,25 +619,21 @@ static void appGattDiscServiceAllChar(uint16 connect_handle)
  *      characteristics of the current service.
  *
  *  PARAMETERS
- *      connect_handle [in]     Connection handle for the current device
+ *      dev [in]                Device undergoing Discovery Procedure
+ *      connect_handle [in]     Connection handle for the device
  *
  *  RETURNS
  *      TRUE if the characteristic descriptor discovery procedure is started
  *      FALSE if there are no more characteristics to discover descriptors for
  *----------------------------------------------------------------------------*/
-static bool appGattDiscCharDescriptors(uint16 connect_handle)
+static bool appGattDiscCharDescriptors(uint16 dev, uint16 connect_handle)
 {
     uint16 l_start_handl;       /* Start handle */
     uint16 l_end_handl;         /* End handle */
     uint16 service_end_hndl;    /* End handle of the current service */
 
-    /* Current service index */
-    const uint16 index = g_app_gatt_data.currentServiceIndex;
     /* Current service */
-    const SERVICE_FUNC_POINTERS_T *pService =
-                                            g_app_gatt_data.serviceStore[index];
-    /* Device undergoing Discovery Procedure */
-    const uint16 dev = GetConnDevice();
+    const SERVICE_FUNC_POINTERS_T *pService = appGattCurrentService(dev);
 
     if(pService != NULL && /* To avoid crash */
        pService->isServiceFound != NULL && 
@@ -410,48 +694,46 @@ static bool appGattDiscCharDescriptors(uint16 connect_handle)
  *      characteristic descriptors.
  *
  *  PARAMETERS
- *      connect_handle [in]     Connection handle for the current device
+ *      dev [in]                Device undergoing Discovery Procedure
+ *      connect_handle [in]     Connection handle for the device
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-static void appGattNotifyServAndDiscNext(uint16 connect_handle)
+static void appGattNotifyServAndDiscNext(uint16 dev, uint16 connect_handle)
 {
-    /* Current service index */
-    uint16 *index = &g_app_gatt_data.currentServiceIndex;
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data = &g_app_gatt_data.dev_data[dev];
     /* Current service */
-    const SERVICE_FUNC_POINTERS_T *pService =
-                                           g_app_gatt_data.serviceStore[*index];
-    /* Device undergoing Discovery Procedure */
-    const uint16 dev = GetConnDevice();
+    const SERVICE_FUNC_POINTERS_T *pService = appGattCurrentService(dev);
 
     if(pService->discoveryComplete == NULL ||
-       !(g_app_gatt_data.service_incomplete = pService->discoveryComplete(dev,
+       !(dev_data->service_incomplete = pService->discoveryComplete(dev,
                                                 connect_handle)))
     {
         /* Discover characteristics of the next service */
         while(1)
         {
             /* Point to the next service to discover */
-            (*index)++;
+            dev_data->currentServiceIndex++;
 
             /* Check only for the discovered services */
-            if(*index < g_app_gatt_data.totalSupportedServices)
+            if((pService = appGattCurrentService(dev)) != NULL)
             {
                if(pService->isServiceFound != NULL && 
                   pService->isServiceFound(dev))
                 {
-                    appGattDiscServiceAllChar(connect_handle);
+                    appGattDiscServiceAllChar(dev, connect_handle);
                     break;
                 }
             }
             else
             {
                 /* Reset currentServiceIndex */
-                *index = 0;
+                dev_data->currentServiceIndex = 0;
 
                /* Start configuring the peer device */
-                g_app_gatt_data.config_in_progress = TRUE;
+                dev_data->config_in_progress = TRUE;
 
                 appGattConfigureServices(dev);
 
@@ -484,18 +766,15 @@ static void appGattNotifyServAndDiscNext(uint16 connect_handle)
  *----------------------------------------------------------------------------*/
 static void appGattConfigureServices(uint16 dev)
 {
-    /* Current service index */
-    uint16 *index = &g_app_gatt_data.currentServiceIndex;
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data = &g_app_gatt_data.dev_data[dev];
     
     /* Service being configured */
     SERVICE_FUNC_POINTERS_T *pService = NULL;
 
-    while(*index < g_app_gatt_data.totalSupportedServices)
+    while((pService = appGattCurrentService(dev)) != NULL)
     {
-        pService = g_app_gatt_data.serviceStore[*index];
-
-        if(pService != NULL &&
-           pService->configureService != NULL)
+        if(pService->configureService != NULL)
         {
             if(pService->configureService(dev))
             {
@@ -507,20 +786,20 @@ static void appGattConfigureServices(uint16 dev)
         }
 
         /* Point to the next service to be configured */
-        (*index)++;
+        dev_data->currentServiceIndex++;
     }
 
-    if(*index == g_app_gatt_data.totalSupportedServices)
+    if(pService == NULL)
     {
         /* All the services have been configured. Notify the Application that
          * the peer device is configured.
          */
-        g_app_gatt_data.config_in_progress = FALSE;
+        dev_data->config_in_progress = FALSE;
         
         /* Reset the currentServiceIndex as this will be used in reading
          * characteristic values
          */
-        *index = 0;
+        dev_data->currentServiceIndex = 0;
 
         DeviceConfigured(dev);
     }
@@ -564,72 +843,68 @@ static void appGattSignalLmAdvertisingReport(
          */
         if(g_app_gatt_data.totalSupportedServices)
         {
-            uint16 data[ADVSCAN_MAX_PAYLOAD];/* Advertising event data */
+            /* AD types that may carry 16-bit service UUIDs, in order of
+             * preference
+             */
+            static const uint16 uuid_ad_types[2] =
+            {
+                AD_TYPE_SERVICE_UUID_16BIT_LIST,
+                AD_TYPE_SERVICE_UUID_16BIT
+            };
+            AD_FIELD_T fields[2];           /* AD structures found */
+            const uint8 *data;              /* Advertised service UUIDs */
+            uint16 found;                   /* Mask of AD structures found */
             uint16 num_uuid_found;          /* Advertised service loop counter */
             uint16 size;                    /* Advertising report size, in octets */
-            uint16 num_uuid_stored;         /* Supported service loop counter */
         
-            /* Extract service UUIDs from the advertisement */
-
-            /* GapLsFindAdType returns zero if no data is present for the specified
-             * criteria
+            /* Extract service UUIDs from the advertisement. Both AD types are
+             * looked up in one walk over the report, and the UUIDs are read
+             * in place rather than copied out.
              */
 
-            /* If it is required to check for 128-bit UUIDs, use
-             * AD_TYPE_SERVICE_UUID_128BIT_LIST as the criteria
+            /* If it is required to check for 128-bit UUIDs, add
+             * AD_TYPE_SERVICE_UUID_128BIT_LIST to the AD types
              */
-            size = GapLsFindAdType(&p_event_data->data, 
-                                   AD_TYPE_SERVICE_UUID_16BIT_LIST, 
-                                   data,
-                                   ADVSCAN_MAX_PAYLOAD);
-            if(size == 0)
+            found = AdFindTypes(p_event_data->data.data,
+                                p_event_data->data.length_data,
+                                uuid_ad_types, fields, 2);
+            if(AD_TYPE_FOUND(found, 0))
             {
-                /* No service UUIDs list found - try single service UUID */
-                size = GapLsFindAdType(&p_event_data->data, 
-                                       AD_TYPE_SERVICE_UUID_16BIT, 
-                                       data,
-                                       ADVSCAN_MAX_PAYLOAD);
-                if(size == 0)
-                {
-                    /* No service data found at all */
-                    return;
-                }
+                data = fields[0].p_data;
+                size = fields[0].length;
+            }
+            else if(AD_TYPE_FOUND(found, 1))
+            {
+                /* No service UUIDs list found - use single service UUID */
+                data = fields[1].p_data;
+                size = fields[1].length;
+            }
+            else
+            {
+                /* No service data found at all */
+                return;
             }
 
-            /* Check the service UUIDs */
+            /* Check the service UUIDs against the supported services,
+             * indexed at GattStartScan
+             */
             for(num_uuid_found = 0; 
                 num_uuid_found < (size / 2) && !flag;
                 num_uuid_found++)
-            /* sizeof(uint16) / sizeof(uint8) is always 2,
-             * size / 2 is used as the firmware returns the number of bytes copied,
-             * so when a single 16-bit UUID is copied, FW returns 2 
+            /* Each 16-bit UUID occupies two octets of the AD structure, least
+             * significant octet first
              */
             {
-                for(num_uuid_stored = 0; 
-                    num_uuid_stored < g_app_gatt_data.totalSupportedServices &&
-                        !flag;
-                    num_uuid_stored++)
+                const uint16 uuid = data[2 * num_uuid_found] |
+                                    (data[2 * num_uuid_found + 1] << 8);
+
+                if(appGattFindServiceIndex(GATT_UUID16, &uuid) !=
+                                                        MAX_SUPPORTED_SERVICES)
                 {
-                    SERVICE_FUNC_POINTERS_T *pService =
-                                  g_app_gatt_data.serviceStore[num_uuid_stored];
-                    GATT_UUID_T type = GATT_UUID_NONE;
-                    uint16      uuid[8];
-
-                    /* Get the service UUID */
-                    if(pService != NULL &&
-                       pService->serviceUuid != NULL)
-                    {
-                        pService->serviceUuid(&type, uuid);
-                    }
-
-                    /* Compare the 16-bit service UUID */
-                    if(type == GATT_UUID16 && data[num_uuid_found] == uuid[0])
-                    {
-                        /* At least one of the supported services is present */
-
-                        /* Set the flag */
-                        flag = TRUE;
-                    }
+                    /* At least one of the supported services is present */
+
+                    /* Set the flag */
+                    flag = TRUE;
                 }
             }
         }
@@ -641,8 +916,6 @@ static void appGattSignalLmAdvertisingReport(
 
     if (flag == TRUE)
     {
-        g_app_gatt_data.currentServiceIndex = 0;
-
         /* Perform any additional filtering, based on e.g. device name,
          * Bluetooth Address etc.
          */
@@ -670,12 +943,18 @@ static void appGattSignalLmAdvertisingReport(
 static void appGattSignalGattDiscPrimServByUuidInd(
                         GATT_DISC_PRIM_SERV_BY_UUID_IND_T *p_event_data)
 {
-    /* Current service index */
-    const uint16 index = g_app_gatt_data.currentServiceIndex;
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
     /* Current service */
-    SERVICE_FUNC_POINTERS_T *pService = g_app_gatt_data.serviceStore[index];
-    /* Device undergoing Discovery Procedure */
-    const uint16 dev = GetConnDevice();
+    SERVICE_FUNC_POINTERS_T *pService;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
+
+    pService = appGattCurrentService(dev);
 
     /* Check if the service was found */
     if(pService != NULL &&
@@ -684,7 +963,7 @@ static void appGattSignalGattDiscPrimServByUuidInd(
         pService->serviceInit(dev, p_event_data);
 
         /* Notify the application about the service found */
-        NotifyServiceFound(pService);
+        NotifyServiceFound(dev, pService);
     }
 }
 
@@ -705,12 +984,25 @@ static void appGattSignalGattDiscPrimServByUuidInd(
 static void appGattSignalGattDiscPrimServByUuidCfm(
                        GATT_DISC_PRIM_SERV_BY_UUID_CFM_T *p_event_data)
 {
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
+
+    dev_data = &g_app_gatt_data.dev_data[dev];
+
     if(p_event_data->result == sys_status_success)
     {
         /* Check if the service was not found but was mandatory, and if so
          * disconnect the connection.
          */
-        if(!appGattCheckMandatoryFoundService())
+        if(!appGattCheckMandatoryFoundService(dev))
         {
             return;
         }
@@ -720,31 +1012,23 @@ static void appGattSignalGattDiscPrimServByUuidCfm(
         /* Prevent an infinite loop when the primary service sought
          * does not exist on the GATT server
          */
-        g_app_gatt_data.currentServiceIndex++;
+        dev_data->currentServiceIndex++;
 
         /* Continue discovering primary services */
         GattDiscoverRemoteDatabase(p_event_data->cid);
 
-        if(g_app_gatt_data.currentServiceIndex ==
+        if(dev_data->currentServiceIndex ==
           g_app_gatt_data.totalSupportedServices)
         {
-            SERVICE_FUNC_POINTERS_T **ppService;
-            uint16 totalServices;
-
-            g_app_gatt_data.currentServiceIndex = 0;
+            dev_data->currentServiceIndex = 0;
 
             /* Primary service discovery is complete. Initiate the discovery of 
-             * characteristics and their descriptors for all the services found
+             * characteristics and their descriptors for only the services
+             * found on the device.
              */
-            ppService = GetConnServices(NULL, &totalServices);
-
-            g_app_gatt_data.totalSupportedServices = totalServices;
+            dev_data->primary_disc_complete = TRUE;
 
-            /* Store only the relevant services */
-            MemCopy(g_app_gatt_data.serviceStore, ppService,
-                             totalServices * sizeof(SERVICE_FUNC_POINTERS_T *));
-
-            appGattDiscServiceAllChar(p_event_data->cid);
+            appGattDiscServiceAllChar(dev, p_event_data->cid);
         }
     }
     else
@@ -770,13 +1054,18 @@ static void appGattSignalGattDiscPrimServByUuidCfm(
 static void appGattSignalGattCharDeclInforInd(
                                         GATT_CHAR_DECL_INFO_IND_T *p_event_data)
 {
-    /* Current service index */
-    const uint16 index = g_app_gatt_data.currentServiceIndex;
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
     /* Current service */
-    const SERVICE_FUNC_POINTERS_T *pService =
-                                            g_app_gatt_data.serviceStore[index];
-    /* Device undergoing Discovery Procedure */
-    const uint16 dev = GetConnDevice();
+    const SERVICE_FUNC_POINTERS_T *pService;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
+
+    pService = appGattCurrentService(dev);
 
     if(pService != NULL &&
        pService->charDiscovered != NULL && 
@@ -804,18 +1093,24 @@ static void appGattSignalGattCharDeclInforInd(
 static void appGattSignalGattDiscServiceCharCfm(
                                      GATT_DISC_SERVICE_CHAR_CFM_T *p_event_data)
 {
-    /* Get the connected device */
-    const uint16 dev = GetConnDevice();
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
 
     if(p_event_data->result == sys_status_success)
     {
         /* Start discovering the characteristics' descriptors */
-        if(!appGattDiscCharDescriptors(p_event_data->cid))
+        if(!appGattDiscCharDescriptors(dev, p_event_data->cid))
         {
             /* No more descriptors found in all the characteristics of the
              * current service
              */
-            appGattNotifyServAndDiscNext(p_event_data->cid);
+            appGattNotifyServAndDiscNext(dev, p_event_data->cid);
         }
     }
     else
@@ -842,18 +1137,24 @@ static void appGattSignalGattDiscServiceCharCfm(
 static void appGattSignalGattCharDescInfoInd(
                                         GATT_CHAR_DESC_INFO_IND_T *p_event_data)
 {
-    /* Current service index */
-    const uint16 index = g_app_gatt_data.currentServiceIndex;
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
     /* Current service */
-    const SERVICE_FUNC_POINTERS_T *pService =
-                                            g_app_gatt_data.serviceStore[index];
-    /* Device undergoing Discovery Procedure */
-    const uint16 dev = GetConnDevice();
+    const SERVICE_FUNC_POINTERS_T *pService;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
+
+    pService = appGattCurrentService(dev);
 
     /* Inform the service about the discovered characteristic descriptor and
      * store it
      */
-    if(pService->descDiscovered != NULL)
+    if(pService != NULL &&
+       pService->descDiscovered != NULL)
     {
        pService->descDiscovered(dev, p_event_data);
     }
@@ -876,20 +1177,26 @@ static void appGattSignalGattCharDescInfoInd(
 static void appGattSignalGattDiscAllCharDescCfm(
                                     GATT_DISC_ALL_CHAR_DESC_CFM_T *p_event_data)
 {
-    /* Get the connected device */
-    const uint16 dev = GetConnDevice();
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
 
     if(p_event_data->result == sys_status_success)
     {
         /* Start discovering the descriptors of the next characteristic in the
          * service
          */
-        if(!appGattDiscCharDescriptors(p_event_data->cid))
+        if(!appGattDiscCharDescriptors(dev, p_event_data->cid))
         {
             /* No more descriptors found in all the characteristics of the
              * current service
              */
-            appGattNotifyServAndDiscNext(p_event_data->cid);
+            appGattNotifyServAndDiscNext(dev, p_event_data->cid);
         }
     }
     else
@@ -915,16 +1222,28 @@ static void appGattSignalGattDiscAllCharDescCfm(
  *----------------------------------------------------------------------------*/
 static void appGattSignalGattCharValInd(GATT_CHAR_VAL_IND_T *p_event_data)
 {
-    /* Index into serviceStore */
+    /* Index into the device's services */
     uint16 index = 0;
-    /* Pointer to service callback table in serviceStore */
+    /* Number of services used on the device */
+    uint16 totalServices;
+    /* Services used on the device */
+    SERVICE_FUNC_POINTERS_T **services;
+    /* Pointer to service callback table */
     SERVICE_FUNC_POINTERS_T *pService = NULL;
-    /* Get the connected device */
-    const uint16 dev = GetConnDevice();
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
+
+    services = appGattDevServices(dev, &totalServices);
     
-    while(index < g_app_gatt_data.totalSupportedServices)
+    while(index < totalServices)
     {
-        pService = g_app_gatt_data.serviceStore[index];
+        pService = services[index];
 
         if(pService != NULL && 
            pService->isServiceFound != NULL && 
@@ -966,12 +1285,20 @@ static void appGattSignalGattCharValInd(GATT_CHAR_VAL_IND_T *p_event_data)
 static void appGattSignalGattWriteCharValCfm(
                                         GATT_WRITE_CHAR_VAL_CFM_T *p_event_data)
 {
-    /* Current service index */
-    const uint16 index = g_app_gatt_data.currentServiceIndex;
-    /* Pointer to service callback table in serviceStore */
+    /* Pointer to service callback table */
     SERVICE_FUNC_POINTERS_T *pService = NULL;
-    /* Get the connected device */
-    const uint16 dev = GetConnDevice();
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
+
+    dev_data = &g_app_gatt_data.dev_data[dev];
 
     if((p_event_data->result == gatt_status_insufficient_authentication) ||
        (p_event_data->result == gatt_status_insufficient_authorization))
@@ -982,8 +1309,8 @@ static void appGattSignalGattWriteCharValCfm(
          */
 #ifdef PAIRING_SUPPORT
         /* Initiate the Pairing Procedure */
-        g_app_gatt_data.pairing_in_progress = TRUE;
-        StartBonding();
+        dev_data->pairing_in_progress = TRUE;
+        StartBonding(dev);
 #else
         /* Disconnect the device */
         DisconnectDevice(dev);
@@ -992,25 +1319,25 @@ static void appGattSignalGattWriteCharValCfm(
     else if(p_event_data->result == sys_status_success)
     {
         /* Successfully modified a characteristic value */
-        if(g_app_gatt_data.service_incomplete) 
+        if(dev_data->service_incomplete) 
         {
             /* This case is executed if the service has enabled a write 
              * request.
              */
-            g_app_gatt_data.service_incomplete = FALSE;
+            dev_data->service_incomplete = FALSE;
 
             /* Notify current service and initiate the discovery of the next
              * service
              */
-            appGattNotifyServAndDiscNext(p_event_data->cid);
+            appGattNotifyServAndDiscNext(dev, p_event_data->cid);
         }
         else if((GetState(dev) == app_state_discovering) && 
-                (g_app_gatt_data.config_in_progress))
+                (dev_data->config_in_progress))
         {
             /* This case is executed during the Discovery Procedure when the
              * service is being configured
              */
-            pService = g_app_gatt_data.serviceStore[index];
+            pService = appGattCurrentService(dev);
 
             /* Confirm that the write request has finished */
             if(pService != NULL &&
@@ -1023,12 +1350,12 @@ static void appGattSignalGattWriteCharValCfm(
             appGattConfigureServices(dev);
         }
         else if((GetState(dev) == app_state_configured) && 
-                !(g_app_gatt_data.config_in_progress))
+                !(dev_data->config_in_progress))
         /* Code should never reach here because this example application does
          * not perform any write procedures.
          */
         {
-            pService = g_app_gatt_data.write_pService;
+            pService = dev_data->write_pService;
 
             /* Confirm that the write request has finished */
             if(pService != NULL &&
@@ -1038,10 +1365,10 @@ static void appGattSignalGattWriteCharValCfm(
             }
 
             /* Reset write_pService to make sure it is not re-used by mistake */
-            g_app_gatt_data.write_pService = NULL;
+            dev_data->write_pService = NULL;
 
             /* Perform next read/write procedure */
-            NextReadWriteProcedure(TRUE);
+            NextReadWriteProcedure(dev, TRUE);
         }
     }
 }
@@ -1063,12 +1390,20 @@ static void appGattSignalGattWriteCharValCfm(
 static void appGattSignalGattReadCharValCfm(GATT_READ_CHAR_VAL_CFM_T
                                             *p_event_data)
 {
-    /* Current service index */
-    const uint16 index = g_app_gatt_data.currentServiceIndex;
-    /* Pointer to service callback table in serviceStore */
+    /* Pointer to service callback table */
     SERVICE_FUNC_POINTERS_T *pService = NULL;
-    /* Get the connected device */
-    const uint16 dev = GetConnDevice();
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
+
+    dev_data = &g_app_gatt_data.dev_data[dev];
 
     if((p_event_data->result == gatt_status_insufficient_authentication) ||
        (p_event_data->result == gatt_status_insufficient_authorization))
@@ -1079,8 +1414,8 @@ static void appGattSignalGattReadCharValCfm(GATT_READ_CHAR_VAL_CFM_T
          */
 #ifdef PAIRING_SUPPORT
         /* Initiate the Pairing Procedure */
-        g_app_gatt_data.pairing_in_progress = TRUE;
-        StartBonding();
+        dev_data->pairing_in_progress = TRUE;
+        StartBonding(dev);
 #else
         /* Disconnect the device */
         DisconnectDevice(dev);
@@ -1090,12 +1425,12 @@ static void appGattSignalGattReadCharValCfm(GATT_READ_CHAR_VAL_CFM_T
     {
         /* Successfully read a characteristic value */
         if((GetState(dev) == app_state_discovering) && 
-           g_app_gatt_data.config_in_progress)
+           dev_data->config_in_progress)
         {
             /* This case is executed during the Discovery Procedure when the
              * service is being configured
              */
-            pService = g_app_gatt_data.serviceStore[index];
+            pService = appGattCurrentService(dev);
 
             /* Confirm that the read request has finished */
             if(pService != NULL &&
@@ -1110,9 +1445,28 @@ static void appGattSignalGattReadCharValCfm(GATT_READ_CHAR_VAL_CFM_T
             appGattConfigureServices(dev);
         }
         else if((GetState(dev) == app_state_configured) && 
-                !g_app_gatt_data.config_in_progress)
+                !dev_data->config_in_progress)
         {
-            pService = g_app_gatt_data.read_pService;
+            pService = dev_data->read_pService;
+
+            if(p_event_data->size_value == GATT_READ_FRAGMENT_SIZE &&
+               pService != NULL &&
+               GattReadLongCharValue(p_event_data->cid,
+                                     p_event_data->handle) ==
+                                                        sys_status_success)
+            {
+                /* The value may be longer than one read returns. The firmware
+                 * reads it again in parts, which are reassembled before it
+                 * is handed to the service. The part read so far is kept in
+                 * case the long read fails.
+                 */
+                dev_data->long_handle = p_event_data->handle;
+                dev_data->long_size   = p_event_data->size_value;
+                MemCopy(dev_data->long_value,
+                        p_event_data->value,
+                        p_event_data->size_value);
+                return;
+            }
 
             /* Confirm that the read request has finished */
             if(pService != NULL &&
@@ -1124,16 +1478,212 @@ static void appGattSignalGattReadCharValCfm(GATT_READ_CHAR_VAL_CFM_T
             }
 
             /* Reset read_pService to make sure it is not re-used by mistake */
-            g_app_gatt_data.read_pService = NULL;
+            dev_data->read_pService = NULL;
 
             /* Perform next read/write procedure */
-            NextReadWriteProcedure(TRUE);
+            NextReadWriteProcedure(dev, TRUE);
         }
     }
 }
 
-/*============================================================================*
- *  Public Function Implementations
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appGattSignalGattReadMultiCharValCfm
+ *
+ *  DESCRIPTION
+ *      This function handles GATT_READ_MULTI_CHAR_VAL_CFM messages received
+ *      from the firmware. If the request fails for any other reason than
+ *      insufficient security, the service's values are read one at a time
+ *      instead.
+ *
+ *  PARAMETERS
+ *      p_event_data [in]       Event data
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appGattSignalGattReadMultiCharValCfm(
+                    GATT_READ_MULTI_CHAR_VAL_CFM_T *p_event_data)
+{
+    /* Pointer to service callback table */
+    SERVICE_FUNC_POINTERS_T *pService = NULL;
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return;
+    }
+
+    dev_data = &g_app_gatt_data.dev_data[dev];
+
+    if((p_event_data->result == gatt_status_insufficient_authentication) ||
+       (p_event_data->result == gatt_status_insufficient_authorization))
+    {
+        /* The Server has rejected the request because the Client has
+         * insufficient authentication and/or authorisation.
+         */
+#ifdef PAIRING_SUPPORT
+        /* Initiate the Pairing Procedure */
+        dev_data->pairing_in_progress = TRUE;
+        StartBonding(dev);
+#else
+        /* Disconnect the device */
+        DisconnectDevice(dev);
+#endif /* PAIRING_SUPPORT */
+    }
+    else if((GetState(dev) == app_state_configured) && 
+            !dev_data->config_in_progress)
+    {
+        pService = dev_data->read_pService;
+
+        if(p_event_data->result == sys_status_success &&
+           pService != NULL &&
+           pService->readMultipleConfirm != NULL)
+        {
+            /* Hand the values read to the service */
+            pService->readMultipleConfirm(dev,
+                                          p_event_data->size_value,
+                                          p_event_data->value);
+        }
+
+        /* Reset read_pService to make sure it is not re-used by mistake */
+        dev_data->read_pService = NULL;
+
+        /* Read the values left one at a time */
+        NextReadWriteProcedure(dev, TRUE);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appGattLongReadComplete
+ *
+ *  DESCRIPTION
+ *      Hand the long characteristic value reassembled in the device's buffer
+ *      to the service once and move onto the next read/write procedure.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which the value has been read
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appGattLongReadComplete(uint16 dev)
+{
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data = &g_app_gatt_data.dev_data[dev];
+    /* Service which requested the read */
+    SERVICE_FUNC_POINTERS_T *pService = dev_data->read_pService;
+
+    dev_data->long_handle = INVALID_ATT_HANDLE;
+
+    if(pService != NULL &&
+       pService->readConfirm != NULL)
+    {
+        pService->readConfirm(dev,
+                              dev_data->long_size,
+                              dev_data->long_value);
+    }
+
+    /* Reset read_pService to make sure it is not re-used by mistake */
+    dev_data->read_pService = NULL;
+
+    /* Perform next read/write procedure */
+    NextReadWriteProcedure(dev, TRUE);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appGattSignalGattLongCharValInd
+ *
+ *  DESCRIPTION
+ *      This function handles GATT_LONG_CHAR_VAL_IND messages received from
+ *      the firmware, each of which carries one part of the value requested
+ *      by GattReadLongCharValue(). The part is copied into the device's
+ *      reassembly buffer at its offset. Octets beyond the end of the buffer
+ *      are dropped, so a longer value is delivered truncated.
+ *
+ *  PARAMETERS
+ *      p_event_data [in]       Event data
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appGattSignalGattLongCharValInd(
+                    GATT_LONG_CHAR_VAL_IND_T *p_event_data)
+{
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data;
+    /* Number of octets kept from this part */
+    uint16 kept;
+
+    if(dev == MAX_CONNECTED_DEVICES ||
+       g_app_gatt_data.dev_data[dev].long_handle == INVALID_ATT_HANDLE ||
+       p_event_data->offset >= GATT_LONG_VALUE_SIZE)
+    {
+        /* The link is no longer known to the application, the read has been
+         * abandoned, or the part lies beyond the buffer
+         */
+        return;
+    }
+
+    dev_data = &g_app_gatt_data.dev_data[dev];
+    kept = MIN(p_event_data->size_value,
+               GATT_LONG_VALUE_SIZE - p_event_data->offset);
+
+    MemCopy(&dev_data->long_value[p_event_data->offset],
+            p_event_data->value,
+            kept);
+
+    if(p_event_data->offset + kept > dev_data->long_size)
+    {
+        dev_data->long_size = p_event_data->offset + kept;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appGattSignalGattReadLongCharValCfm
+ *
+ *  DESCRIPTION
+ *      This function handles GATT_READ_LONG_CHAR_VAL_CFM messages received
+ *      from the firmware, which end the read started by
+ *      GattReadLongCharValue(). The value itself has arrived in
+ *      GATT_LONG_CHAR_VAL_IND messages. An error ends the value at the parts
+ *      already received.
+ *
+ *  PARAMETERS
+ *      p_event_data [in]       Event data
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appGattSignalGattReadLongCharValCfm(
+                    GATT_READ_LONG_CHAR_VAL_CFM_T *p_event_data)
+{
+    /* Device which raised the event */
+    const uint16 dev = GetDeviceByConnHandle(p_event_data->cid);
+
+    if(dev == MAX_CONNECTED_DEVICES ||
+       g_app_gatt_data.dev_data[dev].long_handle == INVALID_ATT_HANDLE)
+    {
+        /* The link is no longer known to the application, or the read has
+         * been abandoned
+         */
+        return;
+    }
+
+    appGattLongReadComplete(dev);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
  *============================================================================*/
 
 /*----------------------------------------------------------------------------*
@@ -1141,23 +1691,30 @@ static void appGattSignalGattReadCharValCfm(GATT_READ_CHAR_VAL_CFM_T
  *      InitGattData
  *
  *  DESCRIPTION
- *      Initialise the application GATT data.
+ *      Initialise the application GATT data for a device. The data for the
+ *      other devices is left alone, as they may be being discovered.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device to initialise the GATT data for
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-void InitGattData(void)
+void InitGattData(uint16 dev)
 {
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data = &g_app_gatt_data.dev_data[dev];
+
     /* Initialise GATT data structure */
-    g_app_gatt_data.totalSupportedServices  = 0;
-    g_app_gatt_data.currentServiceIndex     = 0;
-    g_app_gatt_data.service_incomplete      = FALSE;
-    g_app_gatt_data.read_pService           = NULL;
-    g_app_gatt_data.write_pService          = NULL;
-    g_app_gatt_data.pairing_in_progress     = FALSE;
+    dev_data->currentServiceIndex     = 0;
+    dev_data->primary_disc_complete   = FALSE;
+    dev_data->service_incomplete      = FALSE;
+    dev_data->read_pService           = NULL;
+    dev_data->write_pService          = NULL;
+    dev_data->config_in_progress      = FALSE;
+    dev_data->pairing_in_progress     = FALSE;
+    dev_data->long_handle             = INVALID_ATT_HANDLE;
+    dev_data->long_size               = 0;
 }
 
 /*----------------------------------------------------------------------------*
@@ -1225,6 +1782,11 @@ void GattStartScan(uint16 num,
                                        sizeof(SERVICE_FUNC_POINTERS_T *));
     }
 
+    /* Capture the services' UUIDs once, so that services are looked up
+     * without calling them back
+     */
+    appGattIndexServiceUuids();
+
     /* Configure the GAP modes and scan interval */
     if((GapSetMode(gap_role_central, 
                gap_mode_discover_no, 
@@ -1271,17 +1833,25 @@ bool GattDiscoverRemoteDatabase(uint16 connect_handle)
 {
     bool flag = FALSE;   /* Function status */
 
-    /* Get the connected device */
-    const uint16 dev = GetConnDevice();
+    /* Device with the GATT Database to be discovered */
+    const uint16 dev = GetDeviceByConnHandle(connect_handle);
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return FALSE;
+    }
+
+    dev_data = &g_app_gatt_data.dev_data[dev];
 
-    while(g_app_gatt_data.currentServiceIndex < 
+    while(dev_data->currentServiceIndex < 
           g_app_gatt_data.totalSupportedServices)
     {
-        /* Current service index */
-        const uint16 index = g_app_gatt_data.currentServiceIndex;
         /* Current service */
         const SERVICE_FUNC_POINTERS_T *pService =
-                                            g_app_gatt_data.serviceStore[index];
+                    g_app_gatt_data.serviceStore[dev_data->currentServiceIndex];
         
         /* Check if the service was found */
         if(pService != NULL && 
@@ -1290,23 +1860,21 @@ bool GattDiscoverRemoteDatabase(uint16 connect_handle)
                                             * this device
                                             */
         {            
-            if(pService->serviceUuid != NULL)
-            {
-                GATT_UUID_T type;           /* UUID type */
-                uint16      uuid[8];        /* UUID of service to find */
-                
-                /* Get the UUID and its type */
-                pService->serviceUuid(&type, uuid);
+            /* Index of the service, whose UUID was captured at GattStartScan */
+            const uint16 index = dev_data->currentServiceIndex;
 
+            if(g_app_gatt_data.uuid_type[index] != GATT_UUID_NONE)
+            {
                 /* Start the discover service by UUID procedure */
                 if(GattDiscoverPrimaryServiceByUuid(connect_handle, 
-                                                    type,
-                                                    uuid) == sys_status_success)
+                                        g_app_gatt_data.uuid_type[index],
+                                        g_app_gatt_data.uuid[index]) ==
+                                                        sys_status_success)
                 {
                     DebugIfWriteString("\r\nFinding service - 0x");
 
                     /* Printing only 16-bit UUIDs for now */
-                    DebugIfWriteUint16(uuid[0]); 
+                    DebugIfWriteUint16(g_app_gatt_data.uuid[index][0]); 
 
                     flag = TRUE;
                 }
@@ -1317,12 +1885,254 @@ bool GattDiscoverRemoteDatabase(uint16 connect_handle)
         }
         
         /* Check for the next service */
-        g_app_gatt_data.currentServiceIndex ++;
+        dev_data->currentServiceIndex ++;
     }
 
     return flag;
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattRestoreRemoteDatabase
+ *
+ *  DESCRIPTION
+ *      Restore the GATT Database of a device from its discovery cache, instead
+ *      of discovering it, and start configuring the device. The services are
+ *      restored through their restoreCache callbacks and notified to the
+ *      application in the same order as if they had been discovered.
+ *
+ *  PARAMETERS
+ *      connect_handle [in]     Handle of connection to device with the GATT
+ *                              Database to be restored
+ *      p_cache [in]            Discovery cache, GATT_CACHE_WORDS words
+ *
+ *  RETURNS
+ *      TRUE on success, FALSE if the cache is not valid for this version of
+ *      the application, in which case the GATT Database must be discovered
+ *----------------------------------------------------------------------------*/
+bool GattRestoreRemoteDatabase(uint16 connect_handle, const uint16 *p_cache)
+{
+    uint16 used = GATT_CACHE_HEADER_WORDS;  /* Words of the cache used */
+    uint16 record;                  /* Loop counter */
+    uint16 index;                   /* Index of service in serviceStore */
+    uint16 words;                   /* Words in a service's record */
+
+    /* Device with the GATT Database to be restored */
+    const uint16 dev = GetDeviceByConnHandle(connect_handle);
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link is no longer known to the application */
+        return FALSE;
+    }
+
+    dev_data = &g_app_gatt_data.dev_data[dev];
+
+    if(p_cache[GATT_CACHE_OFFSET_VERSION] != GATT_CACHE_VERSION ||
+       p_cache[GATT_CACHE_OFFSET_SUPPORTED] !=
+                                        g_app_gatt_data.totalSupportedServices)
+    {
+        /* The cache was stored by a different version of the application */
+        return FALSE;
+    }
+
+    for(record = 0; record < p_cache[GATT_CACHE_OFFSET_RECORDS]; record++)
+    {
+        /* Service whose record this is */
+        SERVICE_FUNC_POINTERS_T *pService;
+
+        if(used + GATT_CACHE_RECORD_HEADER_WORDS > GATT_CACHE_WORDS)
+        {
+            break;
+        }
+
+        index = p_cache[used];
+        words = p_cache[used + 1];
+        used += GATT_CACHE_RECORD_HEADER_WORDS;
+
+        if(index >= g_app_gatt_data.totalSupportedServices ||
+           words > GATT_CACHE_WORDS - used)
+        {
+            break;
+        }
+
+        pService = g_app_gatt_data.serviceStore[index];
+
+        if(pService == NULL ||
+           pService->restoreCache == NULL ||
+           !pService->restoreCache(dev, connect_handle, &p_cache[used], words))
+        {
+            break;
+        }
+
+        used += words;
+    }
+
+    if(record != p_cache[GATT_CACHE_OFFSET_RECORDS])
+    {
+        /* The cache is corrupt. Forget any services already restored. */
+        GattResetAllServices(dev);
+        return FALSE;
+    }
+
+    /* Notify the application about the services found */
+    for(index = 0; index < g_app_gatt_data.totalSupportedServices; index++)
+    {
+        /* Current service */
+        SERVICE_FUNC_POINTERS_T *pService = g_app_gatt_data.serviceStore[index];
+
+        if(pService != NULL &&
+           pService->isServiceFound != NULL &&
+           pService->isServiceFound(dev))
+        {
+            NotifyServiceFound(dev, pService);
+        }
+    }
+
+    DebugIfWriteString("\r\nRestored GATT Database from cache");
+
+    /* The services are known, so start configuring the peer device */
+    dev_data->primary_disc_complete = TRUE;
+    dev_data->currentServiceIndex = 0;
+    dev_data->config_in_progress = TRUE;
+
+    appGattConfigureServices(dev);
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattStoreDiscoveryCache
+ *
+ *  DESCRIPTION
+ *      Write the discovered GATT Database of a device to a discovery cache.
+ *      Nothing is cached if a service found on the device cannot write its
+ *      record, as the cache would then be incomplete.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device whose GATT Database has been discovered
+ *      p_cache [out]           Discovery cache, GATT_CACHE_WORDS words
+ *
+ *  RETURNS
+ *      Number of words of the cache used, or 0 if nothing is cached
+ *----------------------------------------------------------------------------*/
+uint16 GattStoreDiscoveryCache(uint16 dev, uint16 *p_cache)
+{
+    uint16 used = GATT_CACHE_HEADER_WORDS;  /* Words of the cache used */
+    uint16 index;                   /* Loop counter */
+    uint16 words = 0;               /* Words in a service's record */
+
+    p_cache[GATT_CACHE_OFFSET_VERSION]   = GATT_CACHE_VERSION;
+    p_cache[GATT_CACHE_OFFSET_SUPPORTED] =
+                                        g_app_gatt_data.totalSupportedServices;
+    p_cache[GATT_CACHE_OFFSET_RECORDS]   = 0;
+
+    for(index = 0; index < g_app_gatt_data.totalSupportedServices; index++)
+    {
+        /* Current service */
+        const SERVICE_FUNC_POINTERS_T *pService =
+                                            g_app_gatt_data.serviceStore[index];
+
+        if(pService == NULL ||
+           pService->isServiceFound == NULL ||
+           !pService->isServiceFound(dev))
+        {
+            /* Service is not present on the device */
+            continue;
+        }
+
+        if(pService->storeCache != NULL &&
+           used + GATT_CACHE_RECORD_HEADER_WORDS < GATT_CACHE_WORDS)
+        {
+            words = pService->storeCache(dev,
+                            &p_cache[used + GATT_CACHE_RECORD_HEADER_WORDS],
+                            GATT_CACHE_WORDS - used -
+                            GATT_CACHE_RECORD_HEADER_WORDS);
+        }
+
+        if(pService->storeCache == NULL || words == 0)
+        {
+            /* The service cannot be cached */
+            return 0;
+        }
+
+        p_cache[used]     = index;
+        p_cache[used + 1] = words;
+        used += GATT_CACHE_RECORD_HEADER_WORDS + words;
+
+        p_cache[GATT_CACHE_OFFSET_RECORDS]++;
+    }
+
+    return used;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattCacheStoreChar
+ *
+ *  DESCRIPTION
+ *      Write the cache record of a characteristic, GATT_CACHE_CHAR_WORDS
+ *      words, for a service's storeCache callback. Only the Client
+ *      Characteristic Configuration Descriptor is cached, as it is the only
+ *      descriptor the services keep.
+ *
+ *  PARAMETERS
+ *      p_cache [out]           Cache record of the characteristic
+ *      p_char [in]             Discovered characteristic
+ *      type [in]               Service-specific characteristic type
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void GattCacheStoreChar(uint16 *p_cache,
+                        const CHARACTERISTIC_T *p_char,
+                        uint16 type)
+{
+    p_cache[0] = p_char->uuid;
+    p_cache[1] = p_char->valHandle;
+    p_cache[2] = (type << 8) | (p_char->properties & 0xff);
+    p_cache[3] = (p_char->nDescriptors != 0) ?
+                            p_char->descriptors[0].handle : INVALID_ATT_HANDLE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattCacheRestoreChar
+ *
+ *  DESCRIPTION
+ *      Restore a characteristic from its cache record, for a service's
+ *      restoreCache callback.
+ *
+ *  PARAMETERS
+ *      p_cache [in]            Cache record of the characteristic
+ *      p_char [out]            Restored characteristic
+ *
+ *  RETURNS
+ *      Service-specific characteristic type
+ *----------------------------------------------------------------------------*/
+uint16 GattCacheRestoreChar(const uint16 *p_cache, CHARACTERISTIC_T *p_char)
+{
+    p_char->uuid       = p_cache[0];
+    p_char->valHandle  = p_cache[1];
+    p_char->properties = WORD_LSB(p_cache[2]);
+
+    if(p_cache[3] != INVALID_ATT_HANDLE)
+    {
+        p_char->descriptors[0].uuid   = UUID_CLIENT_CHAR_CFG;
+        p_char->descriptors[0].handle = p_cache[3];
+        p_char->nDescriptors          = 1;
+    }
+    else
+    {
+        p_char->nDescriptors          = 0;
+    }
+
+    return WORD_MSB(p_cache[2]);
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      GattResetAllServices
@@ -1367,17 +2177,17 @@ void GattResetAllServices(uint16 dev)
  *      GattServiceIncomplete
  *
  *  DESCRIPTION
- *      Check whether service discovery is still in progress.
+ *      Check whether service discovery is still in progress on a device.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device to check
  *
  *  RETURNS
  *      TRUE if there is a pending service discovery, otherwise FALSE
  *----------------------------------------------------------------------------*/
-bool GattServiceIncomplete(void)
+bool GattServiceIncomplete(uint16 dev)
 {
-    return g_app_gatt_data.service_incomplete;
+    return g_app_gatt_data.dev_data[dev].service_incomplete;
 }
 
 /*----------------------------------------------------------------------------*
@@ -1387,17 +2197,17 @@ bool GattServiceIncomplete(void)
  *  DESCRIPTION
  *      Checks whether the Pairing Procedure was initiated by the GATT layer,
  *      because gatt_status_insufficient_authentication or
- *      gatt_status_insufficient_authorization has been received.
+ *      gatt_status_insufficient_authorization has been received from a device.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device to check
  *
  *  RETURNS
  *      TRUE if the Pairing Procedure is in progress, otherwise FALSE
  *----------------------------------------------------------------------------*/
-bool GattPairingInitiated(void)
+bool GattPairingInitiated(uint16 dev)
 {
-    return g_app_gatt_data.pairing_in_progress;
+    return g_app_gatt_data.dev_data[dev].pairing_in_progress;
 }
 
 /*----------------------------------------------------------------------------*
@@ -1417,18 +2227,18 @@ bool GattPairingInitiated(void)
  *----------------------------------------------------------------------------*/
 void GattInitServiceCompletion(uint16 dev, uint16 connect_handle)
 {
-    if(g_app_gatt_data.service_incomplete)
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data = &g_app_gatt_data.dev_data[dev];
+
+    if(dev_data->service_incomplete)
     {
-        /* Current service index */
-        const uint16 index = g_app_gatt_data.currentServiceIndex;
         /* Current service */
-        const SERVICE_FUNC_POINTERS_T *pService =
-                                            g_app_gatt_data.serviceStore[index];
+        const SERVICE_FUNC_POINTERS_T *pService = appGattCurrentService(dev);
     
         if(pService != NULL &&
            pService->discoveryComplete != NULL)
         {
-            g_app_gatt_data.service_incomplete = 
+            dev_data->service_incomplete = 
                     pService->discoveryComplete(dev, connect_handle);
         }
     }
@@ -1451,24 +2261,27 @@ void GattInitServiceCompletion(uint16 dev, uint16 connect_handle)
  *----------------------------------------------------------------------------*/
 void GattInitiateProcedureAgain(uint16 dev)
 {
-    if(g_app_gatt_data.pairing_in_progress)
+    /* GATT procedure data for the device */
+    APP_GATT_DEV_DATA_T *dev_data = &g_app_gatt_data.dev_data[dev];
+
+    if(dev_data->pairing_in_progress)
     {
-        if(g_app_gatt_data.config_in_progress)
+        if(dev_data->config_in_progress)
         {
             /* The error was reported during configuration */
             appGattConfigureServices(dev);
         }
-        else if(g_app_gatt_data.write_pService ||
-                g_app_gatt_data.read_pService)
+        else if(dev_data->write_pService ||
+                dev_data->read_pService)
         {
             /* The error was reported while reading or writing a
              * characteristic value
              */
-            NextReadWriteProcedure(FALSE);
+            NextReadWriteProcedure(dev, FALSE);
         }
 
         /* Indicate that the Pairing Procedure has completed */
-        g_app_gatt_data.pairing_in_progress = FALSE;
+        dev_data->pairing_in_progress = FALSE;
     }
 }
 
@@ -1496,7 +2309,7 @@ bool GattReadRequest(uint16 dev,
     {
         if(pService->readRequest(dev, char_type))
         {
-            g_app_gatt_data.read_pService = pService;
+            g_app_gatt_data.dev_data[dev].read_pService = pService;
             return TRUE;
         }
         else
@@ -1511,6 +2324,36 @@ bool GattReadRequest(uint16 dev,
     return FALSE;
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattReadMultipleRequest
+ *
+ *  DESCRIPTION
+ *      Issue a request to read the values of several characteristics of a
+ *      service at once. The service chooses the characteristics.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to read characteristic values on
+ *      pService [in]           Service supplying the characteristics
+ *
+ *  RETURNS
+ *      TRUE if the request was successfully sent, otherwise FALSE
+ *----------------------------------------------------------------------------*/
+bool GattReadMultipleRequest(uint16 dev,
+                             SERVICE_FUNC_POINTERS_T *pService)
+{
+    if(pService != NULL && 
+       pService->readMultipleRequest != NULL &&
+       pService->readMultipleRequest(dev))
+    {
+        g_app_gatt_data.dev_data[dev].read_pService = pService;
+        return TRUE;
+    }
+
+    /* The service has nothing to read this way, or something went wrong */
+    return FALSE;
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      GattFindServiceByUuid
@@ -1528,57 +2371,16 @@ bool GattReadRequest(uint16 dev,
 SERVICE_FUNC_POINTERS_T *GattFindServiceByUuid(GATT_UUID_T uuid_type, 
                                                const uint16 uuid[])
 {
-    uint16 index;                   /* Loop counter */
+    /* Index of the service in serviceStore */
+    const uint16 index = appGattFindServiceIndex(uuid_type, uuid);
 
-    for (index = 0; index < g_app_gatt_data.totalSupportedServices; index++)
+    if(index == MAX_SUPPORTED_SERVICES)
     {
-        /* Pointer to current service */
-        SERVICE_FUNC_POINTERS_T *pService = g_app_gatt_data.serviceStore[index];
-        
-        if(pService != NULL &&
-           pService->serviceUuid != NULL)
-        {
-            GATT_UUID_T found_uuid_type;    /* Type of UUID found */
-            uint16      found_uuid[8];      /* UUID found */
-            
-            pService->serviceUuid(&found_uuid_type, found_uuid);
-            
-            if(found_uuid_type == uuid_type)
-            {
-                switch(uuid_type)
-                {
-                    case GATT_UUID16:
-                    {
-                        if(found_uuid[0] == uuid[0])
-                        {
-                            /* Service found */
-                            return pService;                            
-                        }
-                    }
-                    break;
-                    
-                    case GATT_UUID128:
-                    {
-                        if(!MemCmp(found_uuid, uuid, 8))
-                        {
-                            /* Service found */
-                            return pService;
-                        }
-                    }
-                    break;
-                    
-                    default:
-                    {
-                        /* Do Nothing */
-                    }
-                    break;
-                }
-            }
-        }
+        /* Service not found */
+        return NULL;
     }
 
-    /* Service not found */
-    return NULL;
+    return g_app_gatt_data.serviceStore[index];
 }
 
 /*----------------------------------------------------------------------------*
@@ -1704,6 +2506,36 @@ void GattDiscoveryEvent(lm_event_code event_code, LM_EVENT_T *p_event_data)
         }
         break;
 
+        case GATT_LONG_CHAR_VAL_IND:
+        {
+            /* Contains one part of the characteristic value requested by 
+             * GattReadLongCharValue()
+             */
+            appGattSignalGattLongCharValInd(
+                                 (GATT_LONG_CHAR_VAL_IND_T *)p_event_data);
+        }
+        break;
+
+        case GATT_READ_LONG_CHAR_VAL_CFM:
+        {
+            /* Indicates that the read started by GattReadLongCharValue() has
+             * completed
+             */
+            appGattSignalGattReadLongCharValCfm(
+                                 (GATT_READ_LONG_CHAR_VAL_CFM_T *)p_event_data);
+        }
+        break;
+
+        case GATT_READ_MULTI_CHAR_VAL_CFM:
+        {
+            /* Contains the characteristic values requested by 
+             * GattReadMultipleCharValues(), concatenated
+             */
+            appGattSignalGattReadMultiCharValCfm(
+                                (GATT_READ_MULTI_CHAR_VAL_CFM_T *)p_event_data);
+        }
+        break;
+
         case GATT_IND_CHAR_VAL_IND:
         {
             /* Indicates the peer device has indicated a characteristic value */
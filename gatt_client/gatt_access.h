@@ -64,6 +64,30 @@
 /* How often to scan for advertisements, ms */
 #define SCAN_INTERVAL                        (400)
 
+/* Version of the discovery cache layout. The discovered handles of a bonded
+ * device are kept in NVM, so that its GATT Database is not discovered again
+ * on every connection. Change the version whenever the supported services or
+ * the layout of a service's cache record change, so that caches stored by an
+ * earlier version are discovered again.
+ */
+#define GATT_CACHE_VERSION                   (0xCA01)
+
+/* Number of words in the discovery cache of a device */
+#define GATT_CACHE_WORDS                     (64)
+
+/* Number of words in the cache record of one characteristic: UUID, value
+ * handle, type and properties, and Client Characteristic Configuration
+ * Descriptor handle
+ */
+#define GATT_CACHE_CHAR_WORDS                (4)
+
+/* Number of words in the cache record of a service with the given number of
+ * characteristics: start handle, end handle, number of characteristics and
+ * the characteristics
+ */
+#define GATT_CACHE_SERVICE_WORDS(num_char)   \
+                                    (3 + (num_char) * GATT_CACHE_CHAR_WORDS)
+
 /*============================================================================*
  *  Public Data Types
  *============================================================================*/
@@ -259,6 +283,19 @@ typedef struct _SERVICE_FUNC_POINTERS_T
                         uint16 size,
                         uint8 *value);
 
+    /* Callback to read the values of several characteristics on the peer
+     * device in one request. Returns FALSE if the service has nothing to
+     * read this way, in which case its values are read one at a time.
+     */
+    bool (*readMultipleRequest)(uint16 dev_num);
+
+    /* Function called when the values of several characteristics have been
+     * successfully read. The values are concatenated in 'value'.
+     */
+    void (*readMultipleConfirm)(uint16 dev_num,
+                                uint16 size,
+                                uint8 *value);
+
     /* Configure the service to request notifications or indications */
     bool (*configureService)(uint16 dev_num);
 
@@ -267,6 +304,20 @@ typedef struct _SERVICE_FUNC_POINTERS_T
     
     /* Reset the service data */
     void (*resetServiceData)(uint16 dev_num);
+
+    /* Write the discovered handles of the service to a discovery cache
+     * record. Returns the number of words written, or 0 if the record does
+     * not fit in 'size' words.
+     */
+    uint16 (*storeCache)(uint16 dev_num, uint16 *p_cache, uint16 size);
+
+    /* Restore the service data from a discovery cache record, as if the
+     * service had just been discovered. Returns TRUE if the record is valid.
+     */
+    bool (*restoreCache)(uint16 dev_num,
+                         uint16 connect_handle,
+                         const uint16 *p_cache,
+                         uint16 size);
 } SERVICE_FUNC_POINTERS_T;
 
 /* Discovered Device structure - used once the advertising reports are received 
@@ -319,6 +370,30 @@ typedef struct _DEVICE_T
     
     /* Application state for the connected device */
     app_state                 state;
+
+    /* Service whose characteristics are read once the device is configured */
+    SERVICE_FUNC_POINTERS_T  *readService;
+
+    /* Next characteristic of readService to read */
+    uint16                    readCharType;
+
+    /* Set TRUE when the device is waiting for a connection parameter update
+     * requested on another device to complete
+     */
+    bool                      paramUpdatePending;
+
+    /* Time at which the link was established */
+    uint32                    connectTime;
+
+    /* Set TRUE when the discovery cache in NVM matches the device's GATT
+     * Database
+     */
+    bool                      gattCacheValid;
+
+    /* Set TRUE when the device has indicated that its GATT Database has
+     * changed while it was being discovered or configured
+     */
+    bool                      gattDatabaseChanged;
 } DEVICE_T;
 
 /* Attribute description */
@@ -361,15 +436,15 @@ typedef struct _CHARACTERISTIC_T
  *      InitGattData
  *
  *  DESCRIPTION
- *      Initialise the application GATT data.
+ *      Initialise the application GATT data for a device.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device to initialise the GATT data for
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-extern void InitGattData(void);
+extern void InitGattData(uint16 dev);
 
 /*----------------------------------------------------------------------------*
  *  NAME
@@ -427,6 +502,80 @@ extern void GattStartScan(uint16 num,
  *----------------------------------------------------------------------------*/
 extern bool GattDiscoverRemoteDatabase(uint16 connectHandle);
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattRestoreRemoteDatabase
+ *
+ *  DESCRIPTION
+ *      Restore the GATT Database of a device from its discovery cache, instead
+ *      of discovering it, and start configuring the device.
+ *
+ *  PARAMETERS
+ *      connect_handle [in]     Handle of connection to device with the GATT
+ *                              Database to be restored
+ *      p_cache [in]            Discovery cache, GATT_CACHE_WORDS words
+ *
+ *  RETURNS
+ *      TRUE on success, FALSE if the cache is not valid for this version of
+ *      the application, in which case the GATT Database must be discovered
+ *----------------------------------------------------------------------------*/
+extern bool GattRestoreRemoteDatabase(uint16 connect_handle,
+                                      const uint16 *p_cache);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattStoreDiscoveryCache
+ *
+ *  DESCRIPTION
+ *      Write the discovered GATT Database of a device to a discovery cache.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device whose GATT Database has been discovered
+ *      p_cache [out]           Discovery cache, GATT_CACHE_WORDS words
+ *
+ *  RETURNS
+ *      Number of words of the cache used, or 0 if nothing is cached
+ *----------------------------------------------------------------------------*/
+extern uint16 GattStoreDiscoveryCache(uint16 dev, uint16 *p_cache);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattCacheStoreChar
+ *
+ *  DESCRIPTION
+ *      Write the cache record of a characteristic, GATT_CACHE_CHAR_WORDS
+ *      words, for a service's storeCache callback.
+ *
+ *  PARAMETERS
+ *      p_cache [out]           Cache record of the characteristic
+ *      p_char [in]             Discovered characteristic
+ *      type [in]               Service-specific characteristic type
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void GattCacheStoreChar(uint16 *p_cache,
+                               const CHARACTERISTIC_T *p_char,
+                               uint16 type);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattCacheRestoreChar
+ *
+ *  DESCRIPTION
+ *      Restore a characteristic from its cache record, for a service's
+ *      restoreCache callback.
+ *
+ *  PARAMETERS
+ *      p_cache [in]            Cache record of the characteristic
+ *      p_char [out]            Restored characteristic
+ *
+ *  RETURNS
+ *      Service-specific characteristic type
+ *----------------------------------------------------------------------------*/
+extern uint16 GattCacheRestoreChar(const uint16 *p_cache,
+                                   CHARACTERISTIC_T *p_char);
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      GattResetAllServices
@@ -448,15 +597,15 @@ extern void GattResetAllServices(uint16 dev);
  *      GattServiceIncomplete
  *
  *  DESCRIPTION
- *      Check whether service discovery is still in progress.
+ *      Check whether service discovery is still in progress on a device.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device to check
  *
  *  RETURNS
  *      TRUE if there is a pending service discovery, otherwise FALSE
  *----------------------------------------------------------------------------*/
-extern bool GattServiceIncomplete(void);
+extern bool GattServiceIncomplete(uint16 dev);
 
 /*----------------------------------------------------------------------------*
  *  NAME
@@ -465,15 +614,15 @@ extern bool GattServiceIncomplete(void);
  *  DESCRIPTION
  *      Checks whether the Pairing Procedure was initiated by the GATT layer,
  *      because gatt_status_insufficient_authentication or
- *      gatt_status_insufficient_authorization has been received.
+ *      gatt_status_insufficient_authorization has been received from a device.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device to check
  *
  *  RETURNS
  *      TRUE if the Pairing Procedure is in progress, otherwise FALSE
  *----------------------------------------------------------------------------*/
-extern bool GattPairingInitiated(void);
+extern bool GattPairingInitiated(uint16 dev);
 
 /*----------------------------------------------------------------------------*
  *  NAME
@@ -528,6 +677,24 @@ extern bool GattReadRequest(uint16 dev,
                             SERVICE_FUNC_POINTERS_T *pService,
                             uint16 char_type);
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattReadMultipleRequest
+ *
+ *  DESCRIPTION
+ *      Issue a request to read the values of several characteristics of a
+ *      service at once.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to read characteristic values on
+ *      pService [in]           Service supplying the characteristics
+ *
+ *  RETURNS
+ *      TRUE if the request was successfully sent, otherwise FALSE
+ *----------------------------------------------------------------------------*/
+extern bool GattReadMultipleRequest(uint16 dev,
+                                    SERVICE_FUNC_POINTERS_T *pService);
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      GattFindServiceByUuid
@@ -42,20 +42,22 @@
 #include "debug_interface.h"/* Application debug routines */
 #include "battery_service_data.h"   /* Battery Service interface */
 #include "dev_info_service_data.h"  /* Device Info Service interface */
+#include "gatt_service_data.h"  /* GATT Service interface */
+#include "throughput.h"     /* Throughput statistics */
 
 /*============================================================================*
  *  Private Definitions
  *============================================================================*/
 
-/* Maximum number of timers */
+/* Maximum number of timers. Each device has its own timers. */
 #ifdef PAIRING_SUPPORT
     /* 1 - Discovery Procedure and connecting state expiry timer
      * 2 - Bonding timer
      */
-    #define MAX_APP_TIMERS                 (2)
+    #define MAX_APP_TIMERS                 (2 * MAX_CONNECTED_DEVICES)
 #else
     /* 1 - Discovery Procedure and connecting state expiry timer */
-    #define MAX_APP_TIMERS                 (1)
+    #define MAX_APP_TIMERS                 (MAX_CONNECTED_DEVICES)
 #endif /* PAIRING_SUPPORT */
 
 /* This macro defines which key types should be excluded from NVM store */
@@ -65,14 +67,15 @@
 /* Magic value to check the sanity of Non-Volatile Memory (NVM) region used by
  * the application. This value is unique for each application.
  */
-#define NVM_SANITY_MAGIC               (0xABAB)
+#define NVM_SANITY_MAGIC               (0xABAC)
 
 /* NVM offset for NVM sanity word */
 #define NVM_OFFSET_SANITY_WORD         (0)
 
 /* Total size required in NVM for each bonded device */
 #define NVM_OFFSET_SIZE_EACH_DEV       (sizeof(g_app_data.devices[0].bonded)\
-                                        + sizeof(g_app_data.devices[0].keys))
+                                        + sizeof(g_app_data.devices[0].keys) \
+                                        + GATT_CACHE_WORDS)
 
 /* Calculate NVM offset for each bonded device */
 #define NVM_OFFSET_DEV_NUM(x)          ((x) * NVM_OFFSET_SIZE_EACH_DEV)
@@ -85,6 +88,12 @@
 #define NVM_OFFSET_SM_KEYS(x)          (NVM_OFFSET_BONDED_FLAG(x) + \
                                         sizeof(g_app_data.devices[(x)].bonded))
 
+/* NVM offset for the discovery cache, which holds the handles discovered on
+ * the bonded device so that they need not be discovered on every connection
+ */
+#define NVM_OFFSET_GATT_CACHE(x)       (NVM_OFFSET_SM_KEYS(x) + \
+                                        sizeof(g_app_data.devices[0].keys))
+
 /* Timer value for starting the Discovery Procedure once the connection is 
  * established. During this time pairing is initiated and completed, if pairing
  * is supported by the application or initiated by the peer device.
@@ -110,22 +119,31 @@ typedef struct _APP_DATA_T
     /* Connected devices */
     DEVICE_T                   devices[MAX_CONNECTED_DEVICES];
 
-    /* Application timer ID */
-    timer_id                   app_timer;
+    /* Application timer ID for each device */
+    timer_id                   app_timer[MAX_CONNECTED_DEVICES];
 
 #ifdef PAIRING_SUPPORT
-    /* Application bonding ID */
-    timer_id                   bonding_timer;
+    /* Application bonding ID for each device */
+    timer_id                   bonding_timer[MAX_CONNECTED_DEVICES];
 #endif /* PAIRING_SUPPORT */
 
-    /* Currently connected device */
-    uint16                     dev_num;
+    /* Offset to NVM data for each device */
+    uint16                     nvm_dev_num[MAX_CONNECTED_DEVICES];
 
-    /* Offset to NVM data for the current device */
-    uint16                     nvm_dev_num;
+    /* Device waiting for LS_CONNECTION_PARAM_UPDATE_CFM. Only one connection
+     * parameter update is requested at a time, so that the confirmation is
+     * handled for the right device.
+     */
+    uint16                     param_update_dev;
 
     /* Number of connected devices */
     uint16                     num_conn;
+
+    /* Discovery cache of the device being restored or stored. It is only
+     * used while it is read from or written to NVM, so one is enough for all
+     * the devices.
+     */
+    uint16                     gatt_cache[GATT_CACHE_WORDS];
 } APP_DATA_T;
 
 /*============================================================================*
@@ -134,6 +152,7 @@ typedef struct _APP_DATA_T
 
 /* List of supported services' callback function tables */
 static SERVICE_FUNC_POINTERS_T *g_supported_services[] = {
+    &GattServiceFuncStore,      /* GATT Service */
     &BatteryServiceFuncStore,   /* Battery Service */
     &DeviceInfoServiceFuncStore /* Device Information Service */
 };
@@ -151,8 +170,11 @@ static APP_DATA_T g_app_data;
 /* Initiate the scanning process for the connected device */
 static void appStartScan(void);
 
-/* Initialise application data structure */
-static void appDataInit(void);
+/* Initialise application data structure for a device */
+static void appDataInit(uint16 dev);
+
+/* Start scanning for the next device, if there is room for it */
+static void appScanForNextDevice(void);
 
 /* Check and read if the NVM data contains the specified device */
 static void checkPersistentStore(uint16 *nvmDevNum, TYPED_BD_ADDR_T bdAddress);
@@ -163,7 +185,19 @@ static void readPersistentStore(uint16 dev_num, uint16 nvm_dev_num);
 /* Store the NVM data. readPersistent store must have been called at least once
  * before calling this function.
  */
-static void storeNvmData(void);
+static void storeNvmData(uint16 dev);
+
+/* Mark the discovery cache of a bonded device in NVM as not valid */
+static void invalidateGattCache(uint16 nvm_dev_num);
+
+/* Store the discovered GATT Database of a bonded device in NVM */
+static void storeGattCache(uint16 dev);
+
+/* Restore the GATT Database of a bonded device from NVM */
+static bool restoreGattCache(uint16 dev);
+
+/* Discover the GATT Database of a configured device again */
+static void appRediscover(uint16 dev);
 
 /* Exit the initialisation state */
 static void appInitExit(uint16 dev);
@@ -183,6 +217,18 @@ static void appConnectingStateTimerExpiry(timer_id tid);
 /* Find the device from the given connection handle */
 static uint16 findDeviceByHciHandle(hci_connection_handle_t handle);
 
+/* Find the device in the given state */
+static uint16 findDeviceByState(app_state state);
+
+/* Find the device which owns the given timer */
+static uint16 findDeviceByTimer(const timer_id timers[], timer_id tid);
+
+/* Find the connected device with the given address */
+static uint16 findDeviceByAddress(const TYPED_BD_ADDR_T *p_addr);
+
+/* Request the next pending connection parameter update */
+static void appStartNextParamUpdate(void);
+
 #ifdef PAIRING_SUPPORT
     /* Start the Pairing Procedure */
     static void appPairingTimerHandlerExpiry(timer_id tid);
@@ -253,33 +299,77 @@ static void appStartScan(void)
  *
  *  DESCRIPTION
  *      This function is called to initialise the application data structure
+ *      for a device
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device number
  *
  *  RETURNS
  *      Nothing
  *---------------------------------------------------------------------------*/
-static void appDataInit(void)
+static void appDataInit(uint16 dev)
 {
     /* Initialise general application timer */
-    if (g_app_data.app_timer != TIMER_INVALID)
+    if (g_app_data.app_timer[dev] != TIMER_INVALID)
     {
-        TimerDelete(g_app_data.app_timer);
-        g_app_data.app_timer = TIMER_INVALID;
+        TimerDelete(g_app_data.app_timer[dev]);
+        g_app_data.app_timer[dev] = TIMER_INVALID;
     }
 
 #ifdef PAIRING_SUPPORT
     /* Initialise bonding timer */
-    if (g_app_data.bonding_timer != TIMER_INVALID)
+    if (g_app_data.bonding_timer[dev] != TIMER_INVALID)
     {
-        TimerDelete(g_app_data.bonding_timer);
-        g_app_data.bonding_timer = TIMER_INVALID;
+        TimerDelete(g_app_data.bonding_timer[dev]);
+        g_app_data.bonding_timer[dev] = TIMER_INVALID;
     }
 #endif /* PAIRING_SUPPORT */
 
     /* Initialise the application GATT data. */
-    InitGattData();
+    InitGattData(dev);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appScanForNextDevice
+ *
+ *  DESCRIPTION
+ *      This function starts scanning on the next spare slot in the application
+ *      data structure, so that another device can be connected while those
+ *      already connected are discovered and configured.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *---------------------------------------------------------------------------*/
+static void appScanForNextDevice(void)
+{
+    uint16 dev;                     /* Loop counter */
+
+    /* Find the device number of the next spare slot in the application data
+     * structure.
+     */
+    for(dev = 0; dev < MAX_CONNECTED_DEVICES; dev++)
+    {
+        if(!g_app_data.devices[dev].connected &&
+           g_app_data.devices[dev].state == app_state_init)
+        {
+            /* Spare slot found, exit the loop */
+            break;
+        }
+    }
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* Maximum limit reached. No more devices may be connected. */
+        DebugIfWriteString("No more connections available\r\n");
+        return;
+    }
+
+    /* Start scanning for the next device */
+    SetState(dev, app_state_scanning);
 }
 
 /*----------------------------------------------------------------------------*
@@ -423,22 +513,20 @@ static void readPersistentStore(uint16 dev, uint16 nvm_dev_num)
             {
                 /* Initialise bonded device flag */
                 g_app_data.devices[dev].bonded = FALSE;
-        
-                /* Store bonded device flag in NVM */
-                Nvm_Write((uint16 *)&g_app_data.devices[dev].bonded, 
-                           sizeof(g_app_data.devices[dev].bonded), 
-                          NVM_OFFSET_BONDED_FLAG(dev));
             }
             
-            for (; dev < MAX_BONDED_DEVICES; dev++)
+            for(dev = 0; dev < MAX_BONDED_DEVICES; dev++)
             {
-                /* If NVM has support for more than MAX_CONNECTED_DEVICES
-                 * devices, initialise bonded device flag in NVM using the
-                 * first device as a template.
+                /* Store bonded device flag in NVM for each device the NVM
+                 * has support for, using the first device as a template. The
+                 * number of connected devices may exceed it.
                  */
                 Nvm_Write((uint16 *)&g_app_data.devices[0].bonded, 
                            sizeof(g_app_data.devices[0].bonded), 
                           NVM_OFFSET_BONDED_FLAG(dev));
+
+                /* No GATT Database has been cached for the device */
+                invalidateGattCache(dev);
             }
         }
     }
@@ -453,33 +541,32 @@ static void readPersistentStore(uint16 dev, uint16 nvm_dev_num)
  *      been called at least once.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device number
  *
  *  RETURNS
  *      Nothing
  *---------------------------------------------------------------------------*/
-static void storeNvmData(void)
+static void storeNvmData(uint16 dev)
 {
     uint16 nvm_sanity = 0xffff;         /* NVM sanity magic number */
-    uint16 dev = 0;                     /* Device number */
+    uint16 nvm_dev = 0;                 /* Bonded device number */
+    uint16 other;                       /* Other connected device number */
     bool bondedFlag = FALSE;            /* Whether device is bonded */
     
-    /* Check NVM to see whether the currently connected device has already
-     * bonded with the Client. If it has then we assume the same keys are
-     * used again.
+    /* Check NVM to see whether the device has already bonded with the
+     * Client. If it has then we assume the same keys are used again.
      */
-    checkPersistentStore(&dev, 
-                         g_app_data.devices[(g_app_data.dev_num)].address);
+    checkPersistentStore(&nvm_dev, g_app_data.devices[dev].address);
 
-    if(dev != MAX_BONDED_DEVICES)
+    if(nvm_dev != MAX_BONDED_DEVICES)
     {
         /* Device data already exists in NVM. Implies device is already
          * paired.
          */
-        if(dev != g_app_data.nvm_dev_num)
+        if(nvm_dev != g_app_data.nvm_dev_num[dev])
         {
             /* Update the offset to the device's bonding data in NVM */
-            g_app_data.nvm_dev_num = dev;
+            g_app_data.nvm_dev_num[dev] = nvm_dev;
         }
 
         /* Do not store the data again */
@@ -495,19 +582,19 @@ static void storeNvmData(void)
         /* If pairing data for the current device is not already stored in NVM,
          * then look for the first free slot in NVM to store the data in
          */
-        for(dev = 0; dev < MAX_BONDED_DEVICES; dev++)
+        for(nvm_dev = 0; nvm_dev < MAX_BONDED_DEVICES; nvm_dev++)
         {
             Nvm_Read((uint16*)&bondedFlag,
                       sizeof(bondedFlag),
-                      NVM_OFFSET_BONDED_FLAG(dev));
+                      NVM_OFFSET_BONDED_FLAG(nvm_dev));
             if(!bondedFlag)
             {
-                g_app_data.nvm_dev_num = dev;
+                g_app_data.nvm_dev_num[dev] = nvm_dev;
                 break;
             }
         }
 
-        if(dev == MAX_BONDED_DEVICES)
+        if(nvm_dev == MAX_BONDED_DEVICES)
         {
             /* If the NVM has no room to store new bonded devices, overwrite
              * the last entry in the list.
@@ -515,21 +602,144 @@ static void storeNvmData(void)
              * It may be preferrable to reject the pairing request if the list
              * is full instead.
              */
-            g_app_data.nvm_dev_num = MAX_BONDED_DEVICES - 1;
+            g_app_data.nvm_dev_num[dev] = MAX_BONDED_DEVICES - 1;
+        }
+
+        /* A connected device which still refers to the slot no longer owns
+         * it, so it must neither write its keys nor its discovery cache there
+         */
+        for(other = 0; other < MAX_CONNECTED_DEVICES; other++)
+        {
+            if(other != dev &&
+               g_app_data.nvm_dev_num[other] == g_app_data.nvm_dev_num[dev])
+            {
+                g_app_data.nvm_dev_num[other] = MAX_BONDED_DEVICES;
+                g_app_data.devices[other].gattCacheValid = FALSE;
+            }
         }
 
         /* Store the bonded flag */
-        Nvm_Write((uint16*)&g_app_data.devices[(g_app_data.dev_num)].bonded,
-                  sizeof(g_app_data.devices[(g_app_data.dev_num)].bonded),
-                  NVM_OFFSET_BONDED_FLAG(g_app_data.nvm_dev_num));
+        Nvm_Write((uint16*)&g_app_data.devices[dev].bonded,
+                  sizeof(g_app_data.devices[dev].bonded),
+                  NVM_OFFSET_BONDED_FLAG(g_app_data.nvm_dev_num[dev]));
 
         /* Store the Link keys */
-        Nvm_Write((uint16*)&g_app_data.devices[(g_app_data.dev_num)].keys, 
-                   sizeof(g_app_data.devices[(g_app_data.dev_num)].keys),
-                   NVM_OFFSET_SM_KEYS(g_app_data.nvm_dev_num));
+        Nvm_Write((uint16*)&g_app_data.devices[dev].keys, 
+                   sizeof(g_app_data.devices[dev].keys),
+                   NVM_OFFSET_SM_KEYS(g_app_data.nvm_dev_num[dev]));
+
+        /* The slot may hold the discovery cache of the device it last held,
+         * so drop it. The cache is stored once the device is configured.
+         */
+        invalidateGattCache(g_app_data.nvm_dev_num[dev]);
+        g_app_data.devices[dev].gattCacheValid = FALSE;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      invalidateGattCache
+ *
+ *  DESCRIPTION
+ *      Mark the discovery cache of a bonded device in NVM as not valid, so
+ *      that its GATT Database is discovered on the next connection.
+ *
+ *  PARAMETERS
+ *      nvm_dev_num [in]        Index to NVM data for the device
+ *
+ *  RETURNS
+ *      Nothing
+ *---------------------------------------------------------------------------*/
+static void invalidateGattCache(uint16 nvm_dev_num)
+{
+    /* Clearing the version word is enough to make the cache not valid */
+    uint16 version = 0;
+
+    Nvm_Write(&version,
+              sizeof(version),
+              NVM_OFFSET_GATT_CACHE(nvm_dev_num));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      storeGattCache
+ *
+ *  DESCRIPTION
+ *      Store the discovered GATT Database of a bonded device in NVM, unless
+ *      it is already there.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device number
+ *
+ *  RETURNS
+ *      Nothing
+ *---------------------------------------------------------------------------*/
+static void storeGattCache(uint16 dev)
+{
+    /* Number of words of the cache used */
+    uint16 words;
+
+    if(!g_app_data.devices[dev].bonded ||
+       g_app_data.nvm_dev_num[dev] >= MAX_BONDED_DEVICES ||
+       g_app_data.devices[dev].gattCacheValid)
+    {
+        /* Only the GATT Database of a bonded device is cached */
+        return;
+    }
+
+    words = GattStoreDiscoveryCache(dev, g_app_data.gatt_cache);
+
+    if(words != 0)
+    {
+        Nvm_Write(g_app_data.gatt_cache,
+                  words,
+                  NVM_OFFSET_GATT_CACHE(g_app_data.nvm_dev_num[dev]));
+
+        g_app_data.devices[dev].gattCacheValid = TRUE;
     }
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      restoreGattCache
+ *
+ *  DESCRIPTION
+ *      Restore the GATT Database of a bonded device from the discovery cache
+ *      in NVM, and start configuring the device.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device number
+ *
+ *  RETURNS
+ *      TRUE if the GATT Database has been restored
+ *      FALSE if it has to be discovered
+ *---------------------------------------------------------------------------*/
+static bool restoreGattCache(uint16 dev)
+{
+    if(!g_app_data.devices[dev].bonded ||
+       g_app_data.nvm_dev_num[dev] >= MAX_BONDED_DEVICES)
+    {
+        return FALSE;
+    }
+
+    Nvm_Read(g_app_data.gatt_cache,
+             GATT_CACHE_WORDS,
+             NVM_OFFSET_GATT_CACHE(g_app_data.nvm_dev_num[dev]));
+
+    if(!GattRestoreRemoteDatabase(g_app_data.devices[dev].connectHandle,
+                                  g_app_data.gatt_cache))
+    {
+        return FALSE;
+    }
+
+    /* The cache matches the device's GATT Database unless the device
+     * indicates otherwise
+     */
+    g_app_data.devices[dev].gattCacheValid = TRUE;
+
+    return TRUE;
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      appInitExit
@@ -572,6 +782,36 @@ static void appStartDiscoveryProcedure(uint16 dev)
     SetState(dev, app_state_discovering);
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appRediscover
+ *
+ *  DESCRIPTION
+ *      Forget the services found on a configured device and start the
+ *      Discovery Procedure again, after the device has changed its GATT
+ *      Database.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device number
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appRediscover(uint16 dev)
+{
+    DebugIfWriteString("\r\nGATT Database changed, rediscovering\r\n");
+
+    GattResetAllServices(dev);
+    InitGattData(dev);
+
+    g_app_data.devices[dev].totalConnectedServices = 0;
+    g_app_data.devices[dev].readService = NULL;
+    g_app_data.devices[dev].readCharType = 0;
+    g_app_data.devices[dev].gattDatabaseChanged = FALSE;
+
+    appStartDiscoveryProcedure(dev);
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      appStartDiscoveryTimerExpiry
@@ -588,17 +828,18 @@ static void appStartDiscoveryProcedure(uint16 dev)
 static void appStartDiscoveryTimerExpiry(timer_id tid)
 {
     /* Device Number */
-    const uint16 dev = g_app_data.dev_num;
-    /* Connection handle */
-    const uint16 connectHandle = g_app_data.devices[dev].connectHandle;
+    const uint16 dev = findDeviceByTimer(g_app_data.app_timer, tid);
 
-    if(tid == g_app_data.app_timer)
+    if(dev < MAX_CONNECTED_DEVICES)
     {
         /* Timer has just expired, so mark it as invalid */
-        g_app_data.app_timer = TIMER_INVALID;
+        g_app_data.app_timer[dev] = TIMER_INVALID;
 
-        /* Start discovering the connected device's GATT database */
-        if(!GattDiscoverRemoteDatabase(connectHandle))
+        /* Use the handles cached for a bonded device, or else start
+         * discovering the connected device's GATT database
+         */
+        if(!restoreGattCache(dev) &&
+           !GattDiscoverRemoteDatabase(g_app_data.devices[dev].connectHandle))
         {
             /* No supported services found or Discovery Procedure failed */
             
@@ -644,8 +885,10 @@ static void requestConnParamUpdate(uint16 dev)
     
     /* When the connection parameters have been updated the firmware will issue
      * a LS_CONNECTION_PARAM_UPDATE_CFM event, which causes this application to
-     * move to the app_state_configured state.
+     * move the device to the app_state_configured state.
      */
+    g_app_data.param_update_dev = dev;
+    g_app_data.devices[dev].paramUpdatePending = FALSE;
 }
 
 /*----------------------------------------------------------------------------*
@@ -665,12 +908,12 @@ static void requestConnParamUpdate(uint16 dev)
 static void appConnectingStateTimerExpiry(timer_id tid)
 {
     /* Device Number */
-    const uint16 dev = g_app_data.dev_num;
+    const uint16 dev = findDeviceByTimer(g_app_data.app_timer, tid);
 
-    if(tid == g_app_data.app_timer)
+    if(dev < MAX_CONNECTED_DEVICES)
     {
         /* Timer has just expired, so mark it as invalid */
-        g_app_data.app_timer = TIMER_INVALID;
+        g_app_data.app_timer[dev] = TIMER_INVALID;
 
         /* If we're still in the connecting state, cancel the connection */
         if(g_app_data.devices[dev].state == app_state_connecting)
@@ -709,6 +952,130 @@ static uint16 findDeviceByHciHandle(hci_connection_handle_t handle)
     return dev_num;
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      findDeviceByState
+ *
+ *  DESCRIPTION
+ *      This function finds the first device in g_app_data in the given state.
+ *
+ *  PARAMETERS
+ *      state [in]              State of device to find
+ *
+ *  RETURNS
+ *      Corresponding device number, or MAX_CONNECTED_DEVICES if no device is
+ *      in the state.
+ *----------------------------------------------------------------------------*/
+static uint16 findDeviceByState(app_state state)
+{
+    uint16 dev_num;             /* Number of device */
+
+    /* Browse through all devices */
+    for(dev_num = 0; dev_num < MAX_CONNECTED_DEVICES; dev_num++)
+    {
+        if(g_app_data.devices[dev_num].state == state)
+            break;
+    }
+    
+    return dev_num;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      findDeviceByTimer
+ *
+ *  DESCRIPTION
+ *      This function finds the device which owns the given timer in one of
+ *      the per-device timer arrays in g_app_data.
+ *
+ *  PARAMETERS
+ *      timers [in]             Per-device timer array to search
+ *      tid [in]                ID of timer to find
+ *
+ *  RETURNS
+ *      Corresponding device number, or MAX_CONNECTED_DEVICES if the timer is
+ *      not owned by any device, e.g. because of some race condition.
+ *----------------------------------------------------------------------------*/
+static uint16 findDeviceByTimer(const timer_id timers[], timer_id tid)
+{
+    uint16 dev_num;             /* Number of device */
+
+    /* Browse through all devices */
+    for(dev_num = 0; dev_num < MAX_CONNECTED_DEVICES; dev_num++)
+    {
+        if(timers[dev_num] == tid)
+            break;
+    }
+    
+    return dev_num;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      findDeviceByAddress
+ *
+ *  DESCRIPTION
+ *      This function finds the connected device in g_app_data with the given
+ *      address. The Security Manager events carry no connection handle, so
+ *      they are routed to their device by address.
+ *
+ *  PARAMETERS
+ *      p_addr [in]             Typed Bluetooth address of device to find
+ *
+ *  RETURNS
+ *      Corresponding device number, or MAX_CONNECTED_DEVICES if no connected
+ *      device has the address.
+ *----------------------------------------------------------------------------*/
+static uint16 findDeviceByAddress(const TYPED_BD_ADDR_T *p_addr)
+{
+    uint16 dev_num;             /* Number of device */
+
+    /* Browse through all devices */
+    for(dev_num = 0; dev_num < MAX_CONNECTED_DEVICES; dev_num++)
+    {
+        if(g_app_data.devices[dev_num].connected &&
+           !MemCmp(&g_app_data.devices[dev_num].address, p_addr,
+                   sizeof(TYPED_BD_ADDR_T)))
+            break;
+    }
+    
+    return dev_num;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appStartNextParamUpdate
+ *
+ *  DESCRIPTION
+ *      This function requests the connection parameter update for the next
+ *      configured device waiting for one, if no update is outstanding.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appStartNextParamUpdate(void)
+{
+    uint16 dev;                     /* Loop counter */
+
+    if(g_app_data.param_update_dev != MAX_CONNECTED_DEVICES)
+    {
+        /* Wait for the outstanding update to complete */
+        return;
+    }
+
+    for(dev = 0; dev < MAX_CONNECTED_DEVICES; dev++)
+    {
+        if(g_app_data.devices[dev].paramUpdatePending)
+        {
+            requestConnParamUpdate(dev);
+            break;
+        }
+    }
+}
+
 #ifdef PAIRING_SUPPORT
 /*----------------------------------------------------------------------------*
  *  NAME
@@ -726,12 +1093,12 @@ static uint16 findDeviceByHciHandle(hci_connection_handle_t handle)
 static void appPairingTimerHandlerExpiry(timer_id tid)
 {
     /* Device Number */
-    const uint16 dev = g_app_data.dev_num;
+    const uint16 dev = findDeviceByTimer(g_app_data.bonding_timer, tid);
 
-    if(g_app_data.bonding_timer == tid)
+    if(dev < MAX_CONNECTED_DEVICES)
     {
         /* Timer has just expired, so mark it as invalid */
-        g_app_data.bonding_timer = TIMER_INVALID;
+        g_app_data.bonding_timer[dev] = TIMER_INVALID;
 
         /* The bonding chance timer has expired. This means the remote has not
          * encrypted the link using old keys or pairing was not initiated.
@@ -778,8 +1145,14 @@ static void appPairingTimerHandlerExpiry(timer_id tid)
 static void handleSignalLmEvConnectionComplete(
                         HCI_EV_DATA_ULP_CONNECTION_COMPLETE_T *p_event_data)
 {
-    /* Device Number */
-    const uint16 dev = g_app_data.dev_num;
+    /* Device Number. Only one device is connecting at a time. */
+    const uint16 dev = findDeviceByState(app_state_connecting);
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* No connection was requested, ignore it */
+        return;
+    }
 
     if(p_event_data->status == HCI_SUCCESS)
     {
@@ -806,12 +1179,14 @@ static void handleSignalLmEvConnectionComplete(
 
         /* Increase the number of connections */
         g_app_data.num_conn++;
+        ThroughputLinksChanged(g_app_data.num_conn);
 
         /* Store the device details */
         g_app_data.devices[dev].connected = TRUE;
 
         g_app_data.devices[dev].hciHandle = p_event_data->connection_handle;
 
+        g_app_data.devices[dev].connectTime = TimeGet32();
 
         DebugIfWriteString("\r\n*** Connected to ");
         DebugIfWriteBdAddress(&g_app_data.devices[dev].address);
@@ -855,8 +1230,14 @@ static void handleSignalLmEvConnectionComplete(
  *----------------------------------------------------------------------------*/
 static void handleSignalGattConnectCfm(GATT_CONNECT_CFM_T *p_event_data)
 {
-    /* Device Number */
-    const uint16 dev = g_app_data.dev_num;
+    /* Device Number. Only one device is connecting at a time. */
+    const uint16 dev = findDeviceByState(app_state_connecting);
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* No connection was requested, ignore it */
+        return;
+    }
 
     if(p_event_data->result == sys_status_success && /* Connection successful */
        /* Compare the address and its type */
@@ -876,17 +1257,19 @@ static void handleSignalGattConnectCfm(GATT_CONNECT_CFM_T *p_event_data)
         DebugIfWriteUint16(p_event_data->cid);
         DebugIfWriteString(")\r\n");
 
-        checkPersistentStore(&g_app_data.nvm_dev_num,
+        checkPersistentStore(&g_app_data.nvm_dev_num[dev],
                              p_event_data->bd_addr);
 
-        if(g_app_data.nvm_dev_num < MAX_BONDED_DEVICES)
+        if(g_app_data.nvm_dev_num[dev] < MAX_BONDED_DEVICES)
         {
             /* Read Persistent Store data and store it*/
-            readPersistentStore(g_app_data.dev_num,
-                                g_app_data.nvm_dev_num);
+            readPersistentStore(dev, g_app_data.nvm_dev_num[dev]);
         }
 
-       SetState(dev, app_state_connected);
+        SetState(dev, app_state_connected);
+
+        /* Scan for the next device while this one is being discovered */
+        appScanForNextDevice();
     }
     else
     {
@@ -922,9 +1305,10 @@ static void handleSignalSmKeyRequestInd(SM_KEY_REQUEST_IND_T *p_event_data)
     /* Keys stored for the peer device, if previously paired */
     SM_KEYSET_T *keys = NULL;
     /* Device Number */
-    const uint16 dev = g_app_data.dev_num;
+    const uint16 dev = findDeviceByAddress(&p_event_data->remote_addr);
 
-    if(g_app_data.devices[dev].bonded && 
+    if(dev < MAX_CONNECTED_DEVICES &&
+       g_app_data.devices[dev].bonded && 
        !g_app_data.devices[dev].requestNewKeys)
     {
         /* If the device is bonded, and new keys have not been requested, use
@@ -934,7 +1318,7 @@ static void handleSignalSmKeyRequestInd(SM_KEY_REQUEST_IND_T *p_event_data)
     }
 
     /* Pass the keys to the SM */
-    SMKeyRequestResponse(&g_app_data.devices[dev].address, keys);
+    SMKeyRequestResponse(&p_event_data->remote_addr, keys);
 }
 
 /*---------------------------------------------------------------------------
@@ -953,9 +1337,10 @@ static void handleSignalSmKeyRequestInd(SM_KEY_REQUEST_IND_T *p_event_data)
 static void handleSignalSmKeysInd(SM_KEYS_IND_T *p_event_data)
 {
     /* Device Number */
-    const uint16 dev = g_app_data.dev_num;
+    const uint16 dev = findDeviceByAddress(&p_event_data->remote_addr);
 
-    if(p_event_data->keys != NULL && /* Valid pointer */
+    if(dev < MAX_CONNECTED_DEVICES && /* Known device */
+       p_event_data->keys != NULL && /* Valid pointer */
        !(p_event_data->keys->keys_present & (uint16)INVALID_KEYS) &&
        (p_event_data->keys->keys_present & (uint16)(1 << SM_BD_ADDR)) &&
        ((g_app_data.devices[dev].bonded != TRUE) ||
@@ -966,12 +1351,13 @@ static void handleSignalSmKeysInd(SM_KEYS_IND_T *p_event_data)
                 p_event_data->keys, 
                 sizeof(SM_KEYSET_T));
 
-        if(g_app_data.devices[dev].requestNewKeys == TRUE)
+        if(g_app_data.devices[dev].requestNewKeys == TRUE &&
+           g_app_data.nvm_dev_num[dev] < MAX_BONDED_DEVICES)
         {
             /* Store the new keys in NVM */
             Nvm_Write((uint16*)&g_app_data.devices[(dev)].keys, 
                        sizeof(g_app_data.devices[(dev)].keys),
-                       NVM_OFFSET_SM_KEYS(g_app_data.nvm_dev_num));
+                       NVM_OFFSET_SM_KEYS(g_app_data.nvm_dev_num[dev]));
         }
     }
 }
@@ -993,8 +1379,14 @@ static void handleSignalSmKeysInd(SM_KEYS_IND_T *p_event_data)
 static void handleSignalSmSimplePairingCompleteInd(
                                  SM_SIMPLE_PAIRING_COMPLETE_IND_T *p_event_data)
 {
-    /* Device Number - to improve readability */
-    const uint16 dev = g_app_data.dev_num;
+    /* Device Number */
+    const uint16 dev = findDeviceByAddress(&p_event_data->bd_addr);
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The link has gone, ignore it */
+        return;
+    }
 
     /* Handling signal as per current state */
     switch(g_app_data.devices[dev].state)
@@ -1011,10 +1403,10 @@ static void handleSignalSmSimplePairingCompleteInd(
                     /* Make sure pairing is not requested again by deleting the 
                      * timer
                      */
-                    if (g_app_data.bonding_timer != TIMER_INVALID)
+                    if (g_app_data.bonding_timer[dev] != TIMER_INVALID)
                     {
-                        TimerDelete(g_app_data.bonding_timer);
-                        g_app_data.bonding_timer = TIMER_INVALID;
+                        TimerDelete(g_app_data.bonding_timer[dev]);
+                        g_app_data.bonding_timer[dev] = TIMER_INVALID;
                     }
 #endif /* PAIRING_SUPPORT */
 
@@ -1022,7 +1414,7 @@ static void handleSignalSmSimplePairingCompleteInd(
                     DebugIfWriteBdAddress(&p_event_data->bd_addr);
                     DebugIfWriteString("\r\n");
 
-                    if(GattServiceIncomplete() && 
+                    if(GattServiceIncomplete(dev) && 
                        ((!g_app_data.devices[dev].bonded) ||
                        g_app_data.devices[(dev)].encryptAgain))
                         /* Make sure that the device was initially not bonded 
@@ -1035,7 +1427,7 @@ static void handleSignalSmSimplePairingCompleteInd(
                         GattInitServiceCompletion(dev, 
                                      g_app_data.devices[dev].connectHandle);
                     }
-                    else if(GattPairingInitiated()) 
+                    else if(GattPairingInitiated(dev)) 
                     {
                         /* Pairing was initiated due to insufficient
                          * authentication/authorisation. So continue the
@@ -1060,7 +1452,14 @@ static void handleSignalSmSimplePairingCompleteInd(
                          * application and service specific information
                          */
                         g_app_data.devices[dev].bonded = TRUE;
-                        storeNvmData();
+                        storeNvmData(dev);
+
+                        if(g_app_data.devices[dev].state ==
+                                                        app_state_configured)
+                        {
+                            /* The device was configured before it bonded */
+                            storeGattCache(dev);
+                        }
                     }
                 }                
             }
@@ -1080,7 +1479,7 @@ static void handleSignalSmSimplePairingCompleteInd(
 #ifdef PAIRING_SUPPORT
 
                     /* Initiate pairing */
-                    StartBonding();
+                    StartBonding(dev);
 
                     DebugIfWriteString("\r\n*** Request pairing again ");
                     DebugIfWriteBdAddress(&p_event_data->bd_addr);
@@ -1104,10 +1503,16 @@ static void handleSignalSmSimplePairingCompleteInd(
                 }
                 else
                 {
-                    /* Bonded flag is false - update the NVM */
-                    Nvm_Write((uint16*)&g_app_data.devices[dev].bonded,
-                              sizeof(g_app_data.devices[dev].bonded),
-                              NVM_OFFSET_BONDED_FLAG(g_app_data.nvm_dev_num));
+                    /* Bonded flag is false - update the NVM, if the device
+                     * still owns its slot there
+                     */
+                    if(g_app_data.nvm_dev_num[dev] < MAX_BONDED_DEVICES)
+                    {
+                        Nvm_Write((uint16*)&g_app_data.devices[dev].bonded,
+                                  sizeof(g_app_data.devices[dev].bonded),
+                                  NVM_OFFSET_BONDED_FLAG(
+                                            g_app_data.nvm_dev_num[dev]));
+                    }
 
                     /* Disconnect the device */
                     SetState(dev, app_state_disconnecting);
@@ -1153,8 +1558,6 @@ static void handleSignalLmDisconnectComplete(
                 HCI_EV_DATA_DISCONNECT_COMPLETE_T *p_event_data)
 {
     uint16 dev_discon;              /* Number of disconnected device */
-    uint16 dev;                     /* Loop counter */
-    bool initiateScanning;          /* Whether to start scanning */
     
     /* Find device number of disconnected device */
     dev_discon = findDeviceByHciHandle(p_event_data->handle);
@@ -1167,7 +1570,12 @@ static void handleSignalLmDisconnectComplete(
         /* Reset all the service data, connected/discovered for this device */
         GattResetAllServices(dev_discon);
 
-        /* Reset the data in the device record */
+        /* Stop the device's timers and reset its GATT data */
+        appDataInit(dev_discon);
+
+        /* Reset the data in the device record. This leaves the device number
+         * in the app_state_init state.
+         */
         MemSet(&g_app_data.devices[dev_discon], 0x0, sizeof(DEVICE_T));
 
         g_app_data.devices[dev_discon].connectHandle = GATT_INVALID_UCID;
@@ -1176,63 +1584,28 @@ static void handleSignalLmDisconnectComplete(
         /* Decrease the number of connected peripheral devices */
         if(g_app_data.num_conn)
            g_app_data.num_conn--;
+        ThroughputLinksChanged(g_app_data.num_conn);
 
-        /* Check the state of all the other devices to see whether scanning
-         * should be initiated for the disconnected device number
-         */
-        for (dev = 0, initiateScanning = TRUE;
-             (dev < MAX_CONNECTED_DEVICES) && initiateScanning;
-             dev++)
-        {
-            if(dev != dev_discon)
-            {
-                switch(g_app_data.devices[dev].state)
-                {
-                    case app_state_connecting:
-                    case app_state_scanning:
-                    case app_state_connected:
-                    case app_state_discovering:
-                    {
-                        /* As one of the devices is already in one of the above 
-                         * states, we cannot initialise scanning for the
-                         * disconnected device number.
-                         */
-                        initiateScanning = FALSE;
-                    }
-                    break;
+        /* Forget the device's NVM slot, it is looked up again on connection */
+        g_app_data.nvm_dev_num[dev_discon] = MAX_BONDED_DEVICES;
 
-                    case app_state_init:
-                    case app_state_configured:
-                    {
-                        /* Safe to start scanning for the disconnected device
-                         * number.
-                         */
-                    }
-                    break;
-
-                    default:
-                    {
-                        /* Control should never come here */
-                        ReportPanic(app_panic_invalid_state);
-                    }
-                    break;
-                }
-            }
-        }
-        
-        if(initiateScanning)
+        if(g_app_data.param_update_dev == dev_discon)
         {
-            /* No other device is being configured, so initiate scanning on this
-             * device number.
+            /* The connection parameter update will not complete, so request
+             * the next one
              */
-            SetState(dev_discon, app_state_scanning);
+            g_app_data.param_update_dev = MAX_CONNECTED_DEVICES;
+            appStartNextParamUpdate();
         }
-        else
+
+        /* Scanning continues while devices are being configured. If it has
+         * stopped because there was no spare slot, start it again on this
+         * device number.
+         */
+        if(findDeviceByState(app_state_scanning) == MAX_CONNECTED_DEVICES &&
+           findDeviceByState(app_state_connecting) == MAX_CONNECTED_DEVICES)
         {
-            /* Move to the init state on this device number, as one of the
-             * other devices is still being configured.
-             */
-            SetState(dev_discon, app_state_init);
+            SetState(dev_discon, app_state_scanning);
         }
     }
 }
@@ -1252,10 +1625,16 @@ static void handleSignalLmDisconnectComplete(
  *----------------------------------------------------------------------------*/
 static void handleSignalGattCancelConnectCfm(void)
 {
+    /* Device Number. Only one device is connecting at a time. */
+    const uint16 dev = findDeviceByState(app_state_connecting);
+
     /* This event was received after the application was in app_state_connecting
      * for too long, so move back to the app_state_scanning state.
      */
-    SetState(g_app_data.dev_num, app_state_scanning);
+    if(dev < MAX_CONNECTED_DEVICES)
+    {
+        SetState(dev, app_state_scanning);
+    }
 }
 
 /*---------------------------------------------------------------------------
@@ -1285,14 +1664,31 @@ static void handleSignalLsConnectionParamUpdateCfm(
      * just report a warning but otherwise continue to the app_state_configured
      * state.
      */
+    /* Device Number */
+    const uint16 dev = g_app_data.param_update_dev;
+
+    if(dev == MAX_CONNECTED_DEVICES)
+    {
+        /* The device has disconnected, ignore it */
+        return;
+    }
+
+    g_app_data.param_update_dev = MAX_CONNECTED_DEVICES;
+
     if (p_event_data->status != sys_status_success)
     {
         DebugIfWriteString("\r\nConnection parameter update request failed on "
                            "device ");
-        DebugIfWriteBdAddress(&g_app_data.devices[g_app_data.dev_num].address);
+        DebugIfWriteBdAddress(&g_app_data.devices[dev].address);
     }
-    
-    SetState(g_app_data.dev_num, app_state_configured);
+
+    if(g_app_data.devices[dev].state == app_state_discovering)
+    {
+        SetState(dev, app_state_configured);
+    }
+
+    /* Request the update for the next configured device */
+    appStartNextParamUpdate();
 }
 
 /*============================================================================*
@@ -1337,6 +1733,18 @@ void DeviceFound(DISCOVERED_DEVICE_T *disc_device)
 {
     uint16 dev;                     /* Loop counter */
 
+    /* Ignore a device which is already connected */
+    for(dev = 0; dev < MAX_CONNECTED_DEVICES; dev++)
+    {
+        if(g_app_data.devices[dev].connected &&
+           !MemCmp(&g_app_data.devices[dev].address,
+                   &disc_device->address,
+                   sizeof(TYPED_BD_ADDR_T)))
+        {
+            return;
+        }
+    }
+
     /* Add device to the list of connections */
     for(dev = 0; dev < MAX_CONNECTED_DEVICES; dev++)
     {
@@ -1355,9 +1763,6 @@ void DeviceFound(DISCOVERED_DEVICE_T *disc_device)
         return;
     }
 
-    /* Store the connected device number */
-    g_app_data.dev_num = dev;
-
     /* Store the device details */
     MemCopy(&g_app_data.devices[dev].address, 
             &disc_device->address, 
@@ -1387,11 +1792,11 @@ void DeviceFound(DISCOVERED_DEVICE_T *disc_device)
      * CONNECTING_STATE_EXPIRY_TIMER microseconds call
      * appConnectingStateTimerExpiry to issue a GATT cancel connect request.
      */
-    if (g_app_data.app_timer != TIMER_INVALID)
+    if (g_app_data.app_timer[dev] != TIMER_INVALID)
     {
-        TimerDelete(g_app_data.app_timer);
+        TimerDelete(g_app_data.app_timer[dev]);
     }
-    g_app_data.app_timer = TimerCreate(CONNECTING_STATE_EXPIRY_TIMER, TRUE,
+    g_app_data.app_timer[dev] = TimerCreate(CONNECTING_STATE_EXPIRY_TIMER, TRUE,
                                 appConnectingStateTimerExpiry);
 
     /* Send the connection request */
@@ -1409,23 +1814,21 @@ void DeviceFound(DISCOVERED_DEVICE_T *disc_device)
  *      discovered service
  *
  *  PARAMETERS
+ *      dev [in]                Device on which the service was discovered
  *      pService [in]           Discovered service callback function table
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-void NotifyServiceFound(SERVICE_FUNC_POINTERS_T *pService)
+void NotifyServiceFound(uint16 dev, SERVICE_FUNC_POINTERS_T *pService)
 {
-    /* Device Number */
-    const uint16 dev = g_app_data.dev_num;
     /* Total number of connected services */
     uint16 *totalServices = &g_app_data.devices[dev].totalConnectedServices;
 
     if(*totalServices < MAX_SUPPORTED_SERV_PER_DEVICE && pService != NULL)
     {
         /* Populate the service database for the connected device */
-        g_app_data.devices[g_app_data.dev_num].
-                                  connected_services[*totalServices] = pService;
+        g_app_data.devices[dev].connected_services[*totalServices] = pService;
         
         /* Increment total number of connected services */
         (*totalServices)++;
@@ -1437,34 +1840,26 @@ void NotifyServiceFound(SERVICE_FUNC_POINTERS_T *pService)
  *      GetConnServices
  *
  *  DESCRIPTION
- *      This function returns a pointer to all the connected services
+ *      This function returns a pointer to all the connected services of a
+ *      device
  *
  *  PARAMETERS
- *      dev [out]               Connected device number. Set to NULL if this
- *                              information is not required.
+ *      dev [in]                Connected device number
  *      totalServices [out]     Total number of connected services. Set to NULL
  *                              if this information is not required.
  *
  *  RETURNS
  *      Pointer to array of connected services' callback function tables
  *----------------------------------------------------------------------------*/
-SERVICE_FUNC_POINTERS_T **GetConnServices(uint16 *dev, uint16 *totalServices)
+SERVICE_FUNC_POINTERS_T **GetConnServices(uint16 dev, uint16 *totalServices)
 {
-    /* Device Number */
-    const uint16 dev_conn = g_app_data.dev_num;
-    
-    if(dev != NULL)
-    {
-        *dev = dev_conn; /* Return the connected device number */
-    }
-    
     if(totalServices != NULL)
     {
         /* Return the total number of services */
-        *totalServices = g_app_data.devices[dev_conn].totalConnectedServices;
+        *totalServices = g_app_data.devices[dev].totalConnectedServices;
     }
 
-    return g_app_data.devices[dev_conn].connected_services;
+    return g_app_data.devices[dev].connected_services;
 }
 
 /*----------------------------------------------------------------------------*
@@ -1545,7 +1940,7 @@ void SetState(uint16 dev, app_state new_state)
                 DebugIfWriteString("\r\nScanning for devices...\r\n");
 
                 /* Reset application data */
-                appDataInit();
+                appDataInit(dev);
 
                 /* Start scanning */
                 appStartScan();
@@ -1572,7 +1967,7 @@ void SetState(uint16 dev, app_state new_state)
                  * PAIRING_TIMER_VALUE ms if the remote device is using a
                  * resolvable random address and has not initiated pairing.
                  */
-                StartBonding();
+                StartBonding(dev);
 #endif /* PAIRING_SUPPORT */
 
                 /* Move to the app_state_discovering state */
@@ -1587,14 +1982,14 @@ void SetState(uint16 dev, app_state new_state)
                  */
                 DebugIfWriteString("\r\ndiscovering...\r\n");
 
-                if (g_app_data.app_timer != TIMER_INVALID)
+                if (g_app_data.app_timer[dev] != TIMER_INVALID)
                 {
-                    TimerDelete(g_app_data.app_timer);
+                    TimerDelete(g_app_data.app_timer[dev]);
                 }
 
                 /* Discovery will start in DISCOVERY_START_TIMER ms */
-                g_app_data.app_timer = TimerCreate(DISCOVERY_START_TIMER, TRUE,
-                                            appStartDiscoveryTimerExpiry);
+                g_app_data.app_timer[dev] = TimerCreate(DISCOVERY_START_TIMER,
+                                            TRUE, appStartDiscoveryTimerExpiry);
             }
             break;
 
@@ -1603,8 +1998,26 @@ void SetState(uint16 dev, app_state new_state)
                 /* Peer device has been configured for all the supported 
                  * services */
                 DebugIfWriteString("\r\nPeer device is Configured...\r\n");
-                
-                NextReadWriteProcedure(TRUE);
+
+                if(g_app_data.devices[dev].gattDatabaseChanged)
+                {
+                    /* The handles used may be stale */
+                    appRediscover(dev);
+                    break;
+                }
+
+                /* Cache the handles of a bonded device */
+                storeGattCache(dev);
+
+                /* Record the time taken to configure the device */
+                ThroughputDeviceConfigured(g_app_data.devices[dev].connectTime);
+                ThroughputReport();
+
+                /* Start reading from the first characteristic */
+                g_app_data.devices[dev].readCharType =
+                                                dev_info_manufacture_name;
+
+                NextReadWriteProcedure(dev, TRUE);
             }
             break;
 
@@ -1646,21 +2059,32 @@ app_state GetState(uint16 dev)
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      GetConnDevice
+ *      GetDeviceByConnHandle
  *
  *  DESCRIPTION
- *      This function returns the connected device for which GATT procedure 
- *      is being performed. 
+ *      This function returns the connected device with the given GATT
+ *      connection handle, so that GATT events are handled for the device
+ *      which raised them.
  *
  *  PARAMETERS
- *      None
+ *      connect_handle [in]     GATT connection handle
  *
  *  RETURNS
- *      Device number of currently connected device
+ *      Device number, or MAX_CONNECTED_DEVICES if no device has the handle
  *----------------------------------------------------------------------------*/
-uint16 GetConnDevice(void)
+uint16 GetDeviceByConnHandle(uint16 connect_handle)
 {
-    return g_app_data.dev_num;
+    uint16 dev;                     /* Loop counter */
+
+    /* Browse through all devices */
+    for(dev = 0; dev < MAX_CONNECTED_DEVICES; dev++)
+    {
+        if(g_app_data.devices[dev].connected &&
+           g_app_data.devices[dev].connectHandle == connect_handle)
+            break;
+    }
+
+    return dev;
 }
 
 /*----------------------------------------------------------------------------*
@@ -1698,9 +2122,11 @@ void DisconnectDevice(uint16 dev)
 void DeviceConfigured(uint16 dev)
 {
     /* Update the connection parameters to reduce current
-     * consumption.
+     * consumption. Only one update is requested at a time, so the others
+     * wait for it to complete.
      */
-    requestConnParamUpdate(dev);
+    g_app_data.devices[dev].paramUpdatePending = TRUE;
+    appStartNextParamUpdate();
 }
 
 #ifdef PAIRING_SUPPORT
@@ -1714,22 +2140,62 @@ void DeviceConfigured(uint16 dev)
  *      initiated pairing by that time.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device to pair with
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-void StartBonding(void)
+void StartBonding(uint16 dev)
 {
-    if (g_app_data.bonding_timer != TIMER_INVALID)
+    if (g_app_data.bonding_timer[dev] != TIMER_INVALID)
     {
-        TimerDelete(g_app_data.bonding_timer);
+        TimerDelete(g_app_data.bonding_timer[dev]);
     }
-    g_app_data.bonding_timer = TimerCreate(PAIRING_TIMER_VALUE, 
+    g_app_data.bonding_timer[dev] = TimerCreate(PAIRING_TIMER_VALUE, 
                                 TRUE, appPairingTimerHandlerExpiry);
 }
 #endif /* PAIRING_SUPPORT */
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RemoteDatabaseChanged
+ *
+ *  DESCRIPTION
+ *      This function is called when a device indicates that its GATT Database
+ *      has changed. The discovery cache of the device is dropped, and the
+ *      device is discovered again once any discovery or configuration in
+ *      progress has completed.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device whose GATT Database has changed
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void RemoteDatabaseChanged(uint16 dev)
+{
+    if(g_app_data.devices[dev].bonded &&
+       g_app_data.nvm_dev_num[dev] < MAX_BONDED_DEVICES)
+    {
+        invalidateGattCache(g_app_data.nvm_dev_num[dev]);
+    }
+
+    g_app_data.devices[dev].gattCacheValid = FALSE;
+
+    if(g_app_data.devices[dev].state == app_state_configured)
+    {
+        /* Any read in progress completes before the Discovery Procedure
+         * starts, and is ignored
+         */
+        appRediscover(dev);
+    }
+    else
+    {
+        /* Discover the device again once it is configured */
+        g_app_data.devices[dev].gattDatabaseChanged = TRUE;
+    }
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      NextReadWriteProcedure
@@ -1737,46 +2203,58 @@ void StartBonding(void)
  *  DESCRIPTION
  *      This function initiates any read/write procedures. If argument 'next' is
  *      TRUE, it will initiate the next argument, otherwise it will initiate the 
- *      procedure for the current characteristic.
+ *      procedure for the current characteristic. Each device keeps its own
+ *      progress, so procedures run on several devices at once.
  *
  *  PARAMETERS
+ *      dev [in]                Device to initiate the procedure on
  *      next [in]               Whether to initiate the next argument
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-void NextReadWriteProcedure(bool next)
+void NextReadWriteProcedure(uint16 dev, bool next)
 {
     /* Read all the characteristics of the Device Info Service, if the service
      * is present on the peer device.
      */
     /* Pointer to Device Info Service callback function table */
-    static SERVICE_FUNC_POINTERS_T *pService = NULL;
+    SERVICE_FUNC_POINTERS_T **pService = &g_app_data.devices[dev].readService;
     /* Current characteristic being read */
-    static uint16 char_type = dev_info_manufacture_name;
+    uint16 *char_type = &g_app_data.devices[dev].readCharType;
 
     /* The first time this function is called, initialise pService to point to
      * the Device Information Service callback function table.
      */
-    if(pService == NULL)
+    if(*pService == NULL)
     {
         const uint16 uuid = UUID_DEVICE_INFO_SERVICE;
 
-        pService = GattFindServiceByUuid(GATT_UUID16, &uuid);
+        *pService = GattFindServiceByUuid(GATT_UUID16, &uuid);
     }
 
-    if(!next && char_type > dev_info_manufacture_name)
+    if(!next && *char_type > dev_info_manufacture_name)
     {
         /* If we're not moving onto the next characteristic, reset char_type
          * so that the last read characteristic is re-read.
          */
-        char_type--;
+        (*char_type)--;
+    }
+
+    if(*char_type == dev_info_manufacture_name &&
+       GattReadMultipleRequest(dev, *pService))
+    {
+        /* Several characteristics are read at once. Wait for the
+         * GATT_READ_MULTI_CHAR_VAL_CFM event, then read the characteristics
+         * left one at a time.
+         */
+        return;
     }
 
     /* Read the next supported characteristic */
-    while(char_type < dev_info_type_invalid)
+    while(*char_type < dev_info_type_invalid)
     {
-        if(GattReadRequest(g_app_data.dev_num, pService, char_type))
+        if(GattReadRequest(dev, *pService, *char_type))
         {
             /* If the current characteristic is supported, exit the loop and
              * wait for the GATT_READ_CHAR_VAL_CFM event.
@@ -1785,49 +2263,22 @@ void NextReadWriteProcedure(bool next)
         }
         
         /* If the current characteristic is not supported, try the next one */
-        char_type++;
+        (*char_type)++;
     }
 
     /* If all the characteristics have been read */
-    if(char_type == dev_info_type_invalid)
+    if(*char_type == dev_info_type_invalid)
     {
-        uint16 dev;                 /* Loop counter */
-
-        /* Reset char_type ready for the next connection */
-        char_type = dev_info_manufacture_name;
-
-        /* The connected device is configured. Start scanning for the next
-         * device if there is room in the application data structure.
-         */
-        /* Find the device number of the next spare slot in the application
-         * data structure.
+        /* The device is configured. Scanning for the next device has already
+         * started when this one was connected.
          */
-        for (dev=0; dev < MAX_CONNECTED_DEVICES; dev++)
-        {
-            if(!g_app_data.devices[dev].connected &&
-               g_app_data.devices[dev].state == app_state_init)
-            {
-                /* Spare slot found, exit the loop */
-                break;
-            }
-        }
-        
-        if(dev == MAX_CONNECTED_DEVICES)
-        {
-            /* Maximum limit reached. No more devices may be connected. */
-            return;
-        }
-
-        /* Start scanning for the next device */
-        SetState(dev, app_state_scanning);
-
         return;
     }
 
     /* Increment char_type, so that next time a read request for the next
      * characteristic will be sent.
      */
-    char_type++;
+    (*char_type)++;
 }
 
 /*============================================================================*
@@ -1894,22 +2345,26 @@ void AppInit(sleep_state last_sleep_state)
 
     /* Initialise the application timers */
     TimerInit(MAX_APP_TIMERS, (void*)app_timers);
-    g_app_data.app_timer = TIMER_INVALID;
-#ifdef PAIRING_SUPPORT
-    g_app_data.bonding_timer = TIMER_INVALID;
-#endif /* PAIRING_SUPPORT */
 
     /* Initialise the GATT Client application state for each device */
     for(dev = 0; dev < MAX_CONNECTED_DEVICES; dev ++)
     {
         g_app_data.devices[dev].state = app_state_init;
+
+        g_app_data.app_timer[dev] = TIMER_INVALID;
+#ifdef PAIRING_SUPPORT
+        g_app_data.bonding_timer[dev] = TIMER_INVALID;
+#endif /* PAIRING_SUPPORT */
+
+        /* Initialise the bonded device numbers */
+        g_app_data.nvm_dev_num[dev] = MAX_BONDED_DEVICES;
     }
-    
-    /* Initialise the connected device numbers */
-    g_app_data.dev_num = MAX_CONNECTED_DEVICES;
 
-    /* Initialise the bonded device numbers */
-    g_app_data.nvm_dev_num = MAX_BONDED_DEVICES;
+    /* No connection parameter update is in progress */
+    g_app_data.param_update_dev = MAX_CONNECTED_DEVICES;
+
+    /* Start the throughput statistics */
+    ThroughputInit();
 
     /* Initialise GATT entity */
     GattInit();
@@ -1931,7 +2386,7 @@ void AppInit(sleep_state last_sleep_state)
     Nvm_Disable();
 
     /* Read persistent storage */
-    readPersistentStore(g_app_data.dev_num, g_app_data.nvm_dev_num);
+    readPersistentStore(MAX_CONNECTED_DEVICES, MAX_BONDED_DEVICES);
 
     /* Tell Security Manager module what value it needs to initialise its
      * diversifier to.
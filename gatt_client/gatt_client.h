@@ -80,30 +80,31 @@ extern void DeviceFound(DISCOVERED_DEVICE_T *disc_device);
  *      discovered service
  *
  *  PARAMETERS
+ *      dev [in]                Device on which the service was discovered
  *      pService [in]           Discovered service callback function table
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-extern void NotifyServiceFound(SERVICE_FUNC_POINTERS_T *pService);
+extern void NotifyServiceFound(uint16 dev, SERVICE_FUNC_POINTERS_T *pService);
 
 /*----------------------------------------------------------------------------*
  *  NAME
  *      GetConnServices
  *
  *  DESCRIPTION
- *      This function returns a pointer to all the connected services
+ *      This function returns a pointer to all the connected services of a
+ *      device
  *
  *  PARAMETERS
- *      dev [out]               Connected device number. Set to NULL if this
- *                              information is not required.
+ *      dev [in]                Connected device number
  *      totalServices [out]     Total number of connected services. Set to NULL
  *                              if this information is not required.
  *
  *  RETURNS
  *      Pointer to array of connected services' callback function tables
  *----------------------------------------------------------------------------*/
-extern SERVICE_FUNC_POINTERS_T **GetConnServices(uint16 *dev,
+extern SERVICE_FUNC_POINTERS_T **GetConnServices(uint16 dev,
                                                  uint16 *totalServices);
 
 /*----------------------------------------------------------------------------*
@@ -140,19 +141,20 @@ extern app_state GetState(uint16 dev);
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      GetConnDevice
+ *      GetDeviceByConnHandle
  *
  *  DESCRIPTION
- *      This function returns the connected device for which GATT procedure 
- *      is being performed. 
+ *      This function returns the connected device with the given GATT
+ *      connection handle, so that GATT events are handled for the device
+ *      which raised them.
  *
  *  PARAMETERS
- *      None
+ *      connect_handle [in]     GATT connection handle
  *
  *  RETURNS
- *      Device number of currently connected device
+ *      Device number, or MAX_CONNECTED_DEVICES if no device has the handle
  *----------------------------------------------------------------------------*/
-extern uint16 GetConnDevice(void);
+extern uint16 GetDeviceByConnHandle(uint16 connect_handle);
 
 /*----------------------------------------------------------------------------*
  *  NAME
@@ -196,14 +198,30 @@ extern void DeviceConfigured(uint16 dev);
  *      initiated pairing by that time.
  *
  *  PARAMETERS
- *      None
+ *      dev [in]                Device to pair with
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-extern void StartBonding(void);
+extern void StartBonding(uint16 dev);
 #endif /* PAIRING_SUPPORT */
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      RemoteDatabaseChanged
+ *
+ *  DESCRIPTION
+ *      This function is called when a device indicates that its GATT Database
+ *      has changed, so that the device is discovered again.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device whose GATT Database has changed
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void RemoteDatabaseChanged(uint16 dev);
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      NextReadWriteProcedure
@@ -211,14 +229,16 @@ extern void StartBonding(void);
  *  DESCRIPTION
  *      This function initiates any read/write procedures. If argument 'next' is
  *      TRUE, it will initiate the next argument, otherwise it will initiate the 
- *      procedure for the current characteristic.
+ *      procedure for the current characteristic. Each device keeps its own
+ *      progress, so procedures run on several devices at once.
  *
  *  PARAMETERS
+ *      dev [in]                Device to initiate the procedure on
  *      next [in]               Whether to initiate the next argument
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-extern void NextReadWriteProcedure(bool next);
+extern void NextReadWriteProcedure(uint16 dev, bool next);
 
 #endif /* __GATT_CLIENT_H__ */
@@ -0,0 +1,929 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      gatt_service_data.c
+ *
+ *  DESCRIPTION
+ *      This file keeps information related to the discovered GATT Service,
+ *      whose Service Changed characteristic is indicated when the Server's
+ *      GATT Database changes
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *===========================================================================*/
+
+#include <gatt.h>           /* GATT application interface */
+#include <mem.h>            /* Memory library */
+#include <gatt_uuid.h>      /* Common Bluetooth UUIDs and macros */
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "gatt_service_data.h"    /* Interface to this file */
+#include "gatt_access.h"    /* GATT-related routines */
+#include "debug_interface.h"/* Application debug routines */
+#include "gatt_client.h"    /* Interface to top level application functions */
+
+/*============================================================================*
+ *  Private Definitions
+ *===========================================================================*/
+
+/* Number of characteristics present in this service, range [1, 15] */
+#define MAXIMUM_NUMBER_OF_CHARACTERISTIC              (1)
+
+/*============================================================================*
+ *  Private Data Types
+ *===========================================================================*/
+
+/* GATT Service structure used in discovery procedure */
+typedef struct _GATT_SERVICE_DATA_T
+{
+    /* Service attribute range */
+    uint16 service_start_handle;
+    uint16 service_end_handle;
+
+    /* Connection handle */
+    uint16 connect_handle;
+
+    /* Characteristics */
+    CHARACTERISTIC_T chars[MAXIMUM_NUMBER_OF_CHARACTERISTIC];
+
+    /* Total number of supported characteristics found for this service in the
+     * Server's GATT Database (number of entries in chars array). The optimal
+     * value is MAXIMUM_NUMBER_OF_CHARACTERISTIC
+     */
+    uint16 total_char:4;
+
+    /* Index into chars array of the current characteristic */
+    uint16 curr_char:4;
+
+    /* Index into chars array of characteristic currently being configured */
+    uint16 curr_config_char:4;
+
+    /* Flag set to 1 if configuration is ongoing */
+    uint16 config_ongoing:1;
+
+    /* Flag set to 1 if a write request initiated during configuration has
+     * been confirmed
+     */
+    uint16 write_cfm:1;
+
+    /* Flag set to 1 if a read request initiated during configuration has
+     * been confirmed
+     */
+    uint16 read_cfm:1;
+
+    /* Array of characteristic 'types' corresponding to the chars array. Only
+     * used in read/write/notify procedures.
+     */
+    gatt_service_char_t type[MAXIMUM_NUMBER_OF_CHARACTERISTIC];
+} GATT_SERVICE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* GATT Service data.
+ * A record is kept for each connected device supporting the service.
+ */
+static GATT_SERVICE_DATA_T g_gs_serv_data[MAX_CONNECTED_DEVICES];
+
+/*============================================================================*
+ *  Public Data
+ *============================================================================*/
+
+/* Callback function table */
+SERVICE_FUNC_POINTERS_T GattServiceFuncStore = {
+    .serviceUuid            = &GattServiceUuid,
+    .isMandatory            = NULL,
+    .serviceInit            = &GattServiceDataInit,
+    .checkHandle            = &GattServiceCheckHandle,
+    .getHandles             = &GattServiceGetHandles,
+    .charDiscovered         = &GattServiceCharDiscovered,
+    .descDiscovered         = &GattServiceCharDescDisc,
+    .discoveryComplete      = &GattServiceDiscoveryComplete,
+    .serviceIndNotifHandler = &GattServiceHandlerNotifInd,
+    .configureServiceNotif  = &GattServiceConfigInd,
+    .writeRequest           = NULL,
+    .writeConfirm           = &GattServiceWriteConfirm,
+    .readRequest            = NULL,
+    .readConfirm            = NULL,
+    .readMultipleRequest    = NULL,
+    .readMultipleConfirm    = NULL,
+    .configureService       = &GattServiceConfigure,
+    .isServiceFound         = &GattServiceFound,
+    .resetServiceData       = &GattServiceResetData,
+    .storeCache             = &GattServiceStoreCache,
+    .restoreCache           = &GattServiceRestoreCache
+};
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *===========================================================================*/
+
+/* Initialise GATT Service data */
+static void gattServiceDataInit(uint16 dev); 
+
+/* Check if the characteristic supports the specified ATT permissions */
+static bool gattServiceCheckATTPermission(uint16               dev,
+                                          gatt_service_char_t  type,
+                                          uint16               permission,
+                                          uint16              *count);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *===========================================================================*/
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      gattServiceDataInit
+ *
+ *  DESCRIPTION
+ *      Initialise the GATT Service data.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to initialise service data for
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void gattServiceDataInit(uint16 dev)
+{
+    uint16 char_num;            /* Loop counter */
+    /* Service data for the specified device */
+    GATT_SERVICE_DATA_T *data = &g_gs_serv_data[dev];
+
+    /* Reset the data */
+    data->connect_handle       = GATT_INVALID_UCID;
+    data->service_start_handle = INVALID_ATT_HANDLE;
+    data->service_end_handle   = INVALID_ATT_HANDLE;
+    data->total_char           = 0; 
+    data->curr_char            = 0;
+    data->curr_config_char     = 0;
+    data->config_ongoing       = FALSE;
+    data->write_cfm            = FALSE;
+    data->read_cfm             = FALSE;
+
+    /* Reset characteristics array */
+    MemSet(data->chars, 0x0, sizeof(data->chars));
+
+    /* Initialise characteristic array values */
+    for(char_num = 0; char_num < MAXIMUM_NUMBER_OF_CHARACTERISTIC; char_num ++)
+    {
+        data->type[char_num] = gatt_service_type_invalid;
+        data->chars[char_num].valHandle             = INVALID_ATT_HANDLE;
+        data->chars[char_num].descriptors[0].handle = INVALID_ATT_HANDLE;
+        data->chars[char_num].descriptors[1].handle = INVALID_ATT_HANDLE;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      gattServiceCheckATTPermission
+ *
+ *  DESCRIPTION
+ *      Check whether a characteristic supports ATT permissions.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to check
+ *      type [in]               Characteristic to check
+ *      permission [in]         ATT permission(s) to check
+ *      count [out]             Index into service data of characteristic
+ *
+ *  RETURNS
+ *      TRUE if the characteristic supports the specified ATT permissions on
+ *      this device
+ *      FALSE otherwise, or on error
+ *----------------------------------------------------------------------------*/
+static bool gattServiceCheckATTPermission(uint16               dev,
+                                          gatt_service_char_t  type,
+                                          uint16               permission,
+                                          uint16              *count)
+{
+    /* Initialise return value */
+    *count = 0;
+
+    /* Check the requested characteristic is supported */
+    if(type >= gatt_service_type_invalid)
+    {
+        return FALSE;
+    }        
+
+    /* Search for the specified characteristic in the chars array */
+    while(g_gs_serv_data[dev].type[*count] != type)
+    {
+        (*count)++;
+
+        if(*count == MAXIMUM_NUMBER_OF_CHARACTERISTIC)
+        {
+            /* Characteristic not found */
+            return FALSE;
+        }
+    }
+
+    /* Check that the characteristic supports all the permissions requested */
+    if((g_gs_serv_data[dev].chars[*count].properties & permission) !=
+                                                                    permission)
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *===========================================================================*/
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceUuid
+ *
+ *  DESCRIPTION
+ *      Return the Service UUID and type (16- or 128-bit)
+ *
+ *  PARAMETERS
+ *      type [out]              UUID type
+ *      uuid [out]              Service UUID
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void GattServiceUuid(GATT_UUID_T *type, uint16 *uuid)
+{
+    *type = GATT_UUID16;
+    uuid[0] = UUID_GATT_SERVICE;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceDataInit
+ *
+ *  DESCRIPTION
+ *      Initialise service data during the Discovery Procedure when the service
+ *      has been discovered in the Server's GATT Database.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to initialise service data for
+ *      p_event_data [in]       Primary service discovery event data
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void GattServiceDataInit(uint16 dev,
+                         GATT_DISC_PRIM_SERV_BY_UUID_IND_T *p_event_data)
+{
+    gattServiceDataInit(dev);
+    
+    g_gs_serv_data[dev].service_start_handle = p_event_data->strt_handle;
+    g_gs_serv_data[dev].service_end_handle   = p_event_data->end_handle;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceCheckHandle
+ *
+ *  DESCRIPTION
+ *      Check if the specified handle belongs to the service.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to check handle for
+ *      handle [in]             Handle to check
+ *
+ *  RETURNS
+ *      TRUE if the supplied handle belongs to this service
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool GattServiceCheckHandle(uint16 dev, uint16 handle)
+{
+    return (((handle >= g_gs_serv_data[dev].service_start_handle) &&
+                    (handle <= g_gs_serv_data[dev].service_end_handle))
+                    ? TRUE : FALSE);
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceGetHandles
+ *
+ *  DESCRIPTION
+ *      This function is called during the Discovery Procedure. Its behaviour
+ *      depends on the value of 'type':
+ *
+ *      service_type:        Return the full range of characteristic handles
+ *                           supported by this service
+ *      characteristic_type: Return the full range of descriptor handles
+ *                           supported by this characteristic
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to return handle range for
+ *      start_hndl [out]        Start of handle range, or INVALID_ATT_HANDLE
+ *      end_hndl [out]          End of handle range, or INVALID_ATT_HANDLE
+ *      type [in]               Type of handles to return
+ *
+ *  RETURNS
+ *      TRUE if type is service_type
+ *      TRUE if type is characteristic type and there are more characteristics
+ *      to be discovered.
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool GattServiceGetHandles(uint16 dev,
+                           uint16 *start_hndl,
+                           uint16 *end_hndl,
+                           gatt_profile_hierarchy_t type)
+{
+    switch(type)
+    {
+        case service_type:
+        {
+            *start_hndl = g_gs_serv_data[dev].service_start_handle;
+            *end_hndl   = g_gs_serv_data[dev].service_end_handle;
+        }
+        break;
+
+        case characteristic_type:
+        {
+            const uint16 curr_char = g_gs_serv_data[dev].curr_char++;
+            
+            /* Start handle will be the 'value handle' */
+            *start_hndl = g_gs_serv_data[dev].chars[curr_char].valHandle;
+
+            if(curr_char + 1 == g_gs_serv_data[dev].total_char)
+            {
+                /* If this is the last service characteristic the end handle is
+                 * the service end handle.
+                 */
+                *end_hndl = g_gs_serv_data[dev].service_end_handle;
+            }
+            else if(curr_char + 1 > g_gs_serv_data[dev].total_char)
+            {
+                /* If there are no more characteristics populate start and end
+                 * handles with INVALID_ATT_HANDLE and return FALSE 
+                 */
+                *start_hndl = INVALID_ATT_HANDLE;
+                *end_hndl   = INVALID_ATT_HANDLE;
+
+                return FALSE;
+            }
+            else
+            {
+                /* Otherwise the end handle is the start handle of the next
+                 * characteristic less 2.
+                 */
+                *end_hndl =
+                         g_gs_serv_data[dev].chars[curr_char + 1].valHandle - 2;
+            }
+        }
+        break;
+
+        default:
+        {
+            *start_hndl = INVALID_ATT_HANDLE;
+            *end_hndl   = INVALID_ATT_HANDLE;
+            
+            /* Unsupported type passed from the application */
+            return FALSE;
+        }
+    }
+
+    /* More characteristics are available - return TRUE */
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceCharDiscovered
+ *
+ *  DESCRIPTION
+ *      This function is called during the Discovery Procedure after a service
+ *      characteristic has been discovered.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which characteristic has been
+ *                              discovered
+ *      p_event_data [in]       Characteristic discovery event data
+ *
+ *  RETURNS
+ *      TRUE if the discovered characteristic is supported by this service
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool GattServiceCharDiscovered(uint16 dev,
+                               GATT_CHAR_DECL_INFO_IND_T *p_event_data)
+{
+    /* Handle of discovered characteristic */
+    const uint16 handle = p_event_data->val_handle;
+
+    /* Total number of supported characteristics discovered on this Server */
+    const uint16 total_char = g_gs_serv_data[dev].total_char;
+
+    /* Check if the discovered characteristic belongs to this service */
+    if(!GattServiceCheckHandle(dev, handle))
+    {
+        /* Discovered characteristic does not belong this service */
+        return FALSE;
+    }
+
+    /* Check if the discovered characteristic is supported by this service */
+    switch(p_event_data->uuid[0])
+    {
+        case UUID_SERVICE_CHANGED:
+        {
+            /* Store related values */
+            g_gs_serv_data[dev].type[total_char] = gatt_service_changed;
+        }
+        break;
+
+        default:
+        {
+            /* Discovered characteristic is not supported by this service */
+            return FALSE;
+        }
+    }
+
+    /* Store discovered characteristic data */ 
+    /* (Example application only supports 16-bit characteristic UUIDs) */
+    g_gs_serv_data[dev].chars[total_char].uuid = p_event_data->uuid[0];
+    g_gs_serv_data[dev].chars[total_char].valHandle = handle;
+    g_gs_serv_data[dev].chars[total_char].properties = p_event_data->prop;
+    g_gs_serv_data[dev].chars[total_char].nDescriptors = 0;
+
+    /* Increment total number of supported characteristics discovered on this
+     * this Server
+     */
+    g_gs_serv_data[dev].total_char++;
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceCharDescDisc
+ *
+ *  DESCRIPTION
+ *      This function is called during the Discovery Procedure after a
+ *      characteristic descriptor has been discovered.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which descriptor has been discovered
+ *      p_event_data [in]       Descriptor discovery event data
+ *
+ *  RETURNS
+ *      TRUE if the discovered characteristic descriptor is supported by this
+ *      service
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+void GattServiceCharDescDisc(uint16 dev,
+                             GATT_CHAR_DESC_INFO_IND_T *p_event_data)
+{
+    /* Current characteristic */
+    const uint16 curr_char = g_gs_serv_data[dev].curr_char - 1;
+    /* Number of descriptors discovered for the current characteristic */
+    uint8 *numDesc = &g_gs_serv_data[dev].chars[curr_char].nDescriptors;
+    /* Properties of the current characteristic */
+    const uint8 prop = g_gs_serv_data[dev].chars[curr_char].properties;
+    
+    /* Only the Client Characteristic Configuration Descriptor is supported by
+     * this service
+     */
+    if(((prop & ATT_PERM_NOTIFY) || (prop & ATT_PERM_INDICATE)) &&
+        p_event_data->uuid[0] == UUID_CLIENT_CHAR_CFG)
+    {
+        /* Add the Client Characteristic Configuration Descriptor 16-bit UUID
+         * only. This may be expanded to include support for 128-bit UUIDs.
+         */
+        g_gs_serv_data[dev].chars[curr_char].descriptors[*numDesc].uuid =
+                                            p_event_data->uuid[0];
+        g_gs_serv_data[dev].chars[curr_char].descriptors[*numDesc].handle =
+                                            p_event_data->desc_handle;
+
+        /* Increment the number of descriptors discovered for the current
+         * characteristic
+         */
+        (*numDesc) ++;
+    }
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceDiscoveryComplete
+ *
+ *  DESCRIPTION
+ *      This function called when the discovery of this service is complete.
+ *      Although GATT write/read requests are supported, it is highly
+ *      recommended that the full Discovery Procedure be completed before
+ *      GATT read/write procedures are initiated.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which service discovery has completed
+ *      connect_handle [in]     Handle of connection with the device
+ *
+ *  RETURNS
+ *      TRUE if a GATT read/write request is initated by this function
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool GattServiceDiscoveryComplete(uint16 dev, uint16 connect_handle)
+{
+    /* Reset the current characteristic index */
+    g_gs_serv_data[dev].curr_char = 0;
+
+    /* Store the connection handle */
+    g_gs_serv_data[dev].connect_handle = connect_handle;
+
+    return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceHandlerNotifInd
+ *
+ *  DESCRIPTION
+ *      Handle GATT_IND_CHAR_VAL_IND and GATT_NOT_CHAR_VAL_IND events for this
+ *      service.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which notification/indication has
+ *                              arisen
+ *      handle [in]             Characteristic affected
+ *      size [in]               Characteristic value size
+ *      value [in]              New characteristic value
+ *
+ *  RETURNS
+ *      TRUE on success, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool GattServiceHandlerNotifInd(uint16 dev,
+                                uint16 handle,
+                                uint16 size,
+                                uint8  *value)
+{
+    /* Index into chars array of the supplied characteristic */
+    uint16 count = 0;
+
+    /* Check the supplied characterstic is belongs to this service */
+    if(!GattServiceCheckHandle(dev, handle))
+    {
+        /* Characteristic does not belong to this service */
+        return FALSE;
+    }
+
+    /* Check whether the supplied characteristic is supported by this service */
+    while(g_gs_serv_data[dev].chars[count].valHandle != handle)
+    {
+        count ++;
+
+        if(count == MAXIMUM_NUMBER_OF_CHARACTERISTIC)
+        {
+            /* Characteristic is not supported by this service */
+            return FALSE;
+        }
+    }
+
+    /* Act on the notification/indication */
+    switch (g_gs_serv_data[dev].type[count])
+    {
+        case gatt_service_changed:
+        {
+            DebugIfWriteString("\r\n[Indication] Service Changed\r\n");
+
+            /* The value holds the range of handles affected. The whole GATT
+             * Database is discovered again, as the handles of any service
+             * may have moved.
+             */
+            RemoteDatabaseChanged(dev);
+        }
+        break;
+
+        default:
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceConfigInd
+ *
+ *  DESCRIPTION
+ *      Update the value of the specified descriptor for the specified
+ *      characteristic of this service according to the value of 'Enable'.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which characteristic descriptor
+ *                              should be updated
+ *      Type [in]               Characteristic the descriptor belongs to
+ *      SubType [in]            Characteristic descriptor to update
+ *      Enable [in]             New characteristic descriptor value
+ *
+ *  RETURNS
+ *      TRUE on success, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool GattServiceConfigInd(uint16 dev,
+                          uint16 Type,
+                          uint8 SubType,
+                          bool Enable)
+{
+    /* Type is promoted to the service characteristics enumerated type */
+    uint16 client_cfg;          /* Descriptor handle corresponding to SubType */
+    uint16 count = 0;           /* Index into chars array of characteristic
+                                 * corresponding to Type
+                                 */
+    uint8 indication[2];        /* New descriptor value corresponding to
+                                 * Enabled
+                                 */
+
+    /* Check that the specified characteristic supports indication on this
+     * device. If so, obtain the index into chars of this characteristic.
+     */
+    if(!gattServiceCheckATTPermission(dev, Type, ATT_PERM_INDICATE, &count))
+    {
+        return FALSE;
+    }
+
+    /* Check if the specified descriptor is supported for this characteristic */
+    if(SubType > g_gs_serv_data[dev].chars[count].nDescriptors || !SubType)
+    {
+        return FALSE;
+    }
+
+    /* Obtain the descriptor handle */
+    client_cfg =
+               g_gs_serv_data[dev].chars[count].descriptors[SubType - 1].handle;
+    if (client_cfg == INVALID_ATT_HANDLE)
+    {
+        return FALSE;
+    }
+
+    /* Prepare the new descriptor value based on 'Enable' */
+    if(Enable)
+    {
+        indication[0] = WORD_LSB(gatt_client_config_indication);
+        indication[1] = WORD_MSB(gatt_client_config_indication);
+    }
+    else
+    {
+        indication[0] = WORD_LSB(gatt_client_config_none);
+        indication[1] = WORD_MSB(gatt_client_config_none);
+    }
+
+    /* Request that the descriptor be modified */
+    GattWriteCharValueReq(g_gs_serv_data[dev].connect_handle, 
+                          GATT_WRITE_REQUEST,
+                          client_cfg,
+                          sizeof(indication),
+                          indication);
+    
+    return TRUE;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceWriteConfirm
+ *
+ *  DESCRIPTION
+ *      Called when a write request is successful.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on characteristic value was read
+ *      connect_handle [in]     Device connection handle
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void GattServiceWriteConfirm(uint16 dev,
+                             uint16 connect_handle)
+{
+    if(g_gs_serv_data[dev].config_ongoing)
+    {
+        /* If the service is being configured, update the write_cfm flag */
+        g_gs_serv_data[dev].write_cfm = TRUE;
+    }
+    else
+    {
+        /* Take action depending on the characteristic value written. */
+        /* This example application does nothing on this service */
+        switch(g_gs_serv_data[dev].type[g_gs_serv_data[dev].curr_char])
+        {
+            case gatt_service_changed:
+            {
+                /* Do nothing */
+            }
+            break;
+
+            default:
+            {
+                /* Do Nothing */
+            }
+            break;
+        }
+    }
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceConfigure
+ *
+ *  DESCRIPTION
+ *      Configure the Server's GATT database for this service.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to configure
+ *
+ *  RETURNS
+ *      TRUE if indication is enabled for the current characteristic
+ *      FALSE when configuration is complete
+ *----------------------------------------------------------------------------*/
+bool GattServiceConfigure(uint16 dev)
+{
+    /* Service data for the specified device */
+    GATT_SERVICE_DATA_T *data = &g_gs_serv_data[dev];
+
+    if(data->write_cfm)
+    {
+        /* If the previous write request was successful advance the index to the
+         * next characteristic to configure
+         */
+        data->curr_config_char ++;
+        
+        /* Reset the confirmation flag */
+        data->write_cfm = FALSE;
+    }
+
+    while(data->curr_config_char < data->total_char)
+    {
+        /* Enable indications of the Service Changed characteristic, so that
+         * the discovery cache is dropped when the Server's GATT Database
+         * changes. A Server which cannot indicate it is assumed never to
+         * change its GATT Database.
+         */
+        if(data->type[data->curr_config_char] == gatt_service_changed &&
+           GattServiceConfigInd(dev, gatt_service_changed, 0x1, TRUE))
+        {
+            data->config_ongoing = TRUE;
+
+            return TRUE;
+        }
+
+        data->curr_config_char ++;
+    }
+
+    /* Do not reset curr_char_config, as the configuration is done only once
+     * per connection 
+     */
+    data->config_ongoing = FALSE;
+
+    return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceFound
+ *
+ *  DESCRIPTION
+ *      Check if this service is supported on the specified device.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to check
+ *
+ *  RETURNS
+ *      TRUE if this service is supported on the specified device.
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool GattServiceFound(uint16 dev)
+{
+    if((g_gs_serv_data[dev].service_start_handle != INVALID_ATT_HANDLE) &&
+       (g_gs_serv_data[dev].service_end_handle != INVALID_ATT_HANDLE))
+    {
+        /* Service is supported for the specified device */
+        return TRUE;
+    }
+
+    /* Service has yet to be discovered or is not supported */
+    return FALSE;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceResetData
+ *
+ *  DESCRIPTION
+ *      Reset the service data for the specified device.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to reset data for
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void GattServiceResetData(uint16 dev)
+{
+    gattServiceDataInit(dev);
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceStoreCache
+ *
+ *  DESCRIPTION
+ *      Write the discovered service data for the specified device to its
+ *      discovery cache record.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to store service data for
+ *      p_cache [out]           Cache record of the service
+ *      size [in]               Number of words available for the record
+ *
+ *  RETURNS
+ *      Number of words written, or 0 if the record does not fit
+ *----------------------------------------------------------------------------*/
+uint16 GattServiceStoreCache(uint16 dev, uint16 *p_cache, uint16 size)
+{
+    uint16 char_num;            /* Loop counter */
+    /* Service data for the specified device */
+    const GATT_SERVICE_DATA_T *data = &g_gs_serv_data[dev];
+    /* Words in the record */
+    const uint16 words = GATT_CACHE_SERVICE_WORDS(data->total_char);
+
+    if(words > size)
+    {
+        return 0;
+    }
+
+    p_cache[0] = data->service_start_handle;
+    p_cache[1] = data->service_end_handle;
+    p_cache[2] = data->total_char;
+
+    for(char_num = 0; char_num < data->total_char; char_num++)
+    {
+        GattCacheStoreChar(&p_cache[GATT_CACHE_SERVICE_WORDS(char_num)],
+                           &data->chars[char_num],
+                           data->type[char_num]);
+    }
+
+    return words;
+}
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceRestoreCache
+ *
+ *  DESCRIPTION
+ *      Restore the service data for the specified device from its discovery
+ *      cache record, in place of the Discovery Procedure.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to restore service data for
+ *      connect_handle [in]     Handle of connection with the device
+ *      p_cache [in]            Cache record of the service
+ *      size [in]               Number of words in the record
+ *
+ *  RETURNS
+ *      TRUE if the record is valid
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool GattServiceRestoreCache(uint16 dev,
+                             uint16 connect_handle,
+                             const uint16 *p_cache,
+                             uint16 size)
+{
+    uint16 char_num;            /* Loop counter */
+    uint16 type;                /* Characteristic type */
+    /* Service data for the specified device */
+    GATT_SERVICE_DATA_T *data = &g_gs_serv_data[dev];
+
+    gattServiceDataInit(dev);
+
+    if(size < GATT_CACHE_SERVICE_WORDS(0) ||
+       p_cache[2] > MAXIMUM_NUMBER_OF_CHARACTERISTIC ||
+       size != GATT_CACHE_SERVICE_WORDS(p_cache[2]))
+    {
+        return FALSE;
+    }
+
+    for(char_num = 0; char_num < p_cache[2]; char_num++)
+    {
+        type = GattCacheRestoreChar(
+                            &p_cache[GATT_CACHE_SERVICE_WORDS(char_num)],
+                            &data->chars[char_num]);
+        if(type >= gatt_service_type_invalid)
+        {
+            gattServiceDataInit(dev);
+            return FALSE;
+        }
+
+        data->type[char_num] = type;
+    }
+
+    data->service_start_handle = p_cache[0];
+    data->service_end_handle   = p_cache[1];
+    data->total_char           = p_cache[2];
+    data->connect_handle       = connect_handle;
+
+    return TRUE;
+}
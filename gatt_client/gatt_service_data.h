@@ -0,0 +1,345 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      gatt_service_data.h
+ *
+ *  DESCRIPTION
+ *      Header file for discovered GATT Service data and its prototypes
+ *
+ ******************************************************************************/
+
+#ifndef __GATT_SERVICE_DATA_H__
+#define __GATT_SERVICE_DATA_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <bt_event_types.h> /* Type definitions for Bluetooth events */
+
+/*============================================================================*
+ *  Local Header File
+ *============================================================================*/
+
+#include "gatt_service_uuids.h" /* GATT Service UUIDs */
+#include "gatt_access.h"    /* GATT-related routines */
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* GATT Service characteristics enumerated type */
+typedef enum {
+    gatt_service_changed = 0,   /* Service Changed */
+    gatt_service_type_invalid
+} gatt_service_char_t;
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* GATT Service callback function table */
+extern SERVICE_FUNC_POINTERS_T GattServiceFuncStore;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceUuid
+ *
+ *  DESCRIPTION
+ *      Return the Service UUID and type (16- or 128-bit)
+ *
+ *  PARAMETERS
+ *      type [out]              UUID type
+ *      uuid [out]              Service UUID
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void GattServiceUuid(GATT_UUID_T *type, uint16 *uuid);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceDataInit
+ *
+ *  DESCRIPTION
+ *      Initialise service data during the Discovery Procedure when the service
+ *      has been discovered in the Server's GATT Database.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to initialise service data for
+ *      p_event_data [in]       Primary service discovery event data
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void GattServiceDataInit(uint16 dev,
+                        GATT_DISC_PRIM_SERV_BY_UUID_IND_T *p_event_data);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceCheckHandle
+ *
+ *  DESCRIPTION
+ *      Check if the specified handle belongs to the service.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to check handle for
+ *      handle [in]             Handle to check
+ *
+ *  RETURNS
+ *      TRUE if the supplied handle belongs to this service
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool GattServiceCheckHandle(uint16 dev, uint16 handle);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceGetHandles
+ *
+ *  DESCRIPTION
+ *      This function is called during the Discovery Procedure. Its behaviour
+ *      depends on the value of 'type':
+ *
+ *      service_type:        Return the full range of characteristic handles
+ *                           supported by this service
+ *      characteristic_type: Return the full range of descriptor handles
+ *                           supported by this characteristic
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to return handle range for
+ *      start_hndl [out]        Start of handle range, or INVALID_ATT_HANDLE
+ *      end_hndl [out]          End of handle range, or INVALID_ATT_HANDLE
+ *      type [in]               Type of handles to return
+ *
+ *  RETURNS
+ *      TRUE if type is service_type
+ *      TRUE if type is characteristic type and there are more characteristics
+ *      to be discovered.
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool GattServiceGetHandles(uint16 dev,
+                                  uint16 *start_hndl,
+                                  uint16 *end_hndl,
+                                  gatt_profile_hierarchy_t type);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceCharDiscovered
+ *
+ *  DESCRIPTION
+ *      This function is called during the Discovery Procedure after a service
+ *      characteristic has been discovered.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which characteristic has been
+ *                              discovered
+ *      p_event_data [in]       Characteristic discovery event data
+ *
+ *  RETURNS
+ *      TRUE if the discovered characteristic is supported by this service
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool GattServiceCharDiscovered(uint16 dev,
+                                      GATT_CHAR_DECL_INFO_IND_T *p_event_data);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceCharDescDisc
+ *
+ *  DESCRIPTION
+ *      This function is called during the Discovery Procedure after a
+ *      characteristic descriptor has been discovered.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which descriptor has been discovered
+ *      p_event_data [in]       Descriptor discovery event data
+ *
+ *  RETURNS
+ *      TRUE if the discovered characteristic descriptor is supported by this
+ *      service
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern void GattServiceCharDescDisc(uint16 dev,
+                                    GATT_CHAR_DESC_INFO_IND_T *p_event_data);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceDiscoveryComplete
+ *
+ *  DESCRIPTION
+ *      This function called when the discovery of this service is complete.
+ *      Although GATT write/read requests are supported, it is highly
+ *      recommended that the full Discovery Procedure be completed before
+ *      GATT read/write procedures are initiated.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which service discovery has completed
+ *      connect_handle [in]     Handle of connection with the device
+ *
+ *  RETURNS
+ *      TRUE if a GATT read/write request is initated by this function
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool GattServiceDiscoveryComplete(uint16 dev,
+                                         uint16 connect_handle);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceHandlerNotifInd
+ *
+ *  DESCRIPTION
+ *      Handle GATT_IND_CHAR_VAL_IND and GATT_NOT_CHAR_VAL_IND events for this
+ *      service.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which notification/indication has
+ *                              arisen
+ *      handle [in]             Characteristic affected
+ *      size [in]               Characteristic value size
+ *      value [in]              New characteristic value
+ *
+ *  RETURNS
+ *      TRUE on success, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool GattServiceHandlerNotifInd(uint16 dev,
+                                       uint16 handle,
+                                       uint16 size,
+                                       uint8  *value);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceConfigInd
+ *
+ *  DESCRIPTION
+ *      Update the value of the specified descriptor for the specified
+ *      characteristic of this service according to the value of 'Enable'.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on which characteristic descriptor
+ *                              should be updated
+ *      Type [in]               Characteristic the descriptor belongs to
+ *      SubType [in]            Characteristic descriptor to update
+ *      Enable [in]             New characteristic descriptor value
+ *
+ *  RETURNS
+ *      TRUE on success, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool GattServiceConfigInd(uint16 dev,
+                                 uint16 Type,
+                                 uint8 SubType,
+                                 bool Enable);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceWriteConfirm
+ *
+ *  DESCRIPTION
+ *      Called when a write request is successful.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device on characteristic value was read
+ *      connect_handle [in]     Device connection handle
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void GattServiceWriteConfirm(uint16 dev,
+                                    uint16 connect_handle);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceConfigure
+ *
+ *  DESCRIPTION
+ *      Configure the Server's GATT database for this service.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to configure
+ *
+ *  RETURNS
+ *      TRUE if indication is enabled for the current characteristic
+ *      FALSE when configuration is complete
+ *----------------------------------------------------------------------------*/
+extern bool GattServiceConfigure(uint16 dev);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceFound
+ *
+ *  DESCRIPTION
+ *      Check if this service is supported on the specified device.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to check
+ *
+ *  RETURNS
+ *      TRUE if this service is supported on the specified device.
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool GattServiceFound(uint16 dev);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceResetData
+ *
+ *  DESCRIPTION
+ *      Reset the service data for the specified device.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to reset data for
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void GattServiceResetData(uint16 dev);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceStoreCache
+ *
+ *  DESCRIPTION
+ *      Write the discovered service data to a discovery cache record.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to store service data for
+ *      p_cache [out]           Cache record of the service
+ *      size [in]               Number of words available for the record
+ *
+ *  RETURNS
+ *      Number of words written, or 0 if the record does not fit
+ *----------------------------------------------------------------------------*/
+extern uint16 GattServiceStoreCache(uint16 dev,
+                                    uint16 *p_cache,
+                                    uint16 size);
+
+/*---------------------------------------------------------------------------
+ *  NAME
+ *      GattServiceRestoreCache
+ *
+ *  DESCRIPTION
+ *      Restore the service data from a discovery cache record.
+ *
+ *  PARAMETERS
+ *      dev [in]                Device to restore service data for
+ *      connect_handle [in]     Handle of connection with the device
+ *      p_cache [in]            Cache record of the service
+ *      size [in]               Number of words in the record
+ *
+ *  RETURNS
+ *      TRUE if the record is valid
+ *      FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool GattServiceRestoreCache(uint16 dev,
+                                    uint16 connect_handle,
+                                    const uint16 *p_cache,
+                                    uint16 size);
+
+#endif /* __GATT_SERVICE_DATA_H__ */
+
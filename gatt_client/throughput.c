@@ -0,0 +1,268 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      throughput.c
+ *
+ *  DESCRIPTION
+ *      This file measures the throughput of the Client: how many devices are
+ *      configured per minute, and how long each takes from connection to
+ *      configuration, for each number of links which are up at once. The
+ *      time spent with each number of links is counted, so the rates can be
+ *      compared as MAX_CONNECTED_DEVICES is raised.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <time.h>           /* Application interface to System Time */
+#include <mem.h>            /* Memory library */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "throughput.h"     /* Interface to this file */
+#include "user_config.h"    /* User configuration */
+#include "debug_interface.h"/* Application debug routines */
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of milliseconds in a minute */
+#define MILLISECONDS_PER_MINUTE         (60000UL)
+
+/* Largest value which can be printed */
+#define THROUGHPUT_PRINT_MAX            (0x7fff)
+
+/*============================================================================*
+ *  Private Data types
+ *============================================================================*/
+
+/* Statistics for one number of links */
+typedef struct _THROUGHPUT_BUCKET_T
+{
+    /* Time spent with this number of links, in milliseconds */
+    uint32                      time;
+
+    /* Total time from connection to configuration, in milliseconds */
+    uint32                      total_latency;
+
+    /* Devices configured while this number of links was up */
+    uint16                      configured;
+
+} THROUGHPUT_BUCKET_T;
+
+/* Throughput data structure */
+typedef struct _THROUGHPUT_DATA_T
+{
+    /* Statistics for each number of links, from none upwards */
+    THROUGHPUT_BUCKET_T         bucket[MAX_CONNECTED_DEVICES + 1];
+
+    /* Current number of links */
+    uint16                      links;
+
+    /* Chip time up to which time has been counted */
+    uint32                      counted;
+
+} THROUGHPUT_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Throughput data */
+static THROUGHPUT_DATA_T g_throughput;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+/* Count the time spent with the current number of links */
+static void throughputCountTime(void);
+
+/* Print a value, limited to the largest which can be printed */
+static void throughputWriteValue(uint32 value);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      throughputCountTime
+ *
+ *  DESCRIPTION
+ *      This function adds the whole milliseconds since time was last counted
+ *      to the current number of links. It is called often enough that the
+ *      chip time does not wrap in between.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void throughputCountTime(void)
+{
+    const uint32 elapsed = (TimeGet32() - g_throughput.counted) / MILLISECOND;
+
+    g_throughput.bucket[g_throughput.links].time += elapsed;
+    g_throughput.counted += elapsed * MILLISECOND;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      throughputWriteValue
+ *
+ *  DESCRIPTION
+ *      This function prints a value in decimal, limited to the largest which
+ *      can be printed.
+ *
+ *  PARAMETERS
+ *      value [in]              Value to print
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void throughputWriteValue(uint32 value)
+{
+    if(value > THROUGHPUT_PRINT_MAX)
+    {
+        value = THROUGHPUT_PRINT_MAX;
+    }
+
+    DebugIfWriteInt((int16)value);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThroughputInit
+ *
+ *  DESCRIPTION
+ *      Clear the throughput statistics and start counting time with no links.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void ThroughputInit(void)
+{
+    MemSet(&g_throughput, 0, sizeof(g_throughput));
+
+    g_throughput.counted = TimeGet32();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThroughputLinksChanged
+ *
+ *  DESCRIPTION
+ *      Record that the number of links has changed. The time up to now is
+ *      counted against the previous number of links.
+ *
+ *  PARAMETERS
+ *      links [in]              New number of links
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void ThroughputLinksChanged(uint16 links)
+{
+    throughputCountTime();
+
+    if(links > MAX_CONNECTED_DEVICES)
+    {
+        links = MAX_CONNECTED_DEVICES;
+    }
+
+    g_throughput.links = links;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThroughputDeviceConfigured
+ *
+ *  DESCRIPTION
+ *      Record that a device has been configured, against the current number
+ *      of links.
+ *
+ *  PARAMETERS
+ *      connect_time [in]       Time at which the link to the device was
+ *                              established
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void ThroughputDeviceConfigured(uint32 connect_time)
+{
+    THROUGHPUT_BUCKET_T *bucket = &g_throughput.bucket[g_throughput.links];
+
+    throughputCountTime();
+
+    bucket->configured++;
+    bucket->total_latency += (TimeGet32() - connect_time) / MILLISECOND;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThroughputReport
+ *
+ *  DESCRIPTION
+ *      Print, for each number of links which has been up, the time spent
+ *      with it in seconds, the devices configured, the devices configured
+ *      per minute and the mean time from connection to configuration in
+ *      milliseconds.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void ThroughputReport(void)
+{
+    uint16 links;                   /* Loop counter */
+
+    throughputCountTime();
+
+    DebugIfWriteString("\r\nLinks  Time(s)  Configured  Per minute  "
+                       "Latency(ms)");
+
+    for(links = 0; links <= MAX_CONNECTED_DEVICES; links++)
+    {
+        const THROUGHPUT_BUCKET_T *bucket = &g_throughput.bucket[links];
+
+        if(bucket->time == 0)
+        {
+            /* This number of links has not been up */
+            continue;
+        }
+
+        DebugIfWriteString("\r\n");
+        throughputWriteValue(links);
+        DebugIfWriteString("  ");
+        throughputWriteValue(bucket->time / 1000);
+        DebugIfWriteString("  ");
+        throughputWriteValue(bucket->configured);
+        DebugIfWriteString("  ");
+        throughputWriteValue(bucket->configured * MILLISECONDS_PER_MINUTE /
+                             bucket->time);
+        DebugIfWriteString("  ");
+        throughputWriteValue(bucket->configured ?
+                             bucket->total_latency / bucket->configured : 0);
+    }
+
+    DebugIfWriteString("\r\n");
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      throughput.h
+ *
+ *  DESCRIPTION
+ *      Header file for the throughput statistics, which measure how many
+ *      devices are configured per minute for each number of links
+ *
+ *****************************************************************************/
+
+#ifndef __THROUGHPUT_H__
+#define __THROUGHPUT_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThroughputInit
+ *
+ *  DESCRIPTION
+ *      Clear the throughput statistics and start counting time with no links.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void ThroughputInit(void);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThroughputLinksChanged
+ *
+ *  DESCRIPTION
+ *      Record that the number of links has changed.
+ *
+ *  PARAMETERS
+ *      links [in]              New number of links
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void ThroughputLinksChanged(uint16 links);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThroughputDeviceConfigured
+ *
+ *  DESCRIPTION
+ *      Record that a device has been configured.
+ *
+ *  PARAMETERS
+ *      connect_time [in]       Time at which the link to the device was
+ *                              established
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void ThroughputDeviceConfigured(uint32 connect_time);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ThroughputReport
+ *
+ *  DESCRIPTION
+ *      Print the throughput statistics for each number of links.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void ThroughputReport(void);
+
+#endif /* __THROUGHPUT_H__ */
@@ -53,13 +53,17 @@
 #define MAX_SUPPORTED_SERV_PER_DEVICE             (5)
 
 /* The MAX_CONNECTED_DEVICES macro defines the number of devices that can be
- * connected at any given time to the Client device. It must not exceed 1.
+ * connected at any given time to the Client device. Each device is discovered
+ * and configured independently, and scanning for the next device continues
+ * while the others are being discovered.
  */
-#define MAX_CONNECTED_DEVICES                     (1)
+#define MAX_CONNECTED_DEVICES                     (3)
 
 /* The MAX_BONDED_DEVICES macro defines the number of devices whose information
- * can be stored in the NVM. It should not exceed 3.
+ * can be stored in the NVM. It should not exceed 3, which lets every connected
+ * device keep its own bonding data and discovery cache. The nvm_size in the
+ * .keyr file must hold one word plus 102 words for each of them.
  */
-#define MAX_BONDED_DEVICES                        (1)
+#define MAX_BONDED_DEVICES                        (3)
 
 #endif /* __USER_CONFIG_H__ */
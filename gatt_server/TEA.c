@@ -1,9 +1,42 @@
 #include "TEA.H"
-#include "string.h"
 
 //TEAԿ
-uint8 TEA_key[16]={0xf3, 0x67, 0x10, 0x32, 0xda, 0x8c, 0x50, 0x4b,
-				 0xe6, 0x9a, 0x69, 0x27, 0xac, 0x4f, 0x92, 0x7d};
+static const uint32 TEA_key[4]={0xf3671032, 0xda8c504b,
+				 0xe69a6927, 0xac4f927d};
+
+/* Number of derived keys remembered, must be a power of two */
+#define KEY_CACHE_SIZE	(8)
+
+/* Cache slot for a seed */
+#define KEY_CACHE_SLOT(k)	(((k) ^ ((k) >> 8)) & (KEY_CACHE_SIZE - 1))
+
+/* Derived key cache entry */
+typedef struct
+{
+	uint16 seed;		/* seed the key was derived from */
+	bool valid;		/* TRUE if the entry holds a key */
+	uint32 key[4];		/* derived key */
+} KEY_CACHE_ENTRY_T;
+
+/* Derived keys, direct mapped by seed */
+static KEY_CACHE_ENTRY_T key_cache[KEY_CACHE_SIZE];
+
+/* Key cache statistics */
+static KEY_CACHE_STATS_T key_cache_stats;
+
+/* XXTEA key schedule constant */
+#define TEA_DELTA	(0x9e3779b9UL)
+
+/* Read and write the 32-bit word p of a buffer of 16-bit words, most
+ * significant word first
+ */
+#define TEA_GET(v, p)		(((uint32)(v)[2*(p)] << 16) | (v)[2*(p) + 1])
+#define TEA_PUT(v, p, x)	((v)[2*(p)] = (uint16)((x) >> 16), \
+				 (v)[2*(p) + 1] = (uint16)((x) & 0xffff))
+
+/* XXTEA mixing function */
+#define TEA_MX	((((z >> 5) ^ (y << 2)) + ((y >> 3) ^ (z << 4))) ^ \
+		 ((sum ^ y) + (key[(p & 3) ^ e] ^ z)))
 
 /********************************************************************* 
 *                            
@@ -21,16 +54,34 @@ uint8 TEA_key[16]={0xf3, 0x67, 0x10, 0x32, 0xda, 0x8c, 0x50, 0x4b,
 *:ĵֽ 
 **********************************************************************/  
   
-extern void encrypt(uint8 *src,uint16 size_src,uint8 *key)  
+extern uint16 encrypt(uint16 *src,uint16 size_src,const uint32 *key)  
 {  
-	uint8 mem[16];
-	uint8 i = 0;
-	memcpy(mem, src, 16);
+	const uint16 n = size_src >> 2;		/* 32-bit words */
+	uint16 rounds;
+	uint16 p, e;
+	uint32 y, z, sum = 0;
 
-	for(i=0; i<16; i++)
+	if(size_src == 0 || (size_src & 7) != 0)
+		return 0;
+
+	rounds = 6 + 52 / n;
+	z = TEA_GET(src, n - 1);
+	do
 	{
-		src[i] = mem[i] ^ key[i];
-	}
+		sum += TEA_DELTA;
+		e = (uint16)(sum >> 2) & 3;
+		for(p = 0; p < n - 1; p++)
+		{
+			y = TEA_GET(src, p + 1);
+			z = TEA_GET(src, p) + TEA_MX;
+			TEA_PUT(src, p, z);
+		}
+		y = TEA_GET(src, 0);
+		z = TEA_GET(src, n - 1) + TEA_MX;
+		TEA_PUT(src, n - 1, z);
+	} while(--rounds);
+
+	return size_src;
 }  
   
 /********************************************************************* 
@@ -41,33 +92,92 @@ extern void encrypt(uint8 *src,uint16 size_src,uint8 *key)
 *:ĵֽ,ʧ,0 
 **********************************************************************/  
   
-extern void decrypt(uint8 *src,uint16 size_src,uint8 *key)  
+extern uint16 decrypt(uint16 *src,uint16 size_src,const uint32 *key)  
 {  
-	uint8 mem[16];
-	uint8 i = 0;
-	memcpy(mem, src, 16);
+	const uint16 n = size_src >> 2;		/* 32-bit words */
+	uint16 rounds;
+	uint16 p, e;
+	uint32 y, z, sum;
+
+	if(size_src == 0 || (size_src & 7) != 0)
+		return 0;
 
-	for(i=0; i<16; i++)
+	rounds = 6 + 52 / n;
+	sum = rounds * TEA_DELTA;
+	y = TEA_GET(src, 0);
+	do
 	{
-		src[i] = mem[i] ^ key[i];
-	}
+		e = (uint16)(sum >> 2) & 3;
+		for(p = n - 1; p > 0; p--)
+		{
+			z = TEA_GET(src, p - 1);
+			y = TEA_GET(src, p) - TEA_MX;
+			TEA_PUT(src, p, y);
+		}
+		z = TEA_GET(src, n - 1);
+		y = TEA_GET(src, 0) - TEA_MX;
+		TEA_PUT(src, 0, y);
+		sum -= TEA_DELTA;
+	} while(--rounds);
+
+	return size_src;
 }  
 
 #define WORD_MSB(_val)              ( ((_val) & 0xff00) >> 8 )
 /*! \brief Extract the LSB of a 16-bit integer. */
 #define WORD_LSB(_val)              ( ((_val) & 0x00ff) )
 
-extern void KeyConvert(uint16 k, uint8* key)
+extern void KeyConvert(uint16 k, uint32* key)
 {
 	uint8 i =0;
-	uint8 x = (uint8)(k>>8 & 0x00ff);
-	x += (uint8)(k&0x00ff);
-	for(i=0; i<16; i++)
+	const uint32 x = ((uint32)k << 16) | k;
+	for(i=0; i<4; i++)
 	{
 		key[i] = TEA_key[i] ^ x;
 	}
 }
 
+/********************************************************************* 
+*  Key cache. Receivers see the same sender seeds over and over, so the
+*  key derived for a seed is remembered and reused. Each seed maps to
+*  one slot, so a lookup costs one compare.
+**********************************************************************/  
+
+extern void KeyCacheInit(void)
+{
+	uint8 i;
+	for(i=0; i<KEY_CACHE_SIZE; i++)
+	{
+		key_cache[i].valid = FALSE;
+	}
+	key_cache_stats.hits = 0;
+	key_cache_stats.misses = 0;
+}
+
+extern const uint32 *KeyCacheLookup(uint16 k)
+{
+	KEY_CACHE_ENTRY_T *entry = &key_cache[KEY_CACHE_SLOT(k)];
+
+	if(entry->valid && entry->seed == k)
+	{
+		key_cache_stats.hits++;
+	}
+	else
+	{
+		/* derive the key into the slot, replacing the previous seed */
+		key_cache_stats.misses++;
+		KeyConvert(k, entry->key);
+		entry->seed = k;
+		entry->valid = TRUE;
+	}
+
+	return entry->key;
+}
+
+extern const KEY_CACHE_STATS_T *KeyCacheGetStats(void)
+{
+	return &key_cache_stats;
+}
 
 extern uint32 WORD16_TO_WORD32(uint16 x, uint16 y)
 {
@@ -16,7 +16,7 @@
 *:ĵֽ 
 **********************************************************************/  
   
-extern void encrypt(uint8 *src,uint16 size_src,uint8 *key);  
+extern uint16 encrypt(uint16 *src,uint16 size_src,const uint32 *key);  
 
 /********************************************************************* 
 *                           㷨 
@@ -26,9 +26,28 @@ extern void encrypt(uint8 *src,uint16 size_src,uint8 *key);
 *:ĵֽ,ʧ,0 
 **********************************************************************/  
 
-extern void decrypt(uint8 *src,uint16 size_src,uint8 *key);  
+extern uint16 decrypt(uint16 *src,uint16 size_src,const uint32 *key);  
 
-extern void KeyConvert(uint16 k, uint8* key);
+/* Derive the 128-bit key for a random seed, as four 32-bit words */
+extern void KeyConvert(uint16 k, uint32* key);
+
+/* Key cache statistics */
+typedef struct
+{
+	uint32 hits;		/* lookups served from the cache */
+	uint32 misses;		/* lookups that derived the key */
+} KEY_CACHE_STATS_T;
+
+/* Empty the key cache and reset its statistics */
+extern void KeyCacheInit(void);
+
+/* Return the key for a random seed, deriving it only if it is not cached.
+ * The key is only valid until the next lookup.
+ */
+extern const uint32 *KeyCacheLookup(uint16 k);
+
+/* Return the key cache statistics */
+extern const KEY_CACHE_STATS_T *KeyCacheGetStats(void);
 
 extern uint32 WORD16_TO_WORD32(uint16 x, uint16 y);
 
@@ -0,0 +1,204 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      ad_parser.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines for parsing the AD structures of advertising
+ *      and scan response data in a single pass. Unlike GapLsFindAdType(), which
+ *      walks the whole report and copies the data out for every AD type looked
+ *      up, these routines reference the AD structures in place.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "ad_parser.h"      /* Interface to this file */
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AdIterInit
+ *
+ *  DESCRIPTION
+ *      This function prepares a walk over the AD structures of a report.
+ *
+ *  PARAMETERS
+ *      p_iter [out]            Walk state to initialise
+ *      p_data [in]             Advertising or scan response data
+ *      length [in]             Number of octets in the data
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void AdIterInit(AD_ITER_T *p_iter, const uint8 *p_data, uint16 length)
+{
+    p_iter->p_data = p_data;
+    p_iter->length = length;
+    p_iter->offset = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AdIterNext
+ *
+ *  DESCRIPTION
+ *      This function returns the next AD structure of the report. Each AD
+ *      structure consists of a length octet, covering the AD type and the
+ *      data, followed by the AD type and the data.
+ *
+ *  PARAMETERS
+ *      p_iter [in/out]         Walk state
+ *      p_field [out]           Next AD structure
+ *
+ *  RETURNS
+ *      TRUE if an AD structure was returned, FALSE at the end of the data
+ *----------------------------------------------------------------------------*/
+extern bool AdIterNext(AD_ITER_T *p_iter, AD_FIELD_T *p_field)
+{
+    const uint16 offset = p_iter->offset;
+    uint16 ad_length;               /* Length of the AD structure */
+
+    /* At least the length and AD type octets must be present */
+    if(offset + 2 > p_iter->length)
+    {
+        return FALSE;
+    }
+
+    ad_length = p_iter->p_data[offset] & 0xff;
+
+    /* A zero length marks the end of the significant part of the data. A
+     * structure that overruns the data is malformed and ends the walk too.
+     */
+    if(ad_length == 0 || offset + 1 + ad_length > p_iter->length)
+    {
+        p_iter->offset = p_iter->length;
+        return FALSE;
+    }
+
+    p_field->ad_type = p_iter->p_data[offset + 1] & 0xff;
+    p_field->p_data = &p_iter->p_data[offset + 2];
+    p_field->length = ad_length - 1;
+
+    p_iter->offset = offset + 1 + ad_length;
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AdFindTypes
+ *
+ *  DESCRIPTION
+ *      This function looks up several AD types in one walk over the report.
+ *      The walk stops early once every AD type has been found.
+ *
+ *  PARAMETERS
+ *      p_data [in]             Advertising or scan response data
+ *      length [in]             Number of octets in the data
+ *      ad_types [in]           AD types to look for
+ *      fields [out]            AD structures found, one per AD type
+ *      num_types [in]          Number of AD types, up to AD_MAX_FIND_TYPES
+ *
+ *  RETURNS
+ *      Mask with bit n set if ad_types[n] was found
+ *----------------------------------------------------------------------------*/
+extern uint16 AdFindTypes(const uint8 *p_data, uint16 length,
+                          const uint16 *ad_types, AD_FIELD_T *fields,
+                          uint16 num_types)
+{
+    AD_ITER_T iter;                 /* Walk state */
+    AD_FIELD_T field;               /* Current AD structure */
+    uint16 found = 0;               /* Mask of AD types found */
+    uint16 all;                     /* Mask of all AD types looked up */
+    uint16 i;                       /* Loop counter */
+
+    if(num_types > AD_MAX_FIND_TYPES)
+    {
+        num_types = AD_MAX_FIND_TYPES;
+    }
+
+    all = (num_types == AD_MAX_FIND_TYPES) ?
+                    0xffff : (uint16)((1 << num_types) - 1);
+
+    AdIterInit(&iter, p_data, length);
+
+    while(found != all && AdIterNext(&iter, &field))
+    {
+        for(i = 0; i < num_types; i++)
+        {
+            if(!AD_TYPE_FOUND(found, i) && field.ad_type == ad_types[i])
+            {
+                fields[i] = field;
+                found |= (1 << i);
+            }
+        }
+    }
+
+    return found;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      AdMatchField
+ *
+ *  DESCRIPTION
+ *      This function checks whether the first AD structure of the given AD
+ *      type in the report holds exactly the given value.
+ *
+ *  PARAMETERS
+ *      p_data [in]             Advertising or scan response data
+ *      length [in]             Number of octets in the data
+ *      ad_type [in]            AD type to look for
+ *      value [in]              Expected value, one octet per element
+ *      value_length [in]       Number of octets in the value
+ *
+ *  RETURNS
+ *      TRUE if the AD structure was found and holds the value
+ *----------------------------------------------------------------------------*/
+extern bool AdMatchField(const uint8 *p_data, uint16 length, uint16 ad_type,
+                         const uint8 *value, uint16 value_length)
+{
+    AD_ITER_T iter;                 /* Walk state */
+    AD_FIELD_T field;               /* Current AD structure */
+    uint16 i;                       /* Loop counter */
+
+    AdIterInit(&iter, p_data, length);
+
+    while(AdIterNext(&iter, &field))
+    {
+        if(field.ad_type == ad_type)
+        {
+            if(field.length != value_length)
+            {
+                return FALSE;
+            }
+
+            for(i = 0; i < value_length; i++)
+            {
+                if((field.p_data[i] & 0xff) != value[i])
+                {
+                    return FALSE;
+                }
+            }
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
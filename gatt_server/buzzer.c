@@ -27,6 +27,7 @@
 #include "buzzer.h"         /* Interface to this file */
 #include "hw_access.h"      /* Hardware access */
 #include "gatt_server.h"    /* Definitions used throughout the GATT server */
+#include "timer_wheel.h"    /* Logical timers on one firmware timer */
 
 /* Only compile this file if the buzzer code has been requested */
 #ifdef ENABLE_BUZZER
@@ -226,8 +227,8 @@ static void appBuzzerTimerHandler(timer_id tid)
     if(g_buzz_data.beep_type != buzzer_beep_off)
     {
         /* Start the timer */
-        g_buzz_data.buzzer_tid = TimerCreate(beep_timer, TRUE, 
-                                               appBuzzerTimerHandler);
+        g_buzz_data.buzzer_tid = TimerWheelCreate(beep_timer,
+                                                  appBuzzerTimerHandler);
     }
 }
 
@@ -308,7 +309,7 @@ extern void BuzzerResetData(void)
     /* Delete buzzer timer if running */
     if (g_buzz_data.buzzer_tid != TIMER_INVALID)
     {
-        TimerDelete(g_buzz_data.buzzer_tid);
+        TimerWheelDelete(g_buzz_data.buzzer_tid);
         g_buzz_data.buzzer_tid = TIMER_INVALID;
     }
     
@@ -338,7 +339,7 @@ extern void SoundBuzzer(buzzer_beep_type beep_type)
     PioEnablePWM(BUZZER_PWM_INDEX_0, FALSE);
     if (g_buzz_data.buzzer_tid != TIMER_INVALID)
     {
-        TimerDelete(g_buzz_data.buzzer_tid);
+        TimerWheelDelete(g_buzz_data.buzzer_tid);
         g_buzz_data.buzzer_tid = TIMER_INVALID;
     }
 
@@ -389,8 +390,8 @@ extern void SoundBuzzer(buzzer_beep_type beep_type)
         PioEnablePWM(BUZZER_PWM_INDEX_0, TRUE);
 
         /* Start the buzzer timer */
-        g_buzz_data.buzzer_tid = TimerCreate(beep_timer, TRUE, 
-                                             appBuzzerTimerHandler);
+        g_buzz_data.buzzer_tid = TimerWheelCreate(beep_timer,
+                                                  appBuzzerTimerHandler);
     }
 
 }
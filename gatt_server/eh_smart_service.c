@@ -25,7 +25,7 @@
  *  Local Header Files
  *============================================================================*/
 #include "gatt_access.h"
-#include "nvm_access.h"
+#include "nvm_store.h"
 #include "app_gatt_db.h"
 #include "panic.h"
 #include "battery.h"
@@ -34,10 +34,55 @@
 #include "gatt_server.h"
 #include "mem.h"
 #include "debug_interface.h"/* Application debug routines */
+#include "smart_home.h"     /* Smart home protocol engine */
+#include "smart_config.h"   /* Persistent smart home configuration */
 /*============================================================================*
  *  Private Data Declaration
  *============================================================================*/
 
+/* Number of sensor samples waiting to be notified that can be queued */
+#define EhSmart_SAMPLE_QUEUE_SIZE             (12)
+
+/* Sensor sample waiting to be notified */
+typedef struct
+{
+    /* Sample octets */
+    uint8                   data[EhSmart_SAMPLE_MAX_LENGTH];
+
+    /* Number of sample octets */
+    uint16                  length;
+
+} EhSmart_SAMPLE_T;
+
+/* Sensor notification pipeline data type */
+typedef struct
+{
+    /* Samples waiting to be notified */
+    EhSmart_SAMPLE_T        sample[EhSmart_SAMPLE_QUEUE_SIZE];
+
+    /* Index of the oldest sample */
+    uint16                  head;
+
+    /* Number of samples queued */
+    uint16                  count;
+
+    /* Most recent sample, returned by reads of the characteristic */
+    EhSmart_SAMPLE_T        last;
+
+    /* Notifications sent but not yet confirmed by the firmware */
+    uint16                  in_flight;
+
+    /* Largest number of notifications the firmware is trusted to buffer */
+    uint16                  window;
+
+    /* Time at which notifications were last enabled */
+    uint32                  start;
+
+    /* Notification statistics */
+    EhSmart_NOTIFY_STATS_T  stats;
+
+} EhSmart_NOTIFY_DATA_T;
+
 
 
 /*============================================================================*
@@ -47,19 +92,13 @@
 /* Blood pressure service data structure */
 EhSmart_SERV_DATA_T g_EhSmart_serv_data;
 
+/* Sensor notification pipeline data */
+static EhSmart_NOTIFY_DATA_T g_EhSmart_notify_data;
+
 /*============================================================================*
  *  Private Definitions
  *============================================================================*/
 
-/* Number of words of NVM memory used by Blood Pressure service*/
-#define EhSmart_SERVICE_NVM_MEMORY_WORDS      (1)
-
-/* The offset of data being stored in NVM for Blood Pressure service. 
- * This offset is added to Blood Pressure service offset to NVM 
- * region to get the absolute offset at which this data is stored in NVM
- */
-#define EhSmart_NVM_MEAS_CLIENT_CONFIG_OFFSET (0)
-
 
 /* Minimum data length of BP Measurement characteristic value,
  * which shall have Flags (uint8), Systolic (SFLOAT), Diastolic 
@@ -67,6 +106,354 @@ EhSmart_SERV_DATA_T g_EhSmart_serv_data;
  */
 #define EhSmart_MEAS_MIN_DATA_LENGTH          (7)
 
+/* Length of a Smart Control characteristic write: address, group and data
+ * type words followed by the data octets
+ */
+#define EhSmart_CONTROL_DATA_LENGTH           (6 + SMART_DATA_LENGTH)
+
+/* Types of the settings written to the Smart Config characteristic. Each
+ * setting is written as its type octet, a length octet and the value, and
+ * any number of settings may be written at once.
+ */
+#define EhSmart_CONFIG_UUID                   (0x00)
+#define EhSmart_CONFIG_INTERVAL               (0x01)
+#define EhSmart_CONFIG_ROLE                   (0x02)
+#define EhSmart_CONFIG_GROUP                  (0x03)
+#define EhSmart_CONFIG_DATA_TYPE              (0x04)
+#define EhSmart_CONFIG_ADV_TYPE               (0x05)
+#define EhSmart_CONFIG_NODE_ID                (0x06)
+
+/* Length of the type and length octets of a Smart Config setting */
+#define EhSmart_CONFIG_HEADER_LENGTH          (2)
+
+/* Lengths of the Smart Config setting values */
+#define EhSmart_CONFIG_UUID_LENGTH            (4)
+#define EhSmart_CONFIG_INTERVAL_LENGTH        (2)
+#define EhSmart_CONFIG_DATA_TYPE_LENGTH       (2)
+#define EhSmart_CONFIG_ADV_TYPE_LENGTH        (1)
+#define EhSmart_CONFIG_NODE_ID_LENGTH         (1)
+
+/* Lengths of the role setting: the role alone, or the role followed by the
+ * scan window and advertising burst lengths
+ */
+#define EhSmart_ROLE_LENGTH                   (1)
+#define EhSmart_ROLE_WINDOWS_LENGTH           (5)
+
+/* Group operations, the first octet of the group setting */
+#define EhSmart_GROUP_CLEAR                   (0x00)
+#define EhSmart_GROUP_JOIN                    (0x01)
+#define EhSmart_GROUP_LEAVE                   (0x02)
+
+/* Largest notification value. Do not increase it beyond (DEFAULT_ATT_MTU - 3
+ * = 20) octets, as the ATT MTU is not negotiated.
+ */
+#define EhSmart_NOTIFY_MAX_LENGTH             (20)
+
+/* Number of notifications the firmware is first trusted to buffer. Fewer are
+ * sent at once after the firmware has failed to buffer one.
+ */
+#define EhSmart_NOTIFY_WINDOW                 (4)
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ehSmartConfigGroup
+ *
+ *  DESCRIPTION
+ *      This function applies a group setting of a Smart Config write to the
+ *      staged configuration. The operation octet is followed, for join and
+ *      leave, by one or more group IDs, each LSB first.
+ *
+ *  RETURNS
+ *      Status to be returned in the GATT_ACCESS_RSP message
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status ehSmartConfigGroup(SMART_CONFIG_T *p_config,
+                                     uint8 *p_value, uint16 length)
+{
+    uint8 op;                           /* Group operation */
+    uint16 group;                       /* Group ID */
+
+    if(length < 1 || ((length - 1) & 1) != 0 ||
+       (p_value[0] != EhSmart_GROUP_CLEAR && length < 3))
+    {
+        return gatt_status_invalid_length;
+    }
+
+    op = *p_value++;
+    length--;
+
+    switch(op)
+    {
+        case EhSmart_GROUP_CLEAR:
+            if(length != 0)
+            {
+                return gatt_status_invalid_length;
+            }
+            p_config->group_count = 0;
+        break;
+
+        case EhSmart_GROUP_JOIN:
+            while(length != 0)
+            {
+                group = BufReadUint16(&p_value);
+                if(group == SMART_GROUP_NONE)
+                {
+                    return gatt_status_invalid_param_value;
+                }
+
+                if(!SmartConfigJoinGroup(p_config, group))
+                {
+                    /* The group list is full */
+                    return gatt_status_insufficient_resources;
+                }
+                length -= 2;
+            }
+        break;
+
+        case EhSmart_GROUP_LEAVE:
+            while(length != 0)
+            {
+                SmartConfigLeaveGroup(p_config, BufReadUint16(&p_value));
+                length -= 2;
+            }
+        break;
+
+        default:
+            return gatt_status_invalid_param_value;
+    }
+
+    return sys_status_success;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ehSmartConfigRole
+ *
+ *  DESCRIPTION
+ *      This function applies a role setting of a Smart Config write to the
+ *      staged configuration. The role octet may be followed by the lengths
+ *      of the scan windows and advertising bursts, in milliseconds, each LSB
+ *      first; without them the current lengths are kept.
+ *
+ *  RETURNS
+ *      Status to be returned in the GATT_ACCESS_RSP message
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status ehSmartConfigRole(SMART_CONFIG_T *p_config,
+                                    uint8 *p_value, uint16 length)
+{
+    if(length != EhSmart_ROLE_LENGTH && length != EhSmart_ROLE_WINDOWS_LENGTH)
+    {
+        return gatt_status_invalid_length;
+    }
+
+    p_config->role = *p_value++;
+
+    if(length == EhSmart_ROLE_WINDOWS_LENGTH)
+    {
+        p_config->scan_window = BufReadUint16(&p_value);
+        p_config->adv_window = BufReadUint16(&p_value);
+    }
+
+    return sys_status_success;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ehSmartConfigSetting
+ *
+ *  DESCRIPTION
+ *      This function applies one setting of a Smart Config write to the
+ *      staged configuration. Values are checked once the whole write has
+ *      been applied.
+ *
+ *  RETURNS
+ *      Status to be returned in the GATT_ACCESS_RSP message
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status ehSmartConfigSetting(SMART_CONFIG_T *p_config, uint8 type,
+                                       uint8 *p_value, uint16 length)
+{
+    uint16 expected;                    /* Length of a fixed length value */
+
+    switch(type)
+    {
+        case EhSmart_CONFIG_ROLE:
+            return ehSmartConfigRole(p_config, p_value, length);
+
+        case EhSmart_CONFIG_GROUP:
+            return ehSmartConfigGroup(p_config, p_value, length);
+
+        case EhSmart_CONFIG_UUID:
+            expected = EhSmart_CONFIG_UUID_LENGTH;
+        break;
+
+        case EhSmart_CONFIG_INTERVAL:
+            expected = EhSmart_CONFIG_INTERVAL_LENGTH;
+        break;
+
+        case EhSmart_CONFIG_DATA_TYPE:
+            expected = EhSmart_CONFIG_DATA_TYPE_LENGTH;
+        break;
+
+        case EhSmart_CONFIG_ADV_TYPE:
+            expected = EhSmart_CONFIG_ADV_TYPE_LENGTH;
+        break;
+
+        case EhSmart_CONFIG_NODE_ID:
+            expected = EhSmart_CONFIG_NODE_ID_LENGTH;
+        break;
+
+        default:
+            return gatt_status_invalid_param_value;
+    }
+
+    if(length != expected)
+    {
+        return gatt_status_invalid_length;
+    }
+
+    switch(type)
+    {
+        case EhSmart_CONFIG_UUID:
+            p_config->uuid = BufReadUint32(&p_value);
+        break;
+
+        case EhSmart_CONFIG_INTERVAL:
+            p_config->adv_interval = BufReadUint16(&p_value);
+        break;
+
+        case EhSmart_CONFIG_DATA_TYPE:
+            p_config->data_type = BufReadUint16(&p_value);
+        break;
+
+        case EhSmart_CONFIG_NODE_ID:
+            p_config->node_id = *p_value;
+        break;
+
+        default:
+            p_config->adv_type = *p_value;
+        break;
+    }
+
+    return sys_status_success;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ehSmartConfigWrite
+ *
+ *  DESCRIPTION
+ *      This function handles a write to the Smart Config characteristic.
+ *      The settings are applied to a copy of the current configuration,
+ *      which is only committed, with a single NVM write, if every setting
+ *      has been applied and the result is valid. A write that fails leaves
+ *      the configuration as it was.
+ *
+ *  RETURNS
+ *      Status to be returned in the GATT_ACCESS_RSP message
+ *
+ *---------------------------------------------------------------------------*/
+
+static sys_status ehSmartConfigWrite(uint8 *p_value, uint16 length)
+{
+    SMART_CONFIG_T config = *SmartConfigGet();
+    sys_status rc;
+    uint8 type;                         /* Type of the setting */
+    uint16 value_length;                /* Length of the setting value */
+
+    if(length == 0)
+    {
+        return gatt_status_invalid_length;
+    }
+
+    while(length != 0)
+    {
+        if(length < EhSmart_CONFIG_HEADER_LENGTH ||
+           length - EhSmart_CONFIG_HEADER_LENGTH < p_value[1])
+        {
+            return gatt_status_invalid_length;
+        }
+
+        type = p_value[0];
+        value_length = p_value[1];
+        p_value += EhSmart_CONFIG_HEADER_LENGTH;
+
+        rc = ehSmartConfigSetting(&config, type, p_value, value_length);
+        if(rc != sys_status_success)
+        {
+            return rc;
+        }
+
+        p_value += value_length;
+        length -= EhSmart_CONFIG_HEADER_LENGTH + value_length;
+    }
+
+    if(!SmartConfigIsValid(&config))
+    {
+        return gatt_status_invalid_param_value;
+    }
+
+    SmartConfigCommit(&config);
+
+    return sys_status_success;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ehSmartNotifyEnabled
+ *
+ *  DESCRIPTION
+ *      This function checks whether the connected host has enabled sensor
+ *      notifications.
+ *
+ *  RETURNS
+ *      TRUE if sensor samples are to be notified, FALSE otherwise
+ *
+ *---------------------------------------------------------------------------*/
+
+static bool ehSmartNotifyEnabled(void)
+{
+    return (GetConnectionID() != GATT_INVALID_UCID &&
+            g_EhSmart_serv_data.meas_client_config ==
+                gatt_client_config_notification);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ehSmartNotifyStop
+ *
+ *  DESCRIPTION
+ *      This function discards the samples waiting to be notified and adds
+ *      the time for which notifications were enabled to the statistics.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+static void ehSmartNotifyStop(void)
+{
+    if(g_EhSmart_serv_data.meas_client_config ==
+       gatt_client_config_notification)
+    {
+        /* Unsigned subtraction copes with the system time wrapping */
+        g_EhSmart_notify_data.stats.time +=
+            (TimeGet32() - g_EhSmart_notify_data.start) / MILLISECOND;
+    }
+
+    g_EhSmart_notify_data.stats.dropped += g_EhSmart_notify_data.count;
+    g_EhSmart_notify_data.head = 0;
+    g_EhSmart_notify_data.count = 0;
+}
+
 /*============================================================================*
  *  Public Function Implementations
  *============================================================================*/
@@ -90,6 +477,11 @@ EhSmart_SERV_DATA_T g_EhSmart_serv_data;
 
 extern void EhSmartDataInit(void)
 {
+    /* Nothing is waiting to be notified on a new connection */
+    ehSmartNotifyStop();
+    g_EhSmart_notify_data.in_flight = 0;
+    g_EhSmart_notify_data.window = EhSmart_NOTIFY_WINDOW;
+
     if(1)
     {
         /* Initialise BP Measurement Client Configuration descriptor
@@ -134,6 +526,9 @@ extern void EhSmartHandleAccessRead(GATT_ACCESS_IND_T *p_ind)
         break;
 
 	case HANDLE_SMART_SENSOR:		////
+		/* the most recent sample */
+		length = g_EhSmart_notify_data.last.length;
+		MemCopy(val, g_EhSmart_notify_data.last.data, length);
 		break;
 
 	case HANDLE_SMART_CONTROL:		////
@@ -188,6 +583,18 @@ extern void EhSmartHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
             if((client_config == gatt_client_config_notification) ||
                (client_config == gatt_client_config_none))
             {
+                if(client_config != g_EhSmart_serv_data.meas_client_config)
+                {
+                    if(client_config == gatt_client_config_notification)
+                    {
+                        g_EhSmart_notify_data.start = TimeGet32();
+                    }
+                    else
+                    {
+                        ehSmartNotifyStop();
+                    }
+                }
+
                 g_EhSmart_serv_data.meas_client_config = client_config;
 
                 /* Write BP Measurement Client configuration to NVM if the 
@@ -206,29 +613,37 @@ extern void EhSmartHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
 		break;
 
 	case HANDLE_SMART_CONTROL:		////
-		DebugIfWriteString("smart control\r\n");
+		/* queue a message: address, group and data type, each LSB
+		 * first, then the data octets
+		 */
+		if(p_ind->size_value != EhSmart_CONTROL_DATA_LENGTH)
+		{
+			rc = gatt_status_invalid_length;
+		}
+		else
+		{
+			Smart_Data_Struct msg;
+
+			msg.SmartUUID = SmartConfigGet()->uuid;
+			msg.SmartADDR = BufReadUint16(&p_value);
+			msg.SmartGRUOP = BufReadUint16(&p_value);
+			msg.SmartDataType = BufReadUint16(&p_value);
+			MemCopy(msg.SmartDATA, p_value, SMART_DATA_LENGTH);
+			msg.Random = 0;
+			msg.SmartTTL = SMART_DEFAULT_TTL;
+			msg.SmartSEQ = 0;
+
+			if(!SmartSendData(&msg))
+			{
+				/* transmit queue is full, the client may retry */
+				rc = gatt_status_insufficient_resources;
+			}
+		}
 		break;
 
 	case HANDLE_SMART_CONFIG:
-		switch(p_value[0])
-		{
-			case 0x00:		////adver uuid
-				break;
-			case 0x01:		////adver interval
-				break;
-			case 0x02:		////role, scan or adver?, 01: adver, 02: scan , 03: scan & adver 
-				break;
-			case 0x03:		////group
-				break;
-			case 0x04:		////data type
-				break;
-			case 0x05:		////adver type
-				break;
-			case 0x06:		////
-				break;
-			default:
-				break;
-		}
+		/* one or more settings, committed together */
+		rc = ehSmartConfigWrite(p_value, p_ind->size_value);
 		break;
 	
     }
@@ -282,34 +697,37 @@ extern bool EhSmartIndCfmPending(void)
  *
  *  DESCRIPTION
  *      This function is used to read Blood Pressure service specific data 
- *      stored in NVM
+ *      stored in NVM. It is called when the bonded host reconnects, so the
+ *      time for which notifications are enabled is counted from here if the
+ *      stored client configuration enables them.
  *
  *  RETURNS
  *      Nothing.
  *
  *---------------------------------------------------------------------------*/
 
-extern void EhSmartReadDataFromNVM(uint16 *p_offset)
+extern void EhSmartReadDataFromNVM(void)
 {
 
-    g_EhSmart_serv_data.nvm_offset = *p_offset;
-
     /* Read NVM only if devices are bonded */
     if(1)
     {
         /* Read BP measurement client configuration */
-        Nvm_Read((uint16*)&g_EhSmart_serv_data.meas_client_config,
-                 sizeof(g_EhSmart_serv_data.meas_client_config),
-                 *p_offset + 
-                 EhSmart_NVM_MEAS_CLIENT_CONFIG_OFFSET);
+        if(NvmStoreRead(nvm_record_client_config,
+                        (uint16*)&g_EhSmart_serv_data.meas_client_config,
+                        sizeof(g_EhSmart_serv_data.meas_client_config)) !=
+           sizeof(g_EhSmart_serv_data.meas_client_config))
+        {
+            g_EhSmart_serv_data.meas_client_config = gatt_client_config_none;
+        }
 
+        if(g_EhSmart_serv_data.meas_client_config ==
+           gatt_client_config_notification)
+        {
+            g_EhSmart_notify_data.start = TimeGet32();
+        }
     }
 
-    /* Increment the offset by the number of words of NVM memory required 
-     * by Blood Pressure service 
-     */
-    *p_offset += EhSmart_SERVICE_NVM_MEMORY_WORDS;
-
 }
 
 
@@ -353,11 +771,190 @@ extern void EhSmartBondingNotify(void)
     if(1)
     {
         /* Write to NVM the client configuration value */
-        Nvm_Write((uint16*)&g_EhSmart_serv_data.meas_client_config,
-                  sizeof(g_EhSmart_serv_data.meas_client_config),
-                  g_EhSmart_serv_data.nvm_offset + 
-                  EhSmart_NVM_MEAS_CLIENT_CONFIG_OFFSET);
+        NvmStoreWrite(nvm_record_client_config,
+                      (uint16*)&g_EhSmart_serv_data.meas_client_config,
+                      sizeof(g_EhSmart_serv_data.meas_client_config));
+    }
+
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EhSmartQueueSample
+ *
+ *  DESCRIPTION
+ *      This function queues a sensor sample to be notified to the connected
+ *      host. Samples are not sent until EhSmartSendSamples() is called, so
+ *      that a batch of samples can share notifications. The sample is also
+ *      kept as the value returned by reads of the characteristic.
+ *
+ *  RETURNS
+ *      TRUE if the sample has been queued or notifications are not enabled,
+ *      FALSE if the sample has been dropped because the queue is full
+ *
+ *---------------------------------------------------------------------------*/
+
+extern bool EhSmartQueueSample(const uint8 *p_sample, uint16 length)
+{
+    EhSmart_SAMPLE_T *p_slot;
+
+    if(length > EhSmart_SAMPLE_MAX_LENGTH)
+    {
+        length = EhSmart_SAMPLE_MAX_LENGTH;
+    }
+
+    MemCopy(g_EhSmart_notify_data.last.data, p_sample, length);
+    g_EhSmart_notify_data.last.length = length;
+
+    if(!ehSmartNotifyEnabled())
+    {
+        return TRUE;
+    }
+
+    if(g_EhSmart_notify_data.count == EhSmart_SAMPLE_QUEUE_SIZE)
+    {
+        g_EhSmart_notify_data.stats.dropped++;
+        return FALSE;
+    }
+
+    p_slot = &g_EhSmart_notify_data.sample[
+                    (g_EhSmart_notify_data.head +
+                     g_EhSmart_notify_data.count) % EhSmart_SAMPLE_QUEUE_SIZE];
+    g_EhSmart_notify_data.count++;
+
+    MemCopy(p_slot->data, p_sample, length);
+    p_slot->length = length;
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EhSmartSendSamples
+ *
+ *  DESCRIPTION
+ *      This function notifies the queued sensor samples. Each notification
+ *      carries as many samples as fit, each preceded by its length octet.
+ *      Notifications are sent back to back, so that they can go out in the
+ *      same connection event, until as many are waiting for confirmation as
+ *      the firmware is trusted to buffer. The rest are sent as confirmations
+ *      come in.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EhSmartSendSamples(void)
+{
+    uint8 value[EhSmart_NOTIFY_MAX_LENGTH];
+
+    if(!ehSmartNotifyEnabled())
+    {
+        return;
+    }
+
+    while(g_EhSmart_notify_data.count != 0 &&
+          g_EhSmart_notify_data.in_flight < g_EhSmart_notify_data.window)
+    {
+        uint16 length = 0;
+
+        do
+        {
+            const EhSmart_SAMPLE_T *p_sample =
+                &g_EhSmart_notify_data.sample[g_EhSmart_notify_data.head];
+
+            if(length + 1 + p_sample->length > EhSmart_NOTIFY_MAX_LENGTH)
+            {
+                break;
+            }
+
+            value[length++] = p_sample->length;
+            MemCopy(&value[length], p_sample->data, p_sample->length);
+            length += p_sample->length;
+
+            g_EhSmart_notify_data.head = (g_EhSmart_notify_data.head + 1) %
+                                         EhSmart_SAMPLE_QUEUE_SIZE;
+            g_EhSmart_notify_data.count--;
+            g_EhSmart_notify_data.stats.samples++;
+
+        } while(g_EhSmart_notify_data.count != 0);
+
+        GattCharValueNotification(GetConnectionID(), HANDLE_SMART_SENSOR,
+                                  length, value);
+
+        g_EhSmart_notify_data.in_flight++;
+        g_EhSmart_notify_data.stats.notifications++;
+        g_EhSmart_notify_data.stats.octets += length;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EhSmartHandleNotificationCfm
+ *
+ *  DESCRIPTION
+ *      This function handles the confirmation of a sensor notification by
+ *      the firmware and sends more queued samples. If the firmware could not
+ *      buffer the notification, its samples are lost and fewer notifications
+ *      are sent at once from now on.
+ *
+ *  RETURNS
+ *      Nothing
+ *
+ *---------------------------------------------------------------------------*/
+
+extern void EhSmartHandleNotificationCfm(GATT_CHAR_VAL_IND_CFM_T *p_event_data)
+{
+    if(p_event_data->handle != HANDLE_SMART_SENSOR)
+    {
+        return;
+    }
+
+    if(g_EhSmart_notify_data.in_flight != 0)
+    {
+        g_EhSmart_notify_data.in_flight--;
     }
 
+    if(p_event_data->result != sys_status_success)
+    {
+        g_EhSmart_notify_data.stats.failed++;
+
+        if(g_EhSmart_notify_data.window > 1)
+        {
+            g_EhSmart_notify_data.window--;
+        }
+    }
+
+    EhSmartSendSamples();
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EhSmartGetNotifyStats
+ *
+ *  DESCRIPTION
+ *      This function returns the sensor notification statistics. The time
+ *      includes the current connection if notifications are enabled, so
+ *      that the octets divided by the time give the throughput achieved.
+ *
+ *  RETURNS
+ *      Sensor notification statistics
+ *
+ *---------------------------------------------------------------------------*/
+
+extern const EhSmart_NOTIFY_STATS_T *EhSmartGetNotifyStats(void)
+{
+    static EhSmart_NOTIFY_STATS_T stats;
+
+    stats = g_EhSmart_notify_data.stats;
+
+    if(ehSmartNotifyEnabled())
+    {
+        /* Unsigned subtraction copes with the system time wrapping */
+        stats.time += (TimeGet32() - g_EhSmart_notify_data.start) /
+                      MILLISECOND;
+    }
+
+    return &stats;
+}
@@ -14,6 +14,13 @@
  *============================================================================*/
 
 
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Largest sensor sample, in octets */
+#define EhSmart_SAMPLE_MAX_LENGTH             (12)
+
 /*============================================================================*
  *  Public Function Prototypes
  *============================================================================*/
@@ -27,10 +34,30 @@ typedef struct
     /* Client configuration for BP measurement characteristic */
     gatt_client_config      meas_client_config;
 
-    /* Offset at which Blood Pressure data is stored in NVM */
-    uint16                  nvm_offset;
-
 } EhSmart_SERV_DATA_T;
+
+/* Sensor notification statistics */
+typedef struct
+{
+    /* Notifications sent */
+    uint32                  notifications;
+
+    /* Samples sent in the notifications */
+    uint32                  samples;
+
+    /* Octets sent in the notifications */
+    uint32                  octets;
+
+    /* Samples dropped because the queue was full or the host went away */
+    uint32                  dropped;
+
+    /* Notifications the firmware failed to send */
+    uint32                  failed;
+
+    /* Time for which notifications have been enabled, milliseconds */
+    uint32                  time;
+
+} EhSmart_NOTIFY_STATS_T;
 /* This function is used to initialise Blood Pressure service data 
  * structure
  */
@@ -62,7 +89,7 @@ extern bool EhSmartIndCfmPending(void);
 /* This function is used to read Blood Pressure service specific data 
  * stored in NVM
  */
-extern void EhSmartReadDataFromNVM(uint16 *p_offset);
+extern void EhSmartReadDataFromNVM(void);
 
 /* This function is used to check if the handle belongs to the Blood 
  * Pressure service
@@ -74,5 +101,21 @@ extern bool EhSmartCheckHandleRange(uint16 handle);
  */
 extern void EhSmartBondingNotify(void);
 
+/* This function queues a sensor sample to be notified to the connected
+ * host
+ */
+extern bool EhSmartQueueSample(const uint8 *p_sample, uint16 length);
+
+/* This function notifies the queued sensor samples as far as the firmware
+ * buffers allow
+ */
+extern void EhSmartSendSamples(void);
+
+/* This function handles the confirmation of a sensor notification */
+extern void EhSmartHandleNotificationCfm(GATT_CHAR_VAL_IND_CFM_T *p_event_data);
+
+/* This function returns the sensor notification statistics */
+extern const EhSmart_NOTIFY_STATS_T *EhSmartGetNotifyStats(void);
+
 
 #endif	/*__EH_SMART_SERVICE_H__*/
\ No newline at end of file
@@ -0,0 +1,403 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      event_profile.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines for profiling the LM event handlers of the
+ *      application. The number of events and the time spent handling them are
+ *      accumulated on the target, so that the scan and GATT access paths can
+ *      be compared between builds without any host side tooling.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <time.h>           /* Application interface to System Time */
+#include <mem.h>            /* Memory library */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"    /* User configuration */
+#include "event_profile.h"  /* Interface to this file */
+#include "debug_interface.h"/* Application debug routines */
+#include "tea.h"            /* Smart home frame cipher */
+
+/* Only compile this file if event profiling has been requested */
+#ifdef ENABLE_EVENT_PROFILING
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Event classes that are profiled separately */
+#define PROFILE_CLASS_ADV_REPORT        (0)
+#define PROFILE_CLASS_ACCESS_IND        (1)
+#define PROFILE_CLASS_OTHER             (2)
+
+/* Number of profiled event classes */
+#define PROFILE_CLASS_MAX               (3)
+
+/* Number of frames processed in each run of the cipher benchmark */
+#define PROFILE_CIPHER_FRAMES           (100)
+
+/* Number of octets and words in a smart home frame */
+#define PROFILE_FRAME_LENGTH            (16)
+#define PROFILE_FRAME_WORDS             (PROFILE_FRAME_LENGTH / 2)
+
+/* Processor clock, in cycles per microsecond */
+#define PROFILE_CYCLES_PER_US           (16)
+
+/*============================================================================*
+ *  Private Data types
+ *============================================================================*/
+
+/* Counters for one event class */
+typedef struct _PROFILE_COUNTER_T
+{
+    /* Number of events handled */
+    uint32                      count;
+
+    /* Total time spent in the event handler, in microseconds */
+    uint32                      total_time;
+
+    /* Longest time spent in the event handler, in microseconds */
+    uint32                      max_time;
+
+} PROFILE_COUNTER_T;
+
+/* Event profiling data structure */
+typedef struct _PROFILE_DATA_T
+{
+    /* Time at which the measurement period started */
+    uint32                      period_start;
+
+    /* Counters for each event class */
+    PROFILE_COUNTER_T           counter[PROFILE_CLASS_MAX];
+
+} PROFILE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Event profiling data */
+static PROFILE_DATA_T g_profile_data;
+
+/* Names of the event classes, used in the report */
+static const char *profile_class_name[PROFILE_CLASS_MAX] =
+{
+    "adv report",
+    "access ind",
+    "other     "
+};
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      profileLegacyCipher
+ *
+ *  DESCRIPTION
+ *      This function does the same work per frame as the octet-wise XOR
+ *      placeholder that the frame cipher replaced, i.e. the derivation of a
+ *      16 octet key from the seed, a copy of the frame and an XOR of every
+ *      octet. It is only used as the baseline of the cipher benchmark.
+ *
+ *  PARAMETERS
+ *      frame [in/out]          Frame, one octet per element
+ *      seed [in]               Random seed
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void profileLegacyCipher(uint8 *frame, uint16 seed)
+{
+    uint8 key[PROFILE_FRAME_LENGTH];
+    uint8 mem[PROFILE_FRAME_LENGTH];
+    uint8 x = (uint8)(((seed >> 8) + seed) & 0xff);
+    uint16 i;                   /* Loop counter */
+
+    for(i = 0; i < PROFILE_FRAME_LENGTH; i++)
+    {
+        key[i] = (uint8)(i ^ x);
+    }
+
+    MemCopy(mem, frame, PROFILE_FRAME_LENGTH);
+
+    for(i = 0; i < PROFILE_FRAME_LENGTH; i++)
+    {
+        frame[i] = mem[i] ^ key[i];
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      profileWriteCost
+ *
+ *  DESCRIPTION
+ *      This function writes the cost per frame of one cipher benchmark run to
+ *      the UART, in microseconds and processor cycles.
+ *
+ *  PARAMETERS
+ *      name [in]               Name of the benchmark run
+ *      elapsed [in]            Time taken by the run, in microseconds
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void profileWriteCost(const char *name, uint32 elapsed)
+{
+    const uint32 per_frame = elapsed / PROFILE_CIPHER_FRAMES;
+
+    DebugIfWriteString(name);
+    DebugIfWriteString(": us per frame ");
+    DebugIfWriteUint32(per_frame);
+    DebugIfWriteString(", cycles ");
+    DebugIfWriteUint32(per_frame * PROFILE_CYCLES_PER_US);
+    DebugIfWriteString("\r\n");
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EventProfileInit
+ *
+ *  DESCRIPTION
+ *      This function resets the event counters and starts a new measurement
+ *      period.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void EventProfileInit(void)
+{
+    MemSet(g_profile_data.counter, 0, sizeof(g_profile_data.counter));
+
+    g_profile_data.period_start = TimeGet32();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EventProfileStart
+ *
+ *  DESCRIPTION
+ *      This function returns the time stamp at which the handling of an LM
+ *      event starts.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Current system time, in microseconds
+ *----------------------------------------------------------------------------*/
+extern uint32 EventProfileStart(void)
+{
+    return TimeGet32();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EventProfileEnd
+ *
+ *  DESCRIPTION
+ *      This function accounts the time spent handling an LM event against the
+ *      class of the event.
+ *
+ *  PARAMETERS
+ *      event_code [in]         LM event ID
+ *      start [in]              Time stamp returned by EventProfileStart()
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void EventProfileEnd(lm_event_code event_code, uint32 start)
+{
+    PROFILE_COUNTER_T *p_counter;
+    /* Unsigned subtraction copes with the system time wrapping */
+    const uint32 elapsed = TimeGet32() - start;
+
+    switch(event_code)
+    {
+        case LM_EV_ADVERTISING_REPORT:
+            p_counter = &g_profile_data.counter[PROFILE_CLASS_ADV_REPORT];
+        break;
+
+        case GATT_ACCESS_IND:
+            p_counter = &g_profile_data.counter[PROFILE_CLASS_ACCESS_IND];
+        break;
+
+        default:
+            p_counter = &g_profile_data.counter[PROFILE_CLASS_OTHER];
+        break;
+    }
+
+    p_counter->count++;
+    p_counter->total_time += elapsed;
+
+    if(elapsed > p_counter->max_time)
+    {
+        p_counter->max_time = elapsed;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EventProfileReport
+ *
+ *  DESCRIPTION
+ *      This function writes, for each event class, the number of events, the
+ *      event rate in events per second and the average and worst case
+ *      handling cost in microseconds to the UART. A new measurement period is
+ *      then started.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void EventProfileReport(void)
+{
+    /* Length of the measurement period, in milliseconds */
+    const uint32 period = (TimeGet32() - g_profile_data.period_start) /
+                          MILLISECOND;
+    uint16 i;                   /* Loop counter */
+
+    DebugIfWriteString("\r\nEvent profile over ");
+    DebugIfWriteUint32(period);
+    DebugIfWriteString(" ms\r\n");
+
+    for(i = 0; i < PROFILE_CLASS_MAX; i++)
+    {
+        const PROFILE_COUNTER_T *p_counter = &g_profile_data.counter[i];
+
+        DebugIfWriteString(profile_class_name[i]);
+        DebugIfWriteString(": count ");
+        DebugIfWriteUint32(p_counter->count);
+
+        if(period != 0)
+        {
+            DebugIfWriteString(", per sec ");
+            DebugIfWriteUint32((p_counter->count * 1000UL) / period);
+        }
+
+        if(p_counter->count != 0)
+        {
+            DebugIfWriteString(", avg us ");
+            DebugIfWriteUint32(p_counter->total_time / p_counter->count);
+            DebugIfWriteString(", max us ");
+            DebugIfWriteUint32(p_counter->max_time);
+        }
+
+        DebugIfWriteString("\r\n");
+    }
+
+    EventProfileInit();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      EventProfileCipher
+ *
+ *  DESCRIPTION
+ *      This function checks that a smart home frame survives an encryption
+ *      round trip, then measures the cost per frame of encryption, decryption,
+ *      key derivation and cached key lookup against the XOR placeholder the
+ *      cipher replaced. The key cache is emptied afterwards, so that its
+ *      statistics only count the lookups for received and sent frames.
+ *      The results are written to the UART.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void EventProfileCipher(void)
+{
+    /* Reference frame, as sent by a node with the default configuration */
+    static const uint16 ref_frame[PROFILE_FRAME_WORDS] =
+    {
+        0x0000, 0x0439, 0x0101, 0x1101, 0x4001, 0x4445, 0x4647, 0x4849
+    };
+    uint16 frame[PROFILE_FRAME_WORDS];
+    uint8 legacy_frame[PROFILE_FRAME_LENGTH];
+    uint32 key[4];
+    uint32 start;
+    uint16 i;                   /* Loop counter */
+
+    /* Round trip check */
+    MemCopy(frame, ref_frame, PROFILE_FRAME_WORDS);
+    KeyConvert(0x00a2, key);
+    encrypt(frame, PROFILE_FRAME_LENGTH, key);
+    decrypt(frame, PROFILE_FRAME_LENGTH, key);
+
+    for(i = 0; i < PROFILE_FRAME_WORDS; i++)
+    {
+        if(frame[i] != ref_frame[i])
+        {
+            DebugIfWriteString("Cipher round trip failed\r\n");
+            return;
+        }
+    }
+
+    /* Baseline: the octet-wise XOR placeholder, including key derivation */
+    MemSet(legacy_frame, 0, PROFILE_FRAME_LENGTH);
+    start = TimeGet32();
+    for(i = 0; i < PROFILE_CIPHER_FRAMES; i++)
+    {
+        profileLegacyCipher(legacy_frame, i);
+    }
+    profileWriteCost("legacy xor", TimeGet32() - start);
+
+    start = TimeGet32();
+    for(i = 0; i < PROFILE_CIPHER_FRAMES; i++)
+    {
+        KeyConvert(i, key);
+    }
+    profileWriteCost("key derivation", TimeGet32() - start);
+
+    /* Lookups of a seed that is already cached */
+    (void)KeyCacheLookup(0x00a2);
+    start = TimeGet32();
+    for(i = 0; i < PROFILE_CIPHER_FRAMES; i++)
+    {
+        (void)KeyCacheLookup(0x00a2);
+    }
+    profileWriteCost("key cache hit", TimeGet32() - start);
+
+    /* Leave the key cache and its statistics to the received frames */
+    KeyCacheInit();
+
+    start = TimeGet32();
+    for(i = 0; i < PROFILE_CIPHER_FRAMES; i++)
+    {
+        encrypt(frame, PROFILE_FRAME_LENGTH, key);
+    }
+    profileWriteCost("xxtea encrypt", TimeGet32() - start);
+
+    start = TimeGet32();
+    for(i = 0; i < PROFILE_CIPHER_FRAMES; i++)
+    {
+        decrypt(frame, PROFILE_FRAME_LENGTH, key);
+    }
+    profileWriteCost("xxtea decrypt", TimeGet32() - start);
+}
+
+#endif /* ENABLE_EVENT_PROFILING */
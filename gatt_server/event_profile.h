@@ -0,0 +1,68 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      event_profile.h
+ *
+ *  DESCRIPTION
+ *      This file contains prototypes for profiling the LM event handlers of
+ *      the application.
+ *
+ *****************************************************************************/
+
+#ifndef __EVENT_PROFILE_H__
+#define __EVENT_PROFILE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+#include <bt_event_types.h> /* Type definitions for Bluetooth events */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"    /* User configuration */
+
+/* Only compile this file if event profiling has been requested */
+#ifdef ENABLE_EVENT_PROFILING
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Reset the event counters and start a new measurement period */
+extern void EventProfileInit(void);
+
+/* Return the time stamp to be passed to EventProfileEnd() */
+extern uint32 EventProfileStart(void);
+
+/* Account an LM event whose handling started at the given time stamp */
+extern void EventProfileEnd(lm_event_code event_code, uint32 start);
+
+/* Write the event rates and average handling costs to the UART */
+extern void EventProfileReport(void);
+
+/* Check the smart home frame cipher and write its cost per frame to the UART */
+extern void EventProfileCipher(void);
+
+#else /* ENABLE_EVENT_PROFILING */
+
+/* Define profiling functions to expand to nothing as event profiling is not
+ * enabled
+ */
+
+#define EventProfileInit()
+#define EventProfileStart()                     (0)
+#define EventProfileEnd(event_code, start)      ((void)(event_code), \
+                                                 (void)(start))
+#define EventProfileReport()
+#define EventProfileCipher()
+
+#endif /* ENABLE_EVENT_PROFILING */
+
+#endif /* __EVENT_PROFILE_H__ */
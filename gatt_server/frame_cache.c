@@ -0,0 +1,333 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      frame_cache.c
+ *
+ *  DESCRIPTION
+ *      This file defines routines for the cache of recently received smart
+ *      home frames. Every node advertises the same frame many times, so each
+ *      frame is remembered by sender address, random seed and a hash of the
+ *      encrypted frame, and repeats are dropped before they are decrypted.
+ *      Entries are aged out on a timer which only runs while the cache holds
+ *      entries.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <timer.h>          /* Chip timer functions */
+#include <mem.h>            /* Memory library */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "frame_cache.h"    /* Interface to this file */
+#include "timer_wheel.h"    /* Logical timers on one firmware timer */
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of frames remembered */
+#define FRAME_CACHE_SIZE                (8)
+
+/* Aging timer period */
+#define FRAME_CACHE_TICK                (500 * MILLISECOND)
+
+/* Number of aging timer periods a frame is remembered for after it was last
+ * received
+ */
+#define FRAME_CACHE_LIFETIME            (6)
+
+/*============================================================================*
+ *  Private Data types
+ *============================================================================*/
+
+/* Cache entry for one received frame */
+typedef struct _FRAME_CACHE_ENTRY_T
+{
+    /* Address of the sender */
+    BD_ADDR_T                   addr;
+
+    /* Random seed the frame was encrypted with */
+    uint16                      seed;
+
+    /* Hash of the encrypted frame */
+    uint16                      hash;
+
+    /* Remaining lifetime in aging timer periods, zero if the entry is free */
+    uint16                      age;
+
+} FRAME_CACHE_ENTRY_T;
+
+/* Frame cache data structure */
+typedef struct _FRAME_CACHE_DATA_T
+{
+    /* Cached frames */
+    FRAME_CACHE_ENTRY_T         entry[FRAME_CACHE_SIZE];
+
+    /* Number of entries in use */
+    uint16                      used;
+
+    /* Timer ID for aging the entries */
+    timer_id                    aging_tid;
+
+} FRAME_CACHE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Frame cache data */
+static FRAME_CACHE_DATA_T g_frame_cache;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+/* Handle the aging timer expiry */
+static void frameCacheAgingTimerHandler(timer_id tid);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      frameCacheHash
+ *
+ *  DESCRIPTION
+ *      This function calculates a 16-bit hash of a frame.
+ *
+ *  PARAMETERS
+ *      p_frame [in]            Frame, one octet per element
+ *      length [in]             Number of octets in the frame
+ *
+ *  RETURNS
+ *      Hash of the frame
+ *----------------------------------------------------------------------------*/
+static uint16 frameCacheHash(const uint8 *p_frame, uint16 length)
+{
+    uint16 hash = 0;
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < length; i++)
+    {
+        /* Rotate left by three bits and add the next octet */
+        hash = ((hash << 3) | (hash >> 13)) ^ (p_frame[i] & 0xff);
+    }
+
+    return hash;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      frameCacheHashWords
+ *
+ *  DESCRIPTION
+ *      This function calculates the same hash as frameCacheHash() for a frame
+ *      packed into words, most significant octet first.
+ *
+ *  PARAMETERS
+ *      frame [in]              Frame, two octets per word
+ *      words [in]              Number of words in the frame
+ *
+ *  RETURNS
+ *      Hash of the frame
+ *----------------------------------------------------------------------------*/
+static uint16 frameCacheHashWords(const uint16 *frame, uint16 words)
+{
+    uint16 hash = 0;
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < words; i++)
+    {
+        hash = ((hash << 3) | (hash >> 13)) ^ (frame[i] >> 8);
+        hash = ((hash << 3) | (hash >> 13)) ^ (frame[i] & 0xff);
+    }
+
+    return hash;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      frameCacheAgingTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function handles the expiry of the aging timer. The lifetime of
+ *      every entry is reduced, and the timer is restarted as long as there are
+ *      entries left.
+ *
+ *  PARAMETERS
+ *      tid [in]                ID of timer that has expired
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void frameCacheAgingTimerHandler(timer_id tid)
+{
+    uint16 i;                       /* Loop counter */
+
+    if(tid != g_frame_cache.aging_tid)
+    {
+        /* Ignore a timer that has been superseded */
+        return;
+    }
+
+    g_frame_cache.aging_tid = TIMER_INVALID;
+
+    for(i = 0; i < FRAME_CACHE_SIZE; i++)
+    {
+        if(g_frame_cache.entry[i].age != 0)
+        {
+            if(--g_frame_cache.entry[i].age == 0)
+            {
+                g_frame_cache.used--;
+            }
+        }
+    }
+
+    if(g_frame_cache.used != 0)
+    {
+        g_frame_cache.aging_tid = TimerWheelCreate(FRAME_CACHE_TICK,
+                                                   frameCacheAgingTimerHandler);
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FrameCacheInit
+ *
+ *  DESCRIPTION
+ *      This function empties the frame cache. It is called after the
+ *      application timers have been initialised, so no aging timer is running.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void FrameCacheInit(void)
+{
+    MemSet(&g_frame_cache, 0, sizeof(g_frame_cache));
+
+    g_frame_cache.aging_tid = TIMER_INVALID;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FrameCacheCheckAndAdd
+ *
+ *  DESCRIPTION
+ *      This function checks whether a frame has been received recently. A
+ *      repeated frame has its lifetime renewed, so that a frame advertised
+ *      continuously stays suppressed. A new frame replaces a free entry or,
+ *      if the cache is full, the entry closest to expiry.
+ *
+ *  PARAMETERS
+ *      p_addr [in]             Address of the sender
+ *      seed [in]               Random seed the frame was encrypted with
+ *      p_frame [in]            Encrypted frame, one octet per element
+ *      length [in]             Number of octets in the frame
+ *
+ *  RETURNS
+ *      TRUE if the frame is a repeat, FALSE if it is new
+ *----------------------------------------------------------------------------*/
+extern bool FrameCacheCheckAndAdd(const BD_ADDR_T *p_addr, uint16 seed,
+                                  const uint8 *p_frame, uint16 length)
+{
+    const uint16 hash = frameCacheHash(p_frame, length);
+    FRAME_CACHE_ENTRY_T *p_victim = &g_frame_cache.entry[0];
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < FRAME_CACHE_SIZE; i++)
+    {
+        FRAME_CACHE_ENTRY_T *p_entry = &g_frame_cache.entry[i];
+
+        if(p_entry->age != 0 &&
+           p_entry->hash == hash &&
+           p_entry->seed == seed &&
+           p_entry->addr.lap == p_addr->lap &&
+           p_entry->addr.uap == p_addr->uap &&
+           p_entry->addr.nap == p_addr->nap)
+        {
+            /* Repeated frame */
+            p_entry->age = FRAME_CACHE_LIFETIME;
+            return TRUE;
+        }
+
+        if(p_entry->age < p_victim->age)
+        {
+            p_victim = p_entry;
+        }
+    }
+
+    if(p_victim->age == 0)
+    {
+        g_frame_cache.used++;
+    }
+
+    p_victim->addr = *p_addr;
+    p_victim->seed = seed;
+    p_victim->hash = hash;
+    p_victim->age = FRAME_CACHE_LIFETIME;
+
+    if(g_frame_cache.aging_tid == TIMER_INVALID)
+    {
+        g_frame_cache.aging_tid = TimerWheelCreate(FRAME_CACHE_TICK,
+                                                   frameCacheAgingTimerHandler);
+    }
+
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      FrameCacheRemove
+ *
+ *  DESCRIPTION
+ *      This function forgets a frame which was added to the cache but could
+ *      not be queued. Otherwise the sender advertising it again would only
+ *      renew the entry, and the frame would be lost. The sender address is no
+ *      longer known when the frame is dropped, so the entry is found by seed
+ *      and hash alone.
+ *
+ *  PARAMETERS
+ *      seed [in]               Random seed the frame was encrypted with
+ *      frame [in]              Encrypted frame, two octets per word, most
+ *                              significant octet first
+ *      words [in]              Number of words in the frame
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void FrameCacheRemove(uint16 seed, const uint16 *frame, uint16 words)
+{
+    const uint16 hash = frameCacheHashWords(frame, words);
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < FRAME_CACHE_SIZE; i++)
+    {
+        FRAME_CACHE_ENTRY_T *p_entry = &g_frame_cache.entry[i];
+
+        if(p_entry->age != 0 &&
+           p_entry->hash == hash &&
+           p_entry->seed == seed)
+        {
+            p_entry->age = 0;
+            g_frame_cache.used--;
+            return;
+        }
+    }
+}
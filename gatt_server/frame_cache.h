@@ -0,0 +1,43 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      frame_cache.h
+ *
+ *  DESCRIPTION
+ *      This file contains prototypes for the cache of recently received smart
+ *      home frames, used to suppress repeated frames.
+ *
+ *****************************************************************************/
+
+#ifndef __FRAME_CACHE_H__
+#define __FRAME_CACHE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+#include <bluetooth.h>      /* Bluetooth specific type definitions */
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Initialise the frame cache to an empty state */
+extern void FrameCacheInit(void);
+
+/* Check whether a frame has been received recently. A frame that has not is
+ * added to the cache. Returns TRUE if the frame is a repeat.
+ */
+extern bool FrameCacheCheckAndAdd(const BD_ADDR_T *p_addr, uint16 seed,
+                                  const uint8 *p_frame, uint16 length);
+
+/* Forget a frame that was added to the cache but then dropped, so that the
+ * next time it is received it is handled again
+ */
+extern void FrameCacheRemove(uint16 seed, const uint16 *frame, uint16 words);
+
+#endif /* __FRAME_CACHE_H__ */
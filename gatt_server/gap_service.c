@@ -27,6 +27,7 @@
 #include "gap_service.h"    /* Interface to this file */
 #include "app_gatt_db.h"    /* GATT database definitions */
 #include "nvm_access.h"     /* Non-volatile memory access */
+#include "nvm_store.h"      /* Log-structured NVM record store */
 
 /*============================================================================*
  *  Private Data Types
@@ -41,9 +42,6 @@ typedef struct _GAP_DATA_T
     /* Pointer to hold device name used by the application */
     uint8   *p_dev_name;
 
-    /* NVM offset at which GAP Service data is stored */
-    uint16  nvm_offset;
-
 } GAP_DATA_T;
 
 /*============================================================================*
@@ -63,18 +61,9 @@ AD_TYPE_LOCAL_NAME_COMPLETE,
  *  Private Definitions
  *============================================================================*/
 
-/* Number of words of NVM memory used by the GAP Service */
-
-/* Add space for Device Name Length and Device Name */
-#define GAP_SERVICE_NVM_MEMORY_WORDS  (1 + DEVICE_NAME_MAX_LENGTH)
-
-/* The offset of data being stored in NVM for the GAP Service. This offset is 
- * added to the GAP Service offset in the NVM region (see g_gap_data.nvm_offset) 
- * to get the absolute offset at which this data is stored in NVM.
+/* The device name is stored in NVM as a record of its own, one character
+ * per word, so that the length of the record is the length of the name.
  */
-#define GAP_NVM_DEVICE_LENGTH_OFFSET  (0)
-
-#define GAP_NVM_DEVICE_NAME_OFFSET    (1)
 
 /*============================================================================*
  *  Private Function Prototypes
@@ -107,18 +96,12 @@ static void updateDeviceName(uint16 length, uint8 *name);
 static void gapWriteDeviceNameToNvm(void)
 {
 
-    /* Write device name length to NVM */
-    Nvm_Write(&g_gap_data.length, sizeof(g_gap_data.length), 
-              g_gap_data.nvm_offset + 
-              GAP_NVM_DEVICE_LENGTH_OFFSET);
-
     /* Write device name to NVM 
      * Typecasting uint8 to uint16 or vice-versa does not have any side effects
      * as both types (uint8 and uint16) take one word of memory on the XAP
      */
-    Nvm_Write((uint16*)g_gap_data.p_dev_name, g_gap_data.length, 
-              g_gap_data.nvm_offset + 
-              GAP_NVM_DEVICE_NAME_OFFSET);
+    NvmStoreWrite(nvm_record_device_name,
+                  (uint16*)g_gap_data.p_dev_name, g_gap_data.length);
 
 }
 
@@ -281,39 +264,73 @@ extern void GapHandleAccessWrite(GATT_ACCESS_IND_T *p_ind)
  *
  *  DESCRIPTION
  *      This function is used to read GAP Service specific data stored in NVM.
+ *      The default device name is kept if none has been stored.
  *
  *  PARAMETERS
- *      p_offset [in]           Offset to GAP Service data in NVM
- *               [out]          Offset to next entry in NVM
+ *      None
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-extern void GapReadDataFromNVM(uint16 *p_offset)
+extern void GapReadDataFromNVM(void)
 {
-
-    g_gap_data.nvm_offset = *p_offset;
-
-    /* Read Device Length */
-    Nvm_Read(&g_gap_data.length, sizeof(g_gap_data.length), 
-             *p_offset + 
-             GAP_NVM_DEVICE_LENGTH_OFFSET);
+    uint16 length;
 
     /* Read Device Name
      * Typecasting uint8 to uint16 or vice-versa does not have any side effects
      * as both types (uint8 and uint16) take one word of memory on the XAP
      */
-    Nvm_Read((uint16*)g_gap_data.p_dev_name, g_gap_data.length, 
-             *p_offset + 
-             GAP_NVM_DEVICE_NAME_OFFSET);
+    length = NvmStoreRead(nvm_record_device_name,
+                          (uint16*)g_gap_data.p_dev_name,
+                          DEVICE_NAME_MAX_LENGTH);
+
+    if(length <= DEVICE_NAME_MAX_LENGTH)
+    {
+        g_gap_data.length = length;
+    }
 
     /* Add NUL character to terminate the device name string */
     g_gap_data.p_dev_name[g_gap_data.length] = '\0';
 
-    /* Increase NVM offset for maximum device name length. Add 1 for
-     * 'device name length' field as well
-     */
-    *p_offset += DEVICE_NAME_MAX_LENGTH + 1;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GapReadDataFromNVMV1
+ *
+ *  DESCRIPTION
+ *      This function is used to read GAP Service specific data stored by
+ *      NVM layout version 1: the device name length followed by the device
+ *      name. The default device name is kept if the length is not valid.
+ *
+ *  PARAMETERS
+ *      offset [in]             Offset to GAP Service data in NVM
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void GapReadDataFromNVMV1(uint16 offset)
+{
+    uint16 length;
+
+    /* Read Device Length */
+    Nvm_Read(&length, sizeof(length), offset);
+
+    if(length <= DEVICE_NAME_MAX_LENGTH)
+    {
+        g_gap_data.length = length;
+
+        /* Read Device Name
+         * Typecasting uint8 to uint16 or vice-versa does not have any side
+         * effects as both types (uint8 and uint16) take one word of memory
+         * on the XAP
+         */
+        Nvm_Read((uint16*)g_gap_data.p_dev_name, g_gap_data.length,
+                 offset + 1);
+
+        /* Add NUL character to terminate the device name string */
+        g_gap_data.p_dev_name[g_gap_data.length] = '\0';
+    }
 
 }
 
@@ -326,26 +343,17 @@ extern void GapReadDataFromNVM(uint16 *p_offset)
  *      first time during application initialisation.
  *
  *  PARAMETERS
- *      p_offset [in]           Offset to GAP Service data in NVM
- *               [out]          Offset to next entry in NVM
+ *      None
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-extern void GapInitWriteDataToNVM(uint16 *p_offset)
+extern void GapInitWriteDataToNVM(void)
 {
 
-    /* The NVM offset at which GAP Service data will be stored */
-    g_gap_data.nvm_offset = *p_offset;
-
     /* Write device name to NVM */
     gapWriteDeviceNameToNvm();
 
-    /* Increase NVM offset for maximum device name length. Add 1 for
-     * 'device name length' field as well
-     */
-    *p_offset += DEVICE_NAME_MAX_LENGTH + 1;
-
 }
 
 /*----------------------------------------------------------------------------*
@@ -45,12 +45,15 @@ extern void GapHandleAccessRead(GATT_ACCESS_IND_T *p_ind);
 extern void GapHandleAccessWrite(GATT_ACCESS_IND_T *p_ind);
 
 /* Read the GAP Service specific data stored in NVM */
-extern void GapReadDataFromNVM(uint16 *p_offset);
+extern void GapReadDataFromNVM(void);
+
+/* Read the GAP Service specific data stored by NVM layout version 1 */
+extern void GapReadDataFromNVMV1(uint16 offset);
 
 /* Write GAP Service specific data to NVM for the first time during
  * application initialisation
  */
-extern void GapInitWriteDataToNVM(uint16 *p_offset);
+extern void GapInitWriteDataToNVM(void);
 
 /* Check if the handle belongs to the GAP Service */
 extern bool GapCheckHandleRange(uint16 handle);
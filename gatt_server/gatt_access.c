@@ -40,6 +40,9 @@
 #include "random.h"
 
 #include "debug_interface.h"
+#include "trace.h"          /* Deferred binary trace */
+#include "smart_group.h"    /* Smart home group membership table */
+#include "smart_config.h"   /* Persistent smart home configuration */
 /*============================================================================*
  *  Private Definitions
  *============================================================================*/
@@ -65,21 +68,94 @@ Smart_Data_Struct SmartHomeIndx;
 #define WORD32_2SB(_val)              ( ((_val) & 0x0000ff00) >> 8 )
 #define WORD32_1SB(_val)              ( ((_val) & 0x000000ff) )
 
+/* AD structures of the smart home advert, in the order they are stored */
+#define SMART_AD_UUID                                     (0)
+#define SMART_AD_SEED                                     (1)
+#define SMART_AD_FRAME                                    (2)
+
+/* Number of AD structures in the smart home advert */
+#define SMART_AD_MAX                                      (3)
+
+/* Offset of each AD structure in the advert cache, AD type included */
+#define SMART_AD_UUID_OFFSET                              (0)
+#define SMART_AD_SEED_OFFSET                              (5)
+#define SMART_AD_FRAME_OFFSET                             (8)
+
+/* Length of the advert cache. With their length octets the AD structures
+ * take 28 octets, which leaves room in the 31-octet advert for the Flags AD
+ * structure the firmware adds in discoverable mode.
+ */
+#define SMART_AD_CACHE_LEN                                (25)
+
+/* Dirty flag of an AD structure in the advert cache */
+#define SMART_AD_DIRTY(idx)                               (1 << (idx))
+#define SMART_AD_DIRTY_ALL                  ((1 << SMART_AD_MAX) - 1)
+
+/* Distinct foreign smart home frames received per second at or above which
+ * the channel is taken to be congested, and at or below which it is taken
+ * to be quiet
+ */
+#define ADVERT_LOAD_CONGESTED                             (8)
+#define ADVERT_LOAD_QUIET                                 (2)
+
+/* Highest congestion level. Each level doubles the advertising interval, so
+ * FAST_INTERVAL_MIN is backed off as far as SLOW_INTERVAL_MIN.
+ */
+#define ADVERT_LEVEL_MAX                                  (6)
+
+/* Levels added to the congestion level while there is nothing new to send */
+#define ADVERT_LEVEL_IDLE                                 (2)
+
 
 /*============================================================================*
  *  Private Data types
  *============================================================================*/
 
+/* Cache of the serialised smart home advert. Each AD structure is only
+ * rebuilt when the data it carries has changed, so that the frame is not
+ * encrypted again and no new seed is drawn for an unchanged advert.
+ */
+typedef struct _ADVERT_CACHE_T
+{
+    /* Serialised AD structures, each starting with its AD type */
+    uint8                       data[SMART_AD_CACHE_LEN];
+
+    /* Length of each AD structure, AD type included */
+    uint16                      length[SMART_AD_MAX];
+
+    /* Bit mask of AD structures that need to be rebuilt */
+    uint16                      dirty;
+
+} ADVERT_CACHE_T;
+
 /*============================================================================*
  *  Private Data 
  *============================================================================*/
 
+/* Smart home advert cache */
+static ADVERT_CACHE_T g_advert_cache;
+
+/* Congestion level of the adaptive advertising interval controller */
+static uint16 g_advert_level;
+
+/* Advertising interval last chosen by the adaptive controller, microseconds */
+static uint32 g_advert_interval;
+
 /*============================================================================*
  *  Private Function Prototypes
  *============================================================================*/
 /* Set advertisement parameters */
 static void gattSetAdvertParams(uint8 fast_connection);
 
+/* Rebuild the AD structures of the advert cache that are out of date */
+static void gattBuildAdvertCache(void);
+
+/* Store the cached advert in the firmware */
+static void gattStoreAdvertData(void);
+
+/* Choose the advertising interval from the load on the channel */
+static uint32 gattAdaptiveInterval(void);
+
 /*============================================================================*
  *  Private Function Implementations
  *============================================================================*/
@@ -87,7 +163,6 @@ static void gattSetAdvertParams(uint8 fast_connection);
 static uint8 InitRandData(uint8* buf)
 {
 	uint8 i = 0;
-	SmartHomeIndx.Random = Random16();
 	buf[i++] = AD_TYPE_SERVICE_UUID_16BIT;
 	buf[i++] = WORD_MSB(SmartHomeIndx.Random);
 	buf[i++] = WORD_LSB(SmartHomeIndx.Random);
@@ -113,54 +188,157 @@ static uint8 InitUUID32Data(uint8* buf)
 extern uint8 BuildEhongSmartData(uint8* buf)
 {
 	uint8 i =0 ;
-	uint8 KEY[16] = {0};
-	buf[i++] = AD_TYPE_SERVICE_UUID_128BIT;			////used for data
+	uint8 j;
+	uint16 frame[SMART_FRAME_WORDS];	/* frame, MSB first in each word */
 
-	/////smart uuid
-	buf[i++] = WORD32_4SB(SmartHomeIndx.SmartUUID);
-	buf[i++] = WORD32_3SB(SmartHomeIndx.SmartUUID);
-	buf[i++] = WORD32_2SB(SmartHomeIndx.SmartUUID);
-	buf[i++] = WORD32_1SB(SmartHomeIndx.SmartUUID);
-
-	/////smart adver type
-	buf[i++] = WORD_MSB(SmartHomeIndx.SmartADDR);
-	buf[i++] = WORD_LSB(SmartHomeIndx.SmartADDR);
-	
-	/////smart group
-	buf[i++] = WORD_MSB(SmartHomeIndx.SmartGRUOP);
-	buf[i++] = WORD_LSB(SmartHomeIndx.SmartGRUOP);
-
-	/////smart DATA TYPE
-	buf[i++] = WORD_MSB(SmartHomeIndx.SmartDataType);
-	buf[i++] = WORD_LSB(SmartHomeIndx.SmartDataType);
-
-	/////smart DATA value
-	buf[i++] = SmartHomeIndx.SmartDATA[0];
-	buf[i++] = SmartHomeIndx.SmartDATA[1];
-	buf[i++] = SmartHomeIndx.SmartDATA[2];
-	buf[i++] = SmartHomeIndx.SmartDATA[3];
-	buf[i++] = SmartHomeIndx.SmartDATA[4];
-	buf[i++] = SmartHomeIndx.SmartDATA[5];
-
-	#if defined ENCRP_TEA
-	KeyConvert(SmartHomeIndx.Random, KEY);
-	encrypt(buf+1, 16, KEY);
+	/* encode the frame and encrypt it with the current seed */
+	SmartBuildData(&SmartHomeIndx, frame);
 
+	buf[i++] = AD_TYPE_SERVICE_UUID_128BIT;			////used for data
+	for(j=0; j<SMART_FRAME_WORDS; j++)
 	{
-		uint8 j=0;
-		DebugIfWriteString("After encryp = ");
-		for(j=0; j<16; j++)
-		{
-			DebugIfWriteUint8(buf[1+j]);
-			DebugIfWriteString(", ");
-		}
-		DebugIfWriteString("\r\n");
+		buf[i++] = WORD_MSB(frame[j]);
+		buf[i++] = WORD_LSB(frame[j]);
 	}
-	#endif
-	
+
+	TraceWrite(trace_frame_sent, frame, SMART_FRAME_WORDS);
+
 	return i;
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      gattBuildAdvertCache
+ *
+ *  DESCRIPTION
+ *      This function rebuilds the AD structures of the advert cache that are
+ *      marked dirty. Whoever draws a new seed must mark the frame dirty as
+ *      well, as the frame is encrypted with it.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void gattBuildAdvertCache(void)
+{
+    if(g_advert_cache.dirty & SMART_AD_DIRTY(SMART_AD_UUID))
+    {
+        g_advert_cache.length[SMART_AD_UUID] =
+            InitUUID32Data(&g_advert_cache.data[SMART_AD_UUID_OFFSET]);
+    }
+
+    if(g_advert_cache.dirty & SMART_AD_DIRTY(SMART_AD_SEED))
+    {
+        g_advert_cache.length[SMART_AD_SEED] =
+            InitRandData(&g_advert_cache.data[SMART_AD_SEED_OFFSET]);
+    }
+
+    if(g_advert_cache.dirty & SMART_AD_DIRTY(SMART_AD_FRAME))
+    {
+        g_advert_cache.length[SMART_AD_FRAME] =
+            BuildEhongSmartData(&g_advert_cache.data[SMART_AD_FRAME_OFFSET]);
+    }
+
+    g_advert_cache.dirty = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      gattStoreAdvertData
+ *
+ *  DESCRIPTION
+ *      This function replaces the advertising data held by the firmware with
+ *      the cached AD structures. The firmware can only append AD structures
+ *      or clear them all, so the cached copies of the unchanged structures
+ *      are stored again as they are.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void gattStoreAdvertData(void)
+{
+    static const uint16 offset[SMART_AD_MAX] =
+    {
+        SMART_AD_UUID_OFFSET,
+        SMART_AD_SEED_OFFSET,
+        SMART_AD_FRAME_OFFSET
+    };
+    uint16 i;                       /* Loop counter */
+
+    /* Reset existing advertising data */
+    if(LsStoreAdvScanData(0, NULL, ad_src_advertise) != ls_err_none)
+    {
+        ReportPanic(app_panic_set_advert_data);
+    }
+
+    for(i = 0; i < SMART_AD_MAX; i++)
+    {
+        if(LsStoreAdvScanData(g_advert_cache.length[i],
+                              &g_advert_cache.data[offset[i]],
+                              ad_src_advertise) != ls_err_none)
+        {
+            ReportPanic(app_panic_set_advert_data);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      gattAdaptiveInterval
+ *
+ *  DESCRIPTION
+ *      This function chooses the advertising interval. The interval starts
+ *      at FAST_INTERVAL_MIN and is doubled for each congestion level, and for
+ *      a further ADVERT_LEVEL_IDLE levels if the smart home protocol engine
+ *      has nothing new to send. A random fraction of up to an eighth is
+ *      added, so that nodes that see the same load do not stay in step.
+ *      A fixed interval set by Smart Config overrides the controller.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Advertising interval, microseconds
+ *----------------------------------------------------------------------------*/
+static uint32 gattAdaptiveInterval(void)
+{
+    uint32 interval = FAST_INTERVAL_MIN;
+    uint16 level = g_advert_level;
+    uint16 i;                       /* Loop counter */
+
+    if(SmartConfigGet()->adv_interval != SMART_CONFIG_INTERVAL_ADAPTIVE)
+    {
+        g_advert_interval = SmartConfigGet()->adv_interval * MILLISECOND;
+        return g_advert_interval;
+    }
+
+    if(!SmartTxPending())
+    {
+        level += ADVERT_LEVEL_IDLE;
+    }
+
+    for(i = 0; i < level && interval < SLOW_INTERVAL_MIN; i++)
+    {
+        interval <<= 1;
+    }
+
+    interval += Random32() % (interval >> 3);
+
+    if(interval > SLOW_INTERVAL_MIN)
+    {
+        interval = SLOW_INTERVAL_MIN;
+    }
+
+    g_advert_interval = interval;
+
+    return interval;
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      gattSetAdvertParams
@@ -169,17 +347,16 @@ extern uint8 BuildEhongSmartData(uint8* buf)
  *      This function is used to set advertisement parameters.
  *
  *  PARAMETERS
- *      p_addr [in]             Bonded host address
- *      fast_connection [in]    TRUE:  Fast advertisements
- *                              FALSE: Slow advertisements
+ *      adv_speed [in]          0:    Fast advertisements
+ *                              0xff: Slow advertisements
+ *                              GATT_ADVERT_ADAPTIVE: Advertisements at the
+ *                              interval chosen by the adaptive controller
  *
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
 static void gattSetAdvertParams(uint8 adv_speed)
 {
-	uint8 advert_data[MAX_ADV_DATA_LEN];/* Advertisement packet */
-	uint16 length;                      /* Length of advertisement packet */
 	/* Advertisement interval, microseconds */
 	uint32 adv_interval_min;
 	uint32 adv_interval_max;
@@ -196,14 +373,7 @@ static void gattSetAdvertParams(uint8 adv_speed)
 	}
 	else
 	{
-		uint32 rand = Random32();
-		if(rand < FAST_INTERVAL_MIN)
-			adv_interval_min = adv_interval_max = FAST_INTERVAL_MIN;
-		else if(rand > SLOW_INTERVAL_MIN)
-			adv_interval_min = adv_interval_max =  SLOW_INTERVAL_MIN;
-		else 
-			adv_interval_min = adv_interval_max = rand;
-			
+		adv_interval_min = adv_interval_max = gattAdaptiveInterval();
 	}
 
 	if((GapSetMode(gap_role_peripheral, gap_mode_discover_general,
@@ -216,39 +386,17 @@ static void gattSetAdvertParams(uint8 adv_speed)
 	    ReportPanic(app_panic_set_advert_params);
 	}
 
-	/* Reset existing advertising data */
-	if(LsStoreAdvScanData(0, NULL, ad_src_advertise) != ls_err_none)
-	{
-	    ReportPanic(app_panic_set_advert_data);
-	}
-
 	/* Reset existing scan response data */
 	if(LsStoreAdvScanData(0, NULL, ad_src_scan_rsp) != ls_err_none)
 	{
 	    ReportPanic(app_panic_set_scan_rsp_data);
 	}
 
-	 length = InitUUID32Data(advert_data);
-	 if (LsStoreAdvScanData(length, advert_data, 
-	                    ad_src_advertise) != ls_err_none)
-	{
-	    ReportPanic(app_panic_set_advert_data);
-	}
-
-	 length = InitRandData(advert_data);
-	 if (LsStoreAdvScanData(length, advert_data, 
-	                    ad_src_advertise) != ls_err_none)
-	{
-	    ReportPanic(app_panic_set_advert_data);
-	}
-	 
-	length = BuildEhongSmartData(advert_data);
-	 if (LsStoreAdvScanData(length, advert_data, 
-	                    ad_src_advertise) != ls_err_none)
-	{
-	    ReportPanic(app_panic_set_advert_data);
-	}
-
+	/* The seed only changes with the message, so an unchanged advert is
+	 * stored again as it is, without encrypting the frame again
+	 */
+	gattBuildAdvertCache();
+	gattStoreAdvertData();
 }
 
 
@@ -258,22 +406,26 @@ static void gattSetAdvertParams(uint8 adv_speed)
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      InitGattData
+ *      InitGattSmartData
  *
  *  DESCRIPTION
- *      This function initialises the application GATT data.
+ *      This function puts the node's own state in the smart home advert. It
+ *      is called once at start-up, after the configuration has been read,
+ *      so that a message being sent is not replaced when the application
+ *      data is initialised again on disconnection.
  *
  *  PARAMETERS
  *      None
  *  RETURNS
  *      Nothing
  *----------------------------------------------------------------------------*/
-extern void InitGattData(void)
+extern void InitGattSmartData(void)
 {
-   	SmartHomeIndx.SmartUUID = 0xf0140439;
-	SmartHomeIndx.SmartGRUOP = 0x1101;
-	SmartHomeIndx.SmartADDR = 0x0101;
-	SmartHomeIndx.SmartDataType = 0x4001;
+   	SmartHomeIndx.SmartUUID = SmartConfigGet()->uuid;
+	SmartHomeIndx.SmartGRUOP = SMART_DEFAULT_GROUP;
+	SmartHomeIndx.SmartADDR = SMART_ADDR(SmartConfigGet()->node_id,
+	                                     SMART_ADDR_DST(SMART_DEFAULT_ADDR));
+	SmartHomeIndx.SmartDataType = SmartConfigGet()->data_type;
 	SmartHomeIndx.SmartDATA[0] = 0x44;
 	SmartHomeIndx.SmartDATA[1] = 0x45;
 	SmartHomeIndx.SmartDATA[2] = 0x46;
@@ -281,8 +433,212 @@ extern void InitGattData(void)
 	SmartHomeIndx.SmartDATA[4] = 0x48;
 	SmartHomeIndx.SmartDATA[5] = 0x49;
 
-	SmartHomeIndx.Random = 0;
-	
+	/* The seed is kept for as long as the message is unchanged */
+	SmartHomeIndx.Random = Random16();
+
+	/* the node's own state is not relayed */
+	SmartHomeIndx.SmartTTL = 0;
+	SmartHomeIndx.SmartSEQ = SMART_SEQ_STATE;
+
+	g_advert_cache.dirty = SMART_AD_DIRTY_ALL;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      InitGattData
+ *
+ *  DESCRIPTION
+ *      This function initialises the application GATT data. The message
+ *      carried by the advert is left as it is.
+ *
+ *  PARAMETERS
+ *      None
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void InitGattData(void)
+{
+	/* Build the whole advert when advertising next starts */
+	g_advert_cache.dirty = SMART_AD_DIRTY_ALL;
+
+	/* Assume a quiet channel until the first scan window says otherwise */
+	g_advert_level = 0;
+	g_advert_interval = FAST_INTERVAL_MIN;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattUpdateSmartData
+ *
+ *  DESCRIPTION
+ *      This function updates the message carried by the smart home advert.
+ *      If the message has changed, a new seed is drawn, the frame is
+ *      encrypted again under it, and the new advert is stored without
+ *      restarting the advertising procedure. Nothing is done if the message
+ *      has not changed, so this function may be called at the sensor sample
+ *      rate, and the seed stays the same for as long as the message does.
+ *      The UUID and seed of the message are ignored.
+ *
+ *  PARAMETERS
+ *      p_msg [in]              Message to advertise
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void GattUpdateSmartData(const Smart_Data_Struct *p_msg)
+{
+    bool changed = (SmartHomeIndx.SmartADDR != p_msg->SmartADDR ||
+                    SmartHomeIndx.SmartGRUOP != p_msg->SmartGRUOP ||
+                    SmartHomeIndx.SmartDataType != p_msg->SmartDataType ||
+                    SmartHomeIndx.SmartTTL != p_msg->SmartTTL ||
+                    SmartHomeIndx.SmartSEQ != p_msg->SmartSEQ);
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < SMART_DATA_LENGTH; i++)
+    {
+        if(SmartHomeIndx.SmartDATA[i] != p_msg->SmartDATA[i])
+        {
+            SmartHomeIndx.SmartDATA[i] = p_msg->SmartDATA[i];
+            changed = TRUE;
+        }
+    }
+
+    if(changed)
+    {
+        SmartHomeIndx.SmartADDR = p_msg->SmartADDR;
+        SmartHomeIndx.SmartGRUOP = p_msg->SmartGRUOP;
+        SmartHomeIndx.SmartDataType = p_msg->SmartDataType;
+        SmartHomeIndx.SmartTTL = p_msg->SmartTTL;
+        SmartHomeIndx.SmartSEQ = p_msg->SmartSEQ;
+
+        /* A new message is encrypted under a new seed */
+        SmartHomeIndx.Random = Random16();
+        g_advert_cache.dirty |= SMART_AD_DIRTY(SMART_AD_SEED) |
+                                SMART_AD_DIRTY(SMART_AD_FRAME);
+    }
+
+    if(!(g_advert_cache.dirty &
+         (SMART_AD_DIRTY(SMART_AD_SEED) | SMART_AD_DIRTY(SMART_AD_FRAME))))
+    {
+        /* Nothing has changed */
+        return;
+    }
+
+    /* Before the first advert the whole advert is built by
+     * gattSetAdvertParams()
+     */
+    if(!(g_advert_cache.dirty & SMART_AD_DIRTY(SMART_AD_UUID)))
+    {
+        gattBuildAdvertCache();
+        gattStoreAdvertData();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattReportAdvertLoad
+ *
+ *  DESCRIPTION
+ *      This function is called at the end of each scan window with the
+ *      number of distinct smart home frames received from other nodes. The
+ *      congestion level, and so the advertising interval, goes up by one
+ *      after a congested window and down by one after a quiet one.
+ *
+ *  PARAMETERS
+ *      frames [in]             Distinct frames received in the window
+ *      window [in]             Length of the window, milliseconds
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void GattReportAdvertLoad(uint16 frames, uint16 window)
+{
+    /* Frames per second */
+    const uint32 load = ((uint32)frames * 1000) / window;
+
+    if(load >= ADVERT_LOAD_CONGESTED)
+    {
+        if(g_advert_level < ADVERT_LEVEL_MAX)
+        {
+            g_advert_level++;
+        }
+    }
+    else if(load <= ADVERT_LOAD_QUIET)
+    {
+        if(g_advert_level > 0)
+        {
+            g_advert_level--;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattGetAdvertInterval
+ *
+ *  DESCRIPTION
+ *      This function returns the advertising interval last chosen by the
+ *      adaptive controller.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Advertising interval, microseconds
+ *----------------------------------------------------------------------------*/
+extern uint32 GattGetAdvertInterval(void)
+{
+    return g_advert_interval;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GattApplySmartConfig
+ *
+ *  DESCRIPTION
+ *      This function puts the UUID, data type and node ID of the smart home
+ *      configuration in the advert. The advert is rebuilt when advertising
+ *      next starts, and the advertising interval is chosen again.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void GattApplySmartConfig(void)
+{
+    const SMART_CONFIG_T *p_config = SmartConfigGet();
+
+    if(SmartHomeIndx.SmartUUID != p_config->uuid)
+    {
+        SmartHomeIndx.SmartUUID = p_config->uuid;
+
+        /* The frame carries the UUID as well as the service tag */
+        g_advert_cache.dirty |= SMART_AD_DIRTY(SMART_AD_UUID) |
+                                SMART_AD_DIRTY(SMART_AD_FRAME);
+    }
+
+    if(SmartHomeIndx.SmartDataType != p_config->data_type)
+    {
+        SmartHomeIndx.SmartDataType = p_config->data_type;
+        g_advert_cache.dirty |= SMART_AD_DIRTY(SMART_AD_FRAME);
+    }
+
+    if(SMART_ADDR_SRC(SmartHomeIndx.SmartADDR) != p_config->node_id)
+    {
+        SmartHomeIndx.SmartADDR =
+                SMART_ADDR(p_config->node_id,
+                           SMART_ADDR_DST(SmartHomeIndx.SmartADDR));
+        g_advert_cache.dirty |= SMART_AD_DIRTY(SMART_AD_FRAME);
+    }
+
+    if(g_advert_cache.dirty & SMART_AD_DIRTY(SMART_AD_FRAME))
+    {
+        /* A changed frame is encrypted under a new seed */
+        SmartHomeIndx.Random = Random16();
+        g_advert_cache.dirty |= SMART_AD_DIRTY(SMART_AD_SEED);
+    }
 }
 
 /*----------------------------------------------------------------------------*
@@ -406,6 +762,9 @@ extern void GattStartAdverts(uint16 time, uint8 advSpd)
     /* Start GATT connection in Slave role */
     GattConnectReq(NULL, connect_flags);
 
+    /* The advert is on air */
+    SmartSetAdvertising(TRUE);
+
     if(time > 0)
     {
     	StartAdvertTimer(time);
@@ -22,6 +22,12 @@
 #include <time.h>           /* Application interface to System Time */
 #include <gatt.h>           /* GATT application interface */
 
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "smart_home.h"     /* Smart home protocol engine */
+
 /*============================================================================*
  *  Public Definitions
  *============================================================================*/
@@ -74,6 +80,11 @@ typedef enum
 /* AD Type for Appearance */
 #define AD_TYPE_APPEARANCE                   (0x19)
 
+/* Advertising speed for GattStartAdverts() that lets the adaptive controller
+ * choose the advertising interval from the load on the channel
+ */
+#define GATT_ADVERT_ADAPTIVE                 (0x01)
+
 /* Maximum Length of Device Name 
  * Note: Do not increase device name length beyond (DEFAULT_ATT_MTU - 3 = 20) 
  * octets as the GAP service doesn't support handling of Prepare write and
@@ -140,7 +151,10 @@ typedef enum
     app_panic_invalid_state,
 
     /* Unexpected beep type */
-    app_panic_unexpected_beep_type
+    app_panic_unexpected_beep_type,
+
+    /* No logical or firmware timer left to start */
+    app_panic_timer_exhausted
 
 } app_panic_code;
 
@@ -175,6 +189,23 @@ extern bool GattIsAddressResolvableRandom(TYPED_BD_ADDR_T *p_addr);
 /* Initialise the application GATT data. */
 extern void InitGattData(void);
 
+/* Put the node's own state in the smart home advert */
+extern void InitGattSmartData(void);
+
 extern uint8 BuildEhongSmartData(uint8* buf);
 
+/* Update the message carried by the smart home advert */
+extern void GattUpdateSmartData(const Smart_Data_Struct *p_msg);
+
+/* Report the smart home frames received in a scan window to the adaptive
+ * advertising interval controller
+ */
+extern void GattReportAdvertLoad(uint16 frames, uint16 window);
+
+/* Return the advertising interval last chosen by the adaptive controller */
+extern uint32 GattGetAdvertInterval(void);
+
+/* Put the smart home configuration in the advert */
+extern void GattApplySmartConfig(void);
+
 #endif /* __GATT_ACCESS_H__ */
@@ -39,59 +39,93 @@
 #include "app_gatt_db.h"    /* GATT database definitions */
 #include "buzzer.h"         /* Buzzer functions */
 #include "nvm_access.h"     /* Non-volatile memory access */
+#include "nvm_store.h"      /* Log-structured NVM record store */
 #include "gatt_server.h"    /* Definitions used throughout the GATT server */
 #include "hw_access.h"      /* Hardware access */
 #include "debug_interface.h"/* Application debug routines */
 #include "gap_service.h"    /* GAP service interface */
+#include "event_profile.h"  /* LM event profiling */
 #include "gatt_uuid.h"
 #include "tea.h"
 #include "smart_home.h"
+#include "ad_parser.h"      /* Single pass AD structure parser */
+#include "frame_cache.h"    /* Cache of recently received frames */
+#include "trace.h"          /* Deferred binary trace */
+#include "smart_group.h"    /* Smart home group membership table */
+#include "smart_config.h"   /* Persistent smart home configuration */
+#include "eh_smart_service.h"/* Smart home service */
+#include "timer_wheel.h"    /* Logical timers on one firmware timer */
+#include "work_queue.h"     /* Deferred work queue */
+
 /*============================================================================*
  *  Private Definitions
  *============================================================================*/
 
-/* Maximum number of timers. Up to five timers are required by this application:
+/* Maximum number of firmware timers. Only the timer wheel uses them. It
+ * runs the logical timers of this application, up to TIMER_WHEEL_MAX_TIMERS:
  *  
  *  buzzer.c:       buzzer_tid
  *  This file:      con_param_update_tid
  *  This file:      app_tid
+ *  This file:      role_tid
  *  This file:      bonding_reattempt_tid (if PAIRING_SUPPORT defined)
  *  hw_access.c:    button_press_tid
+ *  frame_cache.c:  aging_tid
+ *  trace.c:        drain_tid (if DEBUG_OUTPUT_ENABLED defined)
+ *  smart_home.c:   tx_tid
+ *  smart_home.c:   rx_tid
  */
-#define MAX_APP_TIMERS                 (5)
+#define MAX_APP_TIMERS                 (TIMER_WHEEL_FIRMWARE_TIMERS)
 
 /* Number of Identity Resolving Keys (IRKs) that application can store */
 #define MAX_NUMBER_IRK_STORED          (1)
 
-/* Magic value to check the sanity of Non-Volatile Memory (NVM) region used by
- * the application. This value is unique for each application.
+/* Magic value at the start of the NVM layout header. This value is unique
+ * for each application.
  */
-#define NVM_SANITY_MAGIC               (0xABAA)
+#define NVM_HEADER_MAGIC               (0x4E56)
 
-/* NVM offset for NVM sanity word */
-#define NVM_OFFSET_SANITY_WORD         (0)
+/* Version of the NVM layout. Version 1 started with a sanity word instead
+ * of the header and kept the data at fixed offsets. Version 2 was never
+ * released, so there is nothing to migrate from it; its number is not
+ * reused, so that a development board holding it is formatted rather than
+ * misread.
+ */
+#define NVM_LAYOUT_VERSION             (3)
+#define NVM_LAYOUT_V1                  (1)
 
-/* NVM offset for bonded flag */
-#define NVM_OFFSET_BONDED_FLAG         (NVM_OFFSET_SANITY_WORD + 1)
+/* Sanity word of layout version 1, which had no header */
+#define NVM_V1_SANITY_MAGIC            (0xABAA)
 
-/* NVM offset for bonded device Bluetooth address */
-#define NVM_OFFSET_BONDED_ADDR         (NVM_OFFSET_BONDED_FLAG + \
-                                        sizeof(g_app_data.bonded))
+/* NVM offset for the layout header */
+#define NVM_OFFSET_HEADER              (0)
 
-/* NVM offset for diversifier */
-#define NVM_OFFSET_SM_DIV              (NVM_OFFSET_BONDED_ADDR + \
-                                        sizeof(g_app_data.bonded_bd_addr))
+/* NVM offset for the record store, which holds the bonding information and
+ * the data of the supported services
+ */
+#define NVM_OFFSET_STORE               (NVM_OFFSET_HEADER + \
+                                        sizeof(NVM_HEADER_T))
 
-/* NVM offset for IRK */
-#define NVM_OFFSET_SM_IRK              (NVM_OFFSET_SM_DIV + \
-                                        sizeof(g_app_data.diversifier))
+/* Number of words of NVM used by application */
+#define NVM_MAX_APP_MEMORY_WORDS       (NVM_OFFSET_STORE + NVM_STORE_WORDS)
 
-/* Number of words of NVM used by application. Memory used by supported 
- * services is not taken into consideration here.
+/* NVM offsets for the data of layout version 1: bonded flag, bonded device
+ * Bluetooth address, diversifier, IRK and the GAP Service data
  */
-#define NVM_MAX_APP_MEMORY_WORDS       (NVM_OFFSET_SM_IRK + \
+#define NVM_V1_OFFSET_BONDED_FLAG      (1)
+#define NVM_V1_OFFSET_BONDED_ADDR      (NVM_V1_OFFSET_BONDED_FLAG + \
+                                        sizeof(g_app_data.bonded))
+#define NVM_V1_OFFSET_SM_DIV           (NVM_V1_OFFSET_BONDED_ADDR + \
+                                        sizeof(g_app_data.bonded_bd_addr))
+#define NVM_V1_OFFSET_SM_IRK           (NVM_V1_OFFSET_SM_DIV + \
+                                        sizeof(g_app_data.diversifier))
+#define NVM_V1_OFFSET_GAP              (NVM_V1_OFFSET_SM_IRK + \
                                         MAX_WORDS_IRK)
 
+/* CRC-16-CCITT polynomial and initial value used for the layout header */
+#define NVM_HEADER_CRC_POLY            (0x1021)
+#define NVM_HEADER_CRC_INIT            (0xFFFF)
+
 /* Slave device is not allowed to transmit another Connection Parameter 
  * Update request till time TGAP(conn_param_timeout). Refer to section 9.3.9.2,
  * Vol 3, Part C of the Core 4.0 BT spec. The application should retry the 
@@ -100,11 +134,53 @@
  */
 #define GAP_CONN_PARAM_TIMEOUT          (30 * SECOND)
 
+/* Indices of the AD structures carrying the seed and the smart home frame */
+#define SMART_AD_SEED                   (0)
+#define SMART_AD_FRAME                  (1)
+
+/* Number of AD structures looked up once the service tag has matched */
+#define SMART_AD_MAX                    (2)
+
+/* Layout of the work item payload for a received smart home frame: the seed
+ * and the frame, as words
+ */
+#define SMART_WORK_SEED                 (0)
+#define SMART_WORK_FRAME                (1)
+#define SMART_WORK_WORDS                (SMART_WORK_FRAME + SMART_FRAME_WORDS)
+
+/* Length of the sensor sample notified for each received message */
+#define SMART_SAMPLE_LENGTH             (3 + SMART_DATA_LENGTH)
+
 /*============================================================================*
  *  Private Data types
  *============================================================================*/
 
+/* Sections of the NVM layout, in NVM order */
+typedef enum
+{
+    nvm_section_header = 0,         /* Layout header */
+    nvm_section_store,              /* Record store */
+
+    nvm_section_count               /* Number of sections */
+
+} nvm_section;
+
+/* NVM layout header, stored at the start of the application's NVM */
+typedef struct _NVM_HEADER_T
+{
+    /* NVM_HEADER_MAGIC */
+    uint16                      magic;
+
+    /* Version of the layout */
+    uint16                      version;
 
+    /* Length of each section, in words */
+    uint16                      section_length[nvm_section_count];
+
+    /* CRC of the words above, covering the header only */
+    uint16                      crc;
+
+} NVM_HEADER_T;
 
 /*============================================================================*
  *  Private Data
@@ -116,6 +192,14 @@ static uint16 app_timers[SIZEOF_APP_TIMER * MAX_APP_TIMERS];
 /* Application data instance */
 static APP_DATA_T g_app_data;
 
+/* Advertising report statistics */
+static SCAN_STATS_T g_scan_stats;
+
+/* Smart home service tag, i.e. the value of the 32-bit service UUID AD
+ * structure, most significant octet first. Set from the configured UUID.
+ */
+static uint8 smart_uuid_tag[SMART_UUID_LENGTH];
+
 /*============================================================================*
  *  Private Function Prototypes
  *============================================================================*/
@@ -123,6 +207,21 @@ static APP_DATA_T g_app_data;
 /* Initialise application data structure */
 static void appDataInit(void);
 
+/* Calculate the CRC of the NVM layout header */
+static uint16 nvmHeaderCrc(const NVM_HEADER_T *p_header);
+
+/* Find which version of the NVM layout the NVM holds */
+static uint16 nvmLayoutVersion(void);
+
+/* Read the bonding information from the records in the record store */
+static void readPersistentRecords(void);
+
+/* Read the bonding information from NVM layout version 1 */
+static void readPersistentStoreV1(void);
+
+/* Rewrite NVM in the current layout */
+static void writePersistentStore(void);
+
 /* Initialise and read NVM data */
 static void readPersistentStore(void);
 
@@ -152,6 +251,15 @@ static void appInitExit(void);
 /* Handle advertising timer expiry */
 static void appAdvertTimerHandler(timer_id tid);
 
+/* Start scanning and advertising for the smart home role */
+static void appRoleStart(void);
+
+/* Stop scanning and advertising for the smart home role */
+static void appRoleStop(void);
+
+/* Handle the expiry of a scan window or advertising burst */
+static void appRoleTimerHandler(timer_id tid);
+
 /* LM_EV_CONNECTION_COMPLETE signal handler */
 static void handleSignalLmEvConnectionComplete(
                                      LM_EV_CONNECTION_COMPLETE_T *p_event_data);
@@ -192,6 +300,24 @@ static void handleSignalGattAccessInd(GATT_ACCESS_IND_T *p_event_data);
 static void handleSignalLmDisconnectComplete(
                     HCI_EV_DATA_DISCONNECT_COMPLETE_T *p_event_data);
 
+/* Decrypt and queue a received smart home frame, as deferred work */
+static void appReceivedFrameWork(const uint16 *p_payload, uint16 length);
+
+/* Flush the NVM cache, as deferred work */
+static void appNvmFlushWork(const uint16 *p_payload, uint16 length);
+
+/* Flush the NVM cache once the current event has been handled */
+static void appNvmFlushLater(void);
+
+/* Write the bonding information to the record store, as deferred work */
+static void appStoreBondingWork(const uint16 *p_payload, uint16 length);
+
+/* Write the bonding information once the current event has been handled */
+static void appStoreBondingLater(void);
+
+/* Write the statistics to the UART, as deferred work */
+static void appReportStatsWork(const uint16 *p_payload, uint16 length);
+
 /*============================================================================*
  *  Private Function Implementations
  *============================================================================*/
@@ -214,19 +340,20 @@ static void appDataInit(void)
     /* Initialise general application timer */
     if (g_app_data.app_tid != TIMER_INVALID)
     {
-        TimerDelete(g_app_data.app_tid);
+        TimerWheelDelete(g_app_data.app_tid);
         g_app_data.app_tid = TIMER_INVALID;
     }
 
-    TimerDelete(g_app_data.role_tid);
-        g_app_data.role_tid = TIMER_INVALID;
+    /* Stop the smart home role scheduler */
+    appRoleStop();
+
     /* Reset the pairing button press flag */
     g_app_data.pairing_button_pressed = FALSE;
 
     /* Initialise the connection parameter update timer */
     if (g_app_data.con_param_update_tid != TIMER_INVALID)
     {
-        TimerDelete(g_app_data.con_param_update_tid);
+        TimerWheelDelete(g_app_data.con_param_update_tid);
         g_app_data.con_param_update_tid = TIMER_INVALID;
     }
 
@@ -243,7 +370,7 @@ static void appDataInit(void)
     /* Initialise the bonding reattempt timer */
     if (g_app_data.bonding_reattempt_tid != TIMER_INVALID)
     {
-        TimerDelete(g_app_data.bonding_reattempt_tid);
+        TimerWheelDelete(g_app_data.bonding_reattempt_tid);
         g_app_data.bonding_reattempt_tid = TIMER_INVALID;
     }
 #endif /* PAIRING_SUPPORT */
@@ -263,133 +390,361 @@ static void appDataInit(void)
     GapDataInit();
 
     /* Call the required service data initialisation APIs from here */
+    EhSmartDataInit();
 }
 
 /*----------------------------------------------------------------------------*
  *  NAME
- *      readPersistentStore
+ *      nvmHeaderCrc
+ *
+ *  DESCRIPTION
+ *      This function calculates the CRC of the NVM layout header, over every
+ *      word but the CRC itself. The CRC covers the header only. The data
+ *      behind it changes with every record written, and each record in the
+ *      record store carries a check word of its own. Indexing the store stops
+ *      at the first record that fails its check.
+ *
+ *  PARAMETERS
+ *      p_header [in]           Layout header
+ *
+ *  RETURNS
+ *      CRC of the header
+ *----------------------------------------------------------------------------*/
+static uint16 nvmHeaderCrc(const NVM_HEADER_T *p_header)
+{
+    const uint16 *p_word = (const uint16 *)p_header;
+    uint16 crc = NVM_HEADER_CRC_INIT;
+    uint16 i;                           /* Loop counter */
+    uint16 bit;                         /* Loop counter */
+
+    for(i = 0; i < sizeof(NVM_HEADER_T) - sizeof(p_header->crc); i++)
+    {
+        crc ^= p_word[i];
+
+        for(bit = 0; bit < 16; bit++)
+        {
+            if(crc & 0x8000)
+            {
+                crc = (crc << 1) ^ NVM_HEADER_CRC_POLY;
+            }
+            else
+            {
+                crc <<= 1;
+            }
+        }
+    }
+
+    return crc;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmLayoutVersion
  *
  *  DESCRIPTION
- *      This function is used to initialise and read NVM data.
+ *      This function finds which version of the NVM layout the NVM holds.
+ *      A header of the current version is only accepted if its CRC is
+ *      correct and its sections have the lengths this application uses.
  *
  *  PARAMETERS
  *      None
  *
  *  RETURNS
- *      Nothing
+ *      Version of the layout, or 0 if NVM holds no layout this application
+ *      can read
  *----------------------------------------------------------------------------*/
-static void readPersistentStore(void)
+static uint16 nvmLayoutVersion(void)
 {
-    /* NVM offset for supported services */
-    uint16 nvm_offset = NVM_MAX_APP_MEMORY_WORDS;
-    uint16 nvm_sanity = 0xffff;
-    bool nvm_start_fresh = FALSE;
+    NVM_HEADER_T header;
 
-    /* Read persistent storage to find if the device was last bonded to another
-     * device. If the device was bonded, trigger fast undirected advertisements
-     * by setting the white list for bonded host. If the device was not bonded,
-     * trigger undirected advertisements for any host to connect.
-     */
-    
-    Nvm_Read(&nvm_sanity, 
-             sizeof(nvm_sanity), 
-             NVM_OFFSET_SANITY_WORD);
+    Nvm_Read((uint16 *)&header, sizeof(header), NVM_OFFSET_HEADER);
 
-    if(nvm_sanity == NVM_SANITY_MAGIC)
+    if(header.magic == NVM_V1_SANITY_MAGIC)
     {
+        return NVM_LAYOUT_V1;
+    }
 
-        /* Read Bonded Flag from NVM */
-        Nvm_Read((uint16*)&g_app_data.bonded,
-                  sizeof(g_app_data.bonded),
-                  NVM_OFFSET_BONDED_FLAG);
+    if(header.magic == NVM_HEADER_MAGIC &&
+       header.version == NVM_LAYOUT_VERSION &&
+       header.crc == nvmHeaderCrc(&header) &&
+       header.section_length[nvm_section_header] == sizeof(NVM_HEADER_T) &&
+       header.section_length[nvm_section_store] == NVM_STORE_WORDS)
+    {
+        return NVM_LAYOUT_VERSION;
+    }
 
-        if(g_app_data.bonded)
-        {
-            /* Bonded Host Typed BD Address will only be stored if bonded flag
-             * is set to TRUE. Read last bonded device address.
-             */
-            Nvm_Read((uint16*)&g_app_data.bonded_bd_addr, 
-                       sizeof(TYPED_BD_ADDR_T),
-                       NVM_OFFSET_BONDED_ADDR);
+    return 0;
+}
 
-            /* If device is bonded and bonded address is resolvable then read 
-             * the bonded device's IRK
-             */
-            if(GattIsAddressResolvableRandom(&g_app_data.bonded_bd_addr))
-            {
-                Nvm_Read(g_app_data.irk, 
-                         MAX_WORDS_IRK,
-                         NVM_OFFSET_SM_IRK);
-            }
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readPersistentRecords
+ *
+ *  DESCRIPTION
+ *      This function reads the bonding information and the service data
+ *      from the record store, which must have been found. Records that have
+ *      not been written are given their default values.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void readPersistentRecords(void)
+{
+    /* Read Bonded Flag from NVM */
+    if(NvmStoreRead(nvm_record_bonded, (uint16*)&g_app_data.bonded,
+                    sizeof(g_app_data.bonded)) !=
+       sizeof(g_app_data.bonded))
+    {
+        g_app_data.bonded = FALSE;
+    }
 
-        }
-        else /* Case when we have only written NVM_SANITY_MAGIC to NVM but 
-              * didn't get bonded to any host in the last powered session
-              */
+    if(g_app_data.bonded)
+    {
+        /* Bonded Host Typed BD Address will only be stored if bonded flag
+         * is set to TRUE. Read last bonded device address.
+         */
+        NvmStoreRead(nvm_record_bonded_addr,
+                     (uint16*)&g_app_data.bonded_bd_addr, 
+                     sizeof(TYPED_BD_ADDR_T));
+
+        /* If device is bonded and bonded address is resolvable then read 
+         * the bonded device's IRK
+         */
+        if(GattIsAddressResolvableRandom(&g_app_data.bonded_bd_addr))
         {
-            /* Any initialisation can be done here for non-bonded devices */
-            
+            NvmStoreRead(nvm_record_sm_irk,
+                         g_app_data.irk, 
+                         MAX_WORDS_IRK);
         }
 
-        /* Read the diversifier associated with the presently bonded/last 
-         * bonded device.
-         */
-        Nvm_Read(&g_app_data.diversifier, 
-                 sizeof(g_app_data.diversifier),
-                 NVM_OFFSET_SM_DIV);
+    }
+    else /* Case when we have only written the layout to NVM but didn't get
+          * bonded to any host in the last powered session
+          */
+    {
+        /* Any initialisation can be done here for non-bonded devices */
+        
+    }
+
+    /* Read the diversifier associated with the presently bonded/last 
+     * bonded device.
+     */
+    if(NvmStoreRead(nvm_record_sm_div, &g_app_data.diversifier, 
+                    sizeof(g_app_data.diversifier)) !=
+       sizeof(g_app_data.diversifier))
+    {
+        g_app_data.diversifier = 0;
+    }
 
-        /* If NVM in use, read device name and length from NVM */
-        GapReadDataFromNVM(&nvm_offset);
+    /* If NVM in use, read device name and length from NVM */
+    GapReadDataFromNVM();
 
+    /* Read the smart home configuration from NVM */
+    SmartConfigReadDataFromNVM();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readPersistentStoreV1
+ *
+ *  DESCRIPTION
+ *      This function reads the bonding information and the GAP Service data
+ *      from the fixed offsets of NVM layout version 1. That layout had no
+ *      smart home configuration, so the default one is used.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void readPersistentStoreV1(void)
+{
+    /* Read Bonded Flag from NVM */
+    Nvm_Read((uint16*)&g_app_data.bonded,
+              sizeof(g_app_data.bonded),
+              NVM_V1_OFFSET_BONDED_FLAG);
+
+    if(g_app_data.bonded)
+    {
+        /* Read last bonded device address */
+        Nvm_Read((uint16*)&g_app_data.bonded_bd_addr, 
+                   sizeof(TYPED_BD_ADDR_T),
+                   NVM_V1_OFFSET_BONDED_ADDR);
+
+        /* If device is bonded and bonded address is resolvable then read 
+         * the bonded device's IRK
+         */
+        if(GattIsAddressResolvableRandom(&g_app_data.bonded_bd_addr))
+        {
+            Nvm_Read(g_app_data.irk, 
+                     MAX_WORDS_IRK,
+                     NVM_V1_OFFSET_SM_IRK);
+        }
     }
-    else /* NVM Sanity check failed means either the device is being brought up 
-          * for the first time or memory has got corrupted in which case 
-          * discard the data and start fresh.
-          */
+
+    /* Read the diversifier */
+    Nvm_Read(&g_app_data.diversifier, 
+             sizeof(g_app_data.diversifier),
+             NVM_V1_OFFSET_SM_DIV);
+
+    /* Read device name and length from NVM */
+    GapReadDataFromNVMV1(NVM_V1_OFFSET_GAP);
+
+    SmartConfigDataInit();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      writePersistentStore
+ *
+ *  DESCRIPTION
+ *      This function writes the bonding information and the service data
+ *      held in RAM to NVM in the current layout. The header is cleared first
+ *      and written last, so that NVM is not taken for a valid layout if the
+ *      device is reset before it is complete.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void writePersistentStore(void)
+{
+    NVM_HEADER_T header;
+
+    MemSet(&header, 0, sizeof(header));
+    Nvm_Write((uint16 *)&header, sizeof(header), NVM_OFFSET_HEADER);
+    Nvm_Flush();
+
+    /* Start with an empty record store */
+    NvmStoreFormat(NVM_OFFSET_STORE);
+
+    /* Write bonded status to NVM */
+    NvmStoreWrite(nvm_record_bonded,
+                  (uint16*)&g_app_data.bonded, 
+                  sizeof(g_app_data.bonded));
+
+    if(g_app_data.bonded)
     {
+        /* Write typed bd address of bonded host */
+        NvmStoreWrite(nvm_record_bonded_addr,
+                      (uint16*)&g_app_data.bonded_bd_addr,
+                      sizeof(TYPED_BD_ADDR_T));
+
+        if(GattIsAddressResolvableRandom(&g_app_data.bonded_bd_addr))
+        {
+            /* Write the IRK of the bonded host */
+            NvmStoreWrite(nvm_record_sm_irk,
+                          g_app_data.irk,
+                          MAX_WORDS_IRK);
+        }
+    }
+
+    /* Write the diversifier to NVM */
+    NvmStoreWrite(nvm_record_sm_div,
+                  &g_app_data.diversifier, 
+                  sizeof(g_app_data.diversifier));
+
+    /* Write device name and length to NVM */
+    GapInitWriteDataToNVM();
+
+    /* Write the smart home configuration to NVM */
+    SmartConfigWriteDataToNVM();
+
+    /* The records must be in NVM before the header says they are there */
+    Nvm_Flush();
 
-        nvm_start_fresh = TRUE;
+    header.magic = NVM_HEADER_MAGIC;
+    header.version = NVM_LAYOUT_VERSION;
+    header.section_length[nvm_section_header] = sizeof(NVM_HEADER_T);
+    header.section_length[nvm_section_store] = NVM_STORE_WORDS;
+    header.crc = nvmHeaderCrc(&header);
+    Nvm_Write((uint16 *)&header, sizeof(header), NVM_OFFSET_HEADER);
+    Nvm_Flush();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      readPersistentStore
+ *
+ *  DESCRIPTION
+ *      This function is used to initialise and read NVM data. NVM in an
+ *      earlier layout is read and then rewritten in the current one, so that
+ *      the device stays bonded across a firmware upgrade.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void readPersistentStore(void)
+{
+    bool found = FALSE;             /* Whether NVM held a layout */
+
+    /* Read persistent storage to find if the device was last bonded to another
+     * device. If the device was bonded, trigger fast undirected advertisements
+     * by setting the white list for bonded host. If the device was not bonded,
+     * trigger undirected advertisements for any host to connect.
+     */
+    switch(nvmLayoutVersion())
+    {
+        case NVM_LAYOUT_VERSION:
+            found = NvmStoreInit(NVM_OFFSET_STORE);
+            if(found)
+            {
+                readPersistentRecords();
+            }
+        break;
 
-        nvm_sanity = NVM_SANITY_MAGIC;
+        case NVM_LAYOUT_V1:
+            found = TRUE;
+            readPersistentStoreV1();
+            writePersistentStore();
+        break;
 
-        /* Write NVM Sanity word to the NVM */
-        Nvm_Write(&nvm_sanity, 
-                  sizeof(nvm_sanity), 
-                  NVM_OFFSET_SANITY_WORD);
+        default:
+            /* Nothing this application can read */
+        break;
+    }
 
+    if(!found) /* Either the device is being brought up for the first time or
+                * memory has got corrupted, in which case discard the data and
+                * start fresh.
+                */
+    {
         /* The device will not be bonded as it is coming up for the first 
          * time 
          */
         g_app_data.bonded = FALSE;
 
-        /* Write bonded status to NVM */
-        Nvm_Write((uint16*)&g_app_data.bonded, 
-                   sizeof(g_app_data.bonded), 
-                  NVM_OFFSET_BONDED_FLAG);
-
         /* When the application is coming up for the first time after flashing 
          * the image to it, it will not have bonded to any device. So, no LTK 
          * will be associated with it. Hence, set the diversifier to 0.
          */
         g_app_data.diversifier = 0;
 
-        /* Write the same to NVM. */
-        Nvm_Write(&g_app_data.diversifier, 
-                  sizeof(g_app_data.diversifier),
-                  NVM_OFFSET_SM_DIV);
-
-        /* If fresh NVM, write device name and length to NVM for the 
-         * first time.
+        /* Use the default smart home configuration; the GAP Service data
+         * already holds the default device name
          */
-        GapInitWriteDataToNVM(&nvm_offset);
+        SmartConfigDataInit();
 
+        writePersistentStore();
     }
 
     /* Add the 'read Service data from NVM' API call here, to initialise the
-     * service data, if the device is already bonded. One must take care of the
-     * offset being used for storing the data.
+     * service data, if the device is already bonded. Each service keeps its
+     * data in its own record.
      */
 
+    /* Write everything initialised above to NVM at once */
+    Nvm_Flush();
+
 }
 
 
@@ -465,9 +820,9 @@ static void appStartConnUpdateTimer(void)
         g_app_data.num_conn_update_req = 0;
 
         /* Start timer to trigger connection parameter update procedure */
-        g_app_data.con_param_update_tid = TimerCreate(
+        g_app_data.con_param_update_tid = TimerWheelCreate(
                             GAP_CONN_PARAM_TIMEOUT,
-                            TRUE, requestConnParamUpdate);
+                            requestConnParamUpdate);
 
     }
 }
@@ -582,8 +937,14 @@ static void appExitAdvertising(void)
     /* Cancel advertisement timer. Must be valid because timer is active
      * during app_state_fast_advertising and app_state_slow_advertising states.
      */
-    TimerDelete(g_app_data.app_tid);
+    TimerWheelDelete(g_app_data.app_tid);
     g_app_data.app_tid = TIMER_INVALID;
+
+    /* Stop the smart home role scheduler */
+    appRoleStop();
+
+    /* The advert is no longer on air */
+    SmartSetAdvertising(FALSE);
 }
 
 /*----------------------------------------------------------------------------*
@@ -607,12 +968,208 @@ static void appAdvertTimerHandler(timer_id tid)
         /* Timer has just expired so mark it as invalid */
         g_app_data.app_tid = TIMER_INVALID;
         GattStopAdverts();
-
-	
     }/* Else ignore timer expiry, could be because of 
       * some race condition */
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appRoleSetPhase
+ *
+ *  DESCRIPTION
+ *      This function moves the smart home role scheduler to a new phase and
+ *      adds the time spent in the old one to the scan or advertising time.
+ *
+ *  PARAMETERS
+ *      phase [in]              Phase to move to
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appRoleSetPhase(role_phase phase)
+{
+    const uint32 now = TimeGet32();
+
+    /* Unsigned subtraction copes with the system time wrapping */
+    const uint32 elapsed = (now - g_app_data.phase_start) / MILLISECOND;
+
+    switch(g_app_data.phase)
+    {
+        case role_phase_scanning:
+            g_app_data.scan_time += elapsed;
+        break;
+
+        case role_phase_advertising: /* FALLTHROUGH */
+        case role_phase_stopping:
+            g_app_data.adv_time += elapsed;
+        break;
+
+        default:
+            /* Nothing to count while idle */
+        break;
+    }
+
+    g_app_data.phase = phase;
+    g_app_data.phase_start = now;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appRoleScan
+ *
+ *  DESCRIPTION
+ *      This function starts scanning. A node that both scans and advertises
+ *      only scans for the length of a scan window.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appRoleScan(void)
+{
+    appRoleSetPhase(role_phase_scanning);
+    g_app_data.window_frames = 0;
+
+    StartScan(TRUE);
+
+    if(g_app_data.role == smart_role_scan_advertise)
+    {
+        g_app_data.role_tid = TimerWheelCreate(
+                            (uint32)g_app_data.scan_window * MILLISECOND,
+                            appRoleTimerHandler);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appRoleAdvertise
+ *
+ *  DESCRIPTION
+ *      This function starts advertising. A node that both scans and
+ *      advertises does so for the length of an advertising burst. The
+ *      advertising interval adapts to the load on the channel and to whether
+ *      there is anything new to send.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appRoleAdvertise(void)
+{
+    appRoleSetPhase(role_phase_advertising);
+
+    GattStartAdverts(0, GATT_ADVERT_ADAPTIVE);
+
+    if(g_app_data.role == smart_role_scan_advertise)
+    {
+        g_app_data.role_tid = TimerWheelCreate(
+                            (uint32)g_app_data.adv_window * MILLISECOND,
+                            appRoleTimerHandler);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appRoleStart
+ *
+ *  DESCRIPTION
+ *      This function starts scanning and advertising as the smart home role
+ *      requires. A node that both scans and advertises starts with a scan
+ *      window.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appRoleStart(void)
+{
+    if(g_app_data.role == smart_role_advertise)
+    {
+        appRoleAdvertise();
+    }
+    else
+    {
+        appRoleScan();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appRoleStop
+ *
+ *  DESCRIPTION
+ *      This function stops the smart home role scheduler. Scanning is stopped
+ *      here; advertisements are stopped by the caller, if need be.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appRoleStop(void)
+{
+    if(g_app_data.role_tid != TIMER_INVALID)
+    {
+        TimerWheelDelete(g_app_data.role_tid);
+        g_app_data.role_tid = TIMER_INVALID;
+    }
+
+    if(g_app_data.phase == role_phase_scanning)
+    {
+        StartScan(FALSE);
+    }
+
+    appRoleSetPhase(role_phase_idle);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appRoleTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function handles the expiry of a scan window or advertising
+ *      burst. At the end of a scan window the node starts advertising; at the
+ *      end of an advertising burst it stops advertising, and starts scanning
+ *      once GATT_CANCEL_CONNECT_CFM has been received.
+ *
+ *  PARAMETERS
+ *      tid [in]                ID of timer that has expired
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appRoleTimerHandler(timer_id tid)
+{
+    if(g_app_data.role_tid == tid)
+    {
+        /* Timer has just expired so mark it as invalid */
+        g_app_data.role_tid = TIMER_INVALID;
+
+        if(g_app_data.phase == role_phase_scanning)
+        {
+            StartScan(FALSE);
+
+            /* Let the advertising interval follow the load seen */
+            GattReportAdvertLoad(g_app_data.window_frames,
+                                 g_app_data.scan_window);
+
+            appRoleAdvertise();
+        }
+        else if(g_app_data.phase == role_phase_advertising)
+        {
+            appRoleSetPhase(role_phase_stopping);
+            GattStopAdverts();
+        }
+    } /* Else ignore the timer */
+}
+
 /*----------------------------------------------------------------------------*
  *  NAME
  *      appInitExit
@@ -663,12 +1220,12 @@ static void resetIdleTimer(void)
     /* Delete the Idle timer, if already running */
     if (g_app_data.app_tid != TIMER_INVALID)
     {
-        TimerDelete(g_app_data.app_tid);
+        TimerWheelDelete(g_app_data.app_tid);
     }
 
     /* Start the Idle timer again.*/
-    g_app_data.app_tid  = TimerCreate(CONNECTED_IDLE_TIMEOUT_VALUE, 
-                                    TRUE, appIdleTimerHandler);
+    g_app_data.app_tid  = TimerWheelCreate(CONNECTED_IDLE_TIMEOUT_VALUE,
+                                           appIdleTimerHandler);
 }
 #endif /* CONNECTED_IDLE_TIMEOUT_VALUE */
 
@@ -750,6 +1307,9 @@ static void handleSignalLmEvConnectionComplete(
  *----------------------------------------------------------------------------*/
 static void handleSignalGattCancelConnectCfm(void)
 {
+    /* The advert is no longer on air */
+    SmartSetAdvertising(FALSE);
+
     if(g_app_data.pairing_button_pressed)
     {
         /* Pairing removal has been initiated by the user */
@@ -761,16 +1321,23 @@ static void handleSignalGattCancelConnectCfm(void)
         /* Reset and clear the white list */
         LsResetWhiteList();
 
-        /* Trigger fast advertisements */
+        /* Restart the smart home role */
         if(g_app_data.state == app_state_fast_advertising)
         {
-            GattStartAdverts(0, 0);
+            appRoleStart();
         }
         else
         {
             SetState(app_state_fast_advertising);
         }
     }
+    else if(g_app_data.phase == role_phase_stopping)
+    {
+        /* The advertising burst has ended, carry on with the smart home
+         * role
+         */
+        appRoleStart();
+    }
     else
     {
         /* Handle signal as per current state.
@@ -893,6 +1460,14 @@ static void handleSignalGattConnectCfm(GATT_CONNECT_CFM_T *p_event_data)
                      *   Resolvable Random address and the address gets resolved
                      *   using the stored IRK key
                      */
+                    if(g_app_data.bonded)
+                    {
+                        /* The bonded host keeps the client configuration it
+                         * last wrote
+                         */
+                        EhSmartReadDataFromNVM();
+                    }
+
                     SetState(app_state_connected);
 
 #ifndef PAIRING_SUPPORT
@@ -971,11 +1546,6 @@ static void handleSignalSmKeysInd(SM_KEYS_IND_T *p_event_data)
              */
             g_app_data.diversifier = (p_event_data->keys)->div;
 
-            /* Write the new diversifier to NVM */
-            Nvm_Write(&g_app_data.diversifier,
-                      sizeof(g_app_data.diversifier), 
-                      NVM_OFFSET_SM_DIV);
-
             /* Store IRK if the connected host is using random resolvable 
              * address. IRK is used afterwards to validate the identity of 
              * connected host 
@@ -985,14 +1555,12 @@ static void handleSignalSmKeysInd(SM_KEYS_IND_T *p_event_data)
                 MemCopy(g_app_data.irk, 
                         (p_event_data->keys)->irk,
                         MAX_WORDS_IRK);
-
-                /* If bonded device address is resolvable random
-                 * then store IRK to NVM 
-                 */
-                Nvm_Write(g_app_data.irk, 
-                          MAX_WORDS_IRK, 
-                          NVM_OFFSET_SM_IRK);
             }
+
+            /* Write the new diversifier, and the IRK of a bonded host using
+             * a resolvable random address, to NVM
+             */
+            appStoreBondingLater();
         }
         break;
 
@@ -1035,17 +1603,10 @@ static void handleSignalSmSimplePairingCompleteInd(
                 g_app_data.bonded = TRUE;
                 g_app_data.bonded_bd_addr = p_event_data->bd_addr;
 
-                /* Store bonded host typed bd address to NVM */
-
-                /* Write one word bonded flag */
-                Nvm_Write((uint16*)&g_app_data.bonded, 
-                          sizeof(g_app_data.bonded), 
-                          NVM_OFFSET_BONDED_FLAG);
-
-                /* Write typed bd address of bonded host */
-                Nvm_Write((uint16*)&g_app_data.bonded_bd_addr, 
-                          sizeof(TYPED_BD_ADDR_T), 
-                          NVM_OFFSET_BONDED_ADDR);
+                /* Store the bonded flag and the typed bd address of the
+                 * bonded host to NVM
+                 */
+                appStoreBondingLater();
 
                 /* Configure white list with the Bonded host address only 
                  * if the connected host doesn't support random resolvable
@@ -1094,9 +1655,8 @@ static void handleSignalSmSimplePairingCompleteInd(
                  {
                     g_app_data.encrypt_enabled = FALSE;
                     g_app_data.bonding_reattempt_tid = 
-                                          TimerCreate(
+                                          TimerWheelCreate(
                                                BONDING_CHANCE_TIMER,
-                                               TRUE, 
                                                handleBondingChanceTimerExpiry);
                  }
 #else /* !PAIRING_SUPPORT */
@@ -1122,9 +1682,7 @@ static void handleSignalSmSimplePairingCompleteInd(
                  */
 
                 /* Update bonded status to NVM */
-                Nvm_Write((uint16*)&g_app_data.bonded,
-                          sizeof(g_app_data.bonded),
-                          NVM_OFFSET_BONDED_FLAG);
+                appStoreBondingLater();
 
                 /* Initialise the data of used services as the device is no 
                  * longer bonded to the remote host.
@@ -1234,12 +1792,12 @@ static void handleSignalLsConnParamUpdateCfm(
                 /* Delete timer if running */
                 if (g_app_data.con_param_update_tid != TIMER_INVALID)
                 {
-                    TimerDelete(g_app_data.con_param_update_tid);
+                    TimerWheelDelete(g_app_data.con_param_update_tid);
                 }
 
-                g_app_data.con_param_update_tid = TimerCreate(
+                g_app_data.con_param_update_tid = TimerWheelCreate(
                                              GAP_CONN_PARAM_TIMEOUT,
-                                             TRUE, requestConnParamUpdate);
+                                             requestConnParamUpdate);
             }
         }
         break;
@@ -1278,7 +1836,7 @@ static void handleSignalLsConnParamUpdateInd(
             /* Delete timer if running */
             if (g_app_data.con_param_update_tid != TIMER_INVALID)
             {
-                TimerDelete(g_app_data.con_param_update_tid);
+                TimerWheelDelete(g_app_data.con_param_update_tid);
                 g_app_data.con_param_update_tid = TIMER_INVALID;
             }
 
@@ -1495,6 +2053,324 @@ static void handleSignalLmDisconnectComplete(
     }
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appReceivedFrameWork
+ *
+ *  DESCRIPTION
+ *      This function decrypts a smart home frame received in an advertising
+ *      report and passes it to the protocol engine. It is run from the work
+ *      queue, so that the decryption is not done while the firmware waits
+ *      for the report to be handled.
+ *
+ *  PARAMETERS
+ *      p_payload [in]          Seed and frame, SMART_WORK_WORDS words
+ *      length [in]             Number of words of payload
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appReceivedFrameWork(const uint16 *p_payload, uint16 length)
+{
+    uint16 frame[SMART_FRAME_WORDS];    /* Frame, decrypted in place */
+
+    MemCopy(frame, &p_payload[SMART_WORK_FRAME], SMART_FRAME_WORDS);
+
+    switch(SmartParserFrame(p_payload[SMART_WORK_SEED], frame))
+    {
+        case smart_frame_accepted:
+            g_scan_stats.accepted++;
+        break;
+
+        case smart_frame_wrong_uuid:
+            g_scan_stats.rejected_uuid++;
+        break;
+
+        case smart_frame_queue_full:
+        {
+            /* Let the sender's next advert of the frame through again */
+            FrameCacheRemove(p_payload[SMART_WORK_SEED],
+                             &p_payload[SMART_WORK_FRAME], SMART_FRAME_WORDS);
+
+            g_scan_stats.rejected_queue_full++;
+        }
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appNvmFlushWork
+ *
+ *  DESCRIPTION
+ *      This function writes to NVM what the LM events handled since it was
+ *      posted have changed, e.g. bonding information and the configuration,
+ *      with a single transfer.
+ *
+ *  PARAMETERS
+ *      p_payload [in]          Payload of the work item (unused)
+ *      length [in]             Length of the payload (unused)
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appNvmFlushWork(const uint16 *p_payload, uint16 length)
+{
+    Nvm_Flush();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appNvmFlushLater
+ *
+ *  DESCRIPTION
+ *      This function arranges for the words written to the NVM cache to be
+ *      flushed once the current event has been handled. Further events
+ *      handled before then share the transfer. If the work queue is full,
+ *      the cache is flushed now.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appNvmFlushLater(void)
+{
+    if(Nvm_IsDirty() && !WorkQueueIsPending(appNvmFlushWork) &&
+       !WorkQueuePost(appNvmFlushWork, NULL, 0))
+    {
+        Nvm_Flush();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appStoreBondingWork
+ *
+ *  DESCRIPTION
+ *      This function writes the bonding information held in g_app_data to
+ *      the record store: the bonded flag, the bonded host address and IRK,
+ *      and the diversifier. Records which have not changed are skipped by
+ *      the record store.
+ *
+ *  PARAMETERS
+ *      p_payload [in]          Payload of the work item (unused)
+ *      length [in]             Length of the payload (unused)
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appStoreBondingWork(const uint16 *p_payload, uint16 length)
+{
+    /* Write one word bonded flag */
+    NvmStoreWrite(nvm_record_bonded,
+                  (uint16*)&g_app_data.bonded,
+                  sizeof(g_app_data.bonded));
+
+    if(g_app_data.bonded)
+    {
+        /* Write typed bd address of bonded host */
+        NvmStoreWrite(nvm_record_bonded_addr,
+                      (uint16*)&g_app_data.bonded_bd_addr,
+                      sizeof(TYPED_BD_ADDR_T));
+
+        if(GattIsAddressResolvableRandom(&g_app_data.bonded_bd_addr))
+        {
+            /* Write the IRK of the bonded host */
+            NvmStoreWrite(nvm_record_sm_irk,
+                          g_app_data.irk,
+                          MAX_WORDS_IRK);
+        }
+    }
+
+    /* Write the diversifier */
+    NvmStoreWrite(nvm_record_sm_div,
+                  &g_app_data.diversifier,
+                  sizeof(g_app_data.diversifier));
+
+    appNvmFlushLater();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appStoreBondingLater
+ *
+ *  DESCRIPTION
+ *      This function arranges for the bonding information to be written to
+ *      the record store once the current event has been handled. The
+ *      information is taken from g_app_data when the work is run, so
+ *      several changes share one pass. If the work queue is full, the
+ *      information is written now.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appStoreBondingLater(void)
+{
+    if(!WorkQueueIsPending(appStoreBondingWork) &&
+       !WorkQueuePost(appStoreBondingWork, NULL, 0))
+    {
+        appStoreBondingWork(NULL, 0);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appReportStatsWork
+ *
+ *  DESCRIPTION
+ *      This function writes the statistics gathered since the last button
+ *      press to the UART.
+ *
+ *  PARAMETERS
+ *      p_payload [in]          Payload of the work item (unused)
+ *      length [in]             Length of the payload (unused)
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void appReportStatsWork(const uint16 *p_payload, uint16 length)
+{
+    /* Sensor notification statistics, read once for a consistent report */
+    const EhSmart_NOTIFY_STATS_T *p_notify = EhSmartGetNotifyStats();
+    uint32 rate;                    /* Notification throughput, octets/s */
+
+    /* Report the LM event profile gathered since the last button press */
+    EventProfileReport();
+
+    /* Report the advertising report statistics */
+    DebugIfWriteString("Scan reports ");
+    DebugIfWriteUint32(g_scan_stats.reports);
+    DebugIfWriteString(", no tag ");
+    DebugIfWriteUint32(g_scan_stats.rejected_tag);
+    DebugIfWriteString(", bad format ");
+    DebugIfWriteUint32(g_scan_stats.rejected_format);
+    DebugIfWriteString(", repeated ");
+    DebugIfWriteUint32(g_scan_stats.rejected_duplicate);
+    DebugIfWriteString(", queue full ");
+    DebugIfWriteUint32(g_scan_stats.rejected_queue_full);
+    DebugIfWriteString(", wrong UUID ");
+    DebugIfWriteUint32(g_scan_stats.rejected_uuid);
+    DebugIfWriteString(", accepted ");
+    DebugIfWriteUint32(g_scan_stats.accepted);
+    DebugIfWriteString("\r\n");
+
+    /* Report the smart home protocol engine statistics */
+    DebugIfWriteString("Messages received ");
+    DebugIfWriteUint32(SmartGetStats()->received);
+    DebugIfWriteString(", wrong UUID ");
+    DebugIfWriteUint32(SmartGetStats()->wrong_uuid);
+    DebugIfWriteString(", duplicates ");
+    DebugIfWriteUint32(SmartGetStats()->duplicates);
+    DebugIfWriteString(", relayed ");
+    DebugIfWriteUint32(SmartGetStats()->relayed);
+    DebugIfWriteString(", relay dropped ");
+    DebugIfWriteUint32(SmartGetStats()->relay_dropped);
+    DebugIfWriteString(", other groups ");
+    DebugIfWriteUint32(SmartGetStats()->not_member);
+    DebugIfWriteString("\r\n");
+
+    /* Report how the smart home role has shared the time between scanning
+     * and advertising, and what that has cost the messages sent
+     */
+    DebugIfWriteString("Role ");
+    DebugIfWriteUint8(g_app_data.role);
+    DebugIfWriteString(", scanning ");
+    DebugIfWriteUint32(g_app_data.scan_time);
+    DebugIfWriteString(" ms, advertising ");
+    DebugIfWriteUint32(g_app_data.adv_time);
+    DebugIfWriteString(" ms, interval ");
+    DebugIfWriteUint32(GattGetAdvertInterval() / MILLISECOND);
+    DebugIfWriteString(" ms, messages sent ");
+    DebugIfWriteUint32(SmartGetStats()->sent);
+    if(SmartGetStats()->sent != 0)
+    {
+        DebugIfWriteString(" in ");
+        DebugIfWriteUint32(SmartGetStats()->send_time /
+                           SmartGetStats()->sent);
+        DebugIfWriteString(" ms each");
+    }
+    DebugIfWriteString("\r\n");
+
+    /* Report the sensor notification throughput */
+    DebugIfWriteString("Notifications ");
+    DebugIfWriteUint32(p_notify->notifications);
+    DebugIfWriteString(", samples ");
+    DebugIfWriteUint32(p_notify->samples);
+    DebugIfWriteString(", dropped ");
+    DebugIfWriteUint32(p_notify->dropped);
+    DebugIfWriteString(", failed ");
+    DebugIfWriteUint32(p_notify->failed);
+    if(p_notify->time != 0)
+    {
+        if(p_notify->octets <= 0xffffffffUL / 1000)
+        {
+            rate = (p_notify->octets * 1000) / p_notify->time;
+        }
+        else
+        {
+            /* Multiplying the octets would overflow. So many octets take
+             * well over a second to send, so the time is at least that.
+             */
+            rate = p_notify->octets / ((p_notify->time + 999) / 1000);
+        }
+
+        DebugIfWriteString(", ");
+        DebugIfWriteUint32(rate);
+        DebugIfWriteString(" octets/s");
+    }
+    DebugIfWriteString("\r\n");
+
+    /* Report the NVM access statistics */
+    DebugIfWriteString("NVM reads ");
+    DebugIfWriteUint32(Nvm_GetStats()->reads);
+    DebugIfWriteString(", writes ");
+    DebugIfWriteUint32(Nvm_GetStats()->writes);
+    DebugIfWriteString(", transfers ");
+    DebugIfWriteUint32(Nvm_GetStats()->transfers);
+    DebugIfWriteString(", words written ");
+    DebugIfWriteUint32(Nvm_GetStats()->words_written);
+    DebugIfWriteString("\r\n");
+
+    /* Report the NVM record store statistics */
+    DebugIfWriteString("NVM records appended ");
+    DebugIfWriteUint32(NvmStoreGetStats()->appends);
+    DebugIfWriteString(", unchanged ");
+    DebugIfWriteUint32(NvmStoreGetStats()->unchanged);
+    DebugIfWriteString(", compactions ");
+    DebugIfWriteUint32(NvmStoreGetStats()->compactions);
+    DebugIfWriteString("\r\n");
+
+    /* Report the key cache statistics */
+    DebugIfWriteString("Key cache hits ");
+    DebugIfWriteUint32(KeyCacheGetStats()->hits);
+    DebugIfWriteString(", misses ");
+    DebugIfWriteUint32(KeyCacheGetStats()->misses);
+    DebugIfWriteString("\r\n");
+
+    /* Report the deferred work queue statistics */
+    DebugIfWriteString("Work posted ");
+    DebugIfWriteUint32(WorkQueueGetStats()->posted);
+    DebugIfWriteString(", dropped ");
+    DebugIfWriteUint32(WorkQueueGetStats()->dropped);
+    DebugIfWriteString(", max depth ");
+    DebugIfWriteUint32(WorkQueueGetStats()->max_depth);
+    if(WorkQueueGetStats()->run != 0)
+    {
+        DebugIfWriteString(", latency ");
+        DebugIfWriteUint32(WorkQueueGetStats()->total_latency /
+                           WorkQueueGetStats()->run);
+        DebugIfWriteString(" us mean, ");
+        DebugIfWriteUint32(WorkQueueGetStats()->max_latency);
+        DebugIfWriteString(" us max");
+    }
+    DebugIfWriteString("\r\n");
+}
+
 /*============================================================================*
  *  Public Function Implementations
  *============================================================================*/
@@ -1539,6 +2415,9 @@ extern void HandleShortButtonPress(void)
     /* Indicate short button press using short beep */
     SoundBuzzer(buzzer_beep_short);
 
+    /* Report the statistics once the button press has been handled */
+    WorkQueuePost(appReportStatsWork, NULL, 0);
+
     /* Handle signal as per current state */
     switch(g_app_data.state)
     {
@@ -1640,10 +2519,10 @@ extern void SetState(app_state new_state)
                  * device and that device is not using resolvable random 
                  * address.
                  */
-                 
-                //GattStartAdverts(20, 0);	///fast adver for 20 seconds
-                //GattStartAdverts(0, 0xff);
-		StartScan(TRUE);
+
+                /* Scan and advertise as the smart home role requires */
+                appRoleStart();
+
                 /* Indicate advertising mode by sounding two short beeps */
                 SoundBuzzer(buzzer_beep_twice);
             }
@@ -1736,10 +2615,13 @@ extern void HandlePairingRemoval(void)
     /* The device will no longer be bonded */
     g_app_data.bonded = FALSE;
 
-    /* Write bonded status to NVM */
-    Nvm_Write((uint16*)&g_app_data.bonded, 
-              sizeof(g_app_data.bonded), 
-              NVM_OFFSET_BONDED_FLAG);
+    /* Write bonded status to NVM now, as this may be called from a timer
+     * rather than from an event handler
+     */
+    NvmStoreWrite(nvm_record_bonded,
+                  (uint16*)&g_app_data.bonded,
+                  sizeof(g_app_data.bonded));
+    Nvm_Flush();
 
 
     switch(g_app_data.state)
@@ -1826,11 +2708,12 @@ extern void StartAdvertTimer(uint16 interval)
     /* Cancel existing timer, if valid */
     if (g_app_data.app_tid != TIMER_INVALID)
     {
-        TimerDelete(g_app_data.app_tid);
+        TimerWheelDelete(g_app_data.app_tid);
     }
 
     /* Start advertisement timer  */
-    g_app_data.app_tid = TimerCreate(interval*SECOND, TRUE, appAdvertTimerHandler);
+    g_app_data.app_tid = TimerWheelCreate(interval*SECOND,
+                                          appAdvertTimerHandler);
 }
 
 /*----------------------------------------------------------------------------*
@@ -1870,6 +2753,148 @@ extern uint16 GetConnectionID(void)
     return g_app_data.st_ucid;
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      GetScanStats
+ *
+ *  DESCRIPTION
+ *      This function returns the advertising report statistics.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Advertising report statistics
+ *----------------------------------------------------------------------------*/
+extern const SCAN_STATS_T *GetScanStats(void)
+{
+    return &g_scan_stats;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      ApplySmartConfig
+ *
+ *  DESCRIPTION
+ *      This function applies the current smart home configuration: the
+ *      service tag scanned for, the group memberships, the advert and the
+ *      role of the node with the lengths of its scan windows and advertising
+ *      bursts. If the node is scanning or advertising for its role, it
+ *      carries on in the new one; otherwise the new role takes effect next
+ *      time it starts.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void ApplySmartConfig(void)
+{
+    const SMART_CONFIG_T *p_config = SmartConfigGet();
+
+    smart_uuid_tag[0] = (p_config->uuid >> 24) & 0xff;
+    smart_uuid_tag[1] = (p_config->uuid >> 16) & 0xff;
+    smart_uuid_tag[2] = (p_config->uuid >> 8) & 0xff;
+    smart_uuid_tag[3] = p_config->uuid & 0xff;
+
+    SmartGroupLoad(p_config->groups, p_config->group_count);
+
+    GattApplySmartConfig();
+
+    g_app_data.role = (smart_role)p_config->role;
+    g_app_data.scan_window = p_config->scan_window;
+    g_app_data.adv_window = p_config->adv_window;
+
+    switch(g_app_data.phase)
+    {
+        case role_phase_scanning:
+            /* Start again in the new role */
+            appRoleStop();
+            appRoleStart();
+        break;
+
+        case role_phase_advertising:
+            /* Stop advertising first; the new role is started once
+             * GATT_CANCEL_CONNECT_CFM has been received
+             */
+            if(g_app_data.role_tid != TIMER_INVALID)
+            {
+                TimerWheelDelete(g_app_data.role_tid);
+                g_app_data.role_tid = TIMER_INVALID;
+            }
+
+            appRoleSetPhase(role_phase_stopping);
+            GattStopAdverts();
+        break;
+
+        default:
+            /* Either idle, or the new role is started once the advertising
+             * burst has stopped
+             */
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      HandleSmartMessages
+ *
+ *  DESCRIPTION
+ *      This function is called by the smart home protocol engine once
+ *      messages have been received. It takes every message waiting in the
+ *      receive queue, queues each as a sensor sample for the connected host
+ *      and beeps once for the lot. The samples are then notified together.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void HandleSmartMessages(void)
+{
+    Smart_Data_Struct msg;              /* Received message */
+    uint8 sample[SMART_SAMPLE_LENGTH];  /* Sensor sample of the message */
+    bool received = FALSE;
+#ifdef DEBUG_OUTPUT_ENABLED
+    uint16 args[3 + SMART_DATA_LENGTH / 2]; /* Trace record of the message */
+    uint16 i;                           /* Loop counter */
+#endif /* DEBUG_OUTPUT_ENABLED */
+
+    while(SmartReadData(&msg))
+    {
+        /* Source node ID, data type LSB first, then the data octets */
+        sample[0] = SMART_ADDR_SRC(msg.SmartADDR);
+        sample[1] = WORD_LSB(msg.SmartDataType);
+        sample[2] = WORD_MSB(msg.SmartDataType);
+        MemCopy(&sample[3], msg.SmartDATA, SMART_DATA_LENGTH);
+        (void)EhSmartQueueSample(sample, SMART_SAMPLE_LENGTH);
+
+#ifdef DEBUG_OUTPUT_ENABLED
+        /* Address, group, data type and data words */
+        args[0] = msg.SmartADDR;
+        args[1] = msg.SmartGRUOP;
+        args[2] = msg.SmartDataType;
+        for(i = 0; i < SMART_DATA_LENGTH / 2; i++)
+        {
+            args[3 + i] = BYTE8_TO_WORD16(msg.SmartDATA[2 * i],
+                                          msg.SmartDATA[2 * i + 1]);
+        }
+        TraceWrite(trace_scan_result, args, 3 + SMART_DATA_LENGTH / 2);
+#endif /* DEBUG_OUTPUT_ENABLED */
+
+        received = TRUE;
+    }
+
+    if(received)
+    {
+        EhSmartSendSamples();
+
+        SoundBuzzer(buzzer_beep_short);
+    }
+}
+
 /*============================================================================*
  *  System Callback Function Implementations
  *============================================================================*/
@@ -1903,122 +2928,110 @@ extern void AppPowerOnReset(void)
      */
 }
 
-
-Smart_Data_Struct SmartHomeClientIndx;
-
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      appGattSignalLmAdvertisingReport
+ *
+ *  DESCRIPTION
+ *      This function handles the advertising reports received while scanning
+ *      and posts the smart home frames to the work queue, to be decrypted
+ *      and passed to the protocol engine once the report has been handled.
+ *      Reports from foreign advertisers are rejected on the smart home
+ *      service tag in the 32-bit UUID AD structure. The 16-bit and 128-bit
+ *      UUID AD structures, which carry the random seed and the frame
+ *      respectively, are then found in a single walk over the report.
+ *
+ *  PARAMETERS
+ *      p_event_data [in]       Advertising event data
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
 static void appGattSignalLmAdvertisingReport(
                                        LM_EV_ADVERTISING_REPORT_T *p_event_data)
 {
+    /* AD types carrying the smart home frame, indexed by SMART_AD_* */
+    static const uint16 smart_ad_types[SMART_AD_MAX] =
+    {
+        AD_TYPE_SERVICE_UUID_16BIT,
+        AD_TYPE_SERVICE_UUID_128BIT
+    };
+    AD_FIELD_T fields[SMART_AD_MAX];    /* AD structures found */
+    const uint8 *p_frame;               /* Smart home frame in the report */
+    uint16 work[SMART_WORK_WORDS];      /* Seed and frame */
+    uint16 found;                       /* Mask of AD structures found */
+    uint8 i;                            /* Loop counter */
+
+    g_scan_stats.reports++;
+
+    /* Most reports come from foreign advertisers. Reject them on the service
+     * tag alone, before the report is parsed any further.
+     */
+    if(!AdMatchField(p_event_data->data.data,
+                     p_event_data->data.length_data,
+                     AD_TYPE_SERVICE_UUID_32BIT,
+                     smart_uuid_tag, SMART_UUID_LENGTH))
+    {
+        g_scan_stats.rejected_tag++;
+        return;
+    }
+
+    found = AdFindTypes(p_event_data->data.data,
+                        p_event_data->data.length_data,
+                        smart_ad_types, fields, SMART_AD_MAX);
+
+    /* The seed and frame AD structures must be present with the expected
+     * sizes
+     */
+    if(!AD_TYPE_FOUND(found, SMART_AD_SEED) ||
+       fields[SMART_AD_SEED].length != SMART_SEED_LENGTH ||
+       !AD_TYPE_FOUND(found, SMART_AD_FRAME) ||
+       fields[SMART_AD_FRAME].length != SMART_FRAME_LENGTH)
+    {
+        g_scan_stats.rejected_format++;
+        return;
+    }
+
+    /* Nodes advertise the same frame many times. Drop the repeats before
+     * the key is derived and the frame decrypted.
+     */
+    if(FrameCacheCheckAndAdd(&p_event_data->data.address,
+                             BYTE8_TO_WORD16(
+                                fields[SMART_AD_SEED].p_data[0],
+                                fields[SMART_AD_SEED].p_data[1]),
+                             fields[SMART_AD_FRAME].p_data,
+                             SMART_FRAME_LENGTH))
+    {
+        g_scan_stats.rejected_duplicate++;
+        return;
+    }
 
-        uint16 data[ADVSCAN_MAX_PAYLOAD];/* Advertising event data */
-        uint16 size;                    /* Advertising report size, in octets */
+    /* A distinct frame from another node, counted as load on the channel */
+    g_app_data.window_frames++;
 
-	////find the filter uuid32
-        size = GapLsFindAdType(&p_event_data->data, 
-                               AD_TYPE_SERVICE_UUID_32BIT, 
-                               data,
-                               ADVSCAN_MAX_PAYLOAD);
+    /* Pack the frame into words, most significant octet first, so that it
+     * can be decrypted in place. The report itself must not be modified.
+     */
+    p_frame = fields[SMART_AD_FRAME].p_data;
+    for(i = 0; i < SMART_FRAME_WORDS; i++)
+    {
+        work[SMART_WORK_FRAME + i] = BYTE8_TO_WORD16(p_frame[2 * i],
+                                                     p_frame[2 * i + 1]);
+    }
 
-	///mean find it 
-        if((size == 0x0004))
-	{		///128 bits UUID get
-		uint8 i =0;
-		SmartHomeClientIndx.SmartUUID = WORD16_TO_WORD32(data[0], data[1]);
+    /* The seed is sent most significant octet first */
+    p_frame = fields[SMART_AD_SEED].p_data;
+    work[SMART_WORK_SEED] = BYTE8_TO_WORD16(p_frame[0], p_frame[1]);
 
-		if(SmartHomeClientIndx.SmartUUID != 0xf0140439)		///if not the service uuid
-			return;
+    /* Decrypt the frame once the report has been handled */
+    if(!WorkQueuePost(appReceivedFrameWork, work, SMART_WORK_WORDS))
+    {
+        /* Let the sender's next advert of the frame through again */
+        FrameCacheRemove(work[SMART_WORK_SEED], &work[SMART_WORK_FRAME],
+                         SMART_FRAME_WORDS);
 
-		size = GapLsFindAdType(&p_event_data->data, 
-                               AD_TYPE_SERVICE_UUID_16BIT, 
-                               data,
-                               ADVSCAN_MAX_PAYLOAD);
-        
-		SmartHomeClientIndx.Random = SWAP_WORD16(data[0]);
-		
-	
-		size = GapLsFindAdType(&p_event_data->data, 
-                               AD_TYPE_SERVICE_UUID_128BIT, 
-                               data,
-                               ADVSCAN_MAX_PAYLOAD);
-
-		
-		#if defined ENCRP_TEA
-		{
-	uint8 KEY[16] = {0};
-	uint8 DesData[16] ={0};
-	KeyConvert(SmartHomeClientIndx.Random, KEY);
-	
-		for(i=0; i<8; i++)
-		{
-			DesData[i*2] = WORD_LSB(data[i]);
-			DesData[i*2 + 1] = WORD_MSB(data[i]);
-		}
-		
-		DebugIfWriteString("before dec = ");
-		for(i=0; i<16; i++)
-		{
-			DebugIfWriteUint8(DesData[i]);
-			DebugIfWriteString(", ");
-			
-		}
-
-		decrypt(DesData, 16, KEY);
-
-		
-		DebugIfWriteString("After dec = ");
-		for(i=0; i<16; i++)
-		{
-			DebugIfWriteUint8(DesData[i]);
-			DebugIfWriteString(", ");
-			
-		}
-		DebugIfWriteString("\r\n");
-
-	
-		SmartHomeClientIndx.SmartADDR = BYTE8_TO_WORD16(DesData[4], DesData[5]);
-		SmartHomeClientIndx.SmartGRUOP = BYTE8_TO_WORD16(DesData[6], DesData[7]);
-		SmartHomeClientIndx.SmartDataType = BYTE8_TO_WORD16(DesData[8], DesData[9]);
-		for(i=0; i<6; i++)
-		{
-			SmartHomeClientIndx.SmartDATA[i] = DesData[i+10];
-		}
-			}
-		#else
-		SmartHomeClientIndx.SmartADDR = SWAP_WORD16(data[2]);
-		SmartHomeClientIndx.SmartGRUOP = SWAP_WORD16(data[3]);
-		SmartHomeClientIndx.SmartDataType = SWAP_WORD16(data[4]);
-
-		for(i=0; i<3; i++)
-		{
-			SmartHomeClientIndx.SmartDATA[2*i] = WORD_LSB(data[i+5]);
-			SmartHomeClientIndx.SmartDATA[2*i + 1] = WORD_MSB(data[i+5]);
-		}
-
-		#endif
-
-		#ifdef DEBUG_OUTPUT_ENABLED
-		DebugIfWriteString("scan result, uuid= ");
-		DebugIfWriteUint32(SmartHomeClientIndx.SmartUUID);
-		DebugIfWriteString(", adtype=");
-		DebugIfWriteUint16(SmartHomeClientIndx.SmartADDR);
-		DebugIfWriteString(", group=");
-		DebugIfWriteUint16(SmartHomeClientIndx.SmartGRUOP);
-		DebugIfWriteString(", dataType=");
-		DebugIfWriteUint16(SmartHomeClientIndx.SmartDataType);
-		DebugIfWriteString(", data=");
-		for(i=0; i<6; i++)
-			DebugIfWriteUint8(SmartHomeClientIndx.SmartDATA[i]);
-		DebugIfWriteString(", randseed=");
-		DebugIfWriteUint16(SmartHomeClientIndx.Random);
-		
-		DebugIfWriteString("\r\n");
-		#endif
-
-		if(SmartHomeClientIndx.SmartUUID == 0xf0140439)
-		{
-			SoundBuzzer(buzzer_beep_short);
-		}
-	}
+        g_scan_stats.rejected_queue_full++;
+    }
 }
 
 /*----------------------------------------------------------------------------*
@@ -2061,10 +3074,32 @@ extern void AppInit(sleep_state last_sleep_state)
 
     /* Initialise the application timers */
     TimerInit(MAX_APP_TIMERS, (void*)app_timers);
+
+    /* Initialise the logical timers, which run on the application timers */
+    TimerWheelInit();
     
     /* Initialise local timers */
     g_app_data.con_param_update_tid = TIMER_INVALID;
     g_app_data.app_tid = TIMER_INVALID;
+    g_app_data.role_tid = TIMER_INVALID;
+
+    /* The smart home role is set from the configuration */
+    g_app_data.phase = role_phase_idle;
+
+    /* Initialise the deferred work queue */
+    WorkQueueInit();
+
+    /* Initialise the trace buffer */
+    TraceInit();
+
+    /* Initialise the cache of received smart home frames */
+    FrameCacheInit();
+
+    /* Initialise the cache of keys derived from the random seeds */
+    KeyCacheInit();
+
+    /* Initialise the smart home message queues */
+    SmartInit();
 
     /* Initialise GATT entity */
     GattInit();
@@ -2097,6 +3132,12 @@ extern void AppInit(sleep_state last_sleep_state)
     /* Read persistent storage */
     readPersistentStore();
 
+    /* Advertise the node's own state until there is a message to send */
+    InitGattSmartData();
+
+    /* Apply the smart home configuration read from NVM */
+    ApplySmartConfig();
+
     /* Tell Security Manager module what value it needs to initialise its
      * diversifier to.
      */
@@ -2108,6 +3149,9 @@ extern void AppInit(sleep_state last_sleep_state)
     /* Initialise application data structure */
     appDataInit();
 
+    /* Start measuring the LM event handlers */
+    EventProfileInit();
+
     /* Tell GATT about our database. We will get a GATT_ADD_DB_CFM event when
      * this has completed.
      */
@@ -2115,35 +3159,10 @@ extern void AppInit(sleep_state last_sleep_state)
 
     GattAddDatabaseReq(gatt_db_length, p_gatt_db);
 
-	#if 1
-	{
-		uint8 i =0;
-		uint8 KEY[16] = {0};
-		uint8 SrcData[16] = {0xf0,0x14,0x04,0x39,0x01,0x01,
-			0x11,0x01,0x40,0x01,0x44,0x45,0x46,0x47,0x48,0x49};
-		
-		 KeyConvert(0x00a2, KEY);
-		encrypt(SrcData, 16, KEY);
-		DebugIfWriteString("After enc = ");
-		for(i=0; i<16; i++)
-		{
-			DebugIfWriteUint8(SrcData[i]);
-			DebugIfWriteString(", ");
-			
-		}
-		DebugIfWriteString("\r\n");
-
-		decrypt(SrcData, 16, KEY);
-		DebugIfWriteString("After dec = ");
-		for(i=0; i<16; i++)
-		{
-			DebugIfWriteUint8(SrcData[i]);
-			DebugIfWriteString(", ");
-			
-		}
-		DebugIfWriteString("\r\n");
-	}
-	#endif
+    /* Check that a frame survives an encryption round trip and measure the
+     * cost of the cipher
+     */
+    EventProfileCipher();
 }
 
 /*----------------------------------------------------------------------------*
@@ -2176,6 +3195,9 @@ void AppProcessSystemEvent(sys_event_id id, void *data)
             /* Ignore anything else */
         break;
     }
+
+    /* Write to NVM what the event has changed, once it has been handled */
+    appNvmFlushLater();
 }
 
 /*----------------------------------------------------------------------------*
@@ -2196,6 +3218,9 @@ void AppProcessSystemEvent(sys_event_id id, void *data)
  *----------------------------------------------------------------------------*/
 bool AppProcessLmEvent(lm_event_code event_code, LM_EVENT_T *p_event_data)
 {
+    /* Time at which handling of the event started */
+    const uint32 profile_start = EventProfileStart();
+
     switch (event_code)
     {
         /* Handle events received from Firmware */
@@ -2224,6 +3249,14 @@ bool AppProcessLmEvent(lm_event_code event_code, LM_EVENT_T *p_event_data)
             handleSignalGattConnectCfm((GATT_CONNECT_CFM_T*)p_event_data);
         break;
 
+        case GATT_CHAR_VAL_NOT_CFM:
+            /* Confirmation for the completion of GattCharValueNotification()
+             * procedure
+             */
+            EhSmartHandleNotificationCfm(
+                                (GATT_CHAR_VAL_IND_CFM_T *)p_event_data);
+        break;
+
         case SM_KEYS_IND:
             /* Indication for the keys and associated security information
              * on a connection that has completed Short Term Key Generation 
@@ -2314,6 +3347,14 @@ bool AppProcessLmEvent(lm_event_code event_code, LM_EVENT_T *p_event_data)
 
     }
 
+    /* Write to NVM what the event has changed, e.g. the configuration, once
+     * the event has been handled
+     */
+    appNvmFlushLater();
+
+    /* Account the time spent handling the event */
+    EventProfileEnd(event_code, profile_start);
+
     return TRUE;
 }
 
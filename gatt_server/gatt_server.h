@@ -33,9 +33,46 @@
 /* Maximum number of words in central device Identity Resolving Key (IRK) */
 #define MAX_WORDS_IRK                       (8)
 
+/* Largest NVM layout header, in words. The record store follows the header,
+ * and the NVM mirror in RAM covers both.
+ */
+#define NVM_HEADER_MAX_WORDS                (8)
+
 /*============================================================================*
- *  Public Function Prototypes
+ *  Public Data Types
  *============================================================================*/
+
+/* Roles of a smart home node, as written to the Smart Config characteristic */
+typedef enum
+{
+    /* Advertise all the time, never scan */
+    smart_role_advertise = 0x01,
+
+    /* Scan all the time, never advertise */
+    smart_role_scan = 0x02,
+
+    /* Alternate between scan windows and advertising bursts */
+    smart_role_scan_advertise = 0x03
+
+} smart_role;
+
+/* Phases of the smart home role scheduler */
+typedef enum
+{
+    /* Neither scanning nor advertising for the role */
+    role_phase_idle = 0,
+
+    /* Scanning */
+    role_phase_scanning,
+
+    /* Advertising */
+    role_phase_advertising,
+
+    /* Waiting for the advertisements to stop */
+    role_phase_stopping
+
+} role_phase;
+
 /* Application data structure */
 typedef struct _APP_DATA_T
 {
@@ -95,10 +132,65 @@ typedef struct _APP_DATA_T
     /* Current connection timeout value */
     uint16                     conn_timeout;
 
+    /* Timer ID for the current scan window or advertising burst */
+    timer_id                   role_tid;
+
+    /* Role of this smart home node */
+    smart_role                 role;
+
+    /* Length of the scan windows and advertising bursts when the node both
+     * scans and advertises, milliseconds
+     */
+    uint16                     scan_window;
+    uint16                     adv_window;
+
+    /* Current phase of the role scheduler */
+    role_phase                 phase;
+
+    /* Time at which the current phase started */
+    uint32                     phase_start;
+
+    /* Distinct smart home frames received in the current scan window */
+    uint16                     window_frames;
+
+    /* Total time spent scanning and advertising, milliseconds */
+    uint32                     scan_time;
+    uint32                     adv_time;
 
-	/////application val
-	timer_id		role_tid;
 } APP_DATA_T;
+
+/* Advertising report statistics. Each report received while scanning is
+ * counted once, either as accepted or against the stage that rejected it.
+ */
+typedef struct _SCAN_STATS_T
+{
+    /* Number of advertising reports received */
+    uint32                     reports;
+
+    /* Reports without the smart home service tag */
+    uint32                     rejected_tag;
+
+    /* Reports with the tag but without a valid seed or frame */
+    uint32                     rejected_format;
+
+    /* Repeats of a recently received frame */
+    uint32                     rejected_duplicate;
+
+    /* Frames dropped because the work queue or receive queue was full */
+    uint32                     rejected_queue_full;
+
+    /* Frames which did not decrypt to the UUID of this node */
+    uint32                     rejected_uuid;
+
+    /* Reports decoded as smart home frames for this node's UUID */
+    uint32                     accepted;
+
+} SCAN_STATS_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
 /* Call the firmware Panic() routine and provide a single point for debugging
  * any application level panics
  */
@@ -130,4 +222,13 @@ extern bool IsDeviceBonded(void);
 /* Return the unique connection ID (UCID) of the connection */
 extern uint16 GetConnectionID(void);
 
+/* Return the advertising report statistics */
+extern const SCAN_STATS_T *GetScanStats(void);
+
+/* Apply the current smart home configuration */
+extern void ApplySmartConfig(void);
+
+/* Handle the smart home messages waiting in the receive queue */
+extern void HandleSmartMessages(void);
+
 #endif /* __GATT_SERVER_H__ */
@@ -40,6 +40,7 @@ INPUTS=\
       buzzer.c\
       gap_service.c\
       nvm_access.c\
+      nvm_store.c\
       gatt_access.c\
       hw_access.c\
       gatt_server.c\
@@ -47,6 +48,14 @@ INPUTS=\
       eh_smart_service.c\
       TEA.c\
       smart_home.c\
+      event_profile.c\
+      ad_parser.c\
+      frame_cache.c\
+      trace.c\
+      smart_group.c\
+      smart_config.c\
+      timer_wheel.c\
+      work_queue.c\
       $(DBS)
 
 KEYR=\
@@ -26,6 +26,7 @@
 #include "hw_access.h"      /* Interface to this file */
 #include "gatt_server.h"    /* Definitions used throughout the GATT server */
 #include "buzzer.h"         /* Buzzer functions */
+#include "timer_wheel.h"    /* Logical timers on one firmware timer */
 
 /*============================================================================*
  *  Private Definitions
@@ -188,7 +189,7 @@ extern void HwDataReset(void)
     /* Delete button press timer */
     if (g_app_hw_data.button_press_tid != TIMER_INVALID)
     {
-        TimerDelete(g_app_hw_data.button_press_tid);
+        TimerWheelDelete(g_app_hw_data.button_press_tid);
         g_app_hw_data.button_press_tid = TIMER_INVALID;
     }
 
@@ -226,11 +227,11 @@ extern void HandlePIOChangedEvent(pio_changed_data *pio_data)
              * press is detected. If the button is released before the timer
              * expires a short button press is detected.
              */
-            TimerDelete(g_app_hw_data.button_press_tid);
+            TimerWheelDelete(g_app_hw_data.button_press_tid);
 
             g_app_hw_data.button_press_tid = 
-                TimerCreate(EXTRA_LONG_BUTTON_PRESS_TIMER,
-                                           TRUE, handleExtraLongButtonPress);
+                TimerWheelCreate(EXTRA_LONG_BUTTON_PRESS_TIMER,
+                                 handleExtraLongButtonPress);
         }
         else
         {
@@ -240,7 +241,7 @@ extern void HandlePIOChangedEvent(pio_changed_data *pio_data)
                 /* Timer was already running. This means it was a short button 
                  * press.
                  */
-                TimerDelete(g_app_hw_data.button_press_tid);
+                TimerWheelDelete(g_app_hw_data.button_press_tid);
                 g_app_hw_data.button_press_tid = TIMER_INVALID;
 
                 /* Indicate short button press using short beep */
@@ -7,7 +7,10 @@
  *      nvm_access.c
  *
  *  DESCRIPTION
- *      This file defines routines used by application to access NVM.
+ *      This file defines routines used by application to access NVM. The
+ *      application region of NVM is mirrored in RAM: it is read from NVM
+ *      once, reads are served from RAM, and the words written are gathered
+ *      and written to NVM together when Nvm_Flush() is called.
  *
  *****************************************************************************/
 
@@ -19,14 +22,155 @@
 #include <nvm.h>            /* Access to Non-Volatile Memory */
 #include <i2c.h>            /* Access to I2C bus */
 #include <panic.h>          /* Support for applications to panic */
+#include <mem.h>            /* Memory library */
 
 /*============================================================================*
  *  Local Header Files
  *============================================================================*/
 
 #include "nvm_access.h"     /* Interface to this file */
+#include "nvm_store.h"      /* Log-structured NVM record store */
 #include "gatt_server.h"    /* Definitions used throughout the GATT server */
 
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of words of NVM mirrored in RAM, from offset 0. It covers the
+ * layout header and both areas of the record store, so that records are
+ * read from RAM and only written to NVM by Nvm_Flush(), whichever area is
+ * current. Words beyond it are read and written directly.
+ */
+#define NVM_CACHE_WORDS                 (NVM_HEADER_MAX_WORDS + \
+                                         NVM_STORE_WORDS)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* NVM cache data structure */
+typedef struct _NVM_CACHE_T
+{
+    /* Copy of the start of NVM */
+    uint16                      words[NVM_CACHE_WORDS];
+
+    /* Range of words written since the last flush, first to one beyond the
+     * last; empty if both are 0
+     */
+    uint16                      dirty_start;
+    uint16                      dirty_end;
+
+    /* TRUE once the copy has been read from NVM */
+    bool                        loaded;
+
+    /* NVM access statistics */
+    NVM_STATS_T                 stats;
+
+} NVM_CACHE_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* NVM cache */
+static NVM_CACHE_T g_nvm_cache;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmRead
+ *
+ *  DESCRIPTION
+ *      This function reads words from NVM and then disables it to save power.
+ *
+ *  PARAMETERS
+ *      buffer [out]            Data read from NVM
+ *      length [in]             Number of words of data to read
+ *      offset [in]             Offset from which to start reading, in words
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void nvmRead(uint16 *buffer, uint16 length, uint16 offset)
+{
+    sys_status result;
+
+    /* Read from NVM. Firmware re-enables the NVM if it is disabled */
+    result = NvmRead(buffer, length, offset);
+    g_nvm_cache.stats.transfers++;
+
+    /* Disable NVM to save power after read operation */
+    Nvm_Disable();
+
+    /* Report panic if NVM read is not successful */
+    if(sys_status_success != result)
+    {
+        ReportPanic(app_panic_nvm_read);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmWrite
+ *
+ *  DESCRIPTION
+ *      This function writes words to NVM and then disables it to save power.
+ *
+ *  PARAMETERS
+ *      buffer [in]             Data to write to NVM
+ *      length [in]             Number of words of data to write
+ *      offset [in]             Offset from which to start writing, in words
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void nvmWrite(uint16 *buffer, uint16 length, uint16 offset)
+{
+    sys_status result;          /* Function status */
+
+    /* Write to NVM. Firmware re-enables the NVM if it is disabled */
+    result = NvmWrite(buffer, length, offset);
+    g_nvm_cache.stats.transfers++;
+    g_nvm_cache.stats.words_written += length;
+
+    /* Disable NVM to save power after write operation */
+    Nvm_Disable();
+
+    /* Report panic if NVM write is not successful */
+    if(sys_status_success != result)
+    {
+        ReportPanic(app_panic_nvm_write);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmCacheLoad
+ *
+ *  DESCRIPTION
+ *      This function reads the mirrored words from NVM, with a single
+ *      transfer, the first time they are needed.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void nvmCacheLoad(void)
+{
+    if(!g_nvm_cache.loaded)
+    {
+        nvmRead(g_nvm_cache.words, NVM_CACHE_WORDS, 0);
+        g_nvm_cache.dirty_start = 0;
+        g_nvm_cache.dirty_end = 0;
+        g_nvm_cache.loaded = TRUE;
+    }
+}
+
 /*============================================================================*
  *  Public Function Implementations
  *============================================================================*/
@@ -59,12 +203,9 @@ void Nvm_Disable(void)
  *      Nvm_Read
  *
  *  DESCRIPTION
- *      Read words from the NVM Store after preparing the NVM to be readable. 
- *      After the read operation, perform the actions necessary to save power
- *      on NVM.
- *
  *      Read words starting at the word offset, and store them in the supplied
- *      buffer.
+ *      buffer. Words mirrored in RAM are copied from there, without NVM
+ *      being accessed.
  *
  *  PARAMETERS
  *      buffer [out]            Data read from NVM
@@ -76,18 +217,19 @@ void Nvm_Disable(void)
  *----------------------------------------------------------------------------*/
 void Nvm_Read(uint16 *buffer, uint16 length, uint16 offset)
 {
-    sys_status result;
-
-    /* Read from NVM. Firmware re-enables the NVM if it is disabled */
-    result = NvmRead(buffer, length, offset);
+    g_nvm_cache.stats.reads++;
 
-    /* Disable NVM to save power after read operation */
-    Nvm_Disable();
+    nvmCacheLoad();
 
-    /* Report panic if NVM read is not successful */
-    if(sys_status_success != result)
+    if(offset + length <= NVM_CACHE_WORDS)
     {
-        ReportPanic(app_panic_nvm_read);
+        MemCopy(buffer, &g_nvm_cache.words[offset], length);
+    }
+    else
+    {
+        /* NVM must hold any words written to the mirrored part */
+        Nvm_Flush();
+        nvmRead(buffer, length, offset);
     }
 }
 
@@ -96,12 +238,9 @@ void Nvm_Read(uint16 *buffer, uint16 length, uint16 offset)
  *      Nvm_Write
  *
  *  DESCRIPTION
- *      Write words to the NVM Store after preparing the NVM to be writable. 
- *      After the write operation, perform the actions necessary to save power
- *      on NVM.
- *
  *      Write words from the supplied buffer into the NVM Store, starting at the
- *      word offset.
+ *      word offset. Words mirrored in RAM are only written to NVM by the next
+ *      Nvm_Flush(), and only if they have changed.
  *
  *  PARAMETERS
  *      buffer [in]             Data to write to NVM
@@ -113,17 +252,108 @@ void Nvm_Read(uint16 *buffer, uint16 length, uint16 offset)
  *----------------------------------------------------------------------------*/
 void Nvm_Write(uint16 *buffer, uint16 length, uint16 offset)
 {
-    sys_status result;          /* Function status */
+    uint16 i;                   /* Loop counter */
 
-    /* Write to NVM. Firmware re-enables the NVM if it is disabled */
-    result = NvmWrite(buffer, length, offset);
+    g_nvm_cache.stats.writes++;
 
-    /* Disable NVM to save power after write operation */
-    Nvm_Disable();
+    nvmCacheLoad();
 
-    /* Report panic if NVM write is not successful */
-    if(sys_status_success != result)
+    if(offset + length > NVM_CACHE_WORDS)
     {
-        ReportPanic(app_panic_nvm_write);
+        /* Keep the order of the writes, then the mirror up to date */
+        Nvm_Flush();
+        nvmWrite(buffer, length, offset);
+
+        for(i = offset; i < NVM_CACHE_WORDS; i++)
+        {
+            g_nvm_cache.words[i] = buffer[i - offset];
+        }
+        return;
+    }
+
+    for(i = offset; i < offset + length; i++)
+    {
+        if(g_nvm_cache.words[i] != buffer[i - offset])
+        {
+            g_nvm_cache.words[i] = buffer[i - offset];
+
+            if(g_nvm_cache.dirty_end == 0)
+            {
+                g_nvm_cache.dirty_start = i;
+            }
+            else if(i < g_nvm_cache.dirty_start)
+            {
+                g_nvm_cache.dirty_start = i;
+            }
+
+            if(i >= g_nvm_cache.dirty_end)
+            {
+                g_nvm_cache.dirty_end = i + 1;
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_Flush
+ *
+ *  DESCRIPTION
+ *      This function writes the words changed since the last flush to NVM,
+ *      as one transfer covering all of them.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+void Nvm_Flush(void)
+{
+    if(g_nvm_cache.dirty_end != 0)
+    {
+        nvmWrite(&g_nvm_cache.words[g_nvm_cache.dirty_start],
+                 g_nvm_cache.dirty_end - g_nvm_cache.dirty_start,
+                 g_nvm_cache.dirty_start);
+
+        g_nvm_cache.dirty_start = 0;
+        g_nvm_cache.dirty_end = 0;
     }
 }
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_IsDirty
+ *
+ *  DESCRIPTION
+ *      This function checks whether any words mirrored in RAM have changed
+ *      since the last flush.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      TRUE if Nvm_Flush() has words to write, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+bool Nvm_IsDirty(void)
+{
+    return (g_nvm_cache.dirty_end != 0);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_GetStats
+ *
+ *  DESCRIPTION
+ *      This function returns the NVM access statistics.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      NVM access statistics
+ *----------------------------------------------------------------------------*/
+const NVM_STATS_T *Nvm_GetStats(void)
+{
+    return &g_nvm_cache.stats;
+}
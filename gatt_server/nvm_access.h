@@ -20,6 +20,27 @@
 
 #include <types.h>          /* Commonly used type definitions */
 
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* NVM access statistics */
+typedef struct _NVM_STATS_T
+{
+    /* Calls to Nvm_Read() */
+    uint32                      reads;
+
+    /* Calls to Nvm_Write() */
+    uint32                      writes;
+
+    /* Reads and writes of the NVM itself */
+    uint32                      transfers;
+
+    /* Words written to the NVM itself */
+    uint32                      words_written;
+
+} NVM_STATS_T;
+
 /*============================================================================*
  *  Public Function Prototypes
  *============================================================================*/
@@ -45,12 +66,9 @@ extern void Nvm_Disable(void);
  *      Nvm_Read
  *
  *  DESCRIPTION
- *      Read words from the NVM Store after preparing the NVM to be readable. 
- *      After the read operation, perform the actions necessary to save power
- *      on NVM.
- *
  *      Read words starting at the word offset, and store them in the supplied
- *      buffer.
+ *      buffer. Words mirrored in RAM are copied from there, without NVM
+ *      being accessed.
  *
  *  PARAMETERS
  *      buffer [out]            Data read from NVM
@@ -67,12 +85,9 @@ extern void Nvm_Read(uint16 *buffer, uint16 length, uint16 offset);
  *      Nvm_Write
  *
  *  DESCRIPTION
- *      Write words to the NVM Store after preparing the NVM to be writable. 
- *      After the write operation, perform the actions necessary to save power
- *      on NVM.
- *
  *      Write words from the supplied buffer into the NVM Store, starting at the
- *      word offset.
+ *      word offset. Words mirrored in RAM are only written to NVM by the next
+ *      Nvm_Flush(), and only if they have changed.
  *
  *  PARAMETERS
  *      buffer [in]             Data to write to NVM
@@ -84,4 +99,51 @@ extern void Nvm_Read(uint16 *buffer, uint16 length, uint16 offset);
  *----------------------------------------------------------------------------*/
 extern void Nvm_Write(uint16 *buffer, uint16 length, uint16 offset);
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_Flush
+ *
+ *  DESCRIPTION
+ *      This function writes the words changed since the last flush to NVM,
+ *      as one transfer covering all of them.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void Nvm_Flush(void);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_IsDirty
+ *
+ *  DESCRIPTION
+ *      This function checks whether any words mirrored in RAM have changed
+ *      since the last flush.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      TRUE if Nvm_Flush() has words to write, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool Nvm_IsDirty(void);
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      Nvm_GetStats
+ *
+ *  DESCRIPTION
+ *      This function returns the NVM access statistics.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      NVM access statistics
+ *----------------------------------------------------------------------------*/
+extern const NVM_STATS_T *Nvm_GetStats(void);
+
 #endif /* __NVM_ACCESS_H__ */
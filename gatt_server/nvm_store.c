@@ -0,0 +1,534 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      nvm_store.c
+ *
+ *  DESCRIPTION
+ *      This file defines a log-structured record store in NVM. A record is
+ *      never overwritten: each new value is appended to the current area,
+ *      and an index in RAM points at the latest value of each record. When
+ *      the area is full, the latest values are copied to the other area,
+ *      which becomes the current one. Writes are spread over both areas
+ *      rather than wearing the same words.
+ *
+ *      Each area starts with a header holding a magic word and a sequence
+ *      number; the valid area with the later sequence number is current.
+ *      Each record is a header word, holding the record ID and length, a
+ *      check word and the value, and the records are followed by an end
+ *      word. A record that was not completely written fails its check and
+ *      ends the area.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <mem.h>            /* Memory library */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "nvm_store.h"      /* Interface to this file */
+#include "nvm_access.h"     /* Non-volatile memory access */
+#include "gatt_server.h"    /* Definitions used throughout the GATT server */
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Magic word at the start of a valid area */
+#define NVM_STORE_AREA_MAGIC            (0x4c47)
+
+/* Area header: magic word and sequence number */
+#define NVM_STORE_AREA_HEADER_WORDS     (2)
+#define NVM_STORE_AREA_MAGIC_OFFSET     (0)
+#define NVM_STORE_AREA_SEQ_OFFSET       (1)
+
+/* Record header: ID and length word, and check word */
+#define NVM_STORE_RECORD_HEADER_WORDS   (2)
+
+/* Word following the last record of an area */
+#define NVM_STORE_END                   (0xffff)
+
+/* Record header word */
+#define NVM_STORE_HEADER(id, length)    (((id) << 8) | (length))
+#define NVM_STORE_HEADER_ID(header)     ((header) >> 8)
+#define NVM_STORE_HEADER_LENGTH(header) ((header) & 0xff)
+
+/* Index entry of a record that has not been written */
+#define NVM_STORE_NO_OFFSET             (0xffff)
+
+/*============================================================================*
+ *  Private Data Types
+ *============================================================================*/
+
+/* Record store data structure */
+typedef struct _NVM_STORE_DATA_T
+{
+    /* NVM offset of the first area */
+    uint16                      offset;
+
+    /* Current area, 0 or 1 */
+    uint16                      area;
+
+    /* Sequence number of the current area */
+    uint16                      seq;
+
+    /* Offset of the end word in the current area */
+    uint16                      end;
+
+    /* NVM offset and length of the latest value of each record */
+    uint16                      record_offset[nvm_record_count];
+    uint16                      record_length[nvm_record_count];
+
+    /* A record being read, written or copied, with its header, check word
+     * and the end word that follows it
+     */
+    uint16                      buffer[NVM_STORE_RECORD_HEADER_WORDS +
+                                       NVM_STORE_RECORD_MAX + 1];
+
+    /* Record store statistics */
+    NVM_STORE_STATS_T           stats;
+
+} NVM_STORE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Record store data */
+static NVM_STORE_DATA_T g_nvm_store;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmStoreAreaOffset
+ *
+ *  DESCRIPTION
+ *      This function returns the NVM offset of an area.
+ *
+ *  PARAMETERS
+ *      area [in]               Area, 0 or 1
+ *
+ *  RETURNS
+ *      NVM offset of the area
+ *----------------------------------------------------------------------------*/
+static uint16 nvmStoreAreaOffset(uint16 area)
+{
+    return g_nvm_store.offset + area * NVM_STORE_AREA_WORDS;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmStoreCheck
+ *
+ *  DESCRIPTION
+ *      This function calculates the check word of a record. Each word is
+ *      folded in after a rotation, so that words in the wrong order are
+ *      detected as well as wrong words.
+ *
+ *  PARAMETERS
+ *      header [in]             Record header word
+ *      p_value [in]            Record value
+ *      length [in]             Number of words in the value
+ *
+ *  RETURNS
+ *      Check word
+ *----------------------------------------------------------------------------*/
+static uint16 nvmStoreCheck(uint16 header, const uint16 *p_value,
+                            uint16 length)
+{
+    uint16 check = header;
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < length; i++)
+    {
+        check = ((check << 1) | (check >> 15)) ^ p_value[i];
+    }
+
+    /* An erased record must not pass the check */
+    return ~check;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmStoreStartArea
+ *
+ *  DESCRIPTION
+ *      This function writes the end word and then the header of an area,
+ *      making it the current one. The records written to the area must
+ *      already be in NVM, so that a reset cannot leave a current area
+ *      without them.
+ *
+ *  PARAMETERS
+ *      area [in]               Area, 0 or 1
+ *      seq [in]                Sequence number of the area
+ *      end [in]                Offset of the end word in the area
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void nvmStoreStartArea(uint16 area, uint16 seq, uint16 end)
+{
+    uint16 word = NVM_STORE_END;
+    uint16 header[NVM_STORE_AREA_HEADER_WORDS];
+
+    Nvm_Write(&word, 1, nvmStoreAreaOffset(area) + end);
+    Nvm_Flush();
+
+    header[NVM_STORE_AREA_MAGIC_OFFSET] = NVM_STORE_AREA_MAGIC;
+    header[NVM_STORE_AREA_SEQ_OFFSET] = seq;
+    Nvm_Write(header, NVM_STORE_AREA_HEADER_WORDS, nvmStoreAreaOffset(area));
+    Nvm_Flush();
+
+    g_nvm_store.area = area;
+    g_nvm_store.seq = seq;
+    g_nvm_store.end = end;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmStoreInvalidateArea
+ *
+ *  DESCRIPTION
+ *      This function clears the magic word of an area, so that it is not
+ *      taken for the current one while it is being rewritten.
+ *
+ *  PARAMETERS
+ *      area [in]               Area, 0 or 1
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void nvmStoreInvalidateArea(uint16 area)
+{
+    uint16 word = 0;
+
+    Nvm_Write(&word, 1, nvmStoreAreaOffset(area) +
+                        NVM_STORE_AREA_MAGIC_OFFSET);
+    Nvm_Flush();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmStoreIndexArea
+ *
+ *  DESCRIPTION
+ *      This function rebuilds the index from the records of the current
+ *      area, and finds where the next record is to be appended. It stops at
+ *      the end word or at the first record that fails its check.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void nvmStoreIndexArea(void)
+{
+    const uint16 base = nvmStoreAreaOffset(g_nvm_store.area);
+    uint16 *p_buffer = g_nvm_store.buffer;
+    uint16 pos = NVM_STORE_AREA_HEADER_WORDS;
+    uint16 header;
+    uint16 id;
+    uint16 length;
+
+    MemSet(g_nvm_store.record_offset, NVM_STORE_NO_OFFSET, nvm_record_count);
+    MemSet(g_nvm_store.record_length, 0, nvm_record_count);
+
+    while(pos + NVM_STORE_RECORD_HEADER_WORDS < NVM_STORE_AREA_WORDS)
+    {
+        Nvm_Read(p_buffer, NVM_STORE_RECORD_HEADER_WORDS, base + pos);
+
+        header = p_buffer[0];
+        id = NVM_STORE_HEADER_ID(header);
+        length = NVM_STORE_HEADER_LENGTH(header);
+
+        if(header == NVM_STORE_END || id >= nvm_record_count ||
+           length > NVM_STORE_RECORD_MAX ||
+           pos + NVM_STORE_RECORD_HEADER_WORDS + length >=
+               NVM_STORE_AREA_WORDS)
+        {
+            break;
+        }
+
+        Nvm_Read(&p_buffer[NVM_STORE_RECORD_HEADER_WORDS], length,
+                 base + pos + NVM_STORE_RECORD_HEADER_WORDS);
+
+        if(p_buffer[1] != nvmStoreCheck(header,
+                             &p_buffer[NVM_STORE_RECORD_HEADER_WORDS], length))
+        {
+            /* Interrupted while it was being appended */
+            break;
+        }
+
+        g_nvm_store.record_offset[id] = base + pos;
+        g_nvm_store.record_length[id] = length;
+
+        pos += NVM_STORE_RECORD_HEADER_WORDS + length;
+    }
+
+    g_nvm_store.end = pos;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      nvmStoreCompact
+ *
+ *  DESCRIPTION
+ *      This function copies the latest value of each record to the other
+ *      area, which then becomes the current one. The current area stays
+ *      valid until the copy is complete.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void nvmStoreCompact(void)
+{
+    const uint16 area = 1 - g_nvm_store.area;
+    const uint16 base = nvmStoreAreaOffset(area);
+    uint16 *p_buffer = g_nvm_store.buffer;
+    uint16 pos = NVM_STORE_AREA_HEADER_WORDS;
+    uint16 length;
+    uint16 id;
+
+    g_nvm_store.stats.compactions++;
+
+    nvmStoreInvalidateArea(area);
+
+    for(id = 0; id < nvm_record_count; id++)
+    {
+        if(g_nvm_store.record_offset[id] != NVM_STORE_NO_OFFSET)
+        {
+            length = NVM_STORE_RECORD_HEADER_WORDS +
+                     g_nvm_store.record_length[id];
+
+            Nvm_Read(p_buffer, length, g_nvm_store.record_offset[id]);
+            Nvm_Write(p_buffer, length, base + pos);
+
+            g_nvm_store.record_offset[id] = base + pos;
+            pos += length;
+        }
+    }
+
+    nvmStoreStartArea(area, g_nvm_store.seq + 1, pos);
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      NvmStoreFormat
+ *
+ *  DESCRIPTION
+ *      This function erases the record store, leaving it with no records.
+ *
+ *  PARAMETERS
+ *      offset [in]             NVM offset of the record store
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void NvmStoreFormat(uint16 offset)
+{
+    g_nvm_store.offset = offset;
+
+    MemSet(g_nvm_store.record_offset, NVM_STORE_NO_OFFSET, nvm_record_count);
+    MemSet(g_nvm_store.record_length, 0, nvm_record_count);
+
+    nvmStoreInvalidateArea(1);
+    nvmStoreStartArea(0, 0, NVM_STORE_AREA_HEADER_WORDS);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      NvmStoreInit
+ *
+ *  DESCRIPTION
+ *      This function finds the current area of the record store and indexes
+ *      the records in it.
+ *
+ *  PARAMETERS
+ *      offset [in]             NVM offset of the record store
+ *
+ *  RETURNS
+ *      TRUE if the record store has been found, FALSE if it needs to be
+ *      formatted
+ *----------------------------------------------------------------------------*/
+extern bool NvmStoreInit(uint16 offset)
+{
+    uint16 header[2][NVM_STORE_AREA_HEADER_WORDS];
+    bool valid[2];
+    uint16 area;
+
+    g_nvm_store.offset = offset;
+
+    for(area = 0; area < 2; area++)
+    {
+        Nvm_Read(header[area], NVM_STORE_AREA_HEADER_WORDS,
+                 nvmStoreAreaOffset(area));
+        valid[area] = (header[area][NVM_STORE_AREA_MAGIC_OFFSET] ==
+                       NVM_STORE_AREA_MAGIC);
+    }
+
+    if(valid[0] && valid[1])
+    {
+        /* Signed difference copes with the sequence number wrapping */
+        area = ((int16)(header[1][NVM_STORE_AREA_SEQ_OFFSET] -
+                        header[0][NVM_STORE_AREA_SEQ_OFFSET]) > 0) ? 1 : 0;
+    }
+    else if(valid[0] || valid[1])
+    {
+        area = valid[1] ? 1 : 0;
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    g_nvm_store.area = area;
+    g_nvm_store.seq = header[area][NVM_STORE_AREA_SEQ_OFFSET];
+
+    nvmStoreIndexArea();
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      NvmStoreRead
+ *
+ *  DESCRIPTION
+ *      This function reads the latest value of a record. At most the given
+ *      number of words is read.
+ *
+ *  PARAMETERS
+ *      id [in]                 Record ID
+ *      buffer [out]            Record value
+ *      length [in]             Number of words in the buffer
+ *
+ *  RETURNS
+ *      Number of words in the record, which the caller should check, or
+ *      NVM_STORE_NO_RECORD if the record has not been written
+ *----------------------------------------------------------------------------*/
+extern uint16 NvmStoreRead(nvm_record id, uint16 *buffer, uint16 length)
+{
+    if(g_nvm_store.record_offset[id] == NVM_STORE_NO_OFFSET)
+    {
+        return NVM_STORE_NO_RECORD;
+    }
+
+    if(length > g_nvm_store.record_length[id])
+    {
+        length = g_nvm_store.record_length[id];
+    }
+
+    Nvm_Read(buffer, length, g_nvm_store.record_offset[id] +
+                             NVM_STORE_RECORD_HEADER_WORDS);
+
+    return g_nvm_store.record_length[id];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      NvmStoreWrite
+ *
+ *  DESCRIPTION
+ *      This function appends a new value of a record, with a single NVM
+ *      write, unless the record already holds it. The current area is
+ *      compacted first if the record does not fit in it.
+ *
+ *  PARAMETERS
+ *      id [in]                 Record ID
+ *      buffer [in]             Record value
+ *      length [in]             Number of words in the value, at most
+ *                              NVM_STORE_RECORD_MAX
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void NvmStoreWrite(nvm_record id, const uint16 *buffer, uint16 length)
+{
+    uint16 *p_buffer = g_nvm_store.buffer;
+    const uint16 header = NVM_STORE_HEADER(id, length);
+    uint16 record_words = NVM_STORE_RECORD_HEADER_WORDS + length;
+    uint16 i;                       /* Loop counter */
+
+    if(length > NVM_STORE_RECORD_MAX)
+    {
+        ReportPanic(app_panic_nvm_write);
+    }
+
+    if(g_nvm_store.record_length[id] == length &&
+       NvmStoreRead(id, p_buffer, length) == length)
+    {
+        i = 0;
+        while(i < length && p_buffer[i] == buffer[i])
+        {
+            i++;
+        }
+
+        if(i == length)
+        {
+            g_nvm_store.stats.unchanged++;
+            return;
+        }
+    }
+
+    /* The record is followed by the end word */
+    if(g_nvm_store.end + record_words >= NVM_STORE_AREA_WORDS)
+    {
+        nvmStoreCompact();
+
+        if(g_nvm_store.end + record_words >= NVM_STORE_AREA_WORDS)
+        {
+            /* The latest values alone fill the area */
+            ReportPanic(app_panic_nvm_write);
+        }
+    }
+
+    p_buffer[0] = header;
+    p_buffer[1] = nvmStoreCheck(header, buffer, length);
+    MemCopy(&p_buffer[NVM_STORE_RECORD_HEADER_WORDS], buffer, length);
+    p_buffer[record_words] = NVM_STORE_END;
+
+    g_nvm_store.record_offset[id] = nvmStoreAreaOffset(g_nvm_store.area) +
+                                    g_nvm_store.end;
+    g_nvm_store.record_length[id] = length;
+
+    Nvm_Write(p_buffer, record_words + 1, g_nvm_store.record_offset[id]);
+
+    g_nvm_store.end += record_words;
+    g_nvm_store.stats.appends++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      NvmStoreGetStats
+ *
+ *  DESCRIPTION
+ *      This function returns the record store statistics.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Record store statistics
+ *----------------------------------------------------------------------------*/
+extern const NVM_STORE_STATS_T *NvmStoreGetStats(void)
+{
+    return &g_nvm_store.stats;
+}
@@ -0,0 +1,95 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      nvm_store.h
+ *
+ *  DESCRIPTION
+ *      Header file for the log-structured NVM record store
+ *
+ *****************************************************************************/
+
+#ifndef __NVM_STORE_H__
+#define __NVM_STORE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Number of words in each of the two areas of the record store. The latest
+ * values of all the records take about 80 words, so an area leaves room for
+ * about as many again to be appended before it is compacted. Both areas are
+ * mirrored in RAM.
+ */
+#define NVM_STORE_AREA_WORDS            (128)
+
+/* Number of words of NVM used by the record store */
+#define NVM_STORE_WORDS                 (2 * NVM_STORE_AREA_WORDS)
+
+/* Largest record, in words */
+#define NVM_STORE_RECORD_MAX            (32)
+
+/* Length returned by NvmStoreRead() for a record that has not been written */
+#define NVM_STORE_NO_RECORD             (0xffff)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Record IDs. They are stored in NVM, so existing values must not change. */
+typedef enum
+{
+    nvm_record_bonded = 0,          /* Bonded flag */
+    nvm_record_bonded_addr,         /* Typed address of the bonded host */
+    nvm_record_sm_div,              /* Diversifier */
+    nvm_record_sm_irk,              /* IRK of the bonded host */
+    nvm_record_device_name,         /* GAP device name */
+    nvm_record_smart_config,        /* Smart home configuration */
+    nvm_record_client_config,       /* Smart home service client config */
+
+    nvm_record_count                /* Number of record IDs */
+
+} nvm_record;
+
+/* Record store statistics */
+typedef struct _NVM_STORE_STATS_T
+{
+    /* Records appended */
+    uint32                      appends;
+
+    /* Writes skipped because the record already held the value */
+    uint32                      unchanged;
+
+    /* Compaction passes */
+    uint32                      compactions;
+
+} NVM_STORE_STATS_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Erase the record store */
+extern void NvmStoreFormat(uint16 offset);
+
+/* Find the current area of the record store and index its records */
+extern bool NvmStoreInit(uint16 offset);
+
+/* Read the latest value of a record */
+extern uint16 NvmStoreRead(nvm_record id, uint16 *buffer, uint16 length);
+
+/* Append a new value of a record */
+extern void NvmStoreWrite(nvm_record id, const uint16 *buffer, uint16 length);
+
+/* Return the record store statistics */
+extern const NVM_STORE_STATS_T *NvmStoreGetStats(void);
+
+#endif /* __NVM_STORE_H__ */
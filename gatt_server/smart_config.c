@@ -0,0 +1,346 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      smart_config.c
+ *
+ *  DESCRIPTION
+ *      This file defines the persistent smart home configuration: the
+ *      network UUID, advertising interval and type, role, groups, data type
+ *      and node ID of the node. A new configuration is checked as a whole, stored
+ *      in NVM with a single write and only then applied, so that it is never
+ *      partly applied.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <mem.h>            /* Memory library */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "smart_config.h"   /* Interface to this file */
+#include "smart_home.h"     /* Smart home protocol engine */
+#include "gatt_server.h"    /* Definitions used throughout the GATT server */
+#include "nvm_store.h"      /* Log-structured NVM record store */
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Role of the node and lengths of its scan windows and advertising bursts,
+ * in milliseconds, until Smart Config sets them. A third of the time is
+ * spent advertising, so a message needs three times its time on air to be
+ * sent, and frames sent by other nodes while this one advertises are missed.
+ */
+#define SMART_CONFIG_ROLE_DEFAULT       (smart_role_scan_advertise)
+#define SMART_CONFIG_SCAN_WINDOW        (400)
+#define SMART_CONFIG_ADV_WINDOW         (200)
+
+/* Data type of the message advertised until Smart Config sets it */
+#define SMART_CONFIG_DATA_TYPE          (0x4001)
+
+/* Node ID until Smart Config sets it */
+#define SMART_CONFIG_NODE_ID            (SMART_ADDR_SRC(SMART_DEFAULT_ADDR))
+
+/* Number of words of NVM memory used by the configuration */
+#define SMART_CONFIG_NVM_MEMORY_WORDS   (sizeof(SMART_CONFIG_T))
+
+/*============================================================================*
+ *  Private Data types
+ *============================================================================*/
+
+/* Smart home configuration data structure */
+typedef struct _SMART_CONFIG_DATA_T
+{
+    /* Current configuration */
+    SMART_CONFIG_T              config;
+
+} SMART_CONFIG_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Smart home configuration data */
+static SMART_CONFIG_DATA_T g_config_data;
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartConfigGet
+ *
+ *  DESCRIPTION
+ *      This function returns the current configuration.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Current configuration
+ *----------------------------------------------------------------------------*/
+extern const SMART_CONFIG_T *SmartConfigGet(void)
+{
+    return &g_config_data.config;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartConfigIsValid
+ *
+ *  DESCRIPTION
+ *      This function checks that every setting of a configuration is valid,
+ *      and that a fixed advertising interval fits in an advertising burst.
+ *
+ *  PARAMETERS
+ *      p_config [in]           Configuration to check
+ *
+ *  RETURNS
+ *      TRUE if the configuration is valid, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool SmartConfigIsValid(const SMART_CONFIG_T *p_config)
+{
+    uint16 i;                       /* Loop counter */
+
+    if(p_config->group_count > SMART_MAX_GROUPS)
+    {
+        return FALSE;
+    }
+
+    for(i = 0; i < p_config->group_count; i++)
+    {
+        if(p_config->groups[i] == SMART_GROUP_NONE ||
+           p_config->groups[i] == SMART_GROUP_ALL)
+        {
+            return FALSE;
+        }
+    }
+
+    if(p_config->adv_interval != SMART_CONFIG_INTERVAL_ADAPTIVE &&
+       (p_config->adv_interval < SMART_CONFIG_INTERVAL_MIN ||
+        p_config->adv_interval > SMART_CONFIG_INTERVAL_MAX))
+    {
+        return FALSE;
+    }
+
+    if(p_config->role != smart_role_advertise &&
+       p_config->role != smart_role_scan &&
+       p_config->role != smart_role_scan_advertise)
+    {
+        return FALSE;
+    }
+
+    if(p_config->scan_window < SMART_CONFIG_WINDOW_MIN ||
+       p_config->scan_window > SMART_CONFIG_WINDOW_MAX ||
+       p_config->adv_window < SMART_CONFIG_WINDOW_MIN ||
+       p_config->adv_window > SMART_CONFIG_WINDOW_MAX)
+    {
+        return FALSE;
+    }
+
+    /* A node that alternates between scanning and advertising must send at
+     * least one advert in each burst
+     */
+    if(p_config->role == smart_role_scan_advertise &&
+       p_config->adv_interval != SMART_CONFIG_INTERVAL_ADAPTIVE &&
+       p_config->adv_interval > p_config->adv_window)
+    {
+        return FALSE;
+    }
+
+    if(p_config->node_id == 0 || p_config->node_id > SMART_NODE_ID_MAX)
+    {
+        return FALSE;
+    }
+
+    return (p_config->adv_type == SMART_CONFIG_ADV_CONNECTABLE);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartConfigJoinGroup
+ *
+ *  DESCRIPTION
+ *      This function adds a group to a configuration, unless it is already
+ *      there. Every node is a member of SMART_GROUP_ALL without it being
+ *      added.
+ *
+ *  PARAMETERS
+ *      p_config [in/out]       Configuration
+ *      group [in]              Group to join
+ *
+ *  RETURNS
+ *      TRUE if the configuration makes the node a member of the group, FALSE
+ *      if the group is invalid or the list is full
+ *----------------------------------------------------------------------------*/
+extern bool SmartConfigJoinGroup(SMART_CONFIG_T *p_config, uint16 group)
+{
+    uint16 i;                       /* Loop counter */
+
+    if(group == SMART_GROUP_NONE || group == SMART_GROUP_ALL)
+    {
+        return (group == SMART_GROUP_ALL);
+    }
+
+    for(i = 0; i < p_config->group_count; i++)
+    {
+        if(p_config->groups[i] == group)
+        {
+            /* Already a member */
+            return TRUE;
+        }
+    }
+
+    if(p_config->group_count == SMART_MAX_GROUPS)
+    {
+        return FALSE;
+    }
+
+    p_config->groups[p_config->group_count++] = group;
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartConfigLeaveGroup
+ *
+ *  DESCRIPTION
+ *      This function removes a group from a configuration.
+ *
+ *  PARAMETERS
+ *      p_config [in/out]       Configuration
+ *      group [in]              Group to leave
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void SmartConfigLeaveGroup(SMART_CONFIG_T *p_config, uint16 group)
+{
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < p_config->group_count; i++)
+    {
+        if(p_config->groups[i] == group)
+        {
+            /* Move the last group into the gap */
+            p_config->group_count--;
+            p_config->groups[i] = p_config->groups[p_config->group_count];
+            p_config->groups[p_config->group_count] = SMART_GROUP_NONE;
+            return;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartConfigCommit
+ *
+ *  DESCRIPTION
+ *      This function makes a configuration current, writes the whole of it
+ *      to NVM at once and applies it. The configuration must be valid.
+ *      It reaches NVM when the NVM cache is next flushed.
+ *
+ *  PARAMETERS
+ *      p_config [in]           New configuration
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void SmartConfigCommit(const SMART_CONFIG_T *p_config)
+{
+    g_config_data.config = *p_config;
+
+    SmartConfigWriteDataToNVM();
+
+    ApplySmartConfig();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartConfigReadDataFromNVM
+ *
+ *  DESCRIPTION
+ *      This function reads the configuration from NVM. NVM written by an
+ *      application without this configuration, or holding an invalid one,
+ *      is replaced by the defaults.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void SmartConfigReadDataFromNVM(void)
+{
+    if(NvmStoreRead(nvm_record_smart_config,
+                    (uint16 *)&g_config_data.config,
+                    SMART_CONFIG_NVM_MEMORY_WORDS) !=
+           SMART_CONFIG_NVM_MEMORY_WORDS ||
+       !SmartConfigIsValid(&g_config_data.config))
+    {
+        SmartConfigDataInit();
+        SmartConfigWriteDataToNVM();
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartConfigDataInit
+ *
+ *  DESCRIPTION
+ *      This function sets the current configuration to the defaults, without
+ *      writing it to NVM.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void SmartConfigDataInit(void)
+{
+    SMART_CONFIG_T *p_config = &g_config_data.config;
+
+    MemSet(p_config->groups, SMART_GROUP_NONE, SMART_MAX_GROUPS);
+    p_config->groups[0] = SMART_DEFAULT_GROUP;
+    p_config->group_count = 1;
+
+    p_config->uuid = SMART_HOME_UUID;
+    p_config->adv_interval = SMART_CONFIG_INTERVAL_ADAPTIVE;
+    p_config->role = SMART_CONFIG_ROLE_DEFAULT;
+    p_config->scan_window = SMART_CONFIG_SCAN_WINDOW;
+    p_config->adv_window = SMART_CONFIG_ADV_WINDOW;
+    p_config->data_type = SMART_CONFIG_DATA_TYPE;
+    p_config->adv_type = SMART_CONFIG_ADV_CONNECTABLE;
+    p_config->node_id = SMART_CONFIG_NODE_ID;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartConfigWriteDataToNVM
+ *
+ *  DESCRIPTION
+ *      This function appends the current configuration to the NVM record
+ *      store.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void SmartConfigWriteDataToNVM(void)
+{
+    NvmStoreWrite(nvm_record_smart_config, (uint16 *)&g_config_data.config,
+                  SMART_CONFIG_NVM_MEMORY_WORDS);
+}
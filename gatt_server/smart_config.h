@@ -0,0 +1,120 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      smart_config.h
+ *
+ *  DESCRIPTION
+ *      Header file for the persistent smart home configuration
+ *
+ *****************************************************************************/
+
+#ifndef __SMART_CONFIG_H__
+#define __SMART_CONFIG_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "smart_group.h"    /* Smart home group membership table */
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Shortest and longest scan window or advertising burst, in milliseconds. An
+ * advertising burst lasts at least one fast advertising interval.
+ */
+#define SMART_CONFIG_WINDOW_MIN         (100)
+#define SMART_CONFIG_WINDOW_MAX         (10000)
+
+/* Shortest and longest fixed advertising interval, in milliseconds, as
+ * allowed for connectable advertisements
+ */
+#define SMART_CONFIG_INTERVAL_MIN       (20)
+#define SMART_CONFIG_INTERVAL_MAX       (10240)
+
+/* Advertising interval meaning that the adaptive controller chooses it */
+#define SMART_CONFIG_INTERVAL_ADAPTIVE  (0)
+
+/* Advertising types. Only connectable undirected advertisements are
+ * supported, as the node must stay configurable.
+ */
+#define SMART_CONFIG_ADV_CONNECTABLE    (0x00)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Smart home configuration, laid out as it is stored in NVM */
+typedef struct _SMART_CONFIG_T
+{
+    /* Number of groups this node is a member of */
+    uint16                      group_count;
+
+    /* Groups this node is a member of */
+    uint16                      groups[SMART_MAX_GROUPS];
+
+    /* Smart home UUID, identifying the network */
+    uint32                      uuid;
+
+    /* Fixed advertising interval, milliseconds, or
+     * SMART_CONFIG_INTERVAL_ADAPTIVE
+     */
+    uint16                      adv_interval;
+
+    /* Role of the node, one of smart_role */
+    uint16                      role;
+
+    /* Length of the scan windows and advertising bursts, milliseconds */
+    uint16                      scan_window;
+    uint16                      adv_window;
+
+    /* Data type of the message advertised by this node */
+    uint16                      data_type;
+
+    /* Advertising type, SMART_CONFIG_ADV_* */
+    uint16                      adv_type;
+
+    /* Node ID of this node, the source of the messages it sends */
+    uint16                      node_id;
+
+} SMART_CONFIG_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Return the current configuration */
+extern const SMART_CONFIG_T *SmartConfigGet(void);
+
+/* Check that every setting of a configuration is valid */
+extern bool SmartConfigIsValid(const SMART_CONFIG_T *p_config);
+
+/* Add a group to a configuration */
+extern bool SmartConfigJoinGroup(SMART_CONFIG_T *p_config, uint16 group);
+
+/* Remove a group from a configuration */
+extern void SmartConfigLeaveGroup(SMART_CONFIG_T *p_config, uint16 group);
+
+/* Make a configuration current, store it in NVM and apply it */
+extern void SmartConfigCommit(const SMART_CONFIG_T *p_config);
+
+/* Read the configuration from NVM */
+extern void SmartConfigReadDataFromNVM(void);
+
+/* Set the current configuration to the defaults */
+extern void SmartConfigDataInit(void);
+
+/* Write the current configuration to NVM */
+extern void SmartConfigWriteDataToNVM(void);
+
+#endif /* __SMART_CONFIG_H__ */
@@ -0,0 +1,149 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      smart_group.c
+ *
+ *  DESCRIPTION
+ *      This file defines the smart home group membership table. A node may be
+ *      a member of several groups, e.g. a room, a scene and all lights. The
+ *      list of groups is part of the smart home configuration; it is loaded
+ *      into an open addressed hash table with at least half its slots free,
+ *      so that the receive path can check a group in constant time.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <mem.h>            /* Memory library */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "smart_group.h"    /* Interface to this file */
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of slots in the hash table; a power of two, at least twice
+ * SMART_MAX_GROUPS
+ */
+#define SMART_GROUP_SLOTS               (32)
+
+/* Hash table slot at which the search for a group starts */
+#define SMART_GROUP_SLOT(group) \
+            (((group) ^ ((group) >> 5) ^ ((group) >> 10)) & \
+             (SMART_GROUP_SLOTS - 1))
+
+/*============================================================================*
+ *  Private Data types
+ *============================================================================*/
+
+/* Group table data structure */
+typedef struct _SMART_GROUP_DATA_T
+{
+    /* Hash table of the groups, SMART_GROUP_NONE in free slots */
+    uint16                      table[SMART_GROUP_SLOTS];
+
+} SMART_GROUP_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Group table data */
+static SMART_GROUP_DATA_T g_group_data;
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartGroupFind
+ *
+ *  DESCRIPTION
+ *      This function finds the hash table slot holding a group, or the free
+ *      slot at which the group would be inserted. The table is never more
+ *      than half full, so the search always ends.
+ *
+ *  PARAMETERS
+ *      group [in]              Group to find
+ *
+ *  RETURNS
+ *      Index of the slot
+ *----------------------------------------------------------------------------*/
+static uint16 smartGroupFind(uint16 group)
+{
+    uint16 slot = SMART_GROUP_SLOT(group);
+
+    while(g_group_data.table[slot] != SMART_GROUP_NONE &&
+          g_group_data.table[slot] != group)
+    {
+        slot = (slot + 1) & (SMART_GROUP_SLOTS - 1);
+    }
+
+    return slot;
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartGroupIsMember
+ *
+ *  DESCRIPTION
+ *      This function checks whether this node is a member of a group. Every
+ *      node is a member of SMART_GROUP_ALL.
+ *
+ *  PARAMETERS
+ *      group [in]              Group to check
+ *
+ *  RETURNS
+ *      TRUE if this node is a member of the group, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool SmartGroupIsMember(uint16 group)
+{
+    if(group == SMART_GROUP_ALL)
+    {
+        return TRUE;
+    }
+
+    return (group != SMART_GROUP_NONE &&
+            g_group_data.table[smartGroupFind(group)] == group);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartGroupLoad
+ *
+ *  DESCRIPTION
+ *      This function makes this node a member of exactly the groups in a
+ *      list, which must hold no more than SMART_MAX_GROUPS valid groups.
+ *
+ *  PARAMETERS
+ *      groups [in]             Groups to be a member of
+ *      count [in]              Number of groups in the list
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void SmartGroupLoad(const uint16 *groups, uint16 count)
+{
+    uint16 i;                       /* Loop counter */
+
+    MemSet(g_group_data.table, SMART_GROUP_NONE, SMART_GROUP_SLOTS);
+
+    for(i = 0; i < count; i++)
+    {
+        g_group_data.table[smartGroupFind(groups[i])] = groups[i];
+    }
+}
@@ -0,0 +1,49 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      smart_group.h
+ *
+ *  DESCRIPTION
+ *      Header file for the smart home group membership table
+ *
+ *****************************************************************************/
+
+#ifndef __SMART_GROUP_H__
+#define __SMART_GROUP_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Group every node is a member of, e.g. for "all lights off" */
+#define SMART_GROUP_ALL                 (0xffff)
+
+/* Group no node can be a member of; it marks free entries */
+#define SMART_GROUP_NONE                (0x0000)
+
+/* Group this node is a member of when nothing has been configured */
+#define SMART_DEFAULT_GROUP             (0x1101)
+
+/* Maximum number of groups this node can be a member of */
+#define SMART_MAX_GROUPS                (16)
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Check whether this node is a member of a group */
+extern bool SmartGroupIsMember(uint16 group);
+
+/* Load the groups this node is a member of */
+extern void SmartGroupLoad(const uint16 *groups, uint16 count);
+
+#endif /* __SMART_GROUP_H__ */
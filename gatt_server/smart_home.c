@@ -1,32 +1,982 @@
-#include "smart_home.h"
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      smart_home.c
+ *
+ *  DESCRIPTION
+ *      This file defines the smart home protocol engine. Outgoing messages are
+ *      queued and advertised one after the other, each for a fixed time on
+ *      air. The time only runs while the advert is on air, so a node that
+ *      alternates between scanning and advertising still sends every message
+ *      for as long as one that advertises all the time.
+ *      Received frames are decrypted and decoded into a receive queue, from
+ *      which the application takes them once the advertising report handler
+ *      has returned, so that a burst of frames is not lost.
+ *
+ *      Messages are also relayed, if ENABLE_SMART_RELAY is defined, so that
+ *      they reach nodes out of radio range of the sender. A received message
+ *      addressed to another node is advertised again with its hop limit
+ *      lowered, after a random delay that makes relays hearing the same
+ *      message less likely to collide. Each node numbers the messages it
+ *      sends, and a cache of the source node IDs and sequence numbers of
+ *      recently seen messages makes sure each message is relayed and handled
+ *      only once, however many relays it arrives through.
+ *
+ *****************************************************************************/
 
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
 
-Smart_Data_Struct SmartInx;
+#include <timer.h>          /* Chip timer functions */
+#include <time.h>           /* Application interface to System Time */
+#include <random.h>         /* Generators for pseudo-random data sequences */
+#include <mem.h>            /* Memory library */
+#include <gatt_uuid.h>      /* Common Bluetooth UUIDs and macros */
 
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
 
-extern void SmartBuildData(void)
+#include "smart_home.h"     /* Interface to this file */
+#include "gatt_access.h"    /* GATT-related routines */
+#include "gatt_server.h"    /* Definitions used throughout the GATT server */
+#include "tea.h"            /* Smart home frame cipher */
+#include "trace.h"          /* Deferred binary trace */
+#include "smart_group.h"    /* Smart home group membership table */
+#include "smart_config.h"   /* Persistent smart home configuration */
+#include "timer_wheel.h"    /* Logical timers on one firmware timer */
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of messages held by each queue */
+#define SMART_QUEUE_SIZE                (8)
+
+/* Time for which each outgoing message is advertised */
+#define SMART_TX_HOLD                   (500 * MILLISECOND)
+
+/* Delay between a message being received and the application being told */
+#define SMART_RX_DELAY                  (10 * MILLISECOND)
+
+#ifdef ENABLE_SMART_RELAY
+/* Number of messages remembered by the seen cache */
+#define SMART_SEEN_SIZE                 (8)
+
+/* Time for which a message is remembered after it was last received */
+#define SMART_SEEN_LIFETIME             (3 * SECOND)
+
+/* Longest random delay before a relayed message is advertised, in
+ * milliseconds
+ */
+#define SMART_RELAY_JITTER_MS           (100)
+#endif /* ENABLE_SMART_RELAY */
+
+/*============================================================================*
+ *  Private Data types
+ *============================================================================*/
+
+/* Bounded message queue */
+typedef struct _SMART_QUEUE_T
+{
+    /* Queued messages */
+    Smart_Data_Struct           msg[SMART_QUEUE_SIZE];
+
+    /* Index of the oldest message */
+    uint16                      head;
+
+    /* Number of messages queued */
+    uint16                      count;
+
+} SMART_QUEUE_T;
+
+#ifdef ENABLE_SMART_RELAY
+/* Seen cache entry for one message */
+typedef struct _SMART_SEEN_T
+{
+    /* Source node ID and sequence number of the message */
+    uint16                      key;
+
+    /* Time at which the message was last received or sent */
+    uint32                      time;
+
+    /* TRUE if the entry holds a message */
+    bool                        used;
+
+} SMART_SEEN_T;
+#endif /* ENABLE_SMART_RELAY */
+
+/* Smart home protocol engine data structure */
+typedef struct _SMART_DATA_T
 {
-	
+    /* Messages waiting to be advertised */
+    SMART_QUEUE_T               tx_queue;
+
+    /* Received messages waiting for the application */
+    SMART_QUEUE_T               rx_queue;
+
+    /* Timer ID for advertising the current outgoing message */
+    timer_id                    tx_tid;
+
+    /* Timer ID for telling the application about received messages */
+    timer_id                    rx_tid;
+
+    /* TRUE while the advert is on air */
+    bool                        advertising;
+
+    /* TRUE if the current outgoing message is waiting for the advert to go
+     * back on air
+     */
+    bool                        tx_paused;
+
+    /* Time on air the current outgoing message still needs, 0 if there is
+     * no current message
+     */
+    uint32                      tx_left;
+
+    /* Time at which the transmit timer was last started */
+    uint32                      tx_start;
+
+    /* Time at which the current outgoing message was put in the advert */
+    uint32                      tx_loaded;
+
+#ifdef ENABLE_SMART_RELAY
+    /* Recently received and sent messages */
+    SMART_SEEN_T                seen[SMART_SEEN_SIZE];
+#endif /* ENABLE_SMART_RELAY */
+
+    /* Sequence number of the last message sent by this node */
+    uint16                      tx_seq;
+
+    /* Protocol engine statistics */
+    SMART_STATS_T               stats;
+
+} SMART_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Smart home protocol engine data */
+static SMART_DATA_T g_smart_data;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+/* Handle the expiry of the transmit timer */
+static void smartTxTimerHandler(timer_id tid);
+
+/* Handle the expiry of the receive timer */
+static void smartRxTimerHandler(timer_id tid);
+
+/* Put the next outgoing message in the advert */
+static void smartSendNext(void);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartQueuePut
+ *
+ *  DESCRIPTION
+ *      This function adds a message slot at the end of a queue.
+ *
+ *  PARAMETERS
+ *      p_queue [in/out]        Queue
+ *
+ *  RETURNS
+ *      Message slot to fill in, or NULL if the queue is full
+ *----------------------------------------------------------------------------*/
+static Smart_Data_Struct *smartQueuePut(SMART_QUEUE_T *p_queue)
+{
+    uint16 index;
+
+    if(p_queue->count == SMART_QUEUE_SIZE)
+    {
+        return NULL;
+    }
+
+    index = p_queue->head + p_queue->count;
+    if(index >= SMART_QUEUE_SIZE)
+    {
+        index -= SMART_QUEUE_SIZE;
+    }
+    p_queue->count++;
+
+    return &p_queue->msg[index];
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartQueueGet
+ *
+ *  DESCRIPTION
+ *      This function takes the oldest message from a queue.
+ *
+ *  PARAMETERS
+ *      p_queue [in/out]        Queue
+ *      p_msg [out]             Message taken from the queue
+ *
+ *  RETURNS
+ *      TRUE if a message was taken, FALSE if the queue is empty
+ *----------------------------------------------------------------------------*/
+static bool smartQueueGet(SMART_QUEUE_T *p_queue, Smart_Data_Struct *p_msg)
+{
+    if(p_queue->count == 0)
+    {
+        return FALSE;
+    }
+
+    *p_msg = p_queue->msg[p_queue->head];
+
+    if(++p_queue->head == SMART_QUEUE_SIZE)
+    {
+        p_queue->head = 0;
+    }
+    p_queue->count--;
+
+    return TRUE;
+}
+
+#ifdef ENABLE_SMART_RELAY
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartSeenKey
+ *
+ *  DESCRIPTION
+ *      This function returns the key by which a message is remembered in the
+ *      seen cache. The message is identified by its source node ID and
+ *      sequence number, not by its content, because each relay encrypts it
+ *      again under a seed of its own, and the same command may be sent twice
+ *      in a row.
+ *
+ *  PARAMETERS
+ *      p_msg [in]              Message
+ *
+ *  RETURNS
+ *      Key of the message
+ *----------------------------------------------------------------------------*/
+static uint16 smartSeenKey(const Smart_Data_Struct *p_msg)
+{
+    return (SMART_ADDR_SRC(p_msg->SmartADDR) << 8) |
+           (p_msg->SmartSEQ & 0xff);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartSeenFind
+ *
+ *  DESCRIPTION
+ *      This function looks a message key up in the seen cache. Entries that
+ *      have expired are freed on the way.
+ *
+ *  PARAMETERS
+ *      key [in]                Key of the message
+ *      pp_victim [out]         Free entry, or the entry last seen longest ago
+ *
+ *  RETURNS
+ *      Entry holding the message, or NULL if it has not been seen recently
+ *----------------------------------------------------------------------------*/
+static SMART_SEEN_T *smartSeenFind(uint16 key, SMART_SEEN_T **pp_victim)
+{
+    const uint32 now = TimeGet32();
+    SMART_SEEN_T *p_victim = &g_smart_data.seen[0];
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < SMART_SEEN_SIZE; i++)
+    {
+        SMART_SEEN_T *p_entry = &g_smart_data.seen[i];
+
+        /* Unsigned subtraction copes with the system time wrapping */
+        if(p_entry->used && now - p_entry->time >= SMART_SEEN_LIFETIME)
+        {
+            p_entry->used = FALSE;
+        }
+
+        if(p_entry->used && p_entry->key == key)
+        {
+            return p_entry;
+        }
+
+        if(!p_entry->used ||
+           (p_victim->used && now - p_entry->time > now - p_victim->time))
+        {
+            /* Free, or last seen before the current victim */
+            p_victim = p_entry;
+        }
+    }
+
+    *pp_victim = p_victim;
+
+    return NULL;
 }
 
-extern void SmartReadData(uint8* dat)
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartSeenCheck
+ *
+ *  DESCRIPTION
+ *      This function checks whether a message has been seen recently. A
+ *      repeated message has its lifetime renewed. A new message is not added;
+ *      that is left to smartSeenAdd() once the message has been accepted.
+ *      The state a node advertises on its own is never seen before, as its
+ *      sequence number does not change with the state. Its repeats are
+ *      dropped by the frame cache instead.
+ *
+ *  PARAMETERS
+ *      p_msg [in]              Message
+ *
+ *  RETURNS
+ *      TRUE if the message has been seen, FALSE if it is new
+ *----------------------------------------------------------------------------*/
+static bool smartSeenCheck(const Smart_Data_Struct *p_msg)
 {
+    SMART_SEEN_T *p_victim;         /* Unused */
+    SMART_SEEN_T *p_entry;          /* Entry holding the message */
+
+    if(p_msg->SmartSEQ == SMART_SEQ_STATE)
+    {
+        return FALSE;
+    }
+
+    p_entry = smartSeenFind(smartSeenKey(p_msg), &p_victim);
 
+    if(p_entry == NULL)
+    {
+        return FALSE;
+    }
+
+    p_entry->time = TimeGet32();
+
+    return TRUE;
 }
 
-extern void SmartParserFrame(uint8* dat)
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartSeenAdd
+ *
+ *  DESCRIPTION
+ *      This function records a message in the seen cache. A message already
+ *      there has its lifetime renewed; a new one replaces the oldest entry.
+ *      The state a node advertises on its own is not recorded, so that a
+ *      change of state is not taken for a repeat.
+ *
+ *  PARAMETERS
+ *      p_msg [in]              Message
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void smartSeenAdd(const Smart_Data_Struct *p_msg)
 {
+    const uint16 key = smartSeenKey(p_msg);
+    SMART_SEEN_T *p_victim;         /* Entry to replace */
+    SMART_SEEN_T *p_entry;          /* Entry holding the message */
+
+    if(p_msg->SmartSEQ == SMART_SEQ_STATE)
+    {
+        return;
+    }
+
+    p_entry = smartSeenFind(key, &p_victim);
+
+    if(p_entry == NULL)
+    {
+        p_entry = p_victim;
+        p_entry->key = key;
+        p_entry->used = TRUE;
+    }
 
+    p_entry->time = TimeGet32();
 }
+#endif /* ENABLE_SMART_RELAY */
 
-extern void SmartSendData(uint8* dat)
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartTxIdle
+ *
+ *  DESCRIPTION
+ *      This function checks whether the transmitter is idle, i.e. there is
+ *      neither a message being advertised or waiting for the advert to go
+ *      back on air, nor a relayed message waiting for its random delay.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      TRUE if the transmitter is idle, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+static bool smartTxIdle(void)
 {
+    return (g_smart_data.tx_tid == TIMER_INVALID && !g_smart_data.tx_paused);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartTxHold
+ *
+ *  DESCRIPTION
+ *      This function starts the timer for which the current outgoing message
+ *      is advertised. If the advert is not on air, the message waits until it
+ *      is.
+ *
+ *  PARAMETERS
+ *      time [in]               Time on air the message still needs
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void smartTxHold(uint32 time)
+{
+    g_smart_data.tx_left = time;
 
+    if(g_smart_data.advertising)
+    {
+        g_smart_data.tx_start = TimeGet32();
+        g_smart_data.tx_tid = TimerWheelCreate(time, smartTxTimerHandler);
+    }
+    else
+    {
+        g_smart_data.tx_paused = TRUE;
+    }
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartTxDone
+ *
+ *  DESCRIPTION
+ *      This function is called once the current outgoing message, if any, has
+ *      been on air for long enough. It records how long sending the message
+ *      took and sends the next one.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void smartTxDone(void)
+{
+    if(g_smart_data.tx_left != 0)
+    {
+        /* Unsigned subtraction copes with the system time wrapping */
+        g_smart_data.stats.sent++;
+        g_smart_data.stats.send_time +=
+            (TimeGet32() - g_smart_data.tx_loaded) / MILLISECOND;
+
+        g_smart_data.tx_left = 0;
+    }
+
+    smartSendNext();
+}
+
+#ifdef ENABLE_SMART_RELAY
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartRelay
+ *
+ *  DESCRIPTION
+ *      This function queues a received message for advertising with its hop
+ *      limit lowered. If nothing is being sent, the transmit timer is started
+ *      with a random delay rather than the message being sent straight away.
+ *
+ *  PARAMETERS
+ *      p_msg [in]              Received message
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void smartRelay(const Smart_Data_Struct *p_msg)
+{
+    Smart_Data_Struct *p_slot = smartQueuePut(&g_smart_data.tx_queue);
+
+    if(p_slot == NULL)
+    {
+        g_smart_data.stats.relay_dropped++;
+        return;
+    }
+
+    *p_slot = *p_msg;
+    p_slot->SmartTTL--;
+
+    g_smart_data.stats.relayed++;
+
+    if(smartTxIdle())
+    {
+        g_smart_data.tx_tid = TimerWheelCreate(
+                    (Random16() % (SMART_RELAY_JITTER_MS + 1)) * MILLISECOND,
+                    smartTxTimerHandler);
+    }
+}
+#endif /* ENABLE_SMART_RELAY */
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartSendNext
+ *
+ *  DESCRIPTION
+ *      This function puts the next outgoing message in the advert and starts
+ *      the timer for which it is advertised. If there is no message left, the
+ *      last one stays in the advert, but it is not counted as being sent.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void smartSendNext(void)
+{
+    Smart_Data_Struct msg;
+
+    if(smartQueueGet(&g_smart_data.tx_queue, &msg))
+    {
+#ifdef ENABLE_SMART_RELAY
+        /* Remember the message, so that it is not handled or relayed again
+         * when it comes back through a relay
+         */
+        smartSeenAdd(&msg);
+#endif /* ENABLE_SMART_RELAY */
+
+        GattUpdateSmartData(&msg);
+
+        g_smart_data.tx_loaded = TimeGet32();
+        smartTxHold(SMART_TX_HOLD);
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartTxTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function handles the expiry of the transmit timer. Either the
+ *      current message has been advertised for long enough or the random
+ *      delay before a relayed message has passed, so the next one is sent.
+ *
+ *  PARAMETERS
+ *      tid [in]                ID of timer that has expired
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void smartTxTimerHandler(timer_id tid)
+{
+    if(tid != g_smart_data.tx_tid)
+    {
+        /* Ignore a timer that has been superseded */
+        return;
+    }
+
+    g_smart_data.tx_tid = TIMER_INVALID;
+
+    smartTxDone();
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      smartRxTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function handles the expiry of the receive timer, by telling the
+ *      application that there are received messages to be read.
+ *
+ *  PARAMETERS
+ *      tid [in]                ID of timer that has expired
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void smartRxTimerHandler(timer_id tid)
+{
+    if(tid != g_smart_data.rx_tid)
+    {
+        /* Ignore a timer that has been superseded */
+        return;
+    }
+
+    g_smart_data.rx_tid = TIMER_INVALID;
+
+    HandleSmartMessages();
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartInit
+ *
+ *  DESCRIPTION
+ *      This function empties the message queues and the seen cache. It is
+ *      called after the application timers have been initialised, so no timer
+ *      is running.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void SmartInit(void)
+{
+    g_smart_data.tx_queue.head = 0;
+    g_smart_data.tx_queue.count = 0;
+    g_smart_data.rx_queue.head = 0;
+    g_smart_data.rx_queue.count = 0;
+
+    g_smart_data.tx_tid = TIMER_INVALID;
+    g_smart_data.rx_tid = TIMER_INVALID;
+
+    g_smart_data.advertising = FALSE;
+    g_smart_data.tx_paused = FALSE;
+    g_smart_data.tx_left = 0;
+
+#ifdef ENABLE_SMART_RELAY
+    MemSet(g_smart_data.seen, 0, sizeof(g_smart_data.seen));
+#endif /* ENABLE_SMART_RELAY */
+    MemSet(&g_smart_data.stats, 0, sizeof(g_smart_data.stats));
+
+    g_smart_data.tx_seq = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartBuildData
+ *
+ *  DESCRIPTION
+ *      This function encodes a message into a smart home frame, most
+ *      significant octet first in each word, and encrypts it with the key
+ *      derived from the message seed. The hop limit and sequence number are
+ *      encrypted with the rest of the message, so a relay lowers the hop
+ *      limit when it encrypts the message again under its own seed.
+ *
+ *  PARAMETERS
+ *      p_msg [in]              Message to encode
+ *      frame [out]             Frame, SMART_FRAME_WORDS words
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void SmartBuildData(const Smart_Data_Struct *p_msg, uint16 *frame)
+{
+    uint16 i;                       /* Loop counter */
+
+    frame[0] = SMART_FRAME_HOPS_SEQ(p_msg->SmartTTL, p_msg->SmartSEQ);
+    frame[1] = (uint16)(p_msg->SmartUUID & 0xffff);
+    frame[2] = p_msg->SmartADDR;
+    frame[3] = p_msg->SmartGRUOP;
+    frame[4] = p_msg->SmartDataType;
+
+    for(i = 0; i < SMART_DATA_LENGTH / 2; i++)
+    {
+        frame[i + 5] = BYTE8_TO_WORD16(p_msg->SmartDATA[2 * i],
+                                       p_msg->SmartDATA[2 * i + 1]);
+    }
+
+#if defined ENCRP_TEA
+    /* Seeds repeat often, so the key is normally served from the cache */
+    encrypt(frame, SMART_FRAME_LENGTH, KeyCacheLookup(p_msg->Random));
+#endif /* ENCRP_TEA */
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartReadData
+ *
+ *  DESCRIPTION
+ *      This function takes the oldest received message from the receive
+ *      queue.
+ *
+ *  PARAMETERS
+ *      p_msg [out]             Received message
+ *
+ *  RETURNS
+ *      TRUE if a message was read, FALSE if the receive queue is empty
+ *----------------------------------------------------------------------------*/
+extern bool SmartReadData(Smart_Data_Struct *p_msg)
+{
+    return smartQueueGet(&g_smart_data.rx_queue, p_msg);
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartParserFrame
+ *
+ *  DESCRIPTION
+ *      This function decrypts a received frame in place and decodes it into
+ *      the receive queue. The application is told about the message once the
+ *      current event has been handled. Frames that do not decrypt to the
+ *      UUID of this node and messages that have been seen recently are
+ *      dropped, and new messages for other nodes are relayed if their hop
+ *      limit allows. Only messages for groups this node is a member of are
+ *      queued. A message that does not fit in the receive queue is neither
+ *      recorded as seen nor relayed, so that it is handled in full when it is
+ *      next received. Unless relaying is enabled, such a frame is not even
+ *      decrypted, and repeats have already been dropped by the frame cache.
+ *
+ *  PARAMETERS
+ *      seed [in]               Random seed the frame was encrypted with
+ *      frame [in/out]          Frame, SMART_FRAME_WORDS words
+ *
+ *  RETURNS
+ *      smart_frame_wrong_uuid if the frame did not decrypt to the UUID of this
+ *      node, smart_frame_queue_full if a new message was dropped because the
+ *      receive queue is full, smart_frame_accepted otherwise
+ *----------------------------------------------------------------------------*/
+extern smart_frame_result SmartParserFrame(uint16 seed, uint16 *frame)
+{
+    Smart_Data_Struct msg;          /* Received message */
+    Smart_Data_Struct *p_slot;      /* Receive queue slot */
+    uint16 i;                       /* Loop counter */
+
+#ifndef ENABLE_SMART_RELAY
+    /* Without relaying, a frame that cannot be queued need not be decrypted */
+    if(g_smart_data.rx_queue.count == SMART_QUEUE_SIZE)
+    {
+        return smart_frame_queue_full;
+    }
+#endif /* !ENABLE_SMART_RELAY */
+
+#if defined ENCRP_TEA
+    TraceWrite(trace_frame_received, frame, SMART_FRAME_WORDS);
+
+    decrypt(frame, SMART_FRAME_LENGTH, KeyCacheLookup(seed));
+
+    TraceWrite(trace_frame_decrypted, frame, SMART_FRAME_WORDS);
+#endif /* ENCRP_TEA */
+
+    /* A frame encrypted under another key, or one whose service tag matched
+     * by chance, does not decrypt to the UUID of this node
+     */
+    if(frame[1] != (uint16)(SmartConfigGet()->uuid & 0xffff))
+    {
+        g_smart_data.stats.wrong_uuid++;
+        return smart_frame_wrong_uuid;
+    }
+
+    msg.SmartUUID = SmartConfigGet()->uuid;
+    msg.SmartTTL = SMART_FRAME_TTL(frame[0]);
+    msg.SmartSEQ = SMART_FRAME_SEQ(frame[0]);
+    msg.SmartADDR = frame[2];
+    msg.SmartGRUOP = frame[3];
+    msg.SmartDataType = frame[4];
+
+    for(i = 0; i < SMART_DATA_LENGTH / 2; i++)
+    {
+        msg.SmartDATA[2 * i] = WORD_MSB(frame[i + 5]);
+        msg.SmartDATA[2 * i + 1] = WORD_LSB(frame[i + 5]);
+    }
+
+    msg.Random = seed;
+
+#ifdef ENABLE_SMART_RELAY
+    if(smartSeenCheck(&msg))
+    {
+        g_smart_data.stats.duplicates++;
+        return smart_frame_accepted;
+    }
+#endif /* ENABLE_SMART_RELAY */
+
+    if(SmartGroupIsMember(msg.SmartGRUOP))
+    {
+        p_slot = smartQueuePut(&g_smart_data.rx_queue);
+        if(p_slot == NULL)
+        {
+            /* Neither recorded nor relayed, so that the message is handled
+             * in full when the sender advertises it again
+             */
+            return smart_frame_queue_full;
+        }
+
+        *p_slot = msg;
+
+        if(g_smart_data.rx_tid == TIMER_INVALID)
+        {
+            g_smart_data.rx_tid = TimerWheelCreate(SMART_RX_DELAY,
+                                                   smartRxTimerHandler);
+        }
+    }
+    else
+    {
+        g_smart_data.stats.not_member++;
+    }
+
+    g_smart_data.stats.received++;
+
+#ifdef ENABLE_SMART_RELAY
+    smartSeenAdd(&msg);
+
+    if(SMART_ADDR_DST(msg.SmartADDR) != SmartConfigGet()->node_id &&
+       msg.SmartTTL > 1)
+    {
+        smartRelay(&msg);
+    }
+#endif /* ENABLE_SMART_RELAY */
+
+    return smart_frame_accepted;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartSendData
+ *
+ *  DESCRIPTION
+ *      This function queues a message for advertising. The source node ID
+ *      of the message is set to that of this node and the message is given
+ *      the next sequence number. The UUID and seed of the message are
+ *      ignored; the advert supplies its own.
+ *
+ *  PARAMETERS
+ *      p_msg [in]              Message to send
+ *
+ *  RETURNS
+ *      TRUE if the message was queued, FALSE if the transmit queue is full
+ *----------------------------------------------------------------------------*/
+extern bool SmartSendData(const Smart_Data_Struct *p_msg)
+{
+    Smart_Data_Struct *p_slot = smartQueuePut(&g_smart_data.tx_queue);
+
+    if(p_slot == NULL)
+    {
+        return FALSE;
+    }
+
+    *p_slot = *p_msg;
+    p_slot->SmartADDR = SMART_ADDR(SmartConfigGet()->node_id,
+                                   SMART_ADDR_DST(p_msg->SmartADDR));
+
+    /* Relays and receivers tell repeated messages apart by sequence number.
+     * SMART_SEQ_STATE is left to the state the node advertises on its own.
+     */
+    g_smart_data.tx_seq = (g_smart_data.tx_seq % 0xff) + 1;
+    p_slot->SmartSEQ = g_smart_data.tx_seq;
+
+    if(smartTxIdle())
+    {
+        /* Nothing is being sent, so send this message straight away */
+        smartSendNext();
+    }
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartStartScan
+ *
+ *  DESCRIPTION
+ *      This function starts or stops scanning for smart home frames.
+ *
+ *  PARAMETERS
+ *      sc [in]                 TRUE to start scanning, FALSE to stop
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
 extern void SmartStartScan(bool sc)
 {
+    StartScan(sc);
+}
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartSetAdvertising
+ *
+ *  DESCRIPTION
+ *      This function is called whenever the advert goes on or off air. The
+ *      time the current outgoing message has been on air is kept while the
+ *      advert is off air, and the message is advertised for the rest of its
+ *      time once the advert is back on air.
+ *
+ *  PARAMETERS
+ *      advertising [in]        TRUE if the advert is now on air
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void SmartSetAdvertising(bool advertising)
+{
+    if(advertising == g_smart_data.advertising)
+    {
+        return;
+    }
+
+    g_smart_data.advertising = advertising;
+
+    if(advertising)
+    {
+        if(g_smart_data.tx_paused)
+        {
+            g_smart_data.tx_paused = FALSE;
+            smartTxHold(g_smart_data.tx_left);
+        }
+    }
+    else if(g_smart_data.tx_tid != TIMER_INVALID &&
+            g_smart_data.tx_left != 0)
+    {
+        /* Unsigned subtraction copes with the system time wrapping */
+        const uint32 aired = TimeGet32() - g_smart_data.tx_start;
+
+        TimerWheelDelete(g_smart_data.tx_tid);
+        g_smart_data.tx_tid = TIMER_INVALID;
+
+        if(aired >= g_smart_data.tx_left)
+        {
+            /* The timer was about to expire */
+            smartTxDone();
+        }
+        else
+        {
+            g_smart_data.tx_left -= aired;
+            g_smart_data.tx_paused = TRUE;
+        }
+    }
 }
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartTxPending
+ *
+ *  DESCRIPTION
+ *      This function checks whether there is a message, sent by this node or
+ *      relayed, that has not yet been advertised for long enough.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      TRUE if a message is waiting to be sent, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool SmartTxPending(void)
+{
+    return !smartTxIdle();
+}
 
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      SmartGetStats
+ *
+ *  DESCRIPTION
+ *      This function returns the protocol engine statistics. The share of
+ *      duplicates among all messages received shows the cost of relaying.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Protocol engine statistics
+ *----------------------------------------------------------------------------*/
+extern const SMART_STATS_T *SmartGetStats(void)
+{
+    return &g_smart_data.stats;
+}
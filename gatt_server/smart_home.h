@@ -1,21 +1,163 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      smart_home.h
+ *
+ *  DESCRIPTION
+ *      Header file for the smart home protocol engine
+ *
+ *****************************************************************************/
+
+#ifndef __SMART_HOME_H__
+#define __SMART_HOME_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
 #include <types.h>
 
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Smart home service UUID, carried in the 32-bit service UUID AD structure */
+#define SMART_HOME_UUID                 (0xf0140439UL)
+
+/* Lengths, in octets, of the smart home UUID, seed and frame */
+#define SMART_UUID_LENGTH               (4)
+#define SMART_SEED_LENGTH               (2)
+#define SMART_FRAME_LENGTH              (16)
+
+/* Number of 16-bit words in a smart home frame */
+#define SMART_FRAME_WORDS               (SMART_FRAME_LENGTH / 2)
+
+/* Number of data octets in a smart home frame */
+#define SMART_DATA_LENGTH               (6)
+
+/* Address of this node. The address holds the source node ID in the most
+ * significant octet and the destination node ID in the least significant.
+ */
+#define SMART_DEFAULT_ADDR              (0x0101)
+#define SMART_ADDR_SRC(addr)            ((addr) >> 8)
+#define SMART_ADDR_DST(addr)            ((addr) & 0xff)
+#define SMART_ADDR(src, dst)            (((src) << 8) | ((dst) & 0xff))
+
+/* Largest node ID */
+#define SMART_NODE_ID_MAX               (0xff)
+
+/* The first word of the frame holds the hop limit in the most significant
+ * octet and the sequence number in the least significant. Only the least
+ * significant word of the UUID follows, as the whole UUID is carried in the
+ * clear in the service tag.
+ */
+#define SMART_FRAME_HOPS_SEQ(ttl, seq)  ((((ttl) & 0xff) << 8) | ((seq) & 0xff))
+#define SMART_FRAME_TTL(word)           ((word) >> 8)
+#define SMART_FRAME_SEQ(word)           ((word) & 0xff)
+
+/* Sequence number of the state a node advertises on its own. The state is
+ * advertised again under the same number whenever it changes, so it is never
+ * recorded in the seen cache.
+ */
+#define SMART_SEQ_STATE                 (0)
+
+/* Hop limit of the messages sent by this node */
+#define SMART_DEFAULT_TTL               (3)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Outcome of handling a received frame */
+typedef enum
+{
+    /* The frame decrypted to a message for this node's UUID */
+    smart_frame_accepted = 0,
+
+    /* The frame did not decrypt to this node's UUID */
+    smart_frame_wrong_uuid,
+
+    /* A new message was dropped because the receive queue is full */
+    smart_frame_queue_full
+
+} smart_frame_result;
+
 typedef struct
 {
-	
+
 	uint32 SmartUUID;	////device uuid
 	uint16 SmartADDR;		///local id, des id
 	uint16 SmartGRUOP;	///group id
 	uint16 SmartDataType;	///data type
-	uint8   SmartDATA[6];	///len + 5* bytes data
+	uint8   SmartDATA[SMART_DATA_LENGTH];	///len + 5* bytes data
 	uint16 Random;
-	uint8   Key[16];
+	uint16 SmartTTL;	///hops left, 0 or 1: not relayed
+	uint16 SmartSEQ;	///sequence number of the source node
 }Smart_Data_Struct;
 
+/* Smart home protocol engine statistics */
+typedef struct _SMART_STATS_T
+{
+    /* New messages received */
+    uint32                      received;
+
+    /* Frames dropped because they did not decrypt to this node's UUID */
+    uint32                      wrong_uuid;
+
+    /* Messages received again, directly or through a relay */
+    uint32                      duplicates;
+
+    /* Messages queued for relaying */
+    uint32                      relayed;
+
+    /* Messages not relayed because the transmit queue was full */
+    uint32                      relay_dropped;
+
+    /* Messages for groups this node is not a member of */
+    uint32                      not_member;
+
+    /* Messages that have been advertised for long enough */
+    uint32                      sent;
+
+    /* Total time, in milliseconds, from the sent messages being put in the
+     * advert until they had been on air for long enough
+     */
+    uint32                      send_time;
+
+} SMART_STATS_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Empty the message queues */
+extern void SmartInit(void);
+
+/* Encode a message into a frame and encrypt it with the message seed */
+extern void SmartBuildData(const Smart_Data_Struct *p_msg, uint16 *frame);
+
+/* Take the oldest received message from the receive queue */
+extern bool SmartReadData(Smart_Data_Struct *p_msg);
+
+/* Decrypt and decode a received frame into the receive queue */
+extern smart_frame_result SmartParserFrame(uint16 seed, uint16 *frame);
+
+/* Queue a message for advertising */
+extern bool SmartSendData(const Smart_Data_Struct *p_msg);
+
+/* Start or stop scanning for smart home frames */
+extern void SmartStartScan(bool sc);
+
+/* Tell the protocol engine whether the advert is on air */
+extern void SmartSetAdvertising(bool advertising);
+
+/* Check whether a message is waiting to be sent */
+extern bool SmartTxPending(void);
 
-extern void SmartBuildData(void);
-extern void SmartReadData(uint8* dat);
-extern void SmartParserFrame(uint8* dat);
-extern void SmartSendData(uint8* dat);
+/* Return the protocol engine statistics */
+extern const SMART_STATS_T *SmartGetStats(void);
 
-extern void SmartStartScan(bool sc);
\ No newline at end of file
+#endif /* __SMART_HOME_H__ */
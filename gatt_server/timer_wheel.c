@@ -0,0 +1,644 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      timer_wheel.c
+ *
+ *  DESCRIPTION
+ *      This file defines a hierarchical timer wheel which runs any number of
+ *      logical timers, up to TIMER_WHEEL_MAX_TIMERS, on one firmware timer.
+ *
+ *      Time is counted in ticks of 1024 us. Each level of the wheel has 16
+ *      slots, and a slot of level n covers 16^n ticks. A timer is linked into
+ *      the slot of the lowest level which reaches its expiry, so starting
+ *      and stopping a timer take constant time. When the current tick moves
+ *      into a slot, the timers in it have either expired or are moved down
+ *      to a lower level. The firmware timer is only set for the next tick
+ *      at which an occupied slot is reached, so the wheel does not wake the
+ *      chip on every tick.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <timer.h>          /* Chip timer functions */
+#include <time.h>           /* Application interface to System Time */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "timer_wheel.h"    /* Interface to this file */
+#include "gatt_server.h"    /* Definitions used throughout the GATT server */
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Length of a tick, as a power of two microseconds */
+#define WHEEL_TICK_SHIFT                (10)
+#define WHEEL_TICK                      (1UL << WHEEL_TICK_SHIFT)
+
+/* Number of slots in each level, as a power of two */
+#define WHEEL_SLOT_SHIFT                (4)
+#define WHEEL_SLOTS                     (1 << WHEEL_SLOT_SHIFT)
+#define WHEEL_SLOT_MASK                 (WHEEL_SLOTS - 1)
+
+/* Number of levels. Timers beyond the top level, about 18 minutes, wait in
+ * its furthest slot and are linked again when it is reached.
+ */
+#define WHEEL_LEVELS                    (5)
+
+/* Lists the timers are linked into: the slots of every level, the expired
+ * timers waiting for their handlers to be called and the free timers
+ */
+#define WHEEL_LIST_DUE                  (WHEEL_LEVELS * WHEEL_SLOTS)
+#define WHEEL_LIST_FREE                 (WHEEL_LIST_DUE + 1)
+#define WHEEL_LISTS                     (WHEEL_LIST_FREE + 1)
+
+/* End of a list */
+#define WHEEL_NONE                      (0xff)
+
+/* A timer ID holds the index of the timer in its low bits and a count of
+ * timers started in the rest, so that an expired ID is not mistaken for a
+ * timer which has reused the index
+ */
+#define WHEEL_INDEX_SHIFT               (5)
+#define WHEEL_INDEX_MASK                ((1 << WHEEL_INDEX_SHIFT) - 1)
+
+/* Shortest time the firmware timer is set for, in microseconds */
+#define WHEEL_MIN_DELAY                 (100)
+
+/*============================================================================*
+ *  Private Data types
+ *============================================================================*/
+
+/* Logical timer */
+typedef struct _WHEEL_TIMER_T
+{
+    /* Tick at which the timer expires */
+    uint32                      expiry;
+
+    /* Function called when the timer expires */
+    timer_callback_arg          handler;
+
+    /* ID returned when the timer was started */
+    timer_id                    id;
+
+    /* List the timer is linked into */
+    uint8                       list;
+
+    /* Next and previous timers in the list */
+    uint8                       next;
+    uint8                       prev;
+
+} WHEEL_TIMER_T;
+
+/* Timer wheel data structure */
+typedef struct _TIMER_WHEEL_DATA_T
+{
+    /* Logical timers */
+    WHEEL_TIMER_T               timers[TIMER_WHEEL_MAX_TIMERS];
+
+    /* First timer in each list */
+    uint8                       head[WHEEL_LISTS];
+
+    /* Bit mask of the slots of each level which hold timers */
+    uint16                      occupied[WHEEL_LEVELS];
+
+    /* Current tick */
+    uint32                      now;
+
+    /* Chip time at the start of the current tick */
+    uint32                      now_time;
+
+    /* Number of timers started, used to make timer IDs */
+    uint16                      started;
+
+    /* Number of timers which have not expired or been stopped */
+    uint16                      running;
+
+    /* Firmware timer ID */
+    timer_id                    tid;
+
+    /* Tick for which the firmware timer is set */
+    uint32                      deadline;
+
+} TIMER_WHEEL_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Timer wheel data */
+static TIMER_WHEEL_DATA_T g_wheel;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+/* Link a timer into the front of a list */
+static void wheelLink(uint16 index, uint16 list);
+
+/* Unlink a timer from its list */
+static void wheelUnlink(uint16 index);
+
+/* Link a timer into the slot for its expiry */
+static void wheelInsert(uint16 index);
+
+/* Move the current tick forward to the chip time */
+static void wheelAdvance(void);
+
+/* Set the firmware timer for the next occupied slot */
+static void wheelSchedule(void);
+
+/* Handle expiry of the firmware timer */
+static void wheelTimerHandler(timer_id tid);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wheelLink
+ *
+ *  DESCRIPTION
+ *      This function links a timer into the front of a list and marks a
+ *      slot as occupied.
+ *
+ *  PARAMETERS
+ *      index [in]              Index of the timer
+ *      list [in]               List to link it into
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wheelLink(uint16 index, uint16 list)
+{
+    WHEEL_TIMER_T *p_timer = &g_wheel.timers[index];
+
+    p_timer->list = list;
+    p_timer->prev = WHEEL_NONE;
+    p_timer->next = g_wheel.head[list];
+
+    if(p_timer->next != WHEEL_NONE)
+    {
+        g_wheel.timers[p_timer->next].prev = index;
+    }
+
+    g_wheel.head[list] = index;
+
+    if(list < WHEEL_LIST_DUE)
+    {
+        g_wheel.occupied[list >> WHEEL_SLOT_SHIFT] |=
+                                        (1 << (list & WHEEL_SLOT_MASK));
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wheelUnlink
+ *
+ *  DESCRIPTION
+ *      This function unlinks a timer from its list and marks a slot left
+ *      empty as unoccupied.
+ *
+ *  PARAMETERS
+ *      index [in]              Index of the timer
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wheelUnlink(uint16 index)
+{
+    WHEEL_TIMER_T *p_timer = &g_wheel.timers[index];
+
+    if(p_timer->prev != WHEEL_NONE)
+    {
+        g_wheel.timers[p_timer->prev].next = p_timer->next;
+    }
+    else
+    {
+        g_wheel.head[p_timer->list] = p_timer->next;
+    }
+
+    if(p_timer->next != WHEEL_NONE)
+    {
+        g_wheel.timers[p_timer->next].prev = p_timer->prev;
+    }
+
+    if(p_timer->list < WHEEL_LIST_DUE &&
+       g_wheel.head[p_timer->list] == WHEEL_NONE)
+    {
+        g_wheel.occupied[p_timer->list >> WHEEL_SLOT_SHIFT] &=
+                                    ~(1 << (p_timer->list & WHEEL_SLOT_MASK));
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wheelInsert
+ *
+ *  DESCRIPTION
+ *      This function links a timer which expires after the current tick into
+ *      the slot of the lowest level which reaches its expiry.
+ *
+ *  PARAMETERS
+ *      index [in]              Index of the timer
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wheelInsert(uint16 index)
+{
+    uint32 expiry = g_wheel.timers[index].expiry;
+    uint32 slot;                    /* Slot count at the chosen level */
+    uint32 current;                 /* Current slot count at that level */
+    uint16 shift = 0;               /* Ticks per slot, as a power of two */
+    uint16 level;                   /* Level of the wheel */
+
+    for(level = 0; level < WHEEL_LEVELS; level++)
+    {
+        shift = level * WHEEL_SLOT_SHIFT;
+        slot = expiry >> shift;
+        current = g_wheel.now >> shift;
+
+        /* Slot counts wrap at 32 - shift bits */
+        if(((slot - current) & (0xffffffffUL >> shift)) < WHEEL_SLOTS)
+        {
+            break;
+        }
+    }
+
+    if(level == WHEEL_LEVELS)
+    {
+        /* Too far ahead for the wheel: wait in the furthest slot */
+        level = WHEEL_LEVELS - 1;
+        slot = current + WHEEL_SLOTS - 1;
+    }
+
+    wheelLink(index, (level << WHEEL_SLOT_SHIFT) + (slot & WHEEL_SLOT_MASK));
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wheelAdvance
+ *
+ *  DESCRIPTION
+ *      This function moves the current tick forward to the chip time. Every
+ *      slot reached on the way is emptied: expired timers are moved to the
+ *      due list and the others are linked into a lower level.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wheelAdvance(void)
+{
+    uint32 elapsed = TimeGet32() - g_wheel.now_time;
+    uint32 previous = g_wheel.now;
+    uint32 current;                 /* Slot count being reached */
+    uint32 span;                    /* Number of slots reached */
+    uint16 shift;                   /* Ticks per slot, as a power of two */
+    uint16 level;                   /* Level of the wheel */
+    uint16 list;                    /* Slot being emptied */
+    uint16 index;                   /* Timer being moved */
+    uint16 next;                    /* Next timer in the slot */
+
+    g_wheel.now += elapsed >> WHEEL_TICK_SHIFT;
+    g_wheel.now_time += elapsed & ~(WHEEL_TICK - 1);
+
+    for(level = 0; level < WHEEL_LEVELS; level++)
+    {
+        shift = level * WHEEL_SLOT_SHIFT;
+        current = previous >> shift;
+        span = ((g_wheel.now >> shift) - current) & (0xffffffffUL >> shift);
+
+        if(span == 0)
+        {
+            /* No higher level has moved either */
+            break;
+        }
+
+        if(span > WHEEL_SLOTS)
+        {
+            span = WHEEL_SLOTS;
+        }
+
+        while(span-- != 0)
+        {
+            current++;
+            list = (level << WHEEL_SLOT_SHIFT) + (current & WHEEL_SLOT_MASK);
+
+            /* Detach the slot, as timers moved down may be linked into it
+             * again
+             */
+            index = g_wheel.head[list];
+            g_wheel.head[list] = WHEEL_NONE;
+            g_wheel.occupied[level] &= ~(1 << (list & WHEEL_SLOT_MASK));
+
+            while(index != WHEEL_NONE)
+            {
+                next = g_wheel.timers[index].next;
+
+                if((int32)(g_wheel.timers[index].expiry - g_wheel.now) <= 0)
+                {
+                    wheelLink(index, WHEEL_LIST_DUE);
+                }
+                else
+                {
+                    wheelInsert(index);
+                }
+
+                index = next;
+            }
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wheelSchedule
+ *
+ *  DESCRIPTION
+ *      This function sets the firmware timer for the first tick at which an
+ *      occupied slot is reached, unless it is already set for that tick or
+ *      earlier. A timer stopped since only causes an early wake-up.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wheelSchedule(void)
+{
+    uint32 deadline = 0;            /* First tick at which a slot is reached */
+    uint32 tick;                    /* Tick at which a level's slot is reached */
+    uint32 current;                 /* Current slot count at a level */
+    int32 delay;                    /* Firmware timer delay */
+    bool found = FALSE;             /* Whether any slot is occupied */
+    uint16 shift;                   /* Ticks per slot, as a power of two */
+    uint16 level;                   /* Level of the wheel */
+    uint16 i;                       /* Loop counter */
+
+    for(level = 0; level < WHEEL_LEVELS; level++)
+    {
+        if(g_wheel.occupied[level] == 0)
+        {
+            continue;
+        }
+
+        shift = level * WHEEL_SLOT_SHIFT;
+        current = g_wheel.now >> shift;
+
+        for(i = 1; i <= WHEEL_SLOTS; i++)
+        {
+            if(g_wheel.occupied[level] &
+               (1 << ((current + i) & WHEEL_SLOT_MASK)))
+            {
+                tick = (current + i) << shift;
+
+                if(!found || (int32)(tick - deadline) < 0)
+                {
+                    deadline = tick;
+                    found = TRUE;
+                }
+                break;
+            }
+        }
+    }
+
+    if(g_wheel.tid != TIMER_INVALID)
+    {
+        if(found && (int32)(g_wheel.deadline - deadline) <= 0)
+        {
+            /* Already set early enough */
+            return;
+        }
+
+        TimerDelete(g_wheel.tid);
+        g_wheel.tid = TIMER_INVALID;
+    }
+
+    if(found)
+    {
+        delay = (int32)(((deadline - g_wheel.now) << WHEEL_TICK_SHIFT) -
+                        (TimeGet32() - g_wheel.now_time));
+
+        if(delay < (int32)WHEEL_MIN_DELAY)
+        {
+            delay = WHEEL_MIN_DELAY;
+        }
+
+        g_wheel.deadline = deadline;
+        g_wheel.tid = TimerCreate((uint32)delay, TRUE, wheelTimerHandler);
+
+        if(g_wheel.tid == TIMER_INVALID)
+        {
+            ReportPanic(app_panic_timer_exhausted);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      wheelTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function handles expiry of the firmware timer. It moves the
+ *      wheel to the current tick and calls the handlers of the expired
+ *      timers, earliest first. Each timer is freed before its handler is
+ *      called, so the handler may start it again.
+ *
+ *  PARAMETERS
+ *      tid [in]                ID of timer that has expired
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void wheelTimerHandler(timer_id tid)
+{
+    timer_callback_arg handler;     /* Handler of the expired timer */
+    timer_id id;                    /* ID of the expired timer */
+    uint16 first;                   /* Earliest expired timer */
+    uint16 index;                   /* Loop index */
+
+    if(tid != g_wheel.tid)
+    {
+        /* Ignore a timer that has been superseded */
+        return;
+    }
+
+    g_wheel.tid = TIMER_INVALID;
+
+    wheelAdvance();
+
+    while(g_wheel.head[WHEEL_LIST_DUE] != WHEEL_NONE)
+    {
+        first = g_wheel.head[WHEEL_LIST_DUE];
+
+        for(index = g_wheel.timers[first].next; index != WHEEL_NONE;
+            index = g_wheel.timers[index].next)
+        {
+            if((int32)(g_wheel.timers[index].expiry -
+                       g_wheel.timers[first].expiry) < 0)
+            {
+                first = index;
+            }
+        }
+
+        handler = g_wheel.timers[first].handler;
+        id = g_wheel.timers[first].id;
+
+        wheelUnlink(first);
+        wheelLink(first, WHEEL_LIST_FREE);
+        g_wheel.running--;
+
+        handler(id);
+    }
+
+    wheelSchedule();
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimerWheelInit
+ *
+ *  DESCRIPTION
+ *      This function stops every logical timer. It is called after the
+ *      firmware timers have been initialised, so the firmware timer of the
+ *      wheel is not running.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void TimerWheelInit(void)
+{
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < WHEEL_LISTS; i++)
+    {
+        g_wheel.head[i] = WHEEL_NONE;
+    }
+
+    for(i = 0; i < WHEEL_LEVELS; i++)
+    {
+        g_wheel.occupied[i] = 0;
+    }
+
+    for(i = 0; i < TIMER_WHEEL_MAX_TIMERS; i++)
+    {
+        g_wheel.timers[i].id = TIMER_INVALID;
+        wheelLink(i, WHEEL_LIST_FREE);
+    }
+
+    g_wheel.now = 0;
+    g_wheel.now_time = TimeGet32();
+    g_wheel.started = 0;
+    g_wheel.running = 0;
+    g_wheel.tid = TIMER_INVALID;
+    g_wheel.deadline = 0;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimerWheelCreate
+ *
+ *  DESCRIPTION
+ *      This function starts a logical timer. The timer expires on the first
+ *      tick boundary at or after the timeout, so it is never early. Running
+ *      out of timers is a design error and causes a panic.
+ *
+ *  PARAMETERS
+ *      timeout [in]            Timeout in microseconds
+ *      handler [in]            Function called when the timer expires
+ *
+ *  RETURNS
+ *      ID of the timer
+ *----------------------------------------------------------------------------*/
+extern timer_id TimerWheelCreate(uint32 timeout, timer_callback_arg handler)
+{
+    WHEEL_TIMER_T *p_timer;         /* Timer being started */
+    uint32 ticks;                   /* Ticks until expiry */
+    uint16 index = g_wheel.head[WHEEL_LIST_FREE];
+
+    if(index == WHEEL_NONE)
+    {
+        ReportPanic(app_panic_timer_exhausted);
+        return TIMER_INVALID;
+    }
+
+    if(g_wheel.running == 0)
+    {
+        /* The wheel may not have moved for a long time, and nothing can
+         * expire on the way
+         */
+        wheelAdvance();
+    }
+
+    ticks = (TimeGet32() - g_wheel.now_time + timeout + WHEEL_TICK - 1) >>
+            WHEEL_TICK_SHIFT;
+
+    if(ticks == 0)
+    {
+        ticks = 1;
+    }
+
+    p_timer = &g_wheel.timers[index];
+    p_timer->expiry = g_wheel.now + ticks;
+    p_timer->handler = handler;
+    p_timer->id = (++g_wheel.started << WHEEL_INDEX_SHIFT) | index;
+
+    wheelUnlink(index);
+    wheelInsert(index);
+    g_wheel.running++;
+
+    wheelSchedule();
+
+    return p_timer->id;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TimerWheelDelete
+ *
+ *  DESCRIPTION
+ *      This function stops a logical timer. The firmware timer is left
+ *      running, and is set again when it next expires.
+ *
+ *  PARAMETERS
+ *      tid [in]                ID of the timer
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void TimerWheelDelete(timer_id tid)
+{
+    uint16 index = tid & WHEEL_INDEX_MASK;
+
+    if(tid == TIMER_INVALID || index >= TIMER_WHEEL_MAX_TIMERS ||
+       g_wheel.timers[index].id != tid ||
+       g_wheel.timers[index].list == WHEEL_LIST_FREE)
+    {
+        return;
+    }
+
+    wheelUnlink(index);
+    wheelLink(index, WHEEL_LIST_FREE);
+    g_wheel.running--;
+}
@@ -0,0 +1,52 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      timer_wheel.h
+ *
+ *  DESCRIPTION
+ *      Header file for the software timer wheel, which runs the logical
+ *      timers of the application on a single firmware timer
+ *
+ *****************************************************************************/
+
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+#include <timer.h>          /* Chip timer functions */
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Number of firmware timers used by the timer wheel */
+#define TIMER_WHEEL_FIRMWARE_TIMERS     (1)
+
+/* Number of logical timers which can run at once. It must be less than 31. */
+#define TIMER_WHEEL_MAX_TIMERS          (16)
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Initialise the timer wheel. The firmware timers must have been initialised
+ * first.
+ */
+extern void TimerWheelInit(void);
+
+/* Start a logical timer which calls the handler after the timeout, in
+ * microseconds. Returns the ID of the timer.
+ */
+extern timer_id TimerWheelCreate(uint32 timeout, timer_callback_arg handler);
+
+/* Stop a logical timer. An ID which is invalid or has expired is ignored. */
+extern void TimerWheelDelete(timer_id tid);
+
+#endif /* __TIMER_WHEEL_H__ */
@@ -0,0 +1,307 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      trace.c
+ *
+ *  DESCRIPTION
+ *      This file defines the deferred binary trace. Writing formatted debug
+ *      output to the UART from inside the event handlers stalls them, so trace
+ *      events are instead recorded as an event ID and word arguments in a RAM
+ *      ring buffer. A drain timer formats the recorded events and writes them
+ *      to the UART a few at a time, outside the event handlers. When
+ *      the buffer is full new events are dropped and counted; recording never
+ *      waits for the UART.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <timer.h>          /* Chip timer functions */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"    /* User configuration */
+#include "trace.h"          /* Interface to this file */
+#include "debug_interface.h"/* Application debug routines */
+#include "timer_wheel.h"    /* Logical timers on one firmware timer */
+
+/* Only compile this file if debug output has been requested */
+#ifdef DEBUG_OUTPUT_ENABLED
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Size of the trace buffer, in words */
+#define TRACE_BUFFER_WORDS              (128)
+
+/* Maximum number of arguments of one trace event */
+#define TRACE_MAX_ARGS                  (8)
+
+/* Delay between the first trace event being recorded and the buffer being
+ * drained, and between successive drain steps
+ */
+#define TRACE_DRAIN_DELAY               (100 * MILLISECOND)
+
+/* Maximum number of trace events written to the UART in one drain step */
+#define TRACE_DRAIN_EVENTS              (4)
+
+/* Build and parse the header word of a recorded trace event */
+#define TRACE_HEADER(id, num_args)      (((id) << 8) | (num_args))
+#define TRACE_HEADER_ID(header)         ((header) >> 8)
+#define TRACE_HEADER_ARGS(header)       ((header) & 0xff)
+
+/*============================================================================*
+ *  Private Data types
+ *============================================================================*/
+
+/* Trace data structure */
+typedef struct _TRACE_DATA_T
+{
+    /* Ring buffer of recorded trace events. Each event is a header word
+     * holding the ID and number of arguments, followed by the arguments.
+     */
+    uint16                      buffer[TRACE_BUFFER_WORDS];
+
+    /* Index of the next word to write */
+    uint16                      head;
+
+    /* Index of the next word to drain */
+    uint16                      tail;
+
+    /* Number of words in use */
+    uint16                      used;
+
+    /* Number of trace events dropped since the last drain */
+    uint16                      dropped;
+
+    /* Timer ID for draining the buffer */
+    timer_id                    drain_tid;
+
+} TRACE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Trace data */
+static TRACE_DATA_T g_trace_data;
+
+/* Names of the trace events, indexed by trace_id */
+static const char *trace_name[trace_id_max] =
+{
+    "frame sent",
+    "frame received",
+    "frame decrypted",
+    "scan result"
+};
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+/* Handle the drain timer expiry */
+static void traceDrainTimerHandler(timer_id tid);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      tracePut
+ *
+ *  DESCRIPTION
+ *      This function adds a word to the trace buffer. The caller must have
+ *      checked that there is room for it.
+ *
+ *  PARAMETERS
+ *      word [in]               Word to add
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void tracePut(uint16 word)
+{
+    g_trace_data.buffer[g_trace_data.head] = word;
+
+    if(++g_trace_data.head == TRACE_BUFFER_WORDS)
+    {
+        g_trace_data.head = 0;
+    }
+    g_trace_data.used++;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      traceGet
+ *
+ *  DESCRIPTION
+ *      This function removes the oldest word from the trace buffer.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Oldest word in the trace buffer
+ *----------------------------------------------------------------------------*/
+static uint16 traceGet(void)
+{
+    const uint16 word = g_trace_data.buffer[g_trace_data.tail];
+
+    if(++g_trace_data.tail == TRACE_BUFFER_WORDS)
+    {
+        g_trace_data.tail = 0;
+    }
+    g_trace_data.used--;
+
+    return word;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      traceDrainTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function handles the expiry of the drain timer. A few trace events
+ *      are formatted and written to the UART, and the timer is restarted if
+ *      any remain. The number of dropped events is written once the buffer
+ *      has been emptied.
+ *
+ *  PARAMETERS
+ *      tid [in]                ID of timer that has expired
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void traceDrainTimerHandler(timer_id tid)
+{
+    uint16 events;                  /* Trace events written in this step */
+
+    if(tid != g_trace_data.drain_tid)
+    {
+        /* Ignore a timer that has been superseded */
+        return;
+    }
+
+    g_trace_data.drain_tid = TIMER_INVALID;
+
+    for(events = 0;
+        events < TRACE_DRAIN_EVENTS && g_trace_data.used != 0;
+        events++)
+    {
+        const uint16 header = traceGet();
+        const uint16 id = TRACE_HEADER_ID(header);
+        uint16 num_args = TRACE_HEADER_ARGS(header);
+
+        DebugIfWriteString((id < trace_id_max) ? trace_name[id] : "?");
+        DebugIfWriteString(":");
+
+        while(num_args-- != 0)
+        {
+            DebugIfWriteString(" ");
+            DebugIfWriteUint16(traceGet());
+        }
+
+        DebugIfWriteString("\r\n");
+    }
+
+    if(g_trace_data.used != 0)
+    {
+        g_trace_data.drain_tid = TimerWheelCreate(TRACE_DRAIN_DELAY,
+                                                  traceDrainTimerHandler);
+    }
+    else if(g_trace_data.dropped != 0)
+    {
+        DebugIfWriteString("trace dropped ");
+        DebugIfWriteUint16(g_trace_data.dropped);
+        DebugIfWriteString("\r\n");
+
+        g_trace_data.dropped = 0;
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TraceInit
+ *
+ *  DESCRIPTION
+ *      This function empties the trace buffer. It is called after the
+ *      application timers have been initialised, so no drain timer is running.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void TraceInit(void)
+{
+    g_trace_data.head = 0;
+    g_trace_data.tail = 0;
+    g_trace_data.used = 0;
+    g_trace_data.dropped = 0;
+    g_trace_data.drain_tid = TIMER_INVALID;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      TraceWrite
+ *
+ *  DESCRIPTION
+ *      This function records a trace event in the trace buffer. If the event
+ *      does not fit, it is dropped and counted. The event is written to the
+ *      UART later, from the drain timer.
+ *
+ *  PARAMETERS
+ *      id [in]                 Trace event ID
+ *      args [in]               Arguments of the event
+ *      num_args [in]           Number of arguments, up to TRACE_MAX_ARGS
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void TraceWrite(trace_id id, const uint16 *args, uint16 num_args)
+{
+    uint16 i;                       /* Loop counter */
+
+    if(num_args > TRACE_MAX_ARGS)
+    {
+        num_args = TRACE_MAX_ARGS;
+    }
+
+    if(g_trace_data.used + 1 + num_args > TRACE_BUFFER_WORDS)
+    {
+        /* No room; drop the event rather than wait for the UART */
+        g_trace_data.dropped++;
+        return;
+    }
+
+    tracePut(TRACE_HEADER(id, num_args));
+    for(i = 0; i < num_args; i++)
+    {
+        tracePut(args[i]);
+    }
+
+    /* The drain timer runs from the first event recorded until the buffer
+     * has been emptied
+     */
+    if(g_trace_data.drain_tid == TIMER_INVALID)
+    {
+        g_trace_data.drain_tid = TimerWheelCreate(TRACE_DRAIN_DELAY,
+                                                  traceDrainTimerHandler);
+    }
+}
+
+#endif /* DEBUG_OUTPUT_ENABLED */
@@ -0,0 +1,82 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      trace.h
+ *
+ *  DESCRIPTION
+ *      This file contains prototypes for the deferred binary trace, which
+ *      records trace events in RAM and writes them to the UART later.
+ *
+ *****************************************************************************/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "user_config.h"    /* User configuration */
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Trace event IDs. The names written to the UART for each ID are held in
+ * trace.c and must be kept in the same order.
+ */
+typedef enum
+{
+    /* Smart home frame encrypted for advertising. Args: frame words */
+    trace_frame_sent = 0,
+
+    /* Smart home frame received, before decryption. Args: frame words */
+    trace_frame_received,
+
+    /* Smart home frame received, after decryption. Args: frame words */
+    trace_frame_decrypted,
+
+    /* Smart home frame decoded. Args: address, group, data type, data words */
+    trace_scan_result,
+
+    /* Number of trace event IDs */
+    trace_id_max
+
+} trace_id;
+
+/* Only compile the trace if debug output has been requested */
+#ifdef DEBUG_OUTPUT_ENABLED
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Empty the trace buffer */
+extern void TraceInit(void);
+
+/* Record a trace event with up to TRACE_MAX_ARGS word arguments. The event is
+ * dropped if the trace buffer is full.
+ */
+extern void TraceWrite(trace_id id, const uint16 *args, uint16 num_args);
+
+#else /* DEBUG_OUTPUT_ENABLED */
+
+/* Define trace functions to expand to nothing as debug output is not
+ * enabled
+ */
+
+#define TraceInit()
+#define TraceWrite(id, args, num_args)
+
+#endif /* DEBUG_OUTPUT_ENABLED */
+
+#endif /* __TRACE_H__ */
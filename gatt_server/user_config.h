@@ -41,4 +41,16 @@
  */
 /*#define CONNECTED_IDLE_TIMEOUT_VALUE   (5 * MINUTE)*/
 
+/* The ENABLE_EVENT_PROFILING macro when defined makes the application count
+ * the LM events it handles and the time spent in each handler. The event rate
+ * and average handling cost are written to the UART on a short button press.
+ */
+/*#define ENABLE_EVENT_PROFILING*/
+
+/* The ENABLE_SMART_RELAY macro when defined makes the node relay received
+ * smart home messages addressed to other nodes, so that messages reach nodes
+ * more than one radio hop away. Only enable it on mains powered nodes.
+ */
+/*#define ENABLE_SMART_RELAY*/
+
 #endif /* __USER_CONFIG_H__ */
@@ -0,0 +1,284 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      work_queue.c
+ *
+ *  DESCRIPTION
+ *      This file defines the deferred work queue. Event handlers post work
+ *      which need not be done before they return, e.g. decrypting a received
+ *      frame or writing to NVM, so that the firmware gets its events back
+ *      quickly. The queue is drained from a timer, a few items at a time,
+ *      which only runs while work is queued.
+ *
+ *****************************************************************************/
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <timer.h>          /* Chip timer functions */
+#include <time.h>           /* Application interface to System Time */
+#include <mem.h>            /* Memory library */
+
+/*============================================================================*
+ *  Local Header Files
+ *============================================================================*/
+
+#include "work_queue.h"     /* Interface to this file */
+#include "timer_wheel.h"    /* Logical timers on one firmware timer */
+
+/*============================================================================*
+ *  Private Definitions
+ *============================================================================*/
+
+/* Number of work items run each time the drain timer expires, after which
+ * the firmware is given its events before the rest are run
+ */
+#define WORK_QUEUE_BATCH                (4)
+
+/*============================================================================*
+ *  Private Data types
+ *============================================================================*/
+
+/* Work item */
+typedef struct _WORK_ITEM_T
+{
+    /* Function which carries out the work */
+    work_handler                handler;
+
+    /* Time at which the work was posted */
+    uint32                      posted;
+
+    /* Number of words of payload */
+    uint16                      length;
+
+    /* Payload passed to the handler */
+    uint16                      payload[WORK_QUEUE_PAYLOAD_WORDS];
+
+} WORK_ITEM_T;
+
+/* Work queue data structure */
+typedef struct _WORK_QUEUE_DATA_T
+{
+    /* Queued work items */
+    WORK_ITEM_T                 item[WORK_QUEUE_SIZE];
+
+    /* Index of the oldest work item */
+    uint16                      head;
+
+    /* Number of work items queued */
+    uint16                      count;
+
+    /* Timer ID for draining the queue */
+    timer_id                    drain_tid;
+
+    /* Statistics */
+    WORK_QUEUE_STATS_T          stats;
+
+} WORK_QUEUE_DATA_T;
+
+/*============================================================================*
+ *  Private Data
+ *============================================================================*/
+
+/* Work queue data */
+static WORK_QUEUE_DATA_T g_work_queue;
+
+/*============================================================================*
+ *  Private Function Prototypes
+ *============================================================================*/
+
+/* Handle expiry of the drain timer */
+static void workQueueDrainTimerHandler(timer_id tid);
+
+/*============================================================================*
+ *  Private Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      workQueueDrainTimerHandler
+ *
+ *  DESCRIPTION
+ *      This function runs a batch of work items, oldest first. Each item is
+ *      removed from the queue before it is run, so the handler may post more
+ *      work. The timer is started again while work is left.
+ *
+ *  PARAMETERS
+ *      tid [in]                ID of timer that has expired
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+static void workQueueDrainTimerHandler(timer_id tid)
+{
+    WORK_ITEM_T item;               /* Work item being run */
+    uint32 latency;                 /* Time the item was queued for */
+    uint16 run;                     /* Work items run in this batch */
+
+    if(tid != g_work_queue.drain_tid)
+    {
+        /* Ignore a timer that has been superseded */
+        return;
+    }
+
+    g_work_queue.drain_tid = TIMER_INVALID;
+
+    for(run = 0; run < WORK_QUEUE_BATCH && g_work_queue.count != 0; run++)
+    {
+        item = g_work_queue.item[g_work_queue.head];
+
+        g_work_queue.head = (g_work_queue.head + 1) % WORK_QUEUE_SIZE;
+        g_work_queue.count--;
+
+        latency = TimeGet32() - item.posted;
+        g_work_queue.stats.run++;
+        g_work_queue.stats.total_latency += latency;
+        if(latency > g_work_queue.stats.max_latency)
+        {
+            g_work_queue.stats.max_latency = latency;
+        }
+
+        item.handler(item.payload, item.length);
+    }
+
+    if(g_work_queue.count != 0 && g_work_queue.drain_tid == TIMER_INVALID)
+    {
+        g_work_queue.drain_tid = TimerWheelCreate(0,
+                                                  workQueueDrainTimerHandler);
+    }
+}
+
+/*============================================================================*
+ *  Public Function Implementations
+ *============================================================================*/
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WorkQueueInit
+ *
+ *  DESCRIPTION
+ *      This function empties the work queue and clears its statistics. It is
+ *      called after the application timers have been initialised, so no
+ *      drain timer is running.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Nothing
+ *----------------------------------------------------------------------------*/
+extern void WorkQueueInit(void)
+{
+    MemSet(&g_work_queue, 0, sizeof(g_work_queue));
+
+    g_work_queue.drain_tid = TIMER_INVALID;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WorkQueuePost
+ *
+ *  DESCRIPTION
+ *      This function queues a work item and starts the drain timer if it is
+ *      not running. The payload is copied, so it need not outlive the call.
+ *      If the queue is full, the item is dropped and counted.
+ *
+ *  PARAMETERS
+ *      handler [in]            Function which carries out the work
+ *      p_payload [in]          Payload, may be NULL if length is 0
+ *      length [in]             Number of words of payload, up to
+ *                              WORK_QUEUE_PAYLOAD_WORDS
+ *
+ *  RETURNS
+ *      TRUE if the work item was queued, FALSE if the queue is full
+ *----------------------------------------------------------------------------*/
+extern bool WorkQueuePost(work_handler handler, const uint16 *p_payload,
+                          uint16 length)
+{
+    WORK_ITEM_T *p_item;            /* Queue slot */
+
+    g_work_queue.stats.posted++;
+
+    if(g_work_queue.count == WORK_QUEUE_SIZE ||
+       length > WORK_QUEUE_PAYLOAD_WORDS)
+    {
+        g_work_queue.stats.dropped++;
+        return FALSE;
+    }
+
+    p_item = &g_work_queue.item[(g_work_queue.head + g_work_queue.count) %
+                                WORK_QUEUE_SIZE];
+    p_item->handler = handler;
+    p_item->posted = TimeGet32();
+    p_item->length = length;
+    if(length != 0)
+    {
+        MemCopy(p_item->payload, p_payload, length);
+    }
+
+    if(++g_work_queue.count > g_work_queue.stats.max_depth)
+    {
+        g_work_queue.stats.max_depth = g_work_queue.count;
+    }
+
+    if(g_work_queue.drain_tid == TIMER_INVALID)
+    {
+        g_work_queue.drain_tid = TimerWheelCreate(0,
+                                                  workQueueDrainTimerHandler);
+    }
+
+    return TRUE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WorkQueueIsPending
+ *
+ *  DESCRIPTION
+ *      This function checks whether a work item with the handler is queued.
+ *      It lets work which only needs doing once, e.g. an NVM flush, be
+ *      posted once however many events ask for it.
+ *
+ *  PARAMETERS
+ *      handler [in]            Function which carries out the work
+ *
+ *  RETURNS
+ *      TRUE if such a work item is queued, FALSE otherwise
+ *----------------------------------------------------------------------------*/
+extern bool WorkQueueIsPending(work_handler handler)
+{
+    uint16 i;                       /* Loop counter */
+
+    for(i = 0; i < g_work_queue.count; i++)
+    {
+        if(g_work_queue.item[(g_work_queue.head + i) %
+                             WORK_QUEUE_SIZE].handler == handler)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------------*
+ *  NAME
+ *      WorkQueueGetStats
+ *
+ *  DESCRIPTION
+ *      This function returns the work queue statistics.
+ *
+ *  PARAMETERS
+ *      None
+ *
+ *  RETURNS
+ *      Work queue statistics
+ *----------------------------------------------------------------------------*/
+extern const WORK_QUEUE_STATS_T *WorkQueueGetStats(void)
+{
+    return &g_work_queue.stats;
+}
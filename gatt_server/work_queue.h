@@ -0,0 +1,83 @@
+/******************************************************************************
+ *  Copyright Cambridge Silicon Radio Limited 2013-2015
+ *  Part of CSR uEnergy SDK 2.4.5
+ *  Application version 2.4.5.0
+ *
+ *  FILE
+ *      work_queue.h
+ *
+ *  DESCRIPTION
+ *      This file contains prototypes for the deferred work queue, which runs
+ *      work posted from event handlers after the handlers have returned.
+ *
+ *****************************************************************************/
+
+#ifndef __WORK_QUEUE_H__
+#define __WORK_QUEUE_H__
+
+/*============================================================================*
+ *  SDK Header Files
+ *============================================================================*/
+
+#include <types.h>          /* Commonly used type definitions */
+
+/*============================================================================*
+ *  Public Definitions
+ *============================================================================*/
+
+/* Number of work items which can be queued */
+#define WORK_QUEUE_SIZE                 (8)
+
+/* Largest payload of a work item, in words. It holds a received smart home
+ * frame with its seed.
+ */
+#define WORK_QUEUE_PAYLOAD_WORDS        (9)
+
+/*============================================================================*
+ *  Public Data Types
+ *============================================================================*/
+
+/* Function which carries out a work item, given a copy of its payload */
+typedef void (*work_handler)(const uint16 *p_payload, uint16 length);
+
+/* Work queue statistics */
+typedef struct _WORK_QUEUE_STATS_T
+{
+    /* Work items posted */
+    uint32                      posted;
+
+    /* Work items dropped because the queue was full */
+    uint32                      dropped;
+
+    /* Work items run */
+    uint32                      run;
+
+    /* Total time from posting to running, in microseconds */
+    uint32                      total_latency;
+
+    /* Longest time from posting to running, in microseconds */
+    uint32                      max_latency;
+
+    /* Largest number of work items queued at once */
+    uint16                      max_depth;
+
+} WORK_QUEUE_STATS_T;
+
+/*============================================================================*
+ *  Public Function Prototypes
+ *============================================================================*/
+
+/* Empty the work queue */
+extern void WorkQueueInit(void);
+
+/* Queue a work item. Returns FALSE if the queue is full. */
+extern bool WorkQueuePost(work_handler handler, const uint16 *p_payload,
+                          uint16 length);
+
+/* Check whether a work item with the handler is queued */
+extern bool WorkQueueIsPending(work_handler handler);
+
+/* Return the work queue statistics */
+extern const WORK_QUEUE_STATS_T *WorkQueueGetStats(void);
+
+#endif /* __WORK_QUEUE_H__ */